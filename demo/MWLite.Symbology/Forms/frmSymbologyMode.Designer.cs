@@ -200,7 +200,7 @@ namespace MWLite.Symbology.Forms
             }
             else if ((Control)sender == (Control)chkSpatialIndex)
             {
-                s += "Spatial index: creates R-tree for faster search. Affects drawing and selection at close scales. Creates 2 files with .mwd and .mwx extentions in the shapefile folder. Isn't used for editing mode.";
+                s += "Spatial index: creates R-tree for faster search. Affects drawing and selection at close scales. Creates a file with .mwr extension in the shapefile folder. Isn't used for editing mode.";
             }
             else if ((Control)sender == (Control)udMinDrawingSize)
             {
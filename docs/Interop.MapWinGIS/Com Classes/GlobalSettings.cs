@@ -628,6 +628,31 @@ namespace MapWinGIS
         /// \new494 Added in version 4.9.4
         public bool CacheDbfRecords { get; set; }
 
+        /// <summary>
+        /// Gets or sets a value indicating whether the values of dbf fields are kept in memory,
+        /// one typed array per field. A field is loaded on the first access to it.
+        /// </summary>
+        /// <remarks>It takes much less memory than caching of individual records (see GlobalSettings.CacheDbfRecords)
+        /// and speeds up reading of cell values, statistics and classification for large tables.
+        /// Edited rows are still kept as separate records. Table.ClearCache releases the memory. Default is false.</remarks>
+        public bool CacheDbfColumns { get; set; }
+
+        /// <summary>
+        /// Gets or sets the amount of memory in MB each grid opened from disk can use to cache its blocks.
+        /// </summary>
+        /// <remarks>Applies to grids which aren't loaded in memory. Blocks of the raster are cached as they 
+        /// are read by Grid.Value and similar methods, the least recently used ones are released first. 
+        /// Changed values are written back when the block is released or the grid is saved. The setting
+        /// is applied when grid is opened. Default is 64.</remarks>
+        public int GridDiskCacheSize { get; set; }
+
+        /// <summary>
+        /// Gets or sets a value indicating whether table expressions are compiled before they are calculated.
+        /// </summary>
+        /// <remarks>Applies to Table.Query, Table.Calculate, categories and visibility expressions. When it's off
+        /// each row is evaluated by the interpreter, which gives the same results but is slower. Default is true.</remarks>
+        public bool CompileExpressions { get; set; }
+
         /// <summary>
         /// Gets or sets a value indicating whether caching of rendering data for shapes is on.
         /// </summary>
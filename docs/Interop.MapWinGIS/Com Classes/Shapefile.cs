@@ -1572,6 +1572,20 @@ namespace MapWinGIS
             throw new NotImplementedException();
         }
 
+        /// <summary>
+        /// Returns the indices of the polygons in which the points are located, -1 for the points outside the polygons.
+        /// </summary>
+        /// <remarks>Shapefile.BeginPointInShapefile must be called first. The results are the same as
+        /// those of Shapefile.PointInShapefile, but the points are processed by several threads.</remarks>
+        /// <param name="xCoordinates">The x coordinates of the points.</param>
+        /// <param name="yCoordinates">The y coordinates of the points, the number must be the same as for x coordinates.</param>
+        /// <param name="numThreads">The number of threads to use; 0 means the number of processors.</param>
+        /// <returns>The array with shape index for each point or null when the input arrays are invalid.</returns>
+        public int[] PointsInShapefile(double[] xCoordinates, double[] yCoordinates, int numThreads = 0)
+        {
+            throw new NotImplementedException();
+        }
+
         /// <summary>
         /// Gets or sets the value which indicates whether fast mode will be used for the shapefile. 
         /// </summary>
@@ -1974,7 +1988,7 @@ namespace MapWinGIS
         }
 
         /// <summary>
-        /// Removes spatial index associated with shapefile (.mwd and .mwx files).
+        /// Removes spatial index associated with shapefile (.mwr file, as well as .mwd and .mwx files created by older versions).
         /// </summary>
         /// <returns>True on success.</returns>
         /// \new493 Added in version 4.9.3
@@ -460,6 +460,27 @@ namespace MapWinGIS
             throw new NotImplementedException();
         }
 
+        /// <summary>
+        /// Caches tiles of the specified provider for several zoom levels within a polygon or along a polyline
+        /// to SQLite database for further offline use.
+        /// </summary>
+        /// <param name="area">Polygon or polyline in decimal degrees. To cache a corridor along a route, pass the buffer of the route.</param>
+        /// <param name="minZoom">Minimal zoom level.</param>
+        /// <param name="maxZoom">Maximum zoom level.</param>
+        /// <param name="providerId">Id of the provider.</param>
+        /// <param name="stop">StopExecution interface implementation to stop the operation prematurely.</param>
+        /// <param name="maxTileCount">Maximum number of tiles to download, 0 for no limit. Lower zoom levels are taken first.</param>
+        /// <param name="maxBytesPerSecond">Average download rate not to be exceeded, 0 for no limit.</param>
+        /// <param name="maxConcurrency">Maximum number of simultaneous requests, 0 to use the size of thread pool from global settings.</param>
+        /// <returns>The number of tiles scheduled for caching, or -1 if the parameters are invalid.</returns>
+        /// <remarks>Only the tiles which are missing in the cache are downloaded. The operation is executed asynchronously. 
+        /// See details in Tiles.Prefetch; the progress message includes the download rate.</remarks>
+        public int PrefetchArea(Shape area, int minZoom, int maxZoom, int providerId, IStopExecution stop, 
+            int maxTileCount = 0, int maxBytesPerSecond = 0, int maxConcurrency = 0)
+        {
+            throw new NotImplementedException();
+        }
+
         /// <summary>
         /// Gets or sets active provider to serve the tiles.
         /// </summary>
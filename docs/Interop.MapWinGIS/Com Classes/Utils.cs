@@ -934,6 +934,32 @@ namespace MapWinGIS
             throw new NotImplementedException();
         }
 
+        /// <summary>
+        /// Calculates hillshade, slope, aspect or curvature of elevation raster.
+        /// </summary>
+        /// <remarks>The raster is processed in stripes of blocks, the cells of each stripe are calculated 
+        /// using all available processors. Edge cells and cells with nodata among their 8 neighbours are set to nodata.
+        /// Hillshade is written as byte values with 0 as nodata (shaded cells are set to 0 as well), 
+        /// the other derivatives as floating point values with -9999 as nodata. Slope and aspect are in degrees, 
+        /// aspect is measured clockwise from north, -1 is written for flat cells.</remarks>
+        /// <param name="demFilename">The input elevation raster.</param>
+        /// <param name="bandIndex">Index of band with elevation, starting from 1.</param>
+        /// <param name="outputFilename">The output filename.</param>
+        /// <param name="derivative">The value to calculate.</param>
+        /// <param name="zFactor">Z factor. 1 if elevation and coordinates are in the same units.</param>
+        /// <param name="scale">Ratio of horizontal units to vertical ones, e.g. 111120 for degrees and elevation in meters.</param>
+        /// <param name="azimuth">Azimuth of the light source in degrees, for hillshade only.</param>
+        /// <param name="altitude">Altitude of the light source in degrees, for hillshade only.</param>
+        /// <param name="gdalOutputFormat">The name of GDAL driver to create output with, e.g. GTiff.</param>
+        /// <param name="cBack">Callback to report progress and errors.</param>
+        /// <returns>True on success.</returns>
+        /// \see GenerateHillShade
+        public bool GenerateTerrainDerivative(string demFilename, int bandIndex, string outputFilename, tkTerrainDerivative derivative,
+            double zFactor, double scale, double azimuth, double altitude, string gdalOutputFormat, ICallback cBack)
+        {
+            throw new NotImplementedException();
+        }
+
     }
 #if nsp
 }
@@ -1511,6 +1511,32 @@ namespace MapWinGIS
         gpfTiffProxy = 1,
     }
 
+    /// <summary>
+    /// Values which can be calculated by Utils.GenerateTerrainDerivative.
+    /// </summary>
+    public enum tkTerrainDerivative
+    {
+        /// <summary>
+        /// Shaded relief, 1-255
+        /// </summary>
+        tdHillshade = 0,
+
+        /// <summary>
+        /// Slope in degrees
+        /// </summary>
+        tdSlope = 1,
+
+        /// <summary>
+        /// Direction of slope in degrees clockwise from north
+        /// </summary>
+        tdAspect = 2,
+
+        /// <summary>
+        /// Curvature of surface, positive for convex and negative for concave surfaces
+        /// </summary>
+        tdCurvature = 3,
+    }
+
     /// <summary>
     /// Possible behaviours for displaying grid datasource. The behaviours will be used in AxMap.AddLayer and Grid.OpenAsImage methods.
     /// </summary>
@@ -1096,6 +1096,66 @@ STDMETHODIMP CGlobalSettings::put_CacheDbfRecords(VARIANT_BOOL newVal)
 	return S_OK;
 }
 
+// ***************************************************************
+//		CacheDbfColumns
+// ***************************************************************
+STDMETHODIMP CGlobalSettings::get_CacheDbfColumns(VARIANT_BOOL* pVal)
+{
+	AFX_MANAGE_STATE(AfxGetStaticModuleState());
+
+	*pVal = m_globalSettings.cacheDbfColumns ? VARIANT_TRUE : VARIANT_FALSE;
+
+	return S_OK;
+}
+STDMETHODIMP CGlobalSettings::put_CacheDbfColumns(VARIANT_BOOL newVal)
+{
+	AFX_MANAGE_STATE(AfxGetStaticModuleState());
+
+	m_globalSettings.cacheDbfColumns = newVal ? true : false;
+
+	return S_OK;
+}
+
+// ***************************************************************
+//		GridDiskCacheSize
+// ***************************************************************
+STDMETHODIMP CGlobalSettings::get_GridDiskCacheSize(int* pVal)
+{
+	AFX_MANAGE_STATE(AfxGetStaticModuleState());
+
+	*pVal = m_globalSettings.gridDiskCacheSize;
+
+	return S_OK;
+}
+STDMETHODIMP CGlobalSettings::put_GridDiskCacheSize(int newVal)
+{
+	AFX_MANAGE_STATE(AfxGetStaticModuleState());
+
+	m_globalSettings.gridDiskCacheSize = newVal > 0 ? newVal : 1;
+
+	return S_OK;
+}
+
+// ***************************************************************
+//		CompileExpressions
+// ***************************************************************
+STDMETHODIMP CGlobalSettings::get_CompileExpressions(VARIANT_BOOL* pVal)
+{
+	AFX_MANAGE_STATE(AfxGetStaticModuleState());
+
+	*pVal = m_globalSettings.compileExpressions ? VARIANT_TRUE : VARIANT_FALSE;
+
+	return S_OK;
+}
+STDMETHODIMP CGlobalSettings::put_CompileExpressions(VARIANT_BOOL newVal)
+{
+	AFX_MANAGE_STATE(AfxGetStaticModuleState());
+
+	m_globalSettings.compileExpressions = newVal ? true : false;
+
+	return S_OK;
+}
+
 // ***************************************************************
 //		CacheShapeRenderingData
 // ***************************************************************
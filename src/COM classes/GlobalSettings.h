@@ -228,6 +228,12 @@ public:
 	STDMETHOD(put_OgrInterpretYNStringAsBoolean)(VARIANT_BOOL newVal);
     STDMETHOD(get_AllowLayersWithIncompleteReprojection)(VARIANT_BOOL* pVal);
     STDMETHOD(put_AllowLayersWithIncompleteReprojection)(VARIANT_BOOL newVal);
+    STDMETHOD(get_CacheDbfColumns)(VARIANT_BOOL* pVal);
+    STDMETHOD(put_CacheDbfColumns)(VARIANT_BOOL newVal);
+    STDMETHOD(get_GridDiskCacheSize)(int* pVal);
+    STDMETHOD(put_GridDiskCacheSize)(int newVal);
+    STDMETHOD(get_CompileExpressions)(VARIANT_BOOL* pVal);
+    STDMETHOD(put_CompileExpressions)(VARIANT_BOOL newVal);
 };
 
 OBJECT_ENTRY_AUTO(__uuidof(GlobalSettings), CGlobalSettings)
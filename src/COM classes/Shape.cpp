@@ -35,6 +35,8 @@
 static char THIS_FILE[] = __FILE__;
 #endif
 
+volatile LONG CShape::_lastModificationStamp = 0;
+
 // **********************************************
 //		Constructor
 // **********************************************
@@ -49,6 +51,7 @@ CShape::CShape()
 	_isValidReason = "";
 	
 	_useFastMode = m_globalSettings.shapefileFastMode;
+	_modificationStamp = 0;
 
 	_shp = ShapeUtility::CreateEmptyWrapper(!_useFastMode);
 
@@ -2240,8 +2243,11 @@ void CShape::get_LabelPosition(tkLabelPositioning method, double& x, double& y,
 // ********************************************************************
 //		ClearLabelPositionCache()  
 // ********************************************************************
+// Called by all the methods which change the points, so the modification stamp is updated here as well.
 void CShape::ClearLabelPositionCache()
 {
+	_modificationStamp = InterlockedIncrement(&_lastModificationStamp);
+
 	if (labelPositioning == tkLabelPositioning::lpNone)
 		return;
 
@@ -167,6 +167,9 @@ private:
 
 	// forces to use fast shape wrapper class to hold points information
 	bool _useFastMode;							
+
+	long _modificationStamp;					// taken from the counter shared by all shapes when the points change
+	static volatile LONG _lastModificationStamp;
 	
 private:
 	void ClearLabelPositionCache();
@@ -183,6 +186,8 @@ public:
 	IShapeWrapper* get_ShapeWrapper() { return _shp; }
 	void put_FastMode(bool state);
 	bool get_fastMode() { return _useFastMode; }
+	long get_ModificationStamp() { return _modificationStamp; }
+	static long get_LastModificationStamp() { return _lastModificationStamp; }
 	void get_LabelPosition(tkLabelPositioning method, double& x, double& y, double& rotation, tkLineLabelOrientation orientation);
 	bool get_Z(long PointIndex, double* z);
 	bool get_M(long PointIndex, double* m);
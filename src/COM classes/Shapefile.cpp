@@ -78,15 +78,15 @@ CShapefile::CShapefile()
 
     _useSpatialIndex = TRUE;
     _hasSpatialIndex = FALSE;
-    _spatialIndexLoaded = FALSE;
     _spatialIndexMaxAreaPercent = 0.5;
-    _spatialIndexNodeCapacity = 100;
 
     //Neio 20090721
     _useQTree = FALSE;
     _cacheExtents = FALSE;
     _qtree = nullptr;
     _tempTree = nullptr;
+    _snappingIndex = nullptr;
+    _snappingStamp = 0;
 
     _shpfile = nullptr;
     _shxfile = nullptr;
@@ -585,6 +585,9 @@ STDMETHODIMP CShapefile::LoadDataFrom(BSTR ShapefileName, ICallback* cBack, VARI
         if (_shpfile != nullptr)
             fclose(_shpfile);
         _shpfile = nullptr;
+        _shpRecords.Close();
+        CloseMappedFiles();
+        _spatialIndex.Close();
 
         if (_shxfile != nullptr)
             fclose(_shxfile);
@@ -684,6 +687,9 @@ bool CShapefile::OpenCore(CStringW tmpShpfileName, ICallback* cBack)
                 {
                     _shapeData.push_back(new ShapeRecord());
                 }
+
+                // if it fails, records will be read through _shpfile under the lock
+                _shpRecords.Open(_shpfileName);
                 return true;
             }
         }
@@ -938,6 +944,7 @@ STDMETHODIMP CShapefile::Close(VARIANT_BOOL* retval)
     }
 
     ClearCachedGeometries();
+    ClearSnappingIndex();
 
     if (_isEditingShapes)
     {
@@ -965,8 +972,7 @@ STDMETHODIMP CShapefile::Close(VARIANT_BOOL* retval)
     }
     _shapeData.clear();
 
-    if (_spatialIndexLoaded)
-        IndexSearching::unloadSpatialIndex(_spatialIndexID);
+    _spatialIndex.Close();
 
     _sourceType = sstUninitialized;
     _shpfiletype = SHP_NULLSHAPE;
@@ -999,6 +1005,8 @@ STDMETHODIMP CShapefile::Close(VARIANT_BOOL* retval)
 
     if (_shpfile != nullptr) fclose(_shpfile);
     _shpfile = nullptr;
+    _shpRecords.Close();
+    CloseMappedFiles();
 
     if (_shxfile != nullptr) fclose(_shxfile);
     _shxfile = nullptr;
@@ -1249,6 +1257,9 @@ STDMETHODIMP CShapefile::SaveAs(BSTR ShapefileName, ICallback* cBack, VARIANT_BO
         // -----------------------------------------------
         // opening files
         // -----------------------------------------------
+        // the new files may replace the mapped ones
+        CloseMappedFiles();
+
         FILE* shpfile = _wfopen(newShpName, L"wb+");
         if (shpfile == nullptr)
         {
@@ -1306,6 +1317,9 @@ STDMETHODIMP CShapefile::SaveAs(BSTR ShapefileName, ICallback* cBack, VARIANT_BO
         _dbffileName = newDbfName;
         _prjfileName = newShpName.Left(newShpName.GetLength() - 3) + L"prj";
 
+        _shpRecords.Open(_shpfileName);
+        _spatialIndex.Close();
+
         _sourceType = sstDiskBased;
 
         // saving projection in new format
@@ -1367,6 +1381,10 @@ STDMETHODIMP CShapefile::Save(ICallback* cBack, VARIANT_BOOL* retval)
     VARIANT_BOOL res;
     RefreshExtents(&res);
 
+    // the index and the mapping are for the records which are about to be overwritten
+    _spatialIndex.Close();
+    CloseMappedFiles();
+
     // -------------------------------------------------
     //	Reopen the files in the write mode
     // -------------------------------------------------
@@ -1441,6 +1459,9 @@ STDMETHODIMP CShapefile::Save(ICallback* cBack, VARIANT_BOOL* retval)
             //Save the table file
             _table->Save(cBack, retval);
 
+            if (!_shpRecords.IsOpen())
+                _shpRecords.Open(_shpfileName);
+
             _sourceType = sstDiskBased;
 
             // saving projection in new format
@@ -1943,6 +1964,14 @@ STDMETHODIMP CShapefile::put_ShapeModified(long ShapeIndex, VARIANT_BOOL newVal)
     else
     {
         _shapeData[ShapeIndex]->modified(newVal != 0);
+
+        // shapes are marked as modified when they were moved or rotated in place
+        if (newVal && _snappingIndex)
+        {
+            CComPtr<IShape> shp = nullptr;
+            get_Shape(ShapeIndex, &shp);
+            _snappingIndex->UpdateShape(ShapeIndex, shp);
+        }
     }
 
     return S_OK;
@@ -3144,6 +3173,10 @@ void CShapefile::GetRelatedShapeCore(IShape* referenceShape, long referenceIndex
 
             if (geomBase)
             {
+                // the reference geometry is tested against all the candidates, so it's prepared once;
+                // there is no prepared version of equals
+                const GEOSPreparedGeometry* prepared = relation != srEquals ? GeosHelper::Prepare(geomBase) : nullptr;
+
                 for (size_t i = 0; i < shapes.size(); i++)
                 {
                     if (shapes[i] == referenceIndex)
@@ -3154,29 +3187,57 @@ void CShapefile::GetRelatedShapeCore(IShape* referenceShape, long referenceIndex
                     if (geom != nullptr)
                     {
                         char res = 0;
-                        switch (relation)
+                        if (prepared)
                         {
-                        case srContains: res = GeosHelper::Contains(geomBase, geom);
-                            break;
-                        case srCrosses: res = GeosHelper::Crosses(geomBase, geom);
-                            break;
-                        case srEquals: res = GeosHelper::Equals(geomBase, geom);
-                            break;
-                        case srIntersects: res = GeosHelper::Intersects(geomBase, geom);
-                            break;
-                        case srOverlaps: res = GeosHelper::Overlaps(geomBase, geom);
-                            break;
-                        case srTouches: res = GeosHelper::Touches(geomBase, geom);
-                            break;
-                        case srWithin: res = GeosHelper::Within(geomBase, geom);
-                            break;
-                        case srCovers: res = GeosHelper::Covers(geomBase, geom);
-                            break;
-                        case srCoveredBy: res = GeosHelper::CoveredBy(geomBase, geom);
-                            break;
-                        default:
-                        case srDisjoint: res = GeosHelper::Disjoint(geomBase, geom);
-                            break;
+                            switch (relation)
+                            {
+                            case srContains: res = GeosHelper::PreparedContains(prepared, geom);
+                                break;
+                            case srCrosses: res = GeosHelper::PreparedCrosses(prepared, geom);
+                                break;
+                            case srIntersects: res = GeosHelper::PreparedIntersects(prepared, geom);
+                                break;
+                            case srOverlaps: res = GeosHelper::PreparedOverlaps(prepared, geom);
+                                break;
+                            case srTouches: res = GeosHelper::PreparedTouches(prepared, geom);
+                                break;
+                            case srWithin: res = GeosHelper::PreparedWithin(prepared, geom);
+                                break;
+                            case srCovers: res = GeosHelper::PreparedCovers(prepared, geom);
+                                break;
+                            case srCoveredBy: res = GeosHelper::PreparedCoveredBy(prepared, geom);
+                                break;
+                            default:
+                            case srDisjoint: res = GeosHelper::PreparedDisjoint(prepared, geom);
+                                break;
+                            }
+                        }
+                        else
+                        {
+                            switch (relation)
+                            {
+                            case srContains: res = GeosHelper::Contains(geomBase, geom);
+                                break;
+                            case srCrosses: res = GeosHelper::Crosses(geomBase, geom);
+                                break;
+                            case srEquals: res = GeosHelper::Equals(geomBase, geom);
+                                break;
+                            case srIntersects: res = GeosHelper::Intersects(geomBase, geom);
+                                break;
+                            case srOverlaps: res = GeosHelper::Overlaps(geomBase, geom);
+                                break;
+                            case srTouches: res = GeosHelper::Touches(geomBase, geom);
+                                break;
+                            case srWithin: res = GeosHelper::Within(geomBase, geom);
+                                break;
+                            case srCovers: res = GeosHelper::Covers(geomBase, geom);
+                                break;
+                            case srCoveredBy: res = GeosHelper::CoveredBy(geomBase, geom);
+                                break;
+                            default:
+                            case srDisjoint: res = GeosHelper::Disjoint(geomBase, geom);
+                                break;
+                            }
                         }
                         if (res)
                         {
@@ -3185,6 +3246,9 @@ void CShapefile::GetRelatedShapeCore(IShape* referenceShape, long referenceIndex
                     }
                 }
 
+                if (prepared)
+                    GeosHelper::DestroyPrepared(prepared);
+
                 if (referenceIndex == -1)
                     GeosHelper::DestroyGeometry(geomBase);
                 // the geometry was created in this function so it must be destroyed
@@ -3262,26 +3326,15 @@ STDMETHODIMP CShapefile::GetClosestVertex(double x, double y, double maxDistance
     *shapeIndex = -1;
     *pointIndex = -1;
 
-    bool result = false;
+    // search through all shapefile
     if (maxDistance <= 0.0)
-    {
-        // search through all shapefile
-        std::vector<long> ids;
-        for (size_t i = 0; i < _shapeData.size(); i++)
-        {
-            ids.push_back(i);
-        }
-        result = ShapefileHelper::GetClosestPoint(this, x, y, maxDistance, ids, shapeIndex, pointIndex, *distance);
-    }
-    else
-    {
-        std::vector<long> ids;
-        Extent box(x - maxDistance, x + maxDistance, y - maxDistance, y + maxDistance);
-        if (this->SelectShapesCore(box, 0.0, SelectMode::INTERSECTION, ids, false))
-        {
-            result = ShapefileHelper::GetClosestPoint(this, x, y, maxDistance, ids, shapeIndex, pointIndex, *distance);
-        }
-    }
+        maxDistance = DBL_MAX;
+
+    std::map<long, bool> visibility;
+    auto visible = [&](long index) { return IsShapeVisibleCached(index, visibility); };
+
+    bool result = GetSnappingIndex()->FindClosestVertex(x, y, maxDistance, visible, *shapeIndex, *pointIndex, *distance);
+
     *retVal = result ? VARIANT_TRUE : VARIANT_FALSE;
     return S_OK;
 }
@@ -3297,30 +3350,35 @@ STDMETHODIMP CShapefile::GetClosestSnapPosition(double x, double y, double maxDi
 	*retVal = VARIANT_FALSE;
 	*shapeIndex = -1;
 
-	bool result = false;
+	// search through all shapefile
 	if (maxDistance <= 0.0)
-	{
-		// search through all shapefile
-		std::vector<long> ids;
-		for (size_t i = 0; i < _shapeData.size(); i++)
-		{
-			ids.push_back(i);
-		}
-		result = ShapefileHelper::GetClosestSnapPosition(this, x, y, maxDistance, ids, shapeIndex, *fx, *fy, *distance);
-	}
-	else
-	{
-		std::vector<long> ids;
-		Extent box(x - maxDistance, x + maxDistance, y - maxDistance, y + maxDistance);
-		if (this->SelectShapesCore(box, 0.0, SelectMode::INTERSECTION, ids, false))
-		{
-			result = ShapefileHelper::GetClosestSnapPosition(this, x, y, maxDistance, ids, shapeIndex, *fx, *fy, *distance);
-		}
-	}
+		maxDistance = DBL_MAX;
+
+	std::map<long, bool> visibility;
+	auto visible = [&](long index) { return IsShapeVisibleCached(index, visibility); };
+
+	bool result = GetSnappingIndex()->FindClosestPoint(x, y, maxDistance, visible, *shapeIndex, *fx, *fy, *distance);
+
 	*retVal = result ? VARIANT_TRUE : VARIANT_FALSE;
 	return S_OK;
 }
 
+// *****************************************************************
+//		IsShapeVisibleCached()
+// *****************************************************************
+// Snapping queries test the same shape for each of its vertices or segments.
+bool CShapefile::IsShapeVisibleCached(long shapeIndex, std::map<long, bool>& cache)
+{
+	std::map<long, bool>::iterator it = cache.find(shapeIndex);
+	if (it != cache.end())
+		return it->second;
+
+	VARIANT_BOOL visible;
+	get_ShapeVisible(shapeIndex, &visible);
+	cache[shapeIndex] = visible != VARIANT_FALSE;
+	return visible != VARIANT_FALSE;
+}
+
 // *****************************************************************
 //		HasInvalidShapes()
 // *****************************************************************
@@ -3442,6 +3500,7 @@ STDMETHODIMP CShapefile::Move(DOUBLE xProjOffset, DOUBLE yProjOffset, VARIANT_BO
             shp->Move(xProjOffset, yProjOffset);
         }
     }
+    ClearSnappingIndex();
     *retVal = VARIANT_TRUE;
     return S_OK;
 }
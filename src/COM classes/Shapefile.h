@@ -18,11 +18,15 @@
 
 #pragma once
 #include <set>
-#include "IndexSearching.h"
+#include "HilbertRTree.h"
 #include "QTree.h"
 #include "ClipperConverter.h"
 #include "ShapeRecord.h"
 #include "ColoringGraph.h"
+#include "PositionalFile.h"
+#include "MappedFile.h"
+#include "PointInShapefileIndex.h"
+#include "SnappingIndex.h"
 #include <afxmt.h>
 
 //Shapefile File Info
@@ -262,6 +266,7 @@ public:
     STDMETHOD(put_Selectable)(VARIANT_BOOL newVal);
     STDMETHOD(get_HasOgrFidMapping)(VARIANT_BOOL* pVal);
     STDMETHOD(OgrFid2ShapeIndex)(long OgrFid, LONG* retVal);
+    STDMETHOD(PointsInShapefile)(SAFEARRAY* xCoordinates, SAFEARRAY* yCoordinates, LONG numThreads, SAFEARRAY** retVal);
 private:
 
 	// data for point in shapefile test
@@ -272,17 +277,11 @@ private:
 		int NumParts;
 		int NumPoints;
 	};
-	struct PolygonShapefile
-	{
-		ShapeHeader shpHeader;
-		std::vector<Point2D> Points;
-		std::vector<int> Parts;
-	};
 
 private:
 	::CCriticalSection _readLock;
 
-	std::vector<PolygonShapefile> _polySf;
+	CPointInShapefileIndex _pointInShapefileIndex;
 	
 	tkShapefileSourceType _sourceType;		// is it disk-based or in-memory?
 	ShpfileType _shpfiletype;
@@ -302,6 +301,9 @@ private:
 	//Disk access
 	FILE * _shpfile;
 	FILE * _shxfile;
+	CPositionalFile _shpRecords;	// lock-free reading of shape records, may be used by several threads
+	CMappedFile _shpMapping;		// .shp and .shx mapped for drawing; opened on the first use
+	CMappedFile _shxMapping;		// and closed before the files are rewritten
 
 	CStringW _shpfileName;
 	CStringW _shxfileName;
@@ -359,10 +361,8 @@ private:
 	//Flags for Spatial Indexing
 	BOOL _useSpatialIndex;
 	BOOL _hasSpatialIndex;
-	IndexSearching::CSpatialIndexID _spatialIndexID;
-	BOOL _spatialIndexLoaded;	
+	CHilbertRTree _spatialIndex;		// memory-mapped .mwr file, opened on the first query
 	DOUBLE _spatialIndexMaxAreaPercent;
-	int _spatialIndexNodeCapacity;
 	
 	// drawing options
 	tkSelectionAppearance _selectionAppearance;
@@ -374,7 +374,11 @@ private:
 	vector<int> _deleteElement;
 	
 	// during processing operations only
-	QTree* _tempTree;
+	CPackedRTree* _tempTree;
+
+	// vertices and segments for GetClosestVertex / GetClosestSnapPosition, built on the first query
+	SnappingIndex* _snappingIndex;
+	long _snappingStamp;		// the last CShape modification stamp when the index was checked
 	
 	BSTR _sortField;
 	VARIANT_BOOL _sortAscending;
@@ -406,11 +410,18 @@ private:
     QTree* GenerateEmptyQTree(double* xMin, double* xMax, double* yMin, double* yMax, double* zMin, double* zMax);
     void ClearQTree(double* xMin, double* xMax, double* yMin, double* yMax, double* zMin, double* zMax);
 	void GenerateQTree();
+	void QuickQueryInEditModeCore(const QTreeExtent& query, vector<int>& result);
 
-    // temp quad tree
+    // temp tree for geoprocessing; static, so it's bulk loaded rather than built by insertion
+	CPackedRTree* GeneratePackedTree(bool SelectedOnly);
 	bool GenerateTempQTree(bool SelectedOnly);
 	void ClearTempQTree();
-	QTree* GetTempQTree();
+	CPackedRTree* GetTempQTree();
+
+	// snapping
+	SnappingIndex* GetSnappingIndex();
+	void ClearSnappingIndex();
+	bool IsShapeVisibleCached(long shapeIndex, std::map<long, bool>& cache);
 
 	// geoprocessing
 	void DoClipOperation(VARIANT_BOOL SelectedOnlySubject, IShapefile* sfOverlay, VARIANT_BOOL SelectedOnlyOverlay, IShapefile** retval, tkClipOperation operation, ShpfileType returnType = SHP_NULLSHAPE);
@@ -430,7 +441,11 @@ private:
 	void GetRelatedShapeCore(IShape* referenceShape, long referenceIndex, tkSpatialRelation relation, VARIANT* resultArray, VARIANT_BOOL* retval);
 	void ReleaseRenderingCache();
 	bool ReadShapeExtents(long ShapeIndex, Extent& result);
+	bool ReadShpBytes(__int64 offset, void* buffer, int length);
+	int ReadShapeRecordLength(long ShapeIndex);
+	char* ReadShapeRecord(long ShapeIndex, int& contentLength);
 	IShape* ReadComShape(long ShapeIndex);
+	IShape* CreateComShape(char* data, int contentLength);
 	IShape* ReadFastModeShape(long ShapeIndex);
 	int GetWriteFileLength();
 	bool WriteAppendedShape();
@@ -438,8 +453,10 @@ private:
 	bool AppendToShpFile(FILE* shp, IShapeWrapper* wrapper);
 	void WriteBounds(FILE* shp);
 	bool ReopenFiles(bool writeMode);
+	void CloseMappedFiles();
     // read only those geometries requested by the specified array
     void ReadGeosGeometries(std::set<int> list);
+    void ConvertGeosGeometries(const vector<int>& indices, bool displayProgress);
     bool IsShapeCompatible(IShape* shape);
 
 public:
@@ -448,6 +465,7 @@ public:
 	HRESULT GetValidatedShape(int shapeIndex, IShape** retVal);
 	void ReadGeosGeometries(VARIANT_BOOL selectedOnly);
 	GEOSGeometry* GetGeosGeometry(int shapeIndex);
+	void CacheGeosEnvelopes(VARIANT_BOOL selectedOnly);
 
 	// geoprocessing
 	Coloring::ColorGraph* GeneratePolygonColors();
@@ -464,6 +482,7 @@ public:
 	void put_ShapeRenderingData(int ShapeIndex, CShapeData* data);
 	FILE* get_File(){ return _shpfile; }
 	::CCriticalSection* get_ReadLock(){ return &_readLock; }
+	bool get_MappedFiles(CMappedFile*& shp, CMappedFile*& shx);
 	
 	// serialization
 	bool DeserializeCore(VARIANT_BOOL LoadSelection, CPLXMLNode* node);
@@ -478,6 +497,10 @@ public:
 	bool QuickExtentsCore(long ShapeIndex, Extent& result);
 	bool QuickExtentsCore(long ShapeIndex, double* xMin, double* yMin, double* xMax, double* yMax);
 
+	// spatial index
+	bool LoadSpatialIndex();
+	CHilbertRTree* get_SpatialIndex() { return _spatialIndex.IsOpen() ? &_spatialIndex : NULL; }
+
 	// editing
 	bool OpenCore(CStringW tmp_shpfileName, ICallback* cBack);
 	HRESULT CreateNewCore(BSTR ShapefileName, ShpfileType ShapefileType, bool applyRandomOptions, VARIANT_BOOL *retval);
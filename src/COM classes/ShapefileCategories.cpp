@@ -32,6 +32,12 @@
 #include "Shapefile.h"
 #include "TableClass.h"
 #include "TableHelper.h"
+#include "ParallelHelper.h"
+#include <algorithm>
+#include <unordered_map>
+
+// rows are read in batches of this size, and each batch is classified in the threads of pool
+#define CATEGORIES_BATCH_SIZE 65536
 
 //***********************************************************************/
 //*			get_Count()
@@ -520,14 +526,13 @@ void CShapefileCategories::ApplyExpressionCore(long CategoryIndex, long startRow
     rotations.resize(_categories.size() + 1);
 
 	bool uniqueValues = true;
+	bool rangeValues = true;
 	for (auto& _categorie : _categories)
 	{
 		tkCategoryValue value;
 	    _categorie->get_ValueType(&value);
-		if (value != cvSingleValue) {
-			uniqueValues = false;
-			break;
-		}
+		uniqueValues &= value == cvSingleValue;
+		rangeValues &= value == cvRange;
 	}
 
     bool allCategories = CategoryIndex == -1;
@@ -536,38 +541,50 @@ void CShapefileCategories::ApplyExpressionCore(long CategoryIndex, long startRow
 	// we got unique values classification and want to process it fast
 	// ----------------------------------------------------------------
 	bool parsingIsNeeded = true;	
+	CTableClass* table = TableHelper::Cast(tbl);
+
+	if (_classificationField != -1 && rangeValues && !_categories.empty())
+	{
+		// breaks are searched instead of parsing the expressions
+		parsingIsNeeded = !ClassifyRanges(table, CategoryIndex, startRowIndex, results);
+	}
+
 	if (_classificationField != -1 && uniqueValues)
 	{
 		parsingIsNeeded = false;	// in case there are unique values only we don't need any parsing
-			
-		std::map<CComVariant, long> myMap;				// variant value as key and number of category as result
-		for (unsigned int i = 0; i < _categories.size(); i++)
-		{
-            if (!allCategories && i != CategoryIndex)
-                continue;
 
-			CComVariant val;
-			_categories[i]->get_MinValue(&val);
-			if (val.vt != VT_EMPTY)
+		// values which don't fit the type of field are compared as variants
+		if (!ClassifyUniqueValues(table, CategoryIndex, startRowIndex, results))
+		{
+			std::map<CComVariant, long> myMap;				// variant value as key and number of category as result
+			for (unsigned int i = 0; i < _categories.size(); i++)
 			{
-				CComVariant val2;
-				VariantCopy(&val2, &val);
-				myMap[val2] = i;
+				if (!allCategories && i != CategoryIndex)
+					continue;
+
+				CComVariant val;
+				_categories[i]->get_MinValue(&val);
+				if (val.vt != VT_EMPTY)
+				{
+					CComVariant val2;
+					VariantCopy(&val2, &val);
+					myMap[val2] = i;
+				}
 			}
-		}
 		
-		// applying categories to shapes
-		VARIANT val;
-		VariantInit(&val);
-		for (long i = startRowIndex; i <= endRowIndex; i++)
-		{
-			tbl->get_CellValue(_classificationField, i, &val);
-			if (myMap.find(val) != myMap.end())
+			// applying categories to shapes
+			VARIANT val;
+			VariantInit(&val);
+			for (long i = startRowIndex; i <= endRowIndex; i++)
 			{
-				results[i] = myMap[val];	// writing the index of category
+				tbl->get_CellValue(_classificationField, i, &val);
+				if (myMap.find(val) != myMap.end())
+				{
+					results[i - startRowIndex] = myMap[val];	// writing the index of category
+				}
 			}
+			VariantClear(&val);
 		}
-		VariantClear(&val);
 	}
 		
 	// -------------------------------------------------------------
@@ -610,7 +627,7 @@ void CShapefileCategories::ApplyExpressionCore(long CategoryIndex, long startRow
 
     // adding category indices for shapes in the results vector
     if (parsingIsNeeded)
-	    TableHelper::Cast(tbl)->AnalyzeExpressions(
+	    table->AnalyzeExpressions(
 			expressions, results, startRowIndex, endRowIndex);
 
     // -------------------------------------------------------------
@@ -628,6 +645,212 @@ void CShapefileCategories::ApplyExpressionCore(long CategoryIndex, long startRow
     }
 }
 
+// *******************************************************************
+//		ClassifyColumn()
+// *******************************************************************
+// The field is read in this thread batch by batch; classify(column, index) gives 
+// the category of a value or -1, and is called from the threads of pool.
+// Nulls take the value of the previous row (0.0 at the start), as they do in expressions.
+template <typename Classify>
+void CShapefileCategories::ClassifyColumn(CTableClass* table, long fieldIndex, long startRowIndex, std::vector<int>& results, Classify& classify)
+{
+	const long numRows = (long)results.size();
+	ExpressionColumn column;
+
+	unsigned char lastKind = ExpressionColumn::vkDouble;
+	double lastDouble = 0.0;
+	CStringW lastString;
+
+	for (long first = 0; first < numRows; first += CATEGORIES_BATCH_SIZE)
+	{
+		const long count = MIN(CATEGORIES_BATCH_SIZE, numRows - first);
+		table->ReadExpressionColumn(fieldIndex, startRowIndex + first, count, column);
+
+		for (long i = 0; i < count; i++)
+		{
+			switch (column.kinds[i])
+			{
+				case ExpressionColumn::vkDouble:
+					lastKind = ExpressionColumn::vkDouble;
+					lastDouble = column.doubles[i];
+					break;
+				case ExpressionColumn::vkString:
+					lastKind = ExpressionColumn::vkString;
+					lastString = column.strings[i];
+					break;
+				default:
+					if (lastKind == ExpressionColumn::vkString)
+						column.SetString(i, lastString);
+					else
+						column.SetDouble(i, lastDouble);
+					break;
+			}
+		}
+
+		auto process = [&](int begin, int end)
+		{
+			for (int i = begin; i < end; i++)
+			{
+				results[first + i] = classify(column, i);
+			}
+		};
+
+		ParallelHelper::For(count, 0, process, 4096);
+	}
+}
+
+// *******************************************************************
+//		GetClassificationFieldType()
+// *******************************************************************
+// Only numbers and strings are read by ReadExpressionColumn.
+static bool GetClassificationFieldType(CTableClass* table, long fieldIndex, FieldType& type)
+{
+	long numFields = 0;
+	table->get_NumFields(&numFields);
+	if (fieldIndex < 0 || fieldIndex >= numFields)
+		return false;
+
+	CComPtr<IField> field = nullptr;
+	table->get_Field(fieldIndex, &field);
+	if (!field)
+		return false;
+
+	field->get_Type(&type);
+	return type == STRING_FIELD || type == INTEGER_FIELD || type == DOUBLE_FIELD;
+}
+
+// *******************************************************************
+//		ClassifyUniqueValues()
+// *******************************************************************
+// Values of categories are hashed by their type; the same value in several categories 
+// is given to the last one, as std::map did. Returns false if the values don't fit 
+// the type of field, so that the values are compared as variants.
+bool CShapefileCategories::ClassifyUniqueValues(CTableClass* table, long categoryIndex, long startRowIndex, std::vector<int>& results)
+{
+	FieldType type;
+	if (!GetClassificationFieldType(table, _classificationField, type))
+		return false;
+
+	struct StringHasher
+	{
+		size_t operator()(const CStringW& s) const
+		{
+			size_t hash = 2166136261U;		// FNV-1a
+			for (int i = 0; i < s.GetLength(); i++)
+			{
+				hash = (hash ^ (size_t)s[i]) * 16777619U;
+			}
+			return hash;
+		}
+	};
+
+	std::unordered_map<double, int> numbers;
+	std::unordered_map<CStringW, int, StringHasher> strings;
+
+	for (int i = 0; i < (int)_categories.size(); i++)
+	{
+		if (categoryIndex != -1 && i != categoryIndex)
+			continue;
+
+		CComVariant val;
+		_categories[i]->get_MinValue(&val);
+		if (val.vt == VT_EMPTY)
+			continue;
+
+		if (type == STRING_FIELD)
+		{
+			if (val.vt != VT_BSTR)
+				return false;
+			strings[CStringW(val.bstrVal)] = i;
+		}
+		else
+		{
+			if (val.vt == VT_BSTR || FAILED(val.ChangeType(VT_R8)))
+				return false;
+			numbers[val.dblVal] = i;
+		}
+	}
+
+	auto classify = [&](ExpressionColumn& column, int index) -> int
+	{
+		if (column.kinds[index] == ExpressionColumn::vkDouble)
+		{
+			auto it = numbers.find(column.doubles[index]);
+			return it != numbers.end() ? it->second : -1;
+		}
+
+		if (column.kinds[index] == ExpressionColumn::vkString)
+		{
+			auto it = strings.find(column.strings[index]);
+			return it != strings.end() ? it->second : -1;
+		}
+
+		return -1;
+	};
+
+	ClassifyColumn(table, _classificationField, startRowIndex, results, classify);
+	return true;
+}
+
+// *******************************************************************
+//		ClassifyRanges()
+// *******************************************************************
+// Ranges as Generate creates them: ascending and not overlapping, [min, max) with the last 
+// one [min, max]. The bounds are rounded the same way as in their expressions, so the
+// results are the same as with parsing. Returns false for other sets of ranges.
+bool CShapefileCategories::ClassifyRanges(CTableClass* table, long categoryIndex, long startRowIndex, std::vector<int>& results)
+{
+	FieldType type;
+	if (!GetClassificationFieldType(table, _classificationField, type) || type == STRING_FIELD)
+		return false;
+
+	const int numCategories = (int)_categories.size();
+	std::vector<double> mins(numCategories);
+	std::vector<double> maxs(numCategories);
+
+	for (int i = 0; i < numCategories; i++)
+	{
+		CComVariant vMin, vMax;
+		_categories[i]->get_MinValue(&vMin);
+		_categories[i]->get_MaxValue(&vMax);
+
+		if ((vMin.vt != VT_R8 && vMin.vt != VT_I4) || (vMax.vt != VT_R8 && vMax.vt != VT_I4))
+			return false;
+
+		// generated expressions have the bounds formatted with %f
+		CString s;
+		s.Format("%f", vMin.vt == VT_R8 ? vMin.dblVal : (double)vMin.lVal);
+		mins[i] = vMin.vt == VT_R8 ? atof(s) : (double)vMin.lVal;
+		s.Format("%f", vMax.vt == VT_R8 ? vMax.dblVal : (double)vMax.lVal);
+		maxs[i] = vMax.vt == VT_R8 ? atof(s) : (double)vMax.lVal;
+
+		if (mins[i] > maxs[i] || (i > 0 && mins[i] < maxs[i - 1]))
+			return false;
+	}
+
+	auto classify = [&](ExpressionColumn& column, int index) -> int
+	{
+		if (column.kinds[index] != ExpressionColumn::vkDouble)
+			return -1;
+
+		const double value = column.doubles[index];
+
+		// the last range which starts at or before the value
+		const int i = (int)(std::upper_bound(mins.begin(), mins.end(), value) - mins.begin()) - 1;
+		if (i < 0)
+			return -1;
+
+		const bool within = value < maxs[i] || (i == numCategories - 1 && value == maxs[i]);
+		if (!within || (categoryIndex != -1 && i != categoryIndex))
+			return -1;
+
+		return i;
+	};
+
+	ClassifyColumn(table, _classificationField, startRowIndex, results, classify);
+	return true;
+}
+
 void CShapefileCategories::CalculateRotations(
 	CComPtr<IShapeDrawingOptions>& options, CComPtr<ITable>& tbl, 
 	std::vector<double>& rotations, int startIndex, int endIndex)
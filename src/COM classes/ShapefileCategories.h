@@ -27,6 +27,8 @@
 #pragma once
 #include "ShapefileCategory.h"
 
+class CTableClass;
+
 #if defined(_WIN32_WCE) && !defined(_CE_DCOM) && !defined(_CE_ALLOW_SINGLE_THREADED_OBJECTS_IN_MTA)
 #error "Single-threaded COM objects are not properly supported on Windows CE platform, such as the Windows Mobile platforms that do not include full DCOM support. Define _CE_ALLOW_SINGLE_THREADED_OBJECTS_IN_MTA to force ATL to support creating single-thread COM object's and allow use of it's single-threaded COM object implementations. The threading model in your rgs file was set to 'Free' as that is the only threading model supported in non DCOM Windows CE platforms."
 #endif
@@ -160,6 +162,10 @@ private:
 		std::vector<double>& rotations, int startIndex = -1, int endIndex = -1);
 	bool get_AreaValues(std::vector<double>* values);
 	bool get_LengthValues(std::vector<double>* values);
+	bool ClassifyUniqueValues(CTableClass* table, long categoryIndex, long startRowIndex, std::vector<int>& results);
+	bool ClassifyRanges(CTableClass* table, long categoryIndex, long startRowIndex, std::vector<int>& results);
+	template <typename Classify>
+	void ClassifyColumn(CTableClass* table, long fieldIndex, long startRowIndex, std::vector<int>& results, Classify& classify);
 	
 public:	
 	bool DeserializeCore(CPLXMLNode* node, bool applyExpressions);
@@ -109,6 +109,10 @@ STDMETHODIMP CShapefile::StartEditingShapes(VARIANT_BOOL StartEditTable, ICallba
 	// it's used in the disk based mode only
 	ReleaseRenderingCache();
 
+	// the index and the mapping are no longer used in edit mode, and the files are rewritten when it ends
+	_spatialIndex.Close();
+	CloseMappedFiles();
+
 	// ------------------------------------------
 	// reading table into memory
 	// ------------------------------------------
@@ -248,6 +252,9 @@ STDMETHODIMP CShapefile::StopEditingShapes(VARIANT_BOOL ApplyChanges, VARIANT_BO
 					ReleaseMemoryShapes();
 					*retval = VARIANT_TRUE;
 
+					if (!_shpRecords.IsOpen())
+						_shpRecords.Open(_shpfileName);
+
 					if(StopEditTable != VARIANT_FALSE)
 						StopEditingTable(ApplyChanges,cBack,retval);
 
@@ -272,6 +279,7 @@ STDMETHODIMP CShapefile::StopEditingShapes(VARIANT_BOOL ApplyChanges, VARIANT_BO
 		// discard the changes
 		_isEditingShapes = FALSE;
 		ReleaseMemoryShapes();
+		_spatialIndex.Close();	// reopened and validated on the next query
 
 		// reload the shx file
 		this->ReadShx();
@@ -393,6 +401,11 @@ void CShapefile::RegisterNewShape(IShape* Shape, long ShapeIndex)
 
 	_sortingChanged = true;
 
+	if (_snappingIndex)
+	{
+		_snappingIndex->InsertShape(ShapeIndex, Shape);
+	}
+
 	// extending the bounds of the shapefile we don't care if the bounds became less
 	// it's necessary to call RefreshExtents in this case, for zoom to layer working right
 	if (!ShapeHelper::IsEmpty(Shape))
@@ -528,6 +541,11 @@ void CShapefile::ReregisterShape(int shapeIndex)
 		if (zM > _maxZ) _maxZ = zM;
 	}
 
+	if (_snappingIndex)
+	{
+		_snappingIndex->UpdateShape(shapeIndex, shp);
+	}
+
 	if(_useQTree)
 	{
 		_qtree->RemoveNode(shapeIndex);
@@ -649,8 +667,9 @@ bool CShapefile::WriteAppendedShape()
 	// update SHX file
 	AppendToShx(_shxfile, record->shape, offset);
 
-	// update SHP file
+	// update SHP file; flushing to make the record visible for positional reads
 	AppendToShpFile(_shpfile, wrapper);
+	fflush(_shpfile);
 
 	// update DBF file
 	((CTableClass*)_table)->WriteAppendedRow();
@@ -736,6 +755,11 @@ STDMETHODIMP CShapefile::EditDeleteShape(long ShapeIndex, VARIANT_BOOL *retval)
                 }
 				_sortingChanged = true;
 
+				if (_snappingIndex)
+				{
+					_snappingIndex->RemoveShape(ShapeIndex);
+				}
+
 				// TODO: why haven't we updated QTree?
 				*retval = VARIANT_TRUE;
 			}
@@ -798,6 +822,7 @@ STDMETHODIMP CShapefile::EditClear(VARIANT_BOOL *retval)
             this->GenerateQTree(); // will clear it
 		}
 
+		ClearSnappingIndex();
 		_sortingChanged = true;
 
 		*retval = VARIANT_TRUE;
@@ -899,6 +924,8 @@ STDMETHODIMP CShapefile::RefreshShapeExtents(LONG ShapeId, VARIANT_BOOL *retval)
 // ********************************************************************
 BOOL CShapefile::ReleaseMemoryShapes()
 {
+	// shapes will be read from the disk again
+	ClearSnappingIndex();
 
 	int size = (int)_shapeData.size();
 	for( int i = 0; i < size; i++ )
@@ -1135,6 +1162,9 @@ STDMETHODIMP CShapefile::StartAppendMode(VARIANT_BOOL* retVal)
 		return S_OK;
 	}
 
+	// appended shapes are written past the end of the mapping
+	CloseMappedFiles();
+
 	if (!ReopenFiles(true))
 	{
 		// error is reported in function
@@ -41,6 +41,17 @@
 #include "FieldHelper.h"
 #include "ShapeHelper.h"
 #include "GeoProcessing.h"
+#include "ParallelHelper.h"
+
+// the number of subjects of overlay which are passed to the pool at once
+#define OVERLAY_BATCH_SIZE 1024
+
+// geometries are shared between the threads only with reentrant GEOS API
+#ifdef GEOS_NEW
+#define OVERLAY_NUM_THREADS 0
+#else
+#define OVERLAY_NUM_THREADS 1
+#endif
 
 // ReSharper disable CppUseAuto
 
@@ -301,7 +312,7 @@ STDMETHODIMP CShapefile::SelectByShapefile(IShapefile* sf, tkSpatialRelation Rel
     if (_numShapes1 == 0)return NULL;
     if (_numShapes2 == 0) return NULL;
 
-    QTree* qTree = this->GenerateQTreeCore(false);
+    CPackedRTree* qTree = this->GeneratePackedTree(false);
     if (!qTree)
     {
         ErrorMessage(tkFAILED_TO_BUILD_SPATIAL_INDEX);
@@ -318,6 +329,7 @@ STDMETHODIMP CShapefile::SelectByShapefile(IShapefile* sf, tkSpatialRelation Rel
     vector<ShapeRecord*>* data = ((CShapefile*)sf)->get_ShapeVector();
 
     long percent = 0;
+    vector<int> shapeIds;
     for (long shapeid2 = 0; shapeid2 < _numShapes2; shapeid2++)
     {
         CallbackHelper::Progress(_globalCallback, shapeid2, _numShapes2, "Calculating...", _key, percent);
@@ -327,7 +339,7 @@ STDMETHODIMP CShapefile::SelectByShapefile(IShapefile* sf, tkSpatialRelation Rel
 
         double xMin, xMax, yMin, yMax;
         ((CShapefile*)sf)->QuickExtentsCore(shapeid2, &xMin, &yMin, &xMax, &yMax);
-        vector<int> shapeIds = qTree->GetNodes(QTreeExtent(xMin, xMax, yMax, yMin));
+        qTree->GetNodes(QTreeExtent(xMin, xMax, yMax, yMin), shapeIds);
 
         if (!shapeIds.empty())
         {
@@ -446,7 +458,7 @@ VARIANT_BOOL CShapefile::SelectShapesAlt(IExtents* BoundBox, double Tolerance, S
         yMax += 1;
     }
 
-    QTree* qTree = this->GenerateQTreeCore(false);
+    CPackedRTree* qTree = this->GeneratePackedTree(false);
     if (!qTree)
     {
         ErrorMessage(tkFAILED_TO_BUILD_SPATIAL_INDEX);
@@ -464,7 +476,8 @@ VARIANT_BOOL CShapefile::SelectShapesAlt(IExtents* BoundBox, double Tolerance, S
     BoundBox->SetBounds(xMin, yMin, zMin, xMax, yMax, zMax);
 
     set<long> results;
-    vector<int> shapeIds = qTree->GetNodes(QTreeExtent(xMin, xMax, yMax, yMin));
+    vector<int> shapeIds;
+    qTree->GetNodes(QTreeExtent(xMin, xMax, yMax, yMin), shapeIds);
 
     IShape* temp = nullptr;
     ((CExtents*)BoundBox)->ToShape(&temp);
@@ -899,11 +912,17 @@ void CShapefile::DissolveGEOS(long FieldIndex, VARIANT_BOOL SelectedOnly, IField
 
     const bool isM = ShapeUtility::IsM(_shpfiletype);
 
+    // merging the groups, in parallel where possible
+    vector<vector<GEOSGeometry*>*> groups;
+    for (auto& group : shapeMap)
+        groups.push_back(group.second);
+
+    vector<GEOSGeometry*> merged;
+    GeosConverter::MergeGeometryGroups(groups, merged, _globalCallback, _key);
+
     // saving results							
     long count = 0; // number of shapes inserted
-    int shapeProcessed = 0; // for progress bar
-    percent = 0;
-    size = shapeMap.size();
+    int shapeProcessed = 0; // index of group
 
     VARIANT_BOOL vbretval;
     map<CComVariant, vector<GEOSGeometry*>*>::iterator p = shapeMap.begin();
@@ -913,9 +932,7 @@ void CShapefile::DissolveGEOS(long FieldIndex, VARIANT_BOOL SelectedOnly, IField
 
     while (p != shapeMap.end())
     {
-        CallbackHelper::Progress(_globalCallback, shapeProcessed, size, "Merging shapes...", _key, percent);
-
-        GEOSGeometry* gsGeom = GeosConverter::MergeGeometries(*p->second, nullptr, false, false);
+        GEOSGeometry* gsGeom = merged[shapeProcessed];
         delete p->second; // deleting the vector
 
         if (gsGeom != nullptr)
@@ -1041,18 +1058,33 @@ void CShapefile::DissolveClipper(long FieldIndex, VARIANT_BOOL SelectedOnly, IFi
         }
     }
 
-    // perform clipping and saving the results
+    // perform clipping; the groups are independent, so they are shared between the threads of pool
+    vector<ClipperLib::Clipper*> clippers;
+    for (auto& group : shapeMap)
+        clippers.push_back(group.second);
+
+    vector<ClipperLib::Paths> results(clippers.size());
+    auto unite = [&](int begin, int end)
+    {
+        for (int i = begin; i < end; i++)
+        {
+            if (clippers[i])
+                clippers[i]->Execute(ClipperLib::ctUnion, results[i]);
+        }
+    };
+    ParallelHelper::For((int)clippers.size(), 0, unite, 1);
+
+    // saving the results
     VARIANT_BOOL vbretval;
     long count = 0;
+    int groupIndex = 0;
     map<CComVariant, ClipperLib::Clipper*>::iterator p = shapeMap.begin();
     while (p != shapeMap.end())
     {
-        // ClipperLib::Polygons result;
-        ClipperLib::Paths result;
+        ClipperLib::Paths& result = results[groupIndex++];
         ClipperLib::Clipper* clip = p->second;
         if (clip)
         {
-            clip->Execute(ClipperLib::ctUnion, result);
             IShape* shp = ogr.ClipperPolygon2Shape(&result);
 
             if (shp)
@@ -1754,6 +1786,109 @@ bool CShapefile::ValidateClippingOutputType(ShpfileType type1, ShpfileType type2
     return true;
 }
 
+// ********************************************************************
+//		OverlayTask
+// ********************************************************************
+// A subject shape of overlay with the geometries calculated for it by the threads of pool.
+struct OverlayTask
+{
+    OverlayTask()
+        : subjectId(-1), subject(nullptr), xMin(0.0), yMin(0.0), xMax(0.0), yMax(0.0), ownsResults(true)
+    {
+    }
+
+    long subjectId;
+    GEOSGeometry* subject;
+    double xMin;
+    double yMin;
+    double xMax;
+    double yMax;
+    vector<int> candidates;             // overlay shapes which bounds intersect those of subject
+    vector<GEOSGeometry*> results;
+    vector<long> resultIds;             // overlay shape for each result
+    bool ownsResults;                   // false when the cached geometry of subject is passed as result
+};
+
+// ********************************************************************
+//		RunOverlayTasks()
+// ********************************************************************
+// Takes the available subjects in batches. For each batch the candidates are found in the spatial index 
+// of overlay and calculate(handle, task) is called from the threads of pool, each with a GEOS context
+// of its own; then save(task) is called on this thread in the order of subjects, so the output and
+// its attributes are the same as for the sequential processing. Returns false if the operation was stopped.
+template <typename Calculate, typename Save>
+static bool RunOverlayTasks(CShapefile* sfSubject, VARIANT_BOOL selectedOnly, std::set<int>* shapesToSkip,
+                            CPackedRTree* qTree, IStopExecution* stopExecution, Calculate& calculate, Save& save)
+{
+    long numShapes;
+    sfSubject->get_NumShapes(&numShapes);
+
+    vector<OverlayTask> tasks;
+    auto process = [&](int begin, int end)
+    {
+        GEOSContextHandle_t handle = GeosHelper::CreateContext();
+
+        for (int i = begin; i < end; i++)
+        {
+            OverlayTask& task = tasks[i];
+            qTree->GetNodes(QTreeExtent(task.xMin, task.xMax, task.yMax, task.yMin), task.candidates);
+            calculate(handle, task);
+        }
+
+        GeosHelper::DestroyContext(handle);
+    };
+
+    for (long first = 0; first < numShapes; first += OVERLAY_BATCH_SIZE)
+    {
+        const long last = MIN(first + OVERLAY_BATCH_SIZE, numShapes);
+
+        // user can abort the operation at any time
+        if (stopExecution)
+        {
+            VARIANT_BOOL stop;
+            stopExecution->StopFunction(&stop);
+            if (stop)
+                return false;
+        }
+
+        // extents may be read from the disk, so it's done on this thread
+        tasks.clear();
+        for (long subjectId = first; subjectId < last; subjectId++)
+        {
+            if (!sfSubject->ShapeAvailable(subjectId, selectedOnly))
+                continue;
+
+            // those shapes are marked to skip in the course of intersection
+            if (shapesToSkip != nullptr && shapesToSkip->find(subjectId) != shapesToSkip->end())
+                continue;
+
+            tasks.push_back(OverlayTask());
+            OverlayTask& task = tasks.back();
+            task.subjectId = subjectId;
+            task.subject = sfSubject->GetGeosGeometry(subjectId);
+            sfSubject->QuickExtentsCore(subjectId, &task.xMin, &task.yMin, &task.xMax, &task.yMax);
+        }
+
+        ParallelHelper::For((int)tasks.size(), OVERLAY_NUM_THREADS, process, 16);
+
+        for (size_t i = 0; i < tasks.size(); i++)
+        {
+            OverlayTask& task = tasks[i];
+            save(task);
+
+            if (task.ownsResults)
+            {
+                for (size_t j = 0; j < task.results.size(); j++)
+                {
+                    GeosHelper::DestroyGeometry(task.results[j]);
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
 // ********************************************************************
 //		DoClipOperarion()
 // ********************************************************************
@@ -1879,6 +2014,10 @@ void CShapefile::DoClipOperation(VARIANT_BOOL SelectedOnlySubject, IShapefile* s
         this->ReadGeosGeometries(SelectedOnlySubject);
         ((CShapefile*)sfOverlay)->ReadGeosGeometries(SelectedOnlyOverlay);
 
+        // geometries are read by several threads at once during the calculation
+        this->CacheGeosEnvelopes(SelectedOnlySubject);
+        ((CShapefile*)sfOverlay)->CacheGeosEnvelopes(SelectedOnlyOverlay);
+
         // do calculation by GEOS
         switch (operation)
         {
@@ -1940,96 +2079,77 @@ cleaning:
 void CShapefile::ClipGEOS(VARIANT_BOOL SelectedOnlySubject, IShapefile* sfOverlay, VARIANT_BOOL SelectedOnlyOverlay,
                           IShapefile* sfResult)
 {
-    QTree* qTree = ((CShapefile*)sfOverlay)->GetTempQTree();
+    CShapefile* overlay = (CShapefile*)sfOverlay;
+    CPackedRTree* qTree = overlay->GetTempQTree();
 
-    long numShapesSubject, numShapesClip;
+    long numShapesSubject;
     this->get_NumShapes(&numShapesSubject);
-    sfOverlay->get_NumShapes(&numShapesClip);
     const bool isM = ShapeUtility::IsM(_shpfiletype);
 
-    long percent = 0;
-    for (long subjectId = 0; subjectId < numShapesSubject; subjectId++)
+    // the union of overlay shapes which intersect the subject
+    auto calculate = [&](GEOSContextHandle_t handle, OverlayTask& task)
     {
-        CallbackHelper::Progress(_globalCallback, subjectId, numShapesSubject, "Clipping shapes...", _key, percent);
-
-        if (!ShapeAvailable(subjectId, SelectedOnlySubject))
-            continue;
+        if (!task.subject || task.candidates.empty())
+            return;
 
-        double xMin, xMax, yMin, yMax;
-        this->QuickExtentsCore(subjectId, &xMin, &yMin, &xMax, &yMax);
-        vector<int> shapeIds = qTree->GetNodes(QTreeExtent(xMin, xMax, yMax, yMin));
+        vector<GEOSGeometry*> vUnion;
+        const GEOSPreparedGeometry* gsPrepared = GeosHelper::Prepare(handle, task.subject);
 
-        if (!shapeIds.empty())
+        for (int clipId : task.candidates)
         {
-            GEOSGeometry* gsGeom1 = this->GetGeosGeometry(subjectId);
-            if (gsGeom1)
-            {
-                // iterating through clip geometries preparing their union
-                vector<GEOSGeometry*> vUnion;
+            if (!overlay->ShapeAvailable(clipId, SelectedOnlyOverlay))
+                continue;
 
-                for (long clipId : shapeIds)
-                {
-                    // user can abort the operation in any time
-                    if (_stopExecution)
-                    {
-                        VARIANT_BOOL stop;
-                        _stopExecution->StopFunction(&stop);
-                        if (stop)
-                        {
-                            sfResult->EditClear(&stop);
-                            //GeosHelper::DestroyGeometry(gsGeom1);
-                            goto cleaning;
-                        }
-                    }
+            GEOSGeometry* gsGeom2 = overlay->GetGeosGeometry(clipId);
 
-                    // extracting clip geometry
-                    if (!((CShapefile*)sfOverlay)->ShapeAvailable(clipId, SelectedOnlyOverlay))
-                        continue;
+            if (gsGeom2 && (gsPrepared ? GeosHelper::PreparedIntersects(handle, gsPrepared, gsGeom2) : GeosHelper::Intersects(handle, task.subject, gsGeom2)))
+            {
+                vUnion.push_back(gsGeom2);
+            }
+        }
 
-                    GEOSGeometry* gsGeom2 = ((CShapefile*)sfOverlay)->GetGeosGeometry(clipId);
+        if (gsPrepared)
+            GeosHelper::DestroyPrepared(handle, gsPrepared);
 
-                    if (GeosHelper::Intersects(gsGeom1, gsGeom2))
-                    {
-                        vUnion.push_back(gsGeom2);
-                    }
-                }
+        if (vUnion.empty())
+            return;
 
-                // merging (input geometries won't be destroyed)
-                GEOSGeometry* gsGeom2 = nullptr;
-                bool deleteNeeded = false;
+        // merging (input geometries won't be destroyed)
+        GEOSGeometry* gsGeom2 = vUnion.size() > 1 ? GeosConverter::MergeGeometries(handle, vUnion, false) : vUnion[0];
+        if (!gsGeom2)
+            return;
 
-                if ((int)vUnion.size() > 1)
-                {
-                    gsGeom2 = GeosConverter::MergeGeometries(vUnion, nullptr, false, false);
-                    deleteNeeded = true;
-                }
-                else if ((int)vUnion.size() == 1)
-                {
-                    gsGeom2 = vUnion[0];
-                }
+        GEOSGeometry* gsResult = GeosHelper::Intersection(handle, task.subject, gsGeom2);
+        if (gsResult)
+        {
+            task.results.push_back(gsResult);
+            task.resultIds.push_back(-1);
+        }
 
-                if (gsGeom2)
-                {
-                    GEOSGeometry* gsResult = GeosHelper::Intersection(gsGeom1, gsGeom2);
-                    if (gsResult != nullptr)
-                    {
-                        vector<IShape*> vShapes;
-                        GeosConverter::GeomToShapes(gsResult, &vShapes, isM);
-                        GeosHelper::DestroyGeometry(gsResult);
-                        this->InsertShapesVector(sfResult, vShapes, this, subjectId, nullptr);
-                    }
+        // clipping geometry should be deleted only in case it was build up from several parts
+        if (vUnion.size() > 1)
+            GeosHelper::DestroyGeometry(handle, gsGeom2);
+    };
 
-                    // clipping geometry should be deleted only in case it was build up from several parts
-                    if (deleteNeeded)
-                        GeosHelper::DestroyGeometry(gsGeom2);
-                }
+    long percent = 0;
+    auto save = [&](OverlayTask& task)
+    {
+        CallbackHelper::Progress(_globalCallback, task.subjectId, numShapesSubject, "Clipping shapes...", _key, percent);
 
-                // subject geometry should always be deleted
-                //GeosHelper::DestroyGeometry(gsGeom1);
-            }
+        for (size_t i = 0; i < task.results.size(); i++)
+        {
+            vector<IShape*> vShapes;
+            GeosConverter::GeomToShapes(task.results[i], &vShapes, isM);
+            this->InsertShapesVector(sfResult, vShapes, this, task.subjectId, nullptr);
         }
+    };
+
+    if (!RunOverlayTasks(this, SelectedOnlySubject, nullptr, qTree, _stopExecution, calculate, save))
+    {
+        VARIANT_BOOL stop;
+        sfResult->EditClear(&stop);
     }
-cleaning:
+
     CallbackHelper::ProgressCompleted(_globalCallback, _key);
 }
 
@@ -2039,7 +2159,7 @@ cleaning:
 void CShapefile::ClipClipper(VARIANT_BOOL SelectedOnlySubject, IShapefile* sfOverlay, VARIANT_BOOL SelectedOnlyOverlay,
                              IShapefile* sfResult)
 {
-    QTree* qTree = ((CShapefile*)sfOverlay)->GetTempQTree();
+    CPackedRTree* qTree = ((CShapefile*)sfOverlay)->GetTempQTree();
 
     long numShapesSubject, numShapesClip;
     this->get_NumShapes(&numShapesSubject);
@@ -2053,6 +2173,7 @@ void CShapefile::ClipClipper(VARIANT_BOOL SelectedOnlySubject, IShapefile* sfOve
     ClipperConverter ogr(this);
 
     long percent = 0;
+    vector<int> shapeIds;
     for (long subjectId = 0; subjectId < numShapesSubject; subjectId++)
     {
         CallbackHelper::Progress(_globalCallback, subjectId, numShapesSubject, "Clipping shapes...", _key, percent);
@@ -2062,7 +2183,7 @@ void CShapefile::ClipClipper(VARIANT_BOOL SelectedOnlySubject, IShapefile* sfOve
 
         double xMin, xMax, yMin, yMax;
         this->QuickExtentsCore(subjectId, &xMin, &yMin, &xMax, &yMax);
-        vector<int> shapeIds = qTree->GetNodes(QTreeExtent(xMin, xMax, yMax, yMin));
+        qTree->GetNodes(QTreeExtent(xMin, xMax, yMax, yMin), shapeIds);
 
         if (!shapeIds.empty())
         {
@@ -2180,74 +2301,66 @@ void CShapefile::IntersectionGEOS(VARIANT_BOOL SelectedOnlySubject, IShapefile*
                                   std::set<int>* subjectShapesToSkip,
                                   std::set<int>* clippingShapesToSkip)
 {
-    QTree* qTree = ((CShapefile*)sfClip)->GetTempQTree();
+    CShapefile* overlay = (CShapefile*)sfClip;
+    CPackedRTree* qTree = overlay->GetTempQTree();
 
-    long numShapesSubject, numShapesClip;
+    long numShapesSubject;
     this->get_NumShapes(&numShapesSubject);
-    sfClip->get_NumShapes(&numShapesClip);
 
     const bool isM = ShapeUtility::IsM(_shpfiletype);
 
-    long percent = 0;
-    for (long subjectId = 0; subjectId < numShapesSubject; subjectId++)
+    // intersection with each of overlay shapes; disjoint ones are skipped as their intersection is empty
+    auto calculate = [&](GEOSContextHandle_t handle, OverlayTask& task)
     {
-        CallbackHelper::Progress(_globalCallback, subjectId, numShapesSubject, "Intersecting shapes...", _key, percent);
+        if (!task.subject || task.candidates.empty())
+            return;
 
-        if (!ShapeAvailable(subjectId, SelectedOnlySubject))
-            continue;
+        const GEOSPreparedGeometry* gsPrepared = GeosHelper::Prepare(handle, task.subject);
 
-        double xMin, xMax, yMin, yMax;
-        this->QuickExtentsCore(subjectId, &xMin, &yMin, &xMax, &yMax);
-        vector<int> shapeIds = qTree->GetNodes(QTreeExtent(xMin, xMax, yMax, yMin));
-
-        if (!shapeIds.empty())
+        for (int clipId : task.candidates)
         {
-            GEOSGeometry* geom1 = GetGeosGeometry(subjectId);
-
-            if (geom1)
-            {
-                // double sumArea = 0.0;
+            if (!overlay->ShapeAvailable(clipId, SelectedOnlyClip))
+                continue;
 
-                // iterating through clip geometries
-                for (long clipId : shapeIds)
-                {
-                    // user can abort the operation at any time
-                    if (_stopExecution)
-                    {
-                        VARIANT_BOOL stop;
-                        _stopExecution->StopFunction(&stop);
-                        if (stop)
-                        {
-                            sfResult->EditClear(&stop);
-                            //GeosHelper::DestroyGeometry(geom1);
-                            goto cleaning;
-                        }
-                    }
+            GEOSGeometry* geom2 = overlay->GetGeosGeometry(clipId);
+            if (!geom2)
+                continue;
 
-                    // extracting clip geometry
-                    if (!((CShapefile*)sfClip)->ShapeAvailable(clipId, SelectedOnlyClip))
-                        continue;
+            if (gsPrepared && !GeosHelper::PreparedIntersects(handle, gsPrepared, geom2))
+                continue;
 
-                    GEOSGeometry* geom2 = ((CShapefile*)sfClip)->GetGeosGeometry(clipId);
+            GEOSGeometry* geom = GeosHelper::Intersection(handle, task.subject, geom2);
+            if (geom)
+            {
+                task.results.push_back(geom);
+                task.resultIds.push_back(clipId);
+            }
+        }
 
-                    // calculating intersection
-                    GEOSGeometry* geom = GeosHelper::Intersection(geom1, geom2);
-                    // don't delete oGeom1 as it will be used on the next loops
-                    if (geom == nullptr) continue;
+        if (gsPrepared)
+            GeosHelper::DestroyPrepared(handle, gsPrepared);
+    };
 
-                    // saving the results
-                    vector<IShape*> vShapes;
-                    GeosConverter::GeomToShapes(geom, &vShapes, isM);
-                    GeosHelper::DestroyGeometry(geom);
+    long percent = 0;
+    auto save = [&](OverlayTask& task)
+    {
+        CallbackHelper::Progress(_globalCallback, task.subjectId, numShapesSubject, "Intersecting shapes...", _key, percent);
 
-                    this->InsertShapesVector(sfResult, vShapes, this, subjectId, nullptr, sfClip, clipId, fieldMap);
-                    // shapes are released here
-                }
-                //GeosHelper::DestroyGeometry(geom1);
-            }
+        for (size_t i = 0; i < task.results.size(); i++)
+        {
+            vector<IShape*> vShapes;
+            GeosConverter::GeomToShapes(task.results[i], &vShapes, isM);
+            this->InsertShapesVector(sfResult, vShapes, this, task.subjectId, nullptr, sfClip, task.resultIds[i], fieldMap);
+            // shapes are released here
         }
+    };
+
+    if (!RunOverlayTasks(this, SelectedOnlySubject, nullptr, qTree, _stopExecution, calculate, save))
+    {
+        VARIANT_BOOL stop;
+        sfResult->EditClear(&stop);
     }
-cleaning:
+
     CallbackHelper::ProgressCompleted(_globalCallback, _key);
 }
 
@@ -2294,7 +2407,7 @@ void CShapefile::IntersectionClipper(VARIANT_BOOL SelectedOnlySubject, IShapefil
                                      std::set<int>* subjectShapesToSkip,
                                      std::set<int>* clippingShapesToSkip)
 {
-    QTree* qTree = ((CShapefile*)sfClip)->GetTempQTree();
+    CPackedRTree* qTree = ((CShapefile*)sfClip)->GetTempQTree();
 
     long numShapesSubject, numShapesClip;
     this->get_NumShapes(&numShapesSubject);
@@ -2331,6 +2444,7 @@ void CShapefile::IntersectionClipper(VARIANT_BOOL SelectedOnlySubject, IShapefil
     }
 
     long percent = 0;
+    vector<int> shapeIds;
     for (long subjectId = 0; subjectId < numShapesSubject; subjectId++)
     {
         CallbackHelper::Progress(_globalCallback, subjectId, numShapesSubject, "Intersecting shapes...", _key, percent);
@@ -2340,7 +2454,7 @@ void CShapefile::IntersectionClipper(VARIANT_BOOL SelectedOnlySubject, IShapefil
 
         double xMin, xMax, yMin, yMax;
         this->QuickExtentsCore(subjectId, &xMin, &yMin, &xMax, &yMax);
-        vector<int> shapeIds = qTree->GetNodes(QTreeExtent(xMin, xMax, yMax, yMin));
+        qTree->GetNodes(QTreeExtent(xMin, xMax, yMax, yMin), shapeIds);
 
         if (!shapeIds.empty())
         {
@@ -2490,119 +2604,102 @@ void CShapefile::DifferenceGEOS(IShapefile* sfSubject, VARIANT_BOOL SelectedOnly
                                 VARIANT_BOOL SelectedOnlyOverlay,
                                 IShapefile* sfResult, map<long, long>* fieldMap, set<int>* shapesToSkip)
 {
-    QTree* qTree = ((CShapefile*)sfOverlay)->GetTempQTree();
+    CShapefile* overlay = (CShapefile*)sfOverlay;
+    CPackedRTree* qTree = overlay->GetTempQTree();
 
-    long numShapesSubject, numShapesClip;
+    long numShapesSubject;
     sfSubject->get_NumShapes(&numShapesSubject);
-    sfOverlay->get_NumShapes(&numShapesClip);
 
     const bool isM = ShapeUtility::IsM(_shpfiletype);
 
-    long percent = 0;
-    for (long subjectId = 0; subjectId < numShapesSubject; subjectId++)
+    // the union of overlay shapes which intersect the subject is subtracted from it
+    auto calculate = [&](GEOSContextHandle_t handle, OverlayTask& task)
     {
-        CallbackHelper::Progress(_globalCallback, subjectId, numShapesSubject, "Calculating difference...", _key,
-                                 percent);
+        if (!task.subject || task.candidates.empty())
+            return;
 
-        if (!((CShapefile*)sfSubject)->ShapeAvailable(subjectId, SelectedOnlySubject))
-            continue;
+        vector<GEOSGeometry*> vClip;
+        const GEOSPreparedGeometry* gsPrepared = GeosHelper::Prepare(handle, task.subject);
 
-        // those shapes are marked to skip in the course of intersection
-        if (shapesToSkip != nullptr)
+        for (int clipId : task.candidates)
         {
-            if (shapesToSkip->find(subjectId) != shapesToSkip->end())
+            if (!overlay->ShapeAvailable(clipId, SelectedOnlyOverlay))
                 continue;
-        }
-
-        double xMin, xMax, yMin, yMax;
-        ((CShapefile*)sfSubject)->QuickExtentsCore(subjectId, &xMin, &yMin, &xMax, &yMax);
-        vector<int> shapeIds = qTree->GetNodes(QTreeExtent(xMin, xMax, yMax, yMin));
-
-        if (!shapeIds.empty())
-        {
-            GEOSGeometry* gsGeom1 = ((CShapefile*)sfSubject)->GetGeosGeometry(subjectId);
-            if (!gsGeom1) continue;
 
-            vector<GEOSGeometry*> vClip;
+            GEOSGeometry* gsGeom2 = overlay->GetGeosGeometry(clipId);
 
-            // iterating through clip geometries, if the subject will stand this, we add it to the result
-            for (long clipId : shapeIds)
+            if (gsGeom2 && (gsPrepared ? GeosHelper::PreparedIntersects(handle, gsPrepared, gsGeom2) : GeosHelper::Intersects(handle, task.subject, gsGeom2)))
             {
-                // user can abort the operation in any time
-                if (_stopExecution)
-                {
-                    VARIANT_BOOL stop;
-                    _stopExecution->StopFunction(&stop);
-                    if (stop)
-                    {
-                        sfResult->EditClear(&stop);
-                        //GeosHelper::DestroyGeometry(gsGeom1);
-                        goto cleaning;
-                    }
-                }
+                vClip.push_back(gsGeom2);
+            }
+        }
 
-                // extracting clip geometry
-                if (!((CShapefile*)sfOverlay)->ShapeAvailable(clipId, SelectedOnlyOverlay))
-                    continue;
+        if (gsPrepared)
+            GeosHelper::DestroyPrepared(handle, gsPrepared);
 
-                GEOSGeometry* gsGeom2 = ((CShapefile*)sfOverlay)->GetGeosGeometry(clipId);
+        // union of the clipping shapes
+        GEOSGeometry* gsClip = nullptr;
+        if (vClip.size() == 1)
+            gsClip = vClip[0];
+        else if (vClip.size() > 1)
+            gsClip = GeosConverter::MergeGeometries(handle, vClip, false);
 
-                if (gsGeom2 && GeosHelper::Intersects(gsGeom1, gsGeom2))
-                {
-                    vClip.push_back(gsGeom2);
-                }
-            }
+        if (!gsClip)
+        {
+            // the subject is saved as it is
+            task.results.push_back(task.subject);
+            task.resultIds.push_back(-1);
+            task.ownsResults = false;
+            return;
+        }
 
-            GEOSGeometry* gsClip = nullptr;
-            if (vClip.size() == 1)
-            {
-                gsClip = vClip[0];
-            }
-            else if (vClip.size() > 1)
-            {
-                // union of the clipping shapes
-                gsClip = GeosConverter::MergeGeometries(vClip, nullptr, false, false);
-            }
+        GEOSGeometry* gsResult = GeosHelper::Difference(handle, task.subject, gsClip);
+        if (gsResult)
+        {
+            task.results.push_back(gsResult);
+            task.resultIds.push_back(-1);
+        }
 
-            bool deleteNeeded = false;
-            if (gsClip)
-            {
-                gsGeom1 = GeosHelper::Difference(gsGeom1, gsClip);
-                deleteNeeded = true;
+        // if clip geometry was merged, we should delete it
+        if (vClip.size() > 1)
+            GeosHelper::DestroyGeometry(handle, gsClip);
+    };
 
-                // if clip geometry was merged, we should delete it
-                if (vClip.size() > 1)
-                {
-                    GeosHelper::DestroyGeometry(gsClip);
-                }
-            }
+    long percent = 0;
+    auto save = [&](OverlayTask& task)
+    {
+        CallbackHelper::Progress(_globalCallback, task.subjectId, numShapesSubject, "Calculating difference...", _key,
+                                 percent);
 
-            // saving what was left from the subject
-            if (gsGeom1 != nullptr)
-            {
-                vector<IShape*> vShapes;
-                GeosConverter::GeomToShapes(gsGeom1, &vShapes, isM);
-                if (deleteNeeded)
-                    GeosHelper::DestroyGeometry(gsGeom1);
-                this->InsertShapesVector(sfResult, vShapes, sfSubject, subjectId, fieldMap); // shapes are released here
-            }
-        }
-        else
+        if (task.candidates.empty())
         {
             // insert the shape directly no other shapes intersects it
-            // TODO: it makes sense to rewrite it in more efficient way
             IShape* shp1 = nullptr;
-            vector<IShape*> vShapes;
-            ((CShapefile*)sfSubject)->GetValidatedShape(subjectId, &shp1);
+            ((CShapefile*)sfSubject)->GetValidatedShape(task.subjectId, &shp1);
             if (shp1)
             {
+                vector<IShape*> vShapes;
                 vShapes.push_back(shp1);
-                this->InsertShapesVector(sfResult, vShapes, sfSubject, subjectId, fieldMap); // shapes are released here
+                this->InsertShapesVector(sfResult, vShapes, sfSubject, task.subjectId, fieldMap); // shapes are released here
             }
+            return;
         }
+
+        // saving what was left from the subject
+        for (size_t i = 0; i < task.results.size(); i++)
+        {
+            vector<IShape*> vShapes;
+            GeosConverter::GeomToShapes(task.results[i], &vShapes, isM);
+            this->InsertShapesVector(sfResult, vShapes, sfSubject, task.subjectId, fieldMap); // shapes are released here
+        }
+    };
+
+    if (!RunOverlayTasks((CShapefile*)sfSubject, SelectedOnlySubject, shapesToSkip, qTree, _stopExecution, calculate, save))
+    {
+        VARIANT_BOOL stop;
+        sfResult->EditClear(&stop);
     }
 
-cleaning:
     CallbackHelper::ProgressCompleted(_globalCallback, _key);
 }
 
@@ -2643,7 +2740,7 @@ void CShapefile::DifferenceClipper(IShapefile* sfSubject, VARIANT_BOOL SelectedO
                                    VARIANT_BOOL SelectedOnlyClip,
                                    IShapefile* sfResult, map<long, long>* fieldMap, set<int>* shapesToSkip)
 {
-    QTree* qTree = ((CShapefile*)sfClip)->GetTempQTree();
+    CPackedRTree* qTree = ((CShapefile*)sfClip)->GetTempQTree();
 
     long numShapesSubject, numShapesClip;
     sfSubject->get_NumShapes(&numShapesSubject);
@@ -2656,6 +2753,7 @@ void CShapefile::DifferenceClipper(IShapefile* sfSubject, VARIANT_BOOL SelectedO
     ClipperConverter ogr(sfSubject);
 
     long percent = 0;
+    vector<int> shapeIds;
     for (long subjectId = 0; subjectId < numShapesSubject; subjectId++)
     {
         CallbackHelper::Progress(_globalCallback, subjectId, numShapesSubject, "Calculating difference...", _key,
@@ -2672,7 +2770,7 @@ void CShapefile::DifferenceClipper(IShapefile* sfSubject, VARIANT_BOOL SelectedO
 
         double xMin, xMax, yMin, yMax;
         ((CShapefile*)sfSubject)->QuickExtentsCore(subjectId, &xMin, &yMin, &xMax, &yMax);
-        vector<int> shapeIds = qTree->GetNodes(QTreeExtent(xMin, xMax, yMax, yMin));
+        qTree->GetNodes(QTreeExtent(xMin, xMax, yMax, yMin), shapeIds);
 
         if (!shapeIds.empty())
         {
@@ -2880,11 +2978,11 @@ STDMETHODIMP CShapefile::PointInShape(LONG ShapeIndex, DOUBLE x, DOUBLE y, VARIA
     }
     else
     {
-        CSingleLock lock(&_readLock, TRUE);
+        // shape type is followed by the header
+        const __int64 offset = _shpOffsets[ShapeIndex] + sizeof(int) * 2;
 
-        int shpType;
-        fseek(_shpfile, _shpOffsets[ShapeIndex] + sizeof(int) * 2, SEEK_SET);
-        fread(&shpType, sizeof(int), 1, _shpfile);
+        int shpType = SHP_NULLSHAPE;
+        ReadShpBytes(offset, &shpType, sizeof(int));
 
         shpType = ShapeUtility::Convert2D((ShpfileType)shpType);
         if (shpType != SHP_POLYGON)
@@ -2894,7 +2992,11 @@ STDMETHODIMP CShapefile::PointInShape(LONG ShapeIndex, DOUBLE x, DOUBLE y, VARIA
         }
 
         ShapeHeader shpHeader{};
-        fread(&shpHeader, sizeof(ShapeHeader), 1, _shpfile);
+        if (!ReadShpBytes(offset + sizeof(int), &shpHeader, sizeof(ShapeHeader)))
+        {
+            *retval = VARIANT_FALSE;
+            return S_OK;
+        }
 
         // check the bounds
         if (x < shpHeader.MinX || y < shpHeader.MinY || x > shpHeader.MaxX || y > shpHeader.MaxY)
@@ -2906,8 +3008,9 @@ STDMETHODIMP CShapefile::PointInShape(LONG ShapeIndex, DOUBLE x, DOUBLE y, VARIA
         Parts = new long[shpHeader.NumParts + 1];
         Points = new Point2D[shpHeader.NumPoints];
 
-        fread(Parts, sizeof(int), shpHeader.NumParts, _shpfile);
-        fread(Points, sizeof(Point2D), shpHeader.NumPoints, _shpfile);
+        const __int64 partsOffset = offset + sizeof(int) + sizeof(ShapeHeader);
+        ReadShpBytes(partsOffset, Parts, sizeof(int) * shpHeader.NumParts);
+        ReadShpBytes(partsOffset + sizeof(int) * shpHeader.NumParts, Points, sizeof(Point2D) * shpHeader.NumPoints);
         Parts[shpHeader.NumParts] = shpHeader.NumPoints;
         numParts = shpHeader.NumParts;
     }
@@ -2988,88 +3091,74 @@ STDMETHODIMP CShapefile::PointInShapefile(DOUBLE x, DOUBLE y, LONG* ShapeIndex)
 {
     AFX_MANAGE_STATE(AfxGetStaticModuleState());
 
-    const int nShapeCount = _polySf.size();
-    for (int nShape = nShapeCount - 1; nShape >= 0; nShape--)
-        // for(int nShape = 0; nShape < ShapeCount; nShape++) see http://www.mapwindow.org/phorum/read.php?3,9745,9950#msg-9950
-    {
-        PolygonShapefile* sf = &_polySf[nShape];
-
-        if (x < sf->shpHeader.MinX || y < sf->shpHeader.MinY || x > sf->shpHeader.MaxX || y > sf->shpHeader.MaxY)
-        {
-            continue;
-        }
+    // polygons are tested from the last to the first one,
+    // see http://www.mapwindow.org/phorum/read.php?3,9745,9950#msg-9950
+    *ShapeIndex = _pointInShapefileIndex.Find(x, y);
+    return S_OK;
+}
 
-        int CrossCount = 0;
+// ********************************************************************
+//		PointsInShapefile()
+// ********************************************************************
+// The same as PointInShapefile for an array of points; the points are split between
+// several threads, as the index built by BeginPointInShapefile is read only.
+STDMETHODIMP CShapefile::PointsInShapefile(SAFEARRAY* xCoordinates, SAFEARRAY* yCoordinates, LONG numThreads, SAFEARRAY** retVal)
+{
+    AFX_MANAGE_STATE(AfxGetStaticModuleState());
+    *retVal = NULL;
 
-        int i, j;
-        // work backwards through Parts since we only know the first point of each Part
-        for (int nPart = sf->shpHeader.NumParts - 1; nPart >= 0; nPart--)
-        {
-            const int nPointMin = sf->Parts[nPart];
-            const int nPointMax = sf->Parts[nPart + 1] - 1;
-            // algorithm by W. Randolph Franklin; for a detailed explanation, see
-            // https://wrf.ecse.rpi.edu//Research/Short_Notes/pnpoly.html
-            // note that i starts at first point, while j starts at last point, then follows behind i
-            for (i = nPointMin, j = nPointMax - 1; i < nPointMax; j = i++)
-            {
-                if (((sf->Points[i].y > y) != (sf->Points[j].y > y)) &&
-                    (x < (sf->Points[j].x - sf->Points[i].x) * (y - sf->Points[i].y) / (sf->Points[j].y - sf->Points[i].y) + sf->Points[i].x))
-                    // we have a crossing
-                    CrossCount++;
-            }
-        }
-        //for (int nPart = sf->shpHeader.NumParts - 1; nPart >= 0; nPart--)
-        //{
-        //    const int nPointMax = sf->Parts[nPart + 1] - 1;
-        //    for (int nPoint = sf->Parts[nPart]; nPoint < nPointMax; nPoint++)
-        //    {
-        //        const double x1 = sf->Points[nPoint].x - x;
-        //        const double y1 = sf->Points[nPoint].y - y;
-        //        const double x2 = sf->Points[nPoint + 1].x - x;
-        //        const double y2 = sf->Points[nPoint + 1].y - y;
+    if (!xCoordinates || !yCoordinates || SafeArrayGetDim(xCoordinates) != 1 || SafeArrayGetDim(yCoordinates) != 1)
+    {
+        ErrorMessage(tkINVALID_PARAMETERS_ARRAY);
+        return S_OK;
+    }
 
-        //        const double y1y2 = y1 * y2;
+    VARTYPE xType = VT_EMPTY, yType = VT_EMPTY;
+    SafeArrayGetVartype(xCoordinates, &xType);
+    SafeArrayGetVartype(yCoordinates, &yType);
 
-        //        if (y1y2 > 0.0) // If the signs are the same
-        //        {
-        //            // Then it does not cross
-        //            continue;
-        //        }
-        //        if (y1y2 == 0.0) // Then it has intesected a vertex
-        //        {
-        //            if (y1 == 0.0)
-        //            {
-        //                if (y2 > 0.0)
-        //                    continue;
-        //            }
-        //            else if (y1 > 0.0)
-        //                continue;
-        //        }
+    LONG xLower = 0, xUpper = -1, yLower = 0, yUpper = -1;
+    SafeArrayGetLBound(xCoordinates, 1, &xLower);
+    SafeArrayGetUBound(xCoordinates, 1, &xUpper);
+    SafeArrayGetLBound(yCoordinates, 1, &yLower);
+    SafeArrayGetUBound(yCoordinates, 1, &yUpper);
 
-        //        if (x1 > 0.0 && x2 > 0.0)
-        //        {
-        //            CrossCount++;
-        //            continue;
-        //        }
+    const long count = xUpper - xLower + 1;
+    if (xType != VT_R8 || yType != VT_R8 || count < 0 || count != yUpper - yLower + 1)
+    {
+        ErrorMessage(tkINVALID_PARAMETERS_ARRAY);
+        return S_OK;
+    }
 
-        //        // Calculate Intersection
-        //        const double dy = y2 - y1;
-        //        const double dx = x2 - x1;
-        //        const double xint = x1 - y1 * (dx / dy);
+    SAFEARRAY* result = SafeArrayCreateVector(VT_I4, 0, count);
+    if (!result)
+    {
+        ErrorMessage(tkFAILED_TO_ALLOCATE_MEMORY);
+        return S_OK;
+    }
 
-        //        if (xint > 0.0)
-        //            CrossCount++;
-        //    }
-        //}
+    double* xData = NULL;
+    double* yData = NULL;
+    LONG* indices = NULL;
+    SafeArrayAccessData(xCoordinates, (void HUGEP**)&xData);
+    SafeArrayAccessData(yCoordinates, (void HUGEP**)&yData);
+    SafeArrayAccessData(result, (void HUGEP**)&indices);
 
-        if (CrossCount & 1)
+    auto findPoints = [&](int begin, int end)
+    {
+        for (int i = begin; i < end; i++)
         {
-            *ShapeIndex = nShape;
-            return S_OK;
+            indices[i] = _pointInShapefileIndex.Find(xData[i], yData[i]);
         }
-    }
+    };
+
+    ParallelHelper::For(count, numThreads, findPoints);
 
-    *ShapeIndex = -1;
+    SafeArrayUnaccessData(result);
+    SafeArrayUnaccessData(yCoordinates);
+    SafeArrayUnaccessData(xCoordinates);
+
+    *retVal = result;
     return S_OK;
 }
 
@@ -3094,33 +3183,42 @@ STDMETHODIMP CShapefile::BeginPointInShapefile(VARIANT_BOOL* retval)
         return S_OK;
     }
 
-    CSingleLock lock(&_readLock, TRUE);
+    _pointInShapefileIndex.Clear();
 
-    const int size = _shapeData.size();
-    _polySf.resize(size);
+    std::vector<Point2D> points;
+    std::vector<int> parts;
 
+    const int size = _shapeData.size();
     for (int nShape = 0; nShape < size; nShape++)
     {
-        fseek(_shpfile, _shpOffsets[nShape] + sizeof(int) * 2, SEEK_SET);
-        int shpType;
-        fread(&shpType, sizeof(int), 1, _shpfile);
+        // shape type is followed by the header
+        const __int64 offset = _shpOffsets[nShape] + sizeof(int) * 2;
+
+        int shpType = SHP_NULLSHAPE;
+        ReadShpBytes(offset, &shpType, sizeof(int));
         if (shpType != SHP_POLYGON && shpType != SHP_POLYGONM && shpType != SHP_POLYGONZ)
         {
+            _pointInShapefileIndex.Clear();
             *retval = VARIANT_FALSE;
             ErrorMessage(tkUNEXPECTED_SHAPE_TYPE);
             return S_OK;
         }
 
-        PolygonShapefile& sf = _polySf[nShape];
-        fread(&sf.shpHeader, sizeof(ShapeHeader), 1, _shpfile);
+        ShapeHeader header;
+        memset(&header, 0, sizeof(ShapeHeader));
+        ReadShpBytes(offset + sizeof(int), &header, sizeof(ShapeHeader));
 
-        if (sf.shpHeader.NumPoints > 0 && sf.shpHeader.NumParts > 0)
+        if (header.NumPoints > 0 && header.NumParts > 0)
         {
-            sf.Points.resize(sf.shpHeader.NumPoints);
-            sf.Parts.resize(sf.shpHeader.NumParts + 1);
-            fread(&sf.Parts[0], sizeof(int), sf.shpHeader.NumParts, _shpfile);
-            fread(&sf.Points[0], sizeof(Point2D), sf.shpHeader.NumPoints, _shpfile);
-            sf.Parts[sf.shpHeader.NumParts] = sf.shpHeader.NumPoints;
+            const __int64 partsOffset = offset + sizeof(int) + sizeof(ShapeHeader);
+            points.resize(header.NumPoints);
+            parts.resize(header.NumParts + 1);
+            ReadShpBytes(partsOffset, &parts[0], sizeof(int) * header.NumParts);
+            ReadShpBytes(partsOffset + sizeof(int) * header.NumParts, &points[0], sizeof(Point2D) * header.NumPoints);
+            parts[header.NumParts] = header.NumPoints;
+
+            _pointInShapefileIndex.AddPolygon(nShape, header.MinX, header.MinY, header.MaxX, header.MaxY,
+                                              &points[0], header.NumPoints, &parts[0], header.NumParts);
             *retval = VARIANT_TRUE;
         }
         else
@@ -3130,6 +3228,8 @@ STDMETHODIMP CShapefile::BeginPointInShapefile(VARIANT_BOOL* retval)
             *retval = VARIANT_FALSE;
         }
     }
+
+    _pointInShapefileIndex.Finish();
     return S_OK;
 }
 
@@ -3140,7 +3240,7 @@ STDMETHODIMP CShapefile::EndPointInShapefile()
 {
     AFX_MANAGE_STATE(AfxGetStaticModuleState());
 
-    _polySf.clear();
+    _pointInShapefileIndex.Clear();
 
     return S_OK;
 }
@@ -3738,6 +3838,7 @@ STDMETHODIMP CShapefile::Segmentize(double metersTolerance, IShapefile** retVal)
     // convert Shapefile units to meters
     GetUtils()->ConvertDistance(layerUnits, tkUnitsOfMeasure::umMeters, &oneMeter, &vb);
 
+    std::vector<int> shapes;
     for (long i = 0; i < shapeCount; i++)
     {
         CallbackHelper::Progress(_globalCallback, i, shapeCount, "Segmentizing...", _key, percent);
@@ -3750,7 +3851,7 @@ STDMETHODIMP CShapefile::Segmentize(double metersTolerance, IShapefile** retVal)
             //const QTreeExtent query(xMin, xMax, yMax, yMin);
             const QTreeExtent query(xMin - (metersTolerance * oneMeter), xMax + (metersTolerance * oneMeter),
                                     yMax + (metersTolerance * oneMeter), yMin - (metersTolerance * oneMeter));
-            std::vector<int> shapes = this->_tempTree->GetNodes(query);
+            this->_tempTree->GetNodes(query, shapes);
 
             // calculation union of all geometries
             if (!shapes.empty())
@@ -3855,7 +3956,7 @@ double CalcMinAngle(GEOSGeometry* geom, double& xCent, double& yCent)
 Coloring::ColorGraph* CShapefile::GeneratePolygonColors()
 {
     GenerateTempQTree(false);
-    QTree* tree = GetTempQTree();
+    CPackedRTree* tree = GetTempQTree();
     ReadGeosGeometries(VARIANT_FALSE);
 
     const long numShapes = _shapeData.size();
@@ -3866,13 +3967,14 @@ Coloring::ColorGraph* CShapefile::GeneratePolygonColors()
     // ---------------------------------------
     //  spatial relations
     // ---------------------------------------
+    vector<int> shapeIds;
     for (size_t i = 0; i < _shapeData.size(); i++)
     {
         CallbackHelper::Progress(_globalCallback, i, numShapes, "Calculating spatial relations...", _key, percent);
 
         double xMin, xMax, yMin, yMax;
         this->QuickExtentsCore(i, &xMin, &yMin, &xMax, &yMax);
-        vector<int> shapeIds = tree->GetNodes(QTreeExtent(xMin, xMax, yMax, yMin));
+        tree->GetNodes(QTreeExtent(xMin, xMax, yMax, yMin), shapeIds);
 
         graph->InsertNode(i);
 
@@ -89,36 +89,18 @@ STDMETHODIMP CShapefile::get_NumPoints(long ShapeIndex, long *pVal)
 		return S_OK;
 	}
 
-	CSingleLock lock(&_readLock, TRUE);
-
-	// get the Info from the disk
-	fseek(_shpfile, _shpOffsets[ShapeIndex], SEEK_SET);
-	
-	int intbuf;
-	fread(&intbuf, sizeof(int), 1, _shpfile);
-	ShapeUtility::SwapEndian((char*)&intbuf, sizeof(int));
-	
-	// shape records are 1 based
-	if( intbuf != ShapeIndex + 1 && intbuf != ShapeIndex )
-    {
-		ErrorMessage(tkINVALID_SHP_FILE);
+	// get the Info from the disk; only shape type, bounds and counts are needed (44 bytes)
+	int contentLength = ReadShapeRecordLength(ShapeIndex);
+	if (contentLength <= 0) {
 		return FALSE;
 	}
-	
-	fread(&intbuf,sizeof(int), 1, _shpfile);
-	ShapeUtility::SwapEndian((char*)&intbuf, sizeof(int));
 
-	int contentLength = intbuf*2;	//(16 to 32 bit words)
-	if (contentLength <= 0) {
+	int intdata[11];
+	memset(intdata, 0, sizeof(intdata));
+	if (!ReadShpBytes(_shpOffsets[ShapeIndex] + sizeof(int) * 2, intdata, min(contentLength, (int)sizeof(intdata)))) {
 		return FALSE;
 	}
 
-	long numParts=0, numPoints=0;
-	
-	char * cdata = new char[contentLength];
-	fread(cdata, sizeof(char), contentLength, _shpfile);
-	
-	int * intdata = (int*)cdata;						
 	ShpfileType shapetype = (ShpfileType)intdata[0];
 	
 	shapetype = ShapeUtility::Convert2D(shapetype);
@@ -130,14 +112,15 @@ STDMETHODIMP CShapefile::get_NumPoints(long ShapeIndex, long *pVal)
 	{
 		*pVal = 1;
 	}
+	else if (shapetype == SHP_MULTIPOINT)
+	{
+		*pVal = intdata[9];
+	}
 	else
 	{
 		*pVal = intdata[10];
 	}
 
-	delete [] cdata;
-	cdata = NULL;
-
 	return S_OK;
 }
 
@@ -160,19 +143,12 @@ STDMETHODIMP CShapefile::QuickPoint(long ShapeIndex, long PointIndex, IPoint **r
 		}
 		else
 		{	
-			CSingleLock lock(&_readLock, TRUE);
-
 			//Get the Info from the disk
-			fseek(_shpfile,_shpOffsets[ShapeIndex],SEEK_SET);
+			int contentLength;
+			char * cdata = ReadShapeRecord(ShapeIndex, contentLength);
 
-			int intbuf;
-			fread(&intbuf,sizeof(int),1,_shpfile);
-			ShapeUtility::SwapEndian((char*)&intbuf,sizeof(int));
-
-			//Shape records are 1 based
-			if( intbuf != ShapeIndex + 1 && intbuf != ShapeIndex )
+			if( !cdata )
 			{	
-				ErrorMessage(tkINVALID_SHP_FILE);
 				*retval = NULL;
 			}
 			else
@@ -180,22 +156,11 @@ STDMETHODIMP CShapefile::QuickPoint(long ShapeIndex, long PointIndex, IPoint **r
 				bool validPoint = true;
 				double x=0.0, y=0.0, z=0.0, m=0.0;
 				
-				fread(&intbuf,sizeof(int),1,_shpfile);
-				ShapeUtility::SwapEndian((char*)&intbuf,sizeof(int));
-				int contentLength = intbuf*2;	//(16 to 32 bit words)
-				
-				if( contentLength <= 0 )
-					return FALSE;
-
 				long numParts=0, numPoints=0;
-				char * cdata = new char[contentLength];
-				fread(cdata,sizeof(char),contentLength,_shpfile);
 				int * intdata = (int*)cdata;						
 				ShpfileType shapetype = (ShpfileType)intdata[0];
 				double * pntdata;
 
-				lock.Unlock();
-
 				if( shapetype == SHP_NULLSHAPE )
 				{
 					*retval = NULL;				
@@ -375,30 +340,16 @@ STDMETHODIMP CShapefile::QuickPoints(long ShapeIndex, long *NumPoints, SAFEARRAY
 		else
 		{	
 			// get the Info from the disk
-			fseek(_shpfile,_shpOffsets[ShapeIndex],SEEK_SET);
-
-			int intbuf;
-			fread(&intbuf,sizeof(int),1,_shpfile);
-			ShapeUtility::SwapEndian((char*)&intbuf,sizeof(int));
+			int contentLength;
+			char * cdata = ReadShapeRecord(ShapeIndex, contentLength);
 
-			//Shape records are 1 based
-			if( intbuf != ShapeIndex + 1 && intbuf != ShapeIndex )
+			if( !cdata )
 			{	
-				ErrorMessage( tkINVALID_SHP_FILE );
 				*retval = NULL;
 			}
 			else
 			{
-				fread(&intbuf,sizeof(int),1,_shpfile);
-				ShapeUtility::SwapEndian((char*)&intbuf,sizeof(int));
-				int contentLength = intbuf*2;//(16 to 32 bit words)
-				
-				if( contentLength <= 0 )
-					return FALSE;
-
 				long numParts=0, numPoints=0;
-				char * cdata = new char[contentLength];
-				fread(cdata,sizeof(char),contentLength,_shpfile);
 				int * intdata = (int*)cdata;						
 				ShpfileType shapetype = (ShpfileType)intdata[0];
 				double * pntdata;
@@ -601,39 +552,22 @@ bool CShapefile::QuickExtentsCore(long ShapeIndex, Extent& result)
 //	   ReadShapeExtents()
 // *****************************************************************
 bool CShapefile::ReadShapeExtents(long ShapeIndex, Extent& result)
-{	CSingleLock lock(&_readLock, TRUE);
-
-	//Get the Info from the disk
-	fseek(_shpfile, _shpOffsets[ShapeIndex], SEEK_SET);
-
-	int intbuf;
-	fread(&intbuf, sizeof(int), 1, _shpfile);
-	ShapeUtility::SwapEndian((char*)&intbuf, sizeof(int));
-
-	//Shape records are 1 based
-	if (intbuf != ShapeIndex + 1 && intbuf != ShapeIndex)
-	{
-		ErrorMessage(tkINVALID_SHP_FILE);
-		return false;
-	}
-	
-	fread(&intbuf, sizeof(int), 1, _shpfile);
-	ShapeUtility::SwapEndian((char*)&intbuf, sizeof(int));
-	int contentLength = intbuf * 2;//(16 to 32 bit words)
-
+{	//Get the Info from the disk
+	int contentLength = ReadShapeRecordLength(ShapeIndex);
 	if (contentLength <= 0)
 		return FALSE;
 
+	// shape type and bounds only, no need to read the points
+	int intdata[9];
+	memset(intdata, 0, sizeof(intdata));
+	if (!ReadShpBytes(_shpOffsets[ShapeIndex] + sizeof(int) * 2, intdata, min(contentLength, (int)sizeof(intdata))))
+		return FALSE;
+
 	bool bSuccess = false;
 
-	char * cdata = new char[contentLength];
-	fread(cdata, sizeof(char), contentLength, _shpfile);
-	int * intdata = (int*)cdata;
 	ShpfileType shapetype = (ShpfileType)intdata[0];
 	double * bnds;
 
-	lock.Unlock();
-
 	if (shapetype == SHP_NULLSHAPE)
 	{
 		bSuccess = false;
@@ -665,10 +599,6 @@ bool CShapefile::ReadShapeExtents(long ShapeIndex, Extent& result)
 		bSuccess = false;
 	}
 
-	// make sure to always delete allocation
-	delete[] cdata;
-	cdata = NULL;
-	// return status
 	return bSuccess;
 }
 
@@ -58,891 +58,205 @@ STDMETHODIMP CShapefile::get_Shape(long ShapeIndex, IShape **pVal)
 		return S_OK;
 	}
 
-	CSingleLock lock(&_readLock, TRUE);
-
+	// no locking: records are read with positional reads, so several threads can read shapes at once
 	*pVal = _fastMode ? ReadFastModeShape(ShapeIndex) : ReadComShape(ShapeIndex);
 
 	return S_OK;
 }
 
 // ************************************************************
-//		ReadFastModeShape()
+//		ReadShpBytes()
 // ************************************************************
-IShape* CShapefile::ReadFastModeShape(long ShapeIndex)
-{	fseek(_shpfile, _shpOffsets[ShapeIndex], SEEK_SET);
-
-	// read the shp from disk
-	int index = ShapeUtility::ReadIntBigEndian(_shpfile);
-
-	if (index != ShapeIndex + 1)
+// Reads the given range of .shp file without moving the shared file cursor;
+// falls back to the locked fseek/fread if positional reader isn't available
+bool CShapefile::ReadShpBytes(__int64 offset, void* buffer, int length)
+{
+	if (_shpRecords.IsOpen())
 	{
-		ErrorMessage(tkINVALID_SHP_FILE);
-		return NULL;
+		return _shpRecords.Read(offset, buffer, length);
 	}
 
-	int contentLength = ShapeUtility::ReadIntBigEndian(_shpfile) * 2;
+	CSingleLock lock(&_readLock, TRUE);
 
-	// *2: for conversion from 16-bit words to 8-bit words
-	// -2: skip first 2 int - it's record number and content length;
-	int length = contentLength; //- 2 * sizeof(int);
+	if (!_shpfile || fseek(_shpfile, (long)offset, SEEK_SET) != 0) {
+		return false;
+	}
 
-	char* data = new char[length];
-	int count = (int)fread(data, sizeof(char), length, _shpfile);
+	return (int)fread(buffer, sizeof(char), length, _shpfile) == length;
+}
 
-	if (count != length)
-	{
-		delete[] data;
-		return NULL;
-	}
+// ************************************************************
+//		get_MappedFiles()
+// ************************************************************
+// Maps .shp and .shx on the first call and keeps them mapped,
+// so that each redraw doesn't have to map them again
+bool CShapefile::get_MappedFiles(CMappedFile*& shp, CMappedFile*& shx)
+{
+	shp = NULL;
+	shx = NULL;
 
-	IShape* shape = NULL;
+	CSingleLock lock(&_readLock, TRUE);
 
-	if (data != NULL)
+	if (!_shpMapping.IsOpen() || !_shxMapping.IsOpen())
 	{
-		ComHelper::CreateShape(&shape);
-		shape->put_GlobalCallback(_globalCallback);
-		((CShape*)shape)->put_RawData(data, contentLength);
-		delete[] data;
+		if (_sourceType != sstDiskBased || _isEditingShapes || _appendMode || _writing) {
+			return false;
+		}
+
+		if (!_shxMapping.Open(_shxfileName) || _shxMapping.get_Size() < 100 ||
+			!_shpMapping.Open(_shpfileName))
+		{
+			CloseMappedFiles();
+			return false;
+		}
 	}
 
-	return shape;
+	shp = &_shpMapping;
+	shx = &_shxMapping;
+	return true;
 }
 
 // ************************************************************
-//		ReadComShape()
+//		CloseMappedFiles()
 // ************************************************************
-IShape* CShapefile::ReadComShape(long ShapeIndex)
-{	// read the shp from disk
-	fseek(_shpfile, _shpOffsets[ShapeIndex], SEEK_SET);
+// Must be called before .shp/.shx are rewritten or closed; pointers
+// into the mapping that were handed out earlier become invalid
+void CShapefile::CloseMappedFiles()
+{
+	CSingleLock lock(&_readLock, TRUE);
 
-	int intbuf;
-	fread(&intbuf, sizeof(int), 1, _shpfile);
-	ShapeUtility::SwapEndian((char*)&intbuf, sizeof(int));
+	_shpMapping.Close();
+	_shxMapping.Close();
+}
 
-	// shape records are 1 based - Allow for a mistake
-	if (intbuf != ShapeIndex + 1 && intbuf != ShapeIndex)
+// ************************************************************
+//		ReadShapeRecordLength()
+// ************************************************************
+// Reads the record header; returns content length in bytes or -1 on failure
+int CShapefile::ReadShapeRecordLength(long ShapeIndex)
+{
+	int header[2];		// record number and content length
+	if (!ReadShpBytes(_shpOffsets[ShapeIndex], header, sizeof(int) * 2))
 	{
 		ErrorMessage(tkINVALID_SHP_FILE);
-		return NULL;
+		return -1;
 	}
-	
-	fread(&intbuf, sizeof(int), 1, _shpfile);
-	ShapeUtility::SwapEndian((char*)&intbuf, sizeof(int));
-	int contentLength = intbuf * 2;//(32 bit words)
-
-	fread(&intbuf, sizeof(int), 1, _shpfile);
 
-	ShpfileType shpType = (ShpfileType)intbuf;
+	ShapeUtility::SwapEndian((char*)&header[0], sizeof(int));
+	ShapeUtility::SwapEndian((char*)&header[1], sizeof(int));
 
-	IShape * shape = NULL;
-	IPoint * pnt = NULL;
-	VARIANT_BOOL vbretval;
-
-#pragma region Nullshape Or Mismatch
-	// ------------------------------------------------------
-	//	  Shape specific record contents
-	// ------------------------------------------------------
-	
-	// MWGIS-91
-	bool areEqualTypes = shpType == _shpfiletype;
-	if (!areEqualTypes){
-		areEqualTypes = ShapeUtility::Convert2D(shpType) == ShapeUtility::Convert2D(_shpfiletype);
-	}
-	
-	if (_shpfiletype == SHP_NULLSHAPE)
-	{
-		if (shpType != SHP_NULLSHAPE)
-		{
-			ErrorMessage(tkINVALID_SHP_FILE);
-			return NULL;
-		}
-		else
-		{
-			shape->Create(shpType, &vbretval);
-			shape->put_GlobalCallback(_globalCallback);
-			return shape;
-		}
-	}
-	else if (shpType != SHP_NULLSHAPE && !areEqualTypes)
+	// shape records are 1 based - Allow for a mistake
+	if (header[0] != ShapeIndex + 1 && header[0] != ShapeIndex)
 	{
 		ErrorMessage(tkINVALID_SHP_FILE);
-		return NULL;
-	}
-#pragma endregion
-
-#pragma region Point
-	// ------------------------------------------------------
-	//	  SHP_POINT
-	// ------------------------------------------------------
-	else if (_shpfiletype == SHP_POINT)
-	{
-		ComHelper::CreateShape(&shape);
-		shape->Create(shpType, &vbretval);
-		shape->put_GlobalCallback(_globalCallback);
-
-		// if (shpType == SHP_POINT)
-		if (areEqualTypes)
-		{
-			ComHelper::CreatePoint(&pnt);
-			pnt->put_GlobalCallback(_globalCallback);
-
-			double x, y;
-			fread(&x, sizeof(double), 1, _shpfile);
-			fread(&y, sizeof(double), 1, _shpfile);
-			pnt->put_X(x);
-			pnt->put_Y(y);
-
-			long pointIndex = 0;
-			shape->InsertPoint(pnt, &pointIndex, &vbretval);
-			if (vbretval == VARIANT_FALSE)
-			{
-				shape->Release();
-				return NULL;
-			}
-			pnt->Release();
-		}
+		return -1;
 	}
 
-	// ------------------------------------------------------
-	//	  SHP_POINTZ
-	// ------------------------------------------------------
-	else if (_shpfiletype == SHP_POINTZ)
-	{
-		ComHelper::CreateShape(&shape);
-		shape->Create(shpType, &vbretval);
-		shape->put_GlobalCallback(_globalCallback);
+	// *2: for conversion from 16-bit words to 8-bit words
+	return header[1] * 2;
+}
 
-		// if (shpType == SHP_POINTZ)
-		if (areEqualTypes)
-		{
-			ComHelper::CreatePoint(&pnt);
-			pnt->put_GlobalCallback(_globalCallback);
-
-			double x, y, z, m;
-			fread(&x, sizeof(double), 1, _shpfile);
-			fread(&y, sizeof(double), 1, _shpfile);
-			fread(&z, sizeof(double), 1, _shpfile);
-			fread(&m, sizeof(double), 1, _shpfile);
-			pnt->put_X(x);
-			pnt->put_Y(y);
-			pnt->put_Z(z);
-			pnt->put_M(m);
-
-			long pointIndex = 0;
-			shape->InsertPoint(pnt, &pointIndex, &vbretval);
-			if (vbretval == VARIANT_FALSE)
-			{
-				shape->Release();
-				return NULL;
-			}
-			pnt->Release();
-		}
+// ************************************************************
+//		ReadShapeRecord()
+// ************************************************************
+// Returns the content of the record starting with shape type; the caller must delete[] it
+char* CShapefile::ReadShapeRecord(long ShapeIndex, int& contentLength)
+{
+	contentLength = ReadShapeRecordLength(ShapeIndex);
+	if (contentLength < (int)sizeof(int)) {
+		return NULL;
 	}
 
-	// ------------------------------------------------------
-	//	  SHP_POINTM
-	// ------------------------------------------------------
-	else if (_shpfiletype == SHP_POINTM)
+	char* data = new char[contentLength];
+	if (!ReadShpBytes(_shpOffsets[ShapeIndex] + sizeof(int) * 2, data, contentLength))
 	{
-		ComHelper::CreateShape(&shape);
-		shape->Create(shpType, &vbretval);
-		shape->put_GlobalCallback(_globalCallback);
-
-		// if (shpType == SHP_POINTM)
-		if (areEqualTypes)
-		{
-			ComHelper::CreatePoint(&pnt);
-			pnt->put_GlobalCallback(_globalCallback);
-
-			double x, y, m;
-			fread(&x, sizeof(double), 1, _shpfile);
-			fread(&y, sizeof(double), 1, _shpfile);
-			fread(&m, sizeof(double), 1, _shpfile);
-			pnt->put_X(x);
-			pnt->put_Y(y);
-			pnt->put_M(m);
-
-			long pointIndex = 0;
-			shape->InsertPoint(pnt, &pointIndex, &vbretval);
-			if (vbretval == VARIANT_FALSE)
-			{
-				shape->Release();
-				return NULL;
-			}
-			pnt->Release();
-		}
+		delete[] data;
+		return NULL;
 	}
-#pragma endregion
-#pragma region Polyline
-	// ------------------------------------------------------
-	//	  SHP_POLYLINE
-	// ------------------------------------------------------
-	else if (_shpfiletype == SHP_POLYLINE)
-	{
-		ComHelper::CreateShape(&shape);
-		shape->Create(shpType, &vbretval);
-		shape->put_GlobalCallback(_globalCallback);
 
-		// if (shpType == SHP_POLYLINE)
-		if (areEqualTypes)
-		{
-			VARIANT_BOOL retval;
-			double bx, by;
-			int numParts;
-			int numPoints;
-			int part;
-			double x, y;
-
-			fread(&bx, sizeof(double), 1, _shpfile);
-			fread(&by, sizeof(double), 1, _shpfile);
-			fread(&bx, sizeof(double), 1, _shpfile);
-			fread(&by, sizeof(double), 1, _shpfile);
-
-			fread(&numParts, sizeof(int), 1, _shpfile);
-			fread(&numPoints, sizeof(int), 1, _shpfile);
-
-			long partIndex = 0;
-			for (int i = 0; i < numParts; i++)
-			{
-				fread(&part, sizeof(int), 1, _shpfile);
-				partIndex = i;
-				shape->InsertPart(part, &partIndex, &retval);
-				if (retval == VARIANT_FALSE)
-				{
-					shape->Release();
-					return NULL;
-				}
-			}
+	return data;
+}
 
-			long pointIndex = 0;
-			for (int j = 0; j < numPoints; j++)
-			{
-				ComHelper::CreatePoint(&pnt);
-				pnt->put_GlobalCallback(_globalCallback);
-				fread(&x, sizeof(double), 1, _shpfile);
-				fread(&y, sizeof(double), 1, _shpfile);
-				pnt->put_X(x);
-				pnt->put_Y(y);
-				pointIndex = j;
-				shape->InsertPoint(pnt, &pointIndex, &retval);
-				if (retval == VARIANT_FALSE)
-				{
-					shape->Release();
-					return NULL;
-				}
-				pnt->Release();
-			}
-		}
+// ************************************************************
+//		ReadFastModeShape()
+// ************************************************************
+IShape* CShapefile::ReadFastModeShape(long ShapeIndex)
+{
+	int contentLength;
+	char* data = ReadShapeRecord(ShapeIndex, contentLength);
+	if (!data) {
+		return NULL;
 	}
 
-	// ------------------------------------------------------
-	//	  SHP_POLYLINEZ
-	// ------------------------------------------------------
-	else if (_shpfiletype == SHP_POLYLINEZ)
-	{
-		ComHelper::CreateShape(&shape);
-		shape->Create(shpType, &vbretval);
-		shape->put_GlobalCallback(_globalCallback);
-		// if (shpType == SHP_POLYLINEZ)
-		if (areEqualTypes)
-		{
-			VARIANT_BOOL retval;
-			double bx, by, bz, bm;
-			int numParts;
-			int numPoints;
-			int part;
-			double x, y, z, m;
-
-			fread(&bx, sizeof(double), 1, _shpfile);
-			fread(&by, sizeof(double), 1, _shpfile);
-			fread(&bx, sizeof(double), 1, _shpfile);
-			fread(&by, sizeof(double), 1, _shpfile);
-
-			fread(&numParts, sizeof(int), 1, _shpfile);
-			fread(&numPoints, sizeof(int), 1, _shpfile);
-
-			long partIndex = 0;
-			for (int i = 0; i < numParts; i++)
-			{
-				fread(&part, sizeof(int), 1, _shpfile);
-				partIndex = i;
-				shape->InsertPart(part, &partIndex, &retval);
-				if (retval == VARIANT_FALSE)
-				{
-					shape->Release();
-					return NULL;
-				}
-			}
-
-			long pointIndex = 0;
-			//Read the x, y part of the point
-			for (int j = 0; j < numPoints; j++)
-			{
-				ComHelper::CreatePoint(&pnt);
-				pnt->put_GlobalCallback(_globalCallback);
-				fread(&x, sizeof(double), 1, _shpfile);
-				fread(&y, sizeof(double), 1, _shpfile);
-				pnt->put_X(x);
-				pnt->put_Y(y);
-				pointIndex = j;
-				shape->InsertPoint(pnt, &pointIndex, &retval);
-				if (retval == VARIANT_FALSE)
-				{
-					shape->Release();
-					return NULL;
-				}
-				pnt->Release();
-			}
-
-			fread(&bz, sizeof(double), 1, _shpfile);
-			fread(&bz, sizeof(double), 1, _shpfile);
-
-			for (int k = 0; k < numPoints; k++)
-			{
-				fread(&z, sizeof(double), 1, _shpfile);
-				pointIndex = k;
-				IPoint * pnt = NULL;
-				shape->get_Point(pointIndex, &pnt);
-				if (pnt == NULL)
-				{
-					shape->Release();
-					return NULL;
-				}
-				pnt->put_Z(z);
-				pnt->Release();
-			}
+	IShape* shape = NULL;
+	ComHelper::CreateShape(&shape);
+	shape->put_GlobalCallback(_globalCallback);
+	((CShape*)shape)->put_RawData(data, contentLength);
+	delete[] data;
 
-			fread(&bm, sizeof(double), 1, _shpfile);
-			fread(&bm, sizeof(double), 1, _shpfile);
+	return shape;
+}
 
-			for (int mc = 0; mc < numPoints; mc++)
-			{
-				fread(&m, sizeof(double), 1, _shpfile);
-				pointIndex = mc;
-				IPoint * pnt = NULL;
-				shape->get_Point(pointIndex, &pnt);
-				if (pnt == NULL)
-				{
-					shape->Release();
-					return NULL;
-				}
-				pnt->put_M(m);
-				//Rob Cairns 20-Dec-05
-				pnt->Release();
-			}
-		}
+// ************************************************************
+//		ReadComShape()
+// ************************************************************
+IShape* CShapefile::ReadComShape(long ShapeIndex)
+{
+	int contentLength;
+	char* data = ReadShapeRecord(ShapeIndex, contentLength);
+	if (!data) {
+		return NULL;
 	}
 
-	// ------------------------------------------------------
-	//	  SHP_POLYLINEM
-	// ------------------------------------------------------
-	else if (_shpfiletype == SHP_POLYLINEM)
-	{
-		ComHelper::CreateShape(&shape);
-		shape->Create(shpType, &vbretval);
-		shape->put_GlobalCallback(_globalCallback);
+	IShape* shape = CreateComShape(data, contentLength);
+	delete[] data;
 
-		// if (shpType == SHP_POLYLINEM)
-		if (areEqualTypes)
-		{
-			VARIANT_BOOL retval;
-			double bx, by, bm;
-			int numParts;
-			int numPoints;
-			int part;
-			double x, y, m;
-
-			fread(&bx, sizeof(double), 1, _shpfile);
-			fread(&by, sizeof(double), 1, _shpfile);
-			fread(&bx, sizeof(double), 1, _shpfile);
-			fread(&by, sizeof(double), 1, _shpfile);
-
-			fread(&numParts, sizeof(int), 1, _shpfile);
-			fread(&numPoints, sizeof(int), 1, _shpfile);
-
-			long partIndex = 0;
-			for (int i = 0; i < numParts; i++)
-			{
-				fread(&part, sizeof(int), 1, _shpfile);
-				partIndex = i;
-				shape->InsertPart(part, &partIndex, &retval);
-				if (retval == VARIANT_FALSE)
-				{
-					shape->Release();
-					return NULL;
-				}
-			}
-
-			long pointIndex = 0;
-			//Read the x, y part of the point
-			for (int j = 0; j < numPoints; j++)
-			{
-				ComHelper::CreatePoint(&pnt);
-				pnt->put_GlobalCallback(_globalCallback);
-				fread(&x, sizeof(double), 1, _shpfile);
-				fread(&y, sizeof(double), 1, _shpfile);
-				pnt->put_X(x);
-				pnt->put_Y(y);
-				pointIndex = j;
-				shape->InsertPoint(pnt, &pointIndex, &retval);
-				if (retval == VARIANT_FALSE)
-				{
-					shape->Release();
-					return NULL;
-				}
-				pnt->Release();
-			}
-
-			fread(&bm, sizeof(double), 1, _shpfile);
-			fread(&bm, sizeof(double), 1, _shpfile);
-
-			for (int mc = 0; mc < numPoints; mc++)
-			{
-				fread(&m, sizeof(double), 1, _shpfile);
-				pointIndex = mc;
-				IPoint * pnt = NULL;
-				shape->get_Point(pointIndex, &pnt);
-				if (pnt == NULL)
-				{
-					shape->Release();
-					return NULL;
-				}
-				pnt->put_M(m);
-				pnt->Release();
-
-			}
-		}
-	}
-#pragma endregion
-#pragma region Polygon
-	// ------------------------------------------------------
-	//	  SHP_POLYGON
-	// ------------------------------------------------------
-	else if (_shpfiletype == SHP_POLYGON)
-	{
-		ComHelper::CreateShape(&shape);
-		shape->Create(shpType, &vbretval);
-		shape->put_GlobalCallback(_globalCallback);
+	return shape;
+}
 
-		// if (shpType == SHP_POLYGON)
-		if (areEqualTypes)
-		{
-			VARIANT_BOOL retval;
-			double bx, by;
-			int numParts;
-			int numPoints;
-			int part;
-			double x, y;
-
-			fread(&bx, sizeof(double), 1, _shpfile);
-			fread(&by, sizeof(double), 1, _shpfile);
-			fread(&bx, sizeof(double), 1, _shpfile);
-			fread(&by, sizeof(double), 1, _shpfile);
-
-			fread(&numParts, sizeof(int), 1, _shpfile);
-			fread(&numPoints, sizeof(int), 1, _shpfile);
-
-			long partIndex = 0;
-			for (int i = 0; i < numParts; i++)
-			{
-				fread(&part, sizeof(int), 1, _shpfile);
-				partIndex = i;
-				shape->InsertPart(part, &partIndex, &retval);
-				if (retval == VARIANT_FALSE)
-				{
-					shape->Release();
-					return NULL;
-				}
-			}
+// ************************************************************
+//		CreateComShape()
+// ************************************************************
+// Builds shape from the content of .shp record (starting with shape type)
+IShape* CShapefile::CreateComShape(char* data, int contentLength)
+{
+	ShpfileType shpType = (ShpfileType)*(int*)data;
 
-			long pointIndex = 0;
-			for (int j = 0; j < numPoints; j++)
-			{
-				ComHelper::CreatePoint(&pnt);
-				pnt->put_GlobalCallback(_globalCallback);
-				fread(&x, sizeof(double), 1, _shpfile);
-				fread(&y, sizeof(double), 1, _shpfile);
-				pnt->put_X(x);
-				pnt->put_Y(y);
-				pointIndex = j;
-				shape->InsertPoint(pnt, &pointIndex, &retval);
-				if (retval == VARIANT_FALSE)
-				{
-					shape->Release();
-					return NULL;
-				}
-				pnt->Release();
-			}
-		}
+	// MWGIS-91
+	bool areEqualTypes = shpType == _shpfiletype;
+	if (!areEqualTypes){
+		areEqualTypes = ShapeUtility::Convert2D(shpType) == ShapeUtility::Convert2D(_shpfiletype);
 	}
 
-	// ------------------------------------------------------
-	//	  SHP_POLYGONZ
-	// ------------------------------------------------------
-	else if (_shpfiletype == SHP_POLYGONZ)
+	if (_shpfiletype == SHP_NULLSHAPE && shpType != SHP_NULLSHAPE)
 	{
-		ComHelper::CreateShape(&shape);
-		shape->Create(shpType, &vbretval);
-		shape->put_GlobalCallback(_globalCallback);
-		// if (shpType == SHP_POLYGONZ)
-		if (areEqualTypes)
-		{
-			VARIANT_BOOL retval;
-			double bx, by, bz, bm;
-			int numParts;
-			int numPoints;
-			int part;
-			double x, y, z, m;
-
-			fread(&bx, sizeof(double), 1, _shpfile);
-			fread(&by, sizeof(double), 1, _shpfile);
-			fread(&bx, sizeof(double), 1, _shpfile);
-			fread(&by, sizeof(double), 1, _shpfile);
-
-			fread(&numParts, sizeof(int), 1, _shpfile);
-			fread(&numPoints, sizeof(int), 1, _shpfile);
-
-			long partIndex = 0;
-			for (int i = 0; i < numParts; i++)
-			{
-				fread(&part, sizeof(int), 1, _shpfile);
-				partIndex = i;
-				shape->InsertPart(part, &partIndex, &retval);
-				if (retval == VARIANT_FALSE)
-				{
-					shape->Release();
-					return NULL;
-				}
-			}
-
-			//Read the x, y part of the point
-			long pointIndex = 0;
-			for (int j = 0; j < numPoints; j++)
-			{
-				ComHelper::CreatePoint(&pnt);
-				pnt->put_GlobalCallback(_globalCallback);
-				fread(&x, sizeof(double), 1, _shpfile);
-				fread(&y, sizeof(double), 1, _shpfile);
-				pnt->put_X(x);
-				pnt->put_Y(y);
-				pointIndex = j;
-				shape->InsertPoint(pnt, &pointIndex, &retval);
-				if (retval == VARIANT_FALSE)
-				{
-					shape->Release();
-					return NULL;
-				}
-				pnt->Release();
-			}
-
-			fread(&bz, sizeof(double), 1, _shpfile);
-			fread(&bz, sizeof(double), 1, _shpfile);
-
-			for (int k = 0; k < numPoints; k++)
-			{
-				fread(&z, sizeof(double), 1, _shpfile);
-				pointIndex = k;
-				IPoint * pnt = NULL;
-				shape->get_Point(pointIndex, &pnt);
-				if (pnt == NULL)
-				{
-					shape->Release();
-					return NULL;
-				}
-				pnt->put_Z(z);
-				pnt->Release();
-			}
-
-			fread(&bm, sizeof(double), 1, _shpfile);
-			fread(&bm, sizeof(double), 1, _shpfile);
-
-			for (int mc = 0; mc < numPoints; mc++)
-			{
-				fread(&m, sizeof(double), 1, _shpfile);
-				pointIndex = mc;
-				IPoint * pnt = NULL;
-				shape->get_Point(pointIndex, &pnt);
-				if (pnt == NULL)
-				{
-					shape->Release();
-					return NULL;
-				}
-				pnt->put_M(m);
-				pnt->Release();
-			}
-		}
+		ErrorMessage(tkINVALID_SHP_FILE);
+		return NULL;
 	}
-
-	// ------------------------------------------------------
-	//	  SHP_POLYGONM
-	// ------------------------------------------------------
-	else if (_shpfiletype == SHP_POLYGONM)
+	
+	if (shpType != SHP_NULLSHAPE && !areEqualTypes)
 	{
-		ComHelper::CreateShape(&shape);
-		shape->Create(shpType, &vbretval);
-		shape->put_GlobalCallback(_globalCallback);
-		// if (shpType == SHP_POLYGONM)
-		if (areEqualTypes)
-		{
-			VARIANT_BOOL retval;
-			double bx, by, bm;
-			int numParts;
-			int numPoints;
-			int part;
-			double x, y, m;
-
-			fread(&bx, sizeof(double), 1, _shpfile);
-			fread(&by, sizeof(double), 1, _shpfile);
-			fread(&bx, sizeof(double), 1, _shpfile);
-			fread(&by, sizeof(double), 1, _shpfile);
-
-			fread(&numParts, sizeof(int), 1, _shpfile);
-			fread(&numPoints, sizeof(int), 1, _shpfile);
-
-			long partIndex = 0;
-			for (int i = 0; i < numParts; i++)
-			{
-				fread(&part, sizeof(int), 1, _shpfile);
-				partIndex = i;
-				shape->InsertPart(part, &partIndex, &retval);
-				if (retval == VARIANT_FALSE)
-				{
-					shape->Release();
-					return NULL;
-				}
-			}
-
-			//Read the x, y part of the point
-			long pointIndex = 0;
-			for (int j = 0; j < numPoints; j++)
-			{
-				ComHelper::CreatePoint(&pnt);
-				pnt->put_GlobalCallback(_globalCallback);
-				fread(&x, sizeof(double), 1, _shpfile);
-				fread(&y, sizeof(double), 1, _shpfile);
-				pnt->put_X(x);
-				pnt->put_Y(y);
-				pointIndex = j;
-				shape->InsertPoint(pnt, &pointIndex, &retval);
-				if (retval == VARIANT_FALSE)
-				{
-					shape->Release();
-					return NULL;
-				}
-				pnt->Release();
-			}
-
-			// M range
-			fread(&bm, sizeof(double), 1, _shpfile);
-			fread(&bm, sizeof(double), 1, _shpfile);
-
-			for (int mc = 0; mc < numPoints; mc++)
-			{
-				fread(&m, sizeof(double), 1, _shpfile);
-				pointIndex = mc;
-				IPoint * pnt = NULL;
-				shape->get_Point(pointIndex, &pnt);
-				if (pnt == NULL)
-				{
-					shape->Release();
-					return NULL;
-				}
-				pnt->put_M(m);
-				pnt->Release();
-			}
-		}
+		ErrorMessage(tkINVALID_SHP_FILE);
+		return NULL;
 	}
-#pragma endregion
-#pragma region Multipoint
-	// ------------------------------------------------------
-	//	  SHP_MULTIPOINT
-	// ------------------------------------------------------
-	else if (_shpfiletype == SHP_MULTIPOINT)
-	{
-		ComHelper::CreateShape(&shape);
-		shape->Create(shpType, &vbretval);
-		shape->put_GlobalCallback(_globalCallback);
-
-		// if (shpType == SHP_MULTIPOINT)
-		if (areEqualTypes)
-		{
-			VARIANT_BOOL retval;
-			double bx, by;
-			int numPoints;
-			double x, y;
-
-			fread(&bx, sizeof(double), 1, _shpfile);
-			fread(&by, sizeof(double), 1, _shpfile);
-			fread(&bx, sizeof(double), 1, _shpfile);
-			fread(&by, sizeof(double), 1, _shpfile);
-
-			fread(&numPoints, sizeof(int), 1, _shpfile);
 
-			long pointIndex = 0;
-			for (int j = 0; j < numPoints; j++)
-			{
-				ComHelper::CreatePoint(&pnt);
-				pnt->put_GlobalCallback(_globalCallback);
-				fread(&x, sizeof(double), 1, _shpfile);
-				fread(&y, sizeof(double), 1, _shpfile);
-				pnt->put_X(x);
-				pnt->put_Y(y);
-				pointIndex = j;
-				shape->InsertPoint(pnt, &pointIndex, &retval);
-				if (retval == VARIANT_FALSE)
-				{
-					shape->Release();
-					return NULL;
-				}
-				pnt->Release();
-			}
-		}
-	}
+	IShape* shape = NULL;
+	ComHelper::CreateShape(&shape);
+	shape->put_GlobalCallback(_globalCallback);
 
-	// ------------------------------------------------------
-	//	  SHP_MULTIPOINTZ
-	// ------------------------------------------------------
-	else if (_shpfiletype == SHP_MULTIPOINTZ)
+	if (shpType == SHP_NULLSHAPE)
 	{
-		ComHelper::CreateShape(&shape);
+		// null record: the shape stays empty
+		VARIANT_BOOL vbretval;
 		shape->Create(shpType, &vbretval);
-		shape->put_GlobalCallback(_globalCallback);
-
-		// if (shpType == SHP_MULTIPOINTZ)
-		if (areEqualTypes)
-		{
-			VARIANT_BOOL retval;
-			double bx, by, bz, bm;
-			int numPoints;
-			double x, y, z, m;
-
-			fread(&bx, sizeof(double), 1, _shpfile);
-			fread(&by, sizeof(double), 1, _shpfile);
-			fread(&bx, sizeof(double), 1, _shpfile);
-			fread(&by, sizeof(double), 1, _shpfile);
-
-			fread(&numPoints, sizeof(int), 1, _shpfile);
-
-			long pointIndex = 0;
-			for (int j = 0; j < numPoints; j++)
-			{
-				ComHelper::CreatePoint(&pnt);
-				pnt->put_GlobalCallback(_globalCallback);
-				fread(&x, sizeof(double), 1, _shpfile);
-				fread(&y, sizeof(double), 1, _shpfile);
-				pnt->put_X(x);
-				pnt->put_Y(y);
-				pointIndex = j;
-				shape->InsertPoint(pnt, &pointIndex, &retval);
-				if (retval == VARIANT_FALSE)
-				{
-					shape->Release();
-					return NULL;
-				}
-				pnt->Release();
-			}
-
-			fread(&bz, sizeof(double), 1, _shpfile);
-			fread(&bz, sizeof(double), 1, _shpfile);
-
-			for (int k = 0; k < numPoints; k++)
-			{
-				fread(&z, sizeof(double), 1, _shpfile);
-				pointIndex = k;
-				IPoint * pnt = NULL;
-				shape->get_Point(pointIndex, &pnt);
-				if (pnt == NULL)
-				{
-					shape->Release();
-					return NULL;
-				}
-				pnt->put_Z(z);
-				pnt->Release();
-			}
-
-			fread(&bm, sizeof(double), 1, _shpfile);
-			fread(&bm, sizeof(double), 1, _shpfile);
-
-			for (int mc = 0; mc < numPoints; mc++)
-			{
-				fread(&m, sizeof(double), 1, _shpfile);
-				pointIndex = mc;
-				IPoint * pnt = NULL;
-				shape->get_Point(pointIndex, &pnt);
-				if (pnt == NULL)
-				{
-					shape->Release();
-					return NULL;
-				}
-				pnt->put_M(m);
-				pnt->Release();
-			}
-		}
+		return shape;
 	}
 
-	// ------------------------------------------------------
-	//	  SHP_MULTIPOINTM
-	// ------------------------------------------------------
-	else if (_shpfiletype == SHP_MULTIPOINTM)
+	if (!((CShape*)shape)->put_RawData(data, contentLength))
 	{
-		ComHelper::CreateShape(&shape);
-		shape->Create(shpType, &vbretval);
-		shape->put_GlobalCallback(_globalCallback);
-
-		// if (shpType == SHP_MULTIPOINTM)
-		if (areEqualTypes)
-		{
-			VARIANT_BOOL retval;
-			double bx, by, bm;
-			int numPoints;
-			double x, y, m;
-
-			fread(&bx, sizeof(double), 1, _shpfile);
-			fread(&by, sizeof(double), 1, _shpfile);
-			fread(&bx, sizeof(double), 1, _shpfile);
-			fread(&by, sizeof(double), 1, _shpfile);
-
-			fread(&numPoints, sizeof(int), 1, _shpfile);
-
-			long pointIndex = 0;
-			for (int j = 0; j < numPoints; j++)
-			{
-				ComHelper::CreatePoint(&pnt);
-				pnt->put_GlobalCallback(_globalCallback);
-				fread(&x, sizeof(double), 1, _shpfile);
-				fread(&y, sizeof(double), 1, _shpfile);
-				pnt->put_X(x);
-				pnt->put_Y(y);
-				pointIndex = j;
-				shape->InsertPoint(pnt, &pointIndex, &retval);
-				if (retval == VARIANT_FALSE)
-				{
-					shape->Release();
-					return NULL;
-				}
-				pnt->Release();
-			}
-
-			fread(&bm, sizeof(double), 1, _shpfile);
-			fread(&bm, sizeof(double), 1, _shpfile);
-
-			for (int mc = 0; mc < numPoints; mc++)
-			{
-				fread(&m, sizeof(double), 1, _shpfile);
-				pointIndex = mc;
-				IPoint * pnt = NULL;
-				shape->get_Point(pointIndex, &pnt);
-				if (pnt == NULL)
-				{
-					shape->Release();
-					return NULL;
-				}
-				pnt->put_M(m);
-				pnt->Release();
-			}
-		}
+		shape->Release();
+		return NULL;
 	}
-#pragma endregion
 
 	return shape;
 }
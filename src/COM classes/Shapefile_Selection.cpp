@@ -88,7 +88,7 @@ bool CShapefile::SelectShapesCore(Extent& extents, double Tolerance, SelectMode
     bool bPtSelection = b_minX == b_maxX && b_minY == b_maxY;
 	int local_numShapes = _shapeData.size();
 
-	IndexSearching::CIndexSearching *res;
+	vector<long> indexResult;
 	vector<int> qtreeResult;
 	bool useSpatialIndexResults = false;
 	bool useQTreeResults = false;
@@ -100,30 +100,9 @@ bool CShapefile::SelectShapesCore(Extent& extents, double Tolerance, SelectMode
 	
 	if (useSpatialIndex)
 	{
-		double lowVals[2], highVals[2];
-		IndexSearching::QueryTypeFlags qType;
-
-		lowVals[0] = b_minX;
-		lowVals[1] = b_minY;
-		highVals[0] = b_maxX;
-		highVals[1] = b_maxY;
-
-		qType = (SelectMode == INTERSECTION) ? IndexSearching::intersection : IndexSearching::contained;
-		res = new IndexSearching::CIndexSearching();
-
-		int ret = selectShapesFromIndex(_spatialIndexID, lowVals, highVals, qType, res);
-		if (ret != 0)
-		{
-			_hasSpatialIndex = false;
-			_spatialIndexLoaded = false;
-			IndexSearching::unloadSpatialIndex(_spatialIndexID);
-			delete res;		//TODO throw error
-		}
-		else
-		{
-			local_numShapes = res->getLength();
-			useSpatialIndexResults = true;
-		}
+		_spatialIndex.Search(b_minX, b_minY, b_maxX, b_maxY, SelectMode != INTERSECTION, indexResult);
+		local_numShapes = indexResult.size();
+		useSpatialIndexResults = true;
 	}
 	else if(_isEditingShapes && _useQTree)
 	{
@@ -167,7 +146,7 @@ bool CShapefile::SelectShapesCore(Extent& extents, double Tolerance, SelectMode
 			{
 				if (useSpatialIndexResults) 
 				{
-					shapeVal = (res->getValue(i)) - 1;
+					shapeVal = indexResult[i];
 				}
 				else if (useQTreeResults)
 				{
@@ -217,7 +196,7 @@ bool CShapefile::SelectShapesCore(Extent& extents, double Tolerance, SelectMode
 		{	
 			if (useSpatialIndexResults) 
 			{
-				shapeVal = (res->getValue(i)) - 1;
+				shapeVal = indexResult[i];
 			}
 			else if (useQTreeResults)
 			{
@@ -327,11 +306,7 @@ bool CShapefile::SelectShapesCore(Extent& extents, double Tolerance, SelectMode
         GeosHelper::DestroyGeometry(geosExtent);
 	}
 
-	if (useSpatialIndexResults)
-	{
-		delete res;
-	}
-	else if( _useQTree && _isEditingShapes != FALSE)
+	if( _useQTree && _isEditingShapes != FALSE)
 	{
 		qtreeResult.clear();
 	}
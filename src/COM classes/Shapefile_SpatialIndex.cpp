@@ -21,6 +21,7 @@
 
 #include "stdafx.h"
 #include "Shapefile.h"
+#include "Shape.h"
 
 #pragma region SpatialIndex
 // *****************************************************************
@@ -31,20 +32,8 @@ STDMETHODIMP CShapefile::get_HasSpatialIndex(VARIANT_BOOL *pVal)
 {
     AFX_MANAGE_STATE(AfxGetStaticModuleState())
     
-    try 
-	{
-		_hasSpatialIndex	= FALSE;
-		CString mwdfileName = _shpfileName.Left(_shpfileName.GetLength() - 3) + "mwd";
-		CString mwxfileName = _shpfileName.Left(_shpfileName.GetLength() - 3) + "mwx";
-		if (Utility::FileExists(mwdfileName) && Utility::FileExists(mwxfileName))
-		{
-			_hasSpatialIndex = TRUE;
-		}
-	}
-	catch (...)
-	{
-	    _hasSpatialIndex = FALSE;
-	}
+	_hasSpatialIndex = _spatialIndex.IsOpen() || 
+					   (_shpfileName.GetLength() > 3 && Utility::FileExistsW(CHilbertRTree::GetIndexFilename(_shpfileName)));
 
  	*pVal = _hasSpatialIndex?VARIANT_TRUE:VARIANT_FALSE;
 
@@ -62,19 +51,6 @@ STDMETHODIMP CShapefile::put_HasSpatialIndex(VARIANT_BOOL pVal)
 	return S_OK;
 }
 
-bool TestIndexSearching()
-{
-	__try
-	{
-		IndexSearching::isValidSpatialIndex("", 0);
-		return true;
-	}
-	__except(1)
-	{
-		return false;
-	}
-}
-
 // *****************************************************************
 //		get/put_UseSpatialIndex()
 // *****************************************************************
@@ -82,10 +58,6 @@ bool TestIndexSearching()
 STDMETHODIMP CShapefile::get_UseSpatialIndex(VARIANT_BOOL *pVal)
 {
     AFX_MANAGE_STATE(AfxGetStaticModuleState())
-	if (_useSpatialIndex)
-	{
-		//useSpatialIndex = TestIndexSearching();
-	}
 	*pVal = _useSpatialIndex?VARIANT_TRUE:VARIANT_FALSE;
 	return S_OK;
 }
@@ -95,9 +67,9 @@ STDMETHODIMP CShapefile::put_UseSpatialIndex(VARIANT_BOOL pVal)
 	_useSpatialIndex = pVal;
 	
 	// Unload spatial index in case it needs to be recreated
-	if (!_useSpatialIndex && _spatialIndexLoaded) 
+	if (!_useSpatialIndex) 
 	{
-		IndexSearching::unloadSpatialIndex(_spatialIndexID);
+		_spatialIndex.Close();
 	}
 	return S_OK;
 }
@@ -132,45 +104,55 @@ STDMETHODIMP CShapefile::get_CanUseSpatialIndex(IExtents* pArea, VARIANT_BOOL* p
 
 	if (!_isEditingShapes && _useSpatialIndex)
 	{
-		VARIANT_BOOL spatialIndexExists;
-		get_HasSpatialIndex(&spatialIndexExists);
+		double xM = min(_maxX, extents.right);
+		double xm = max(_minX, extents.left);
+		double yM = min(_maxY, extents.top);
+		double ym = max(_minY, extents.bottom);
+
+		double shapeFileArea = (_maxX - _minX)*(_maxY - _minY);
+		double selectShapeArea = (xM - xm) * (yM - ym);
 
-		if (spatialIndexExists)
+		//when large portions of the map are being drawn,
+		//the spatial index *probably* won't help, don't use it.
+		if (selectShapeArea / shapeFileArea < _spatialIndexMaxAreaPercent && LoadSpatialIndex())
 		{
-			double xM = min(_maxX, extents.right);
-			double xm = max(_minX, extents.left);
-			double yM = min(_maxY, extents.top);
-			double ym = max(_minY, extents.bottom);
-
-			double shapeFileArea = (_maxX - _minX)*(_maxY - _minY);
-			double selectShapeArea = (xM - xm) * (yM - ym);
-
-			if (selectShapeArea / shapeFileArea < _spatialIndexMaxAreaPercent)
-			{
-				//when large portions of the map are being drawn,
-				//the spatial index *probably* won't help, don't use it.
-				if (_spatialIndexLoaded)
-				{
-					*pVal = VARIANT_TRUE;
-					return S_OK;
-				}
-				else
-				{
-					USES_CONVERSION;
-					string baseName = W2A(_shpfileName.Left(_shpfileName.GetLength() - 4));		// TODO: use Unicode
-					if (IndexSearching::loadSpatialIndex(baseName, false, _spatialIndexNodeCapacity, _spatialIndexID))
-					{
-						_spatialIndexLoaded = true;
-						*pVal = VARIANT_TRUE;
-						return S_OK;
-					}
-				}
-			}
+			*pVal = VARIANT_TRUE;
 		}
 	}
 	return S_OK;
 }
 
+// *****************************************************************
+//		LoadSpatialIndex()
+// *****************************************************************
+// Maps .mwr file into memory; it stays mapped until the shapefile is closed, edited, saved
+// or the index is removed, so only the first query pays for opening it.
+bool CShapefile::LoadSpatialIndex()
+{
+	if (_spatialIndex.IsOpen())
+	{
+		if (!_isEditingShapes && _spatialIndex.get_NumShapes() == (int)_shapeData.size())
+			return true;
+
+		_spatialIndex.Close();
+	}
+
+	if (_isEditingShapes || _shpfileName.GetLength() <= 3)
+		return false;
+
+	if (!_spatialIndex.Open(_shpfileName))
+		return false;
+
+	// the index was built for another version of the file
+	if (!_spatialIndex.IsValidFor(_shpfileName, (int)_shapeData.size()))
+	{
+		_spatialIndex.Close();
+		return false;
+	}
+
+	return true;
+}
+
 // ***********************************************************
 //		CreateSpatialIndex()
 // ***********************************************************
@@ -182,7 +164,7 @@ STDMETHODIMP CShapefile::CreateSpatialIndex(BSTR ShapefileName, VARIANT_BOOL *re
 
 	*retval = VARIANT_TRUE;
 
-    CString tmp_shpfileName = OLE2CA(ShapefileName);
+    CStringW tmp_shpfileName = OLE2W(ShapefileName);
 	if( tmp_shpfileName.GetLength() <= 3 )
 	{	
 		*retval = VARIANT_FALSE;
@@ -190,22 +172,15 @@ STDMETHODIMP CShapefile::CreateSpatialIndex(BSTR ShapefileName, VARIANT_BOOL *re
 	}
 	else
 	{
-		string baseName;
-		baseName = tmp_shpfileName.Left(tmp_shpfileName.GetLength() - 4);
-	    
-		// 0.9 = utilization rate, 100 = Node Capacity
-		// Creates two files baseName.dat and baseName.idx
-		try 
-		{
-			if (!IndexSearching::createSpatialIndex(0.9, _spatialIndexNodeCapacity, (char *)baseName.c_str()))
-			{	
-				*retval = VARIANT_FALSE;
-				ErrorMessage(tkINVALID_FILENAME);
-			}
-		}
-		catch (...)
-		{
-		    *retval = VARIANT_FALSE;
+		// the mapped file can't be overwritten
+		if (tmp_shpfileName.CompareNoCase(_shpfileName) == 0)
+			_spatialIndex.Close();
+
+		// one pass over .shx; the tree is written to the single .mwr file
+		if (!CHilbertRTree::Create(tmp_shpfileName))
+		{	
+			*retval = VARIANT_FALSE;
+			ErrorMessage(tkINVALID_FILENAME);
 		}
 	}
 
@@ -223,9 +198,8 @@ STDMETHODIMP CShapefile::IsSpatialIndexValid(VARIANT_BOOL *retval)
 		*retval = VARIANT_FALSE;
 	else
 	{
-		USES_CONVERSION;
-		string baseName = W2A(_shpfileName.Left(_shpfileName.GetLength() - 4));		// TODO: use Unicode
-		bool bIsValid = IndexSearching::isValidSpatialIndex(baseName.c_str(), _spatialIndexNodeCapacity);
+		CHilbertRTree tree;
+		bool bIsValid = tree.Open(_shpfileName) && tree.IsValidFor(_shpfileName, (int)_shapeData.size());
 		*retval = bIsValid ? VARIANT_TRUE : VARIANT_FALSE;
 	}
 
@@ -253,7 +227,8 @@ STDMETHODIMP CShapefile::QuickQueryInEditMode(IExtents *BoundBox, int ** Result,
 		double xMin, yMin, zMin, xMax, yMax, zMax;
 		BoundBox->GetBounds(&xMin,&yMin,&zMin,&xMax,&yMax,&zMax);
 
-		vector<int> r = _qtree->GetNodes(QTreeExtent(xMin,xMax,yMax,yMin));
+		vector<int> r;
+		QuickQueryInEditModeCore(QTreeExtent(xMin,xMax,yMax,yMin), r);
 		int size = r.size();
 		*Result = new int[size];
 		
@@ -263,6 +238,18 @@ STDMETHODIMP CShapefile::QuickQueryInEditMode(IExtents *BoundBox, int ** Result,
 	return S_OK;
 }
 
+// ********************************************************************
+//		QuickQueryInEditModeCore()
+// ********************************************************************
+// The results are written to the caller's vector, so it can be reused between redraws.
+void CShapefile::QuickQueryInEditModeCore(const QTreeExtent& query, vector<int>& result)
+{
+	result.clear();
+
+	if (_isEditingShapes && _useQTree && _qtree)
+		_qtree->GetNodes(query, result);
+}
+
 // *****************************************************************
 //		get_UseQTree()
 // *****************************************************************
@@ -352,7 +339,7 @@ QTree* CShapefile::GenerateQTreeCore(bool SelectedOnly)
 	if (_shapeData.size() == 0)
 		return qtree;
 
-	long percent;
+	long percent = 0;
 	int numShapes = (int)_shapeData.size();
 	for(int i = 0; i < numShapes; i++ )
 	{	
@@ -380,13 +367,41 @@ QTree* CShapefile::GenerateQTreeCore(bool SelectedOnly)
 // Build the tree anew for geoprocessing operations, as the original one
 // probably not 100% accurate/optimal + we may need only selected shapes
 
+// **********************************************************************
+// 						GeneratePackedTree()				           
+// **********************************************************************
+CPackedRTree* CShapefile::GeneratePackedTree(bool SelectedOnly)
+{
+	CPackedRTree* tree = new CPackedRTree();
+
+	int numShapes = (int)_shapeData.size();
+	tree->Reserve(numShapes);
+
+	long percent = 0;
+	double xMin, xMax, yMin, yMax;
+	for (int i = 0; i < numShapes; i++)
+	{
+		if (!ShapeAvailable(i, SelectedOnly))
+			continue;
+
+		if (this->QuickExtentsCore(i, &xMin, &yMin, &xMax, &yMax))
+			tree->AddItem(i, xMin, yMin, xMax, yMax);
+
+		CallbackHelper::Progress(_globalCallback, i, numShapes, "Building index...", _key, percent);
+	}
+	CallbackHelper::ProgressCompleted(_globalCallback, _key);
+
+	tree->Finish();
+	return tree;
+}
+
 // **********************************************************************
 // 						GenerateTempQTree()				           
 // **********************************************************************
 bool CShapefile::GenerateTempQTree(bool SelectedOnly)
 {
 	ClearTempQTree();
-	_tempTree = GenerateQTreeCore(SelectedOnly);
+	_tempTree = GeneratePackedTree(SelectedOnly);
 	return _tempTree != NULL;
 }
 
@@ -405,11 +420,62 @@ void CShapefile::ClearTempQTree()
 // **********************************************************************
 // 						GetTempQtree()				           
 // **********************************************************************
-QTree* CShapefile::GetTempQTree()
+CPackedRTree* CShapefile::GetTempQTree()
 {
 	return _tempTree;
 }
 
+// **********************************************************************
+// 						GetSnappingIndex()				           
+// **********************************************************************
+// Built on the first snapping query; it's updated as shapes are inserted,
+// removed or changed in edit mode, and dropped when the shapes are reloaded.
+// Shapes can also be changed directly through IShape, without notification of 
+// the shapefile; they are found by the modification stamp once any shape was changed.
+SnappingIndex* CShapefile::GetSnappingIndex()
+{
+	long stamp = CShape::get_LastModificationStamp();
+
+	if (_snappingIndex && _isEditingShapes && stamp != _snappingStamp)
+	{
+		for (long i = 0; i < (long)_shapeData.size(); i++)
+		{
+			IShape* shp = _shapeData[i]->shape;
+			if (!_snappingIndex->IsCurrent(i, shp))
+				_snappingIndex->UpdateShape(i, shp);
+		}
+	}
+
+	_snappingStamp = stamp;
+
+	if (!_snappingIndex)
+	{
+		_snappingIndex = new SnappingIndex();
+		_snappingIndex->Init(Extent(_minX, _maxX, _minY, _maxY), (long)_shapeData.size());
+
+		for (long i = 0; i < (long)_shapeData.size(); i++)
+		{
+			IShape* shp = NULL;
+			get_Shape(i, &shp);
+			_snappingIndex->InsertShape(i, shp);
+			if (shp) shp->Release();
+		}
+	}
+	return _snappingIndex;
+}
+
+// **********************************************************************
+// 						ClearSnappingIndex()				           
+// **********************************************************************
+void CShapefile::ClearSnappingIndex()
+{
+	if (_snappingIndex)
+	{
+		delete _snappingIndex;
+		_snappingIndex = NULL;
+	}
+}
+
 // **********************************************************************
 // 						RemoveSpatialIndex()				           
 // **********************************************************************
@@ -417,9 +483,12 @@ STDMETHODIMP CShapefile::RemoveSpatialIndex(VARIANT_BOOL* retVal)
 {
 	AFX_MANAGE_STATE(AfxGetStaticModuleState());
 	*retVal = VARIANT_TRUE;
-	CStringW names[] = {L"mwd", L"mwx"};
+	_spatialIndex.Close();
+
+	// .mwd/.mwx are left by the older versions
+	CStringW names[] = {L"mwr", L"mwd", L"mwx"};
 
-	for (int i = 0; i < 2; i++)
+	for (int i = 0; i < 3; i++)
 	{
 		CString name = _shpfileName.Left(_shpfileName.GetLength() - 3) + names[i];
 		if (Utility::FileExists(name))
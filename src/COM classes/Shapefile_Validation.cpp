@@ -26,6 +26,8 @@
 #include "GeosConverter.h"
 #include "ShapeValidationInfo.h"
 
+#define GEOS_CONVERSION_BATCH_SIZE 16384
+
 // ReSharper disable CppUseAuto
 
 #pragma region Validation
@@ -287,6 +289,20 @@ GEOSGeometry* CShapefile::GetGeosGeometry(int shapeIndex)
     return _shapeData[shapeIndex]->geosGeom;
 }
 
+// *********************************************************
+//		CacheGeosEnvelopes()
+// *********************************************************
+// GEOS calculates envelopes on the first use, so it's done here for the geometries
+// which are going to be read by several threads at once.
+void CShapefile::CacheGeosEnvelopes(VARIANT_BOOL selectedOnly)
+{
+    for (size_t i = 0; i < _shapeData.size(); i++)
+    {
+        if (ShapeAvailable(i, selectedOnly))
+            GeosConverter::CacheEnvelopes(_shapeData[i]->geosGeom);
+    }
+}
+
 // *********************************************************
 //		ClearCachedGeometries()
 // *********************************************************
@@ -319,31 +335,20 @@ void CShapefile::ReadGeosGeometries(VARIANT_BOOL selectedOnly)
         ClearCachedGeometries();
     }
 
-    long percent = 0;
+    vector<int> indices;
     const int size = (int)_shapeData.size();
     for (int i = 0; i < size; i++)
     {
-        CallbackHelper::Progress(_globalCallback, i, size, "Converting to geometries", _key, percent);
-
         if (!ShapeAvailable(i, selectedOnly))
             continue;
 
         if (_shapeData[i]->geosGeom)
             CallbackHelper::AssertionFailed("GEOS Geometry during the reading was expected to be empty.");
 
-        IShape* shp = nullptr;
-        this->GetValidatedShape(i, &shp);
-        if (shp)
-        {
-            // ReSharper disable once CppLocalVariableMayBeConst
-            GEOSGeom geom = GeosConverter::ShapeToGeom(shp);
-            if (geom)
-            {
-                _shapeData[i]->geosGeom = geom;
-            }
-            shp->Release();
-        }
+        indices.push_back(i);
     }
+
+    ConvertGeosGeometries(indices, true);
     _geosGeometriesRead = true;
 }
 
@@ -358,22 +363,48 @@ void CShapefile::ReadGeosGeometries(std::set<int> list)
 
     // list is small subset of shapes,
     // so iterate list instead of shapeData
-    for each (int i in list)
+    const vector<int> indices(list.begin(), list.end());
+    ConvertGeosGeometries(indices, false);
+
+    _geosGeometriesRead = true;
+}
+
+// *********************************************************
+//		ConvertGeosGeometries()
+// *********************************************************
+// Shapes are passed to the converter in batches, which bounds the memory taken by the copies of their coordinates;
+// the conversion of each batch is shared between the threads of the pool.
+void CShapefile::ConvertGeosGeometries(const vector<int>& indices, bool displayProgress)
+{
+    long percent = 0;
+    const int size = (int)indices.size();
+
+    vector<IShape*> shapes;
+    vector<GEOSGeometry*> geoms;
+
+    for (int first = 0; first < size; first += GEOS_CONVERSION_BATCH_SIZE)
     {
-        IShape* shp = nullptr;
-        this->GetValidatedShape(i, &shp);
-        if (shp)
+        const int last = MIN(first + GEOS_CONVERSION_BATCH_SIZE, size);
+
+        shapes.assign(last - first, nullptr);
+        for (int i = first; i < last; i++)
         {
-            GEOSGeom geom = GeosConverter::ShapeToGeom(shp);
-            if (geom)
-            {
-                _shapeData[i]->geosGeom = geom;
-            }
-            shp->Release();
+            if (displayProgress)
+                CallbackHelper::Progress(_globalCallback, i, size, "Converting to geometries", _key, percent);
+
+            this->GetValidatedShape(indices[i], &shapes[i - first]);
         }
-    }
 
-    _geosGeometriesRead = true;
+        GeosConverter::ShapesToGeoms(shapes, geoms);
+
+        for (int i = first; i < last; i++)
+        {
+            _shapeData[indices[i]]->geosGeom = geoms[i - first];
+
+            if (shapes[i - first])
+                shapes[i - first]->Release();
+        }
+    }
 }
 
 #pragma endregion
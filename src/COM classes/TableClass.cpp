@@ -191,7 +191,7 @@ STDMETHODIMP CTableClass::Calculate(BSTR Expression, LONG RowIndex, VARIANT* Res
 	}
 
     CStringW err;
-    return CalculateCoreRaw(
+    bool result = CalculateCoreRaw(
         Expression,
         [&](CExpressionValue* result, int rowIndex, CStringW& ErrorString) -> int {
             if (result->isBoolean())
@@ -212,10 +212,11 @@ STDMETHODIMP CTableClass::Calculate(BSTR Expression, LONG RowIndex, VARIANT* Res
             return true;
         },
         err,
-        m_globalSettings.floatNumberFormat, RowIndex, true
+        m_globalSettings.floatNumberFormat, RowIndex, RowIndex
     );
 
     *ErrorString = W2BSTR(err);
+    *retVal = result && Result->vt != VT_NULL ? VARIANT_TRUE : VARIANT_FALSE;
     return S_OK;
 }
 
@@ -250,55 +251,202 @@ bool CTableClass::CalculateCoreRaw(CStringW Expression,
     std::function<bool(CExpressionValue* value, int rowIndex, CStringW& ErrorString)> processValue, 
     CStringW& ErrorString, CString floatFormat, int startRowIndex, int endRowIndex, bool ignoreCalculationErrors)
 {
-    USES_CONVERSION;
-
-    CustomExpression expr;
-    expr.SetFloatFormat(floatFormat);
-    if (!expr.ReadFieldNames(this))
+    CompiledExpression expr;
+    if (!expr.Parse(this, Expression, floatFormat, ErrorString))
     {
-        ErrorString = "Failed to read field names";
         return false;
     }
 
+    int start = (startRowIndex == -1) ? 0 : startRowIndex;
+    int end = (endRowIndex == -1) ? int(_rows.size()) : endRowIndex + 1;
+
+    std::vector<CompiledExpression*> expressions(1, &expr);
+
+    return CalculateExpressions(
+        expressions, start, end,
+        [&](int expressionIndex, CExpressionValue* result, int rowIndex, CStringW& err) -> bool {
+            // check if we can ignore calculation errors:
+            if (!result && ignoreCalculationErrors)
+            {
+                err = ""; // clear the error
+                return true;
+            }
+
+            // if we had a result & processing went fine, continue
+            if (result && processValue(result, rowIndex, err))
+                return true;
+
+            ErrorString = err;
+            return false;
+        }
+    );
+}
+
+// ********************************************************************
+//			CalculateExpressions()
+// ********************************************************************
+// Calculates the expressions for the rows in [start, end) and passes the results (NULL on error)
+// to processValue in the order of expressions. The values of fields are read for a batch
+// of rows at once, each field a single time even if it is used by several expressions.
+bool CTableClass::CalculateExpressions(std::vector<CompiledExpression*>& expressions, int start, int end,
+    std::function<bool(int expressionIndex, CExpressionValue* value, int rowIndex, CStringW& ErrorString)> processValue)
+{
+    std::vector<long> fields;
+    std::vector<std::vector<int>> columnIndices(expressions.size());
+    bool usesGeometry = false;
+
+    for (size_t i = 0; i < expressions.size(); i++)
+    {
+        for (int j = 0; j < expressions[i]->get_NumFields(); j++)
+        {
+            long fieldIndex = expressions[i]->get_FieldIndex(j);
+            
+            size_t k = std::find(fields.begin(), fields.end(), fieldIndex) - fields.begin();
+            if (k == fields.size())
+                fields.push_back(fieldIndex);
+
+            columnIndices[i].push_back(k);
+        }
+
+        if (expressions[i]->UsesGeometry())
+            usesGeometry = true;
+    }
+
+    std::vector<ExpressionColumn> columns(fields.size());
+    std::vector<std::vector<ExpressionColumn*>> expressionColumns(expressions.size());
+    for (size_t i = 0; i < expressions.size(); i++)
+    {
+        for (size_t j = 0; j < columnIndices[i].size(); j++)
+            expressionColumns[i].push_back(&columns[columnIndices[i][j]]);
+    }
+
+    IShapefile* sf = usesGeometry ? GetParentShapefile() : NULL;	 // doesn't add reference
+
     CStringW err;
-    if (!expr.Parse(Expression, true, err))
+    for (int batchStart = start; batchStart < end; batchStart += EXPRESSION_BATCH_SIZE)
     {
-        ErrorString = err;
-        return false;
+        int batchSize = min(EXPRESSION_BATCH_SIZE, end - batchStart);
+
+        for (size_t i = 0; i < fields.size(); i++)
+            ReadExpressionColumn(fields[i], batchStart, batchSize, columns[i]);
+
+        for (int k = 0; k < batchSize; k++)
+        {
+            int rowIndex = batchStart + k;
+
+            CComPtr<IShape> shp = NULL;
+            if (sf)
+                sf->get_Shape(rowIndex, &shp);
+
+            for (size_t i = 0; i < expressions.size(); i++)
+            {
+                CompiledExpression* expr = expressions[i];
+                expr->SetFieldValues(expressionColumns[i], k);
+
+                if (shp && expr->UsesGeometry())
+                    expr->put_Shape(shp);
+
+                CExpressionValue* result = expr->Calculate(err);
+                if (!processValue((int)i, result, rowIndex, err))
+                    return false;
+            }
+        }
     }
 
-    bool error = false;
-    CStringW str;
+    return true;
+}
 
-    int start = (startRowIndex == -1) ? 0 : startRowIndex;
-    int end = (endRowIndex == -1) ? int(_rows.size()) : endRowIndex + 1;
+// ********************************************************************
+//			ReadExpressionColumn()
+// ********************************************************************
+// Gives the same values as TableHelper::SetFieldValues gets from get_CellValue, but the rows
+// which aren't in memory are read directly from the columnar store, mapped dbf or dbf, without TableRow.
+void CTableClass::ReadExpressionColumn(long fieldIndex, long firstRow, long numRows, ExpressionColumn& column)
+{
+    column.Reset(numRows);
 
-    for (int i = start; i < end; i++)
+    FieldType type = GetFieldType(fieldIndex);
+    int dbfField = _fields[fieldIndex]->oldIndex;
+    bool isUtf8 = _dbfHandle != NULL && (DBFGetCodePage(_dbfHandle) == nullptr || strcmp(DBFGetCodePage(_dbfHandle), "UTF-8") == 0);
+    TableColumnStore* store = GetColumnStore();
+
+    for (long k = 0; k < numRows; k++)
     {
-        TableHelper::SetFieldValues(this, i, expr);
+        long rowIndex = firstRow + k;
+        long record = _rows[rowIndex].oldIndex;
 
-        // calculate expression
-        CExpressionValue* result = expr.Calculate(err);
-        
-        // check if we can ignore calculation errors:
-        if (!result && ignoreCalculationErrors)
+        if (_rows[rowIndex].row != NULL || dbfField == -1 || record == -1 || _dbfHandle == NULL)
         {
-            err = ""; // clear the error
+            CComVariant var;
+            get_CellValue(fieldIndex, rowIndex, &var);
+            column.SetVariant(k, var);
             continue;
         }
-            
-        // if we had a result & processing went fine, continue
-        if (result && processValue(result, i, err))
+
+        // booleans and dates aren't passed to expressions
+        if (type != STRING_FIELD && type != INTEGER_FIELD && type != DOUBLE_FIELD)
             continue;
-        else
+
+        if (store)
         {
-            ErrorString = err;
-            error = true;
-            return false;
+            if (type == STRING_FIELD)
+            {
+                CStringW s;
+                if (store->GetWideString(dbfField, record, type, s))
+                {
+                    column.SetString(k, s);
+                    continue;
+                }
+            }
+            else
+            {
+                VARIANT var;
+                VariantInit(&var);
+                if (store->GetValue(dbfField, record, type, &var))
+                {
+                    column.SetVariant(k, var);
+                    continue;
+                }
+            }
         }
-    }
 
-    return true;
+        if (_dbfReader.Contains(dbfField, record))
+        {
+            if (type == STRING_FIELD)
+                column.SetString(k, _dbfReader.ReadWideString(dbfField, record));
+            else if (_dbfReader.IsNull(dbfField, record))
+                continue;
+            else if (type == INTEGER_FIELD)
+                column.SetDouble(k, (double)_dbfReader.ReadInteger(dbfField, record));
+            else
+                column.SetDouble(k, _dbfReader.ReadDouble(dbfField, record));
+            continue;
+        }
+
+        // the same as CTableClass::ReadRecord
+        if (DBFIsAttributeNULL(_dbfHandle, record, dbfField) == 1)
+        {
+            if (type == STRING_FIELD)
+                column.SetString(k, L"");
+            continue;
+        }
+
+        switch (type)
+        {
+            case STRING_FIELD:
+                {
+                    const char* v = DBFReadStringAttribute(_dbfHandle, record, dbfField);
+                    column.SetString(k, isUtf8 ? Utility::ConvertFromUtf8(v) : CStringW(v));
+                }
+                break;
+            case INTEGER_FIELD:
+                column.SetDouble(k, (double)DBFReadIntegerAttribute(_dbfHandle, record, dbfField));
+                break;
+            case DOUBLE_FIELD:
+                column.SetDouble(k, DBFReadDoubleAttribute(_dbfHandle, record, dbfField));
+                break;
+        }
+    }
 }
 
 // ********************************************************************
@@ -344,34 +492,49 @@ bool CTableClass::CalculateCore(CStringW Expression, std::vector<CStringW>& resu
 void CTableClass::AnalyzeExpressions(std::vector<CStringW>& expressions, std::vector<int>& results,
 	int startRowIndex, int endRowIndex)
 {
-	// TODO: optimize, if all expressions have the same fields in the same positions
-	// don't read the values multiple times.
 	// For unique values classification it's better to store classification field,
 	// but in older style files it may be not present.
-	CustomExpression expr;
-	if (!expr.ReadFieldNames(this)) return;
-
 	startRowIndex = startRowIndex < 0 ? 0 : startRowIndex;
+	int end = (endRowIndex == -1) ? int(_rows.size()) : endRowIndex + 1;
+
+	// all the expressions are calculated in a single pass, so that fields are read only once;
+	// a later category overwrites an earlier one the same way as with a pass per category
+	std::vector<CompiledExpression*> compiled;
+	std::vector<int> categories;
 
 	for (unsigned int categoryId = 0; categoryId < expressions.size(); categoryId++)
 	{
 		if (expressions[categoryId] != "")
 		{
 			CStringW ErrorString;
-            CalculateCoreRaw(
-                expressions[categoryId],
-                [&](CExpressionValue* result, int rowIndex, CStringW& ErrorString) -> int {
-                    USES_CONVERSION;
-                    if (result->isBoolean() && result->bln())
-                    {
-                        results[rowIndex-startRowIndex] = categoryId;
-                    }
-                    return true;
-                },
-                ErrorString, m_globalSettings.floatNumberFormat, startRowIndex, endRowIndex, true
-            );
+			CompiledExpression* expr = new CompiledExpression();
+			if (expr->Parse(this, expressions[categoryId], m_globalSettings.floatNumberFormat, ErrorString))
+			{
+				compiled.push_back(expr);
+				categories.push_back(categoryId);
+			}
+			else
+			{
+				delete expr;
+			}
 		}
 	}
+
+	CalculateExpressions(
+		compiled, startRowIndex, end,
+		[&](int expressionIndex, CExpressionValue* result, int rowIndex, CStringW& ErrorString) -> bool {
+			if (result && result->isBoolean() && result->bln())
+			{
+				results[rowIndex - startRowIndex] = categories[expressionIndex];
+			}
+			return true;
+		}
+	);
+
+	for (size_t i = 0; i < compiled.size(); i++)
+	{
+		delete compiled[i];
+	}
 }
 
 // ***********************************************************
@@ -431,29 +594,69 @@ STDMETHODIMP CTableClass::get_CellValue(long FieldIndex, long RowIndex, VARIANT
 			return S_OK;
 		}
 
-	if (ReadRecord(RowIndex) && _rows[RowIndex].row != NULL)
+	if (ReadCellValue(FieldIndex, RowIndex, pVal))
 	{
-		VARIANT* var = _rows[RowIndex].row->values[FieldIndex];
-		if (var != NULL)
+		if (pVal->vt == VT_NULL)
 		{
-			if (var->vt != VT_NULL)
-			{
-				VariantCopy(pVal, _rows[RowIndex].row->values[FieldIndex]);
-			}
-			else
-			{
-				// MWGIS-128
-				// no value, send back EMPTY variant
-				VariantInit(pVal);
-				pVal->vt = VT_EMPTY;
-			}
-			return S_OK;
+			// MWGIS-128
+			// no value, send back EMPTY variant
+			VariantInit(pVal);
+			pVal->vt = VT_EMPTY;
 		}
+		return S_OK;
 	}
 	pVal = NULL;
 	return S_OK;
 }
 
+// ***********************************************************
+//		ReadCellValue
+// ***********************************************************
+// Copies the value of the cell; rows which aren't in memory are read from the columnar
+// store or the mapped dbf when they are available, without creating TableRow for them.
+bool CTableClass::ReadCellValue(long fieldIndex, long rowIndex, VARIANT* val)
+{
+	if (_rows[rowIndex].row == NULL)
+	{
+		FieldType type;
+		_fields[fieldIndex]->field->get_Type(&type);
+
+		TableColumnStore* store = GetColumnStore();
+		if (store && store->GetValue(_fields[fieldIndex]->oldIndex, _rows[rowIndex].oldIndex, type, val))
+			return true;
+
+		if (_dbfReader.GetValue(_fields[fieldIndex]->oldIndex, _rows[rowIndex].oldIndex, type, val))
+			return true;
+	}
+
+	if (ReadRecord(rowIndex) && _rows[rowIndex].row != NULL)
+	{
+		VARIANT* var = _rows[rowIndex].row->values[fieldIndex];
+		if (var != NULL)
+		{
+			VariantCopy(val, var);
+			return true;
+		}
+	}
+	return false;
+}
+
+// ***********************************************************
+//		GetColumnStore
+// ***********************************************************
+// Returns the store if GlobalSettings.CacheDbfColumns is on; the columns are loaded by the store
+// on the first access to them.
+TableColumnStore* CTableClass::GetColumnStore()
+{
+	if (!m_globalSettings.cacheDbfColumns || _dbfHandle == NULL)
+		return NULL;
+
+	if (!_columnStore.IsOpen())
+		_columnStore.Open(_dbfHandle, &_dbfReader);
+
+	return _columnStore.IsOpen() ? &_columnStore : NULL;
+}
+
 // ***********************************************************
 //		get_EditingTable
 // ***********************************************************
@@ -588,6 +791,9 @@ STDMETHODIMP CTableClass::Open(BSTR dbfFilename, ICallback *cBack, VARIANT_BOOL
 		_filename = name;
 		*retval = VARIANT_TRUE;
 
+		// if the file can't be mapped, the fields are read with dbfopen as usual
+		_dbfReader.Open(name, _dbfHandle);
+
 		//After open the dbf file, load all _fields info and create spatial row indices 
 		//with FieldWrapper and RecordWrapper help classes.
 		LoadDefaultFields();
@@ -633,6 +839,8 @@ STDMETHODIMP CTableClass::CreateNew(BSTR dbfFilename, VARIANT_BOOL *retval)
 void CTableClass::CloseUnderlyingFile()
 {
 	_filename = L"";
+	_columnStore.Clear();
+	_dbfReader.Close();
 	if (_dbfHandle != NULL)
 	{
 		DBFClose(_dbfHandle);
@@ -899,6 +1107,9 @@ STDMETHODIMP CTableClass::Close(VARIANT_BOOL *retval)
 
 	_filename = L"";
 
+	_columnStore.Clear();
+	_dbfReader.Close();
+
 	if (_dbfHandle != NULL)
 	{
 		DBFClose(_dbfHandle);
@@ -1326,6 +1537,8 @@ bool CTableClass::ReadRecord(long RowIndex)
 	long percent = 0, newpercent = 0;
 	_rows[RowIndex].row = new TableRow();
 
+	TableColumnStore* store = GetColumnStore();
+
 	for (int i = 0; i < FieldCount(); i++)
 	{
 		FieldType type = GetFieldType(i);
@@ -1335,6 +1548,15 @@ bool CTableClass::ReadRecord(long RowIndex)
 		{
 			val = new VARIANT;
 			VariantInit(val);
+
+			if ((store && store->GetValue(_fields[i]->oldIndex, _rows[RowIndex].oldIndex, type, val)) ||
+				_dbfReader.GetValue(_fields[i]->oldIndex, _rows[RowIndex].oldIndex, type, val))
+			{
+				_rows[RowIndex].row->SetDirty(TableRow::DATA_CLEAN);
+				_rows[RowIndex].row->values.push_back(val);
+				continue;
+			}
+
 			bool isNull = false;
 
 			//Rob Cairns 14/2/2006
@@ -1958,6 +2180,10 @@ STDMETHODIMP CTableClass::StopEditingTable(VARIANT_BOOL ApplyChanges, ICallback
 			USES_CONVERSION;
 			if (SaveToFile(A2W(tempFilename), false, cBack))
 			{
+				// the file can't be overwritten while it's mapped; it's reopened below anyway
+				_columnStore.Clear();
+				_dbfReader.Close();
+
 				BOOL result = CopyFile(tempFilename, W2A(_filename), FALSE);
 				_unlink(tempFilename);
 			}
@@ -2087,8 +2313,7 @@ STDMETHODIMP CTableClass::get_MinValue(long FieldIndex, VARIANT* retval)
 		CComVariant min, val;
 		for (unsigned long i = 0; i < _rows.size(); i++)
 		{
-			if (ReadRecord(i) && _rows[i].row != NULL)
-				val.Copy(_rows[i].row->values[FieldIndex]);
+			ReadCellValue(FieldIndex, i, &val);
 			if (i == 0)	min = val;
 			else if (val < min)	min = val;
 			val.Clear();
@@ -2113,8 +2338,7 @@ STDMETHODIMP CTableClass::get_MaxValue(long FieldIndex, VARIANT* retval)
 		CComVariant max, val;
 		for (long i = 0; i < (long)_rows.size(); i++)
 		{
-			if (ReadRecord(i) && _rows[i].row != NULL)
-				val.Copy(_rows[i].row->values[FieldIndex]);
+			ReadCellValue(FieldIndex, i, &val);
 			if (i == 0)	max = val;
 			else if (val > max)	max = val;
 			val.Clear();
@@ -2140,16 +2364,19 @@ STDMETHODIMP CTableClass::get_MeanValue(long FieldIndex, double* retval)
 		_fields[FieldIndex]->field->get_Type(&type);
 		if (type == DOUBLE_FIELD || type == INTEGER_FIELD)
 		{
+			// null values are left out, so they don't count in the number of values either
 			double sum = 0;
+			long count = 0;
 			for (unsigned long i = 0; i < _rows.size(); i++)
 			{
-				if (ReadRecord(i) && _rows[i].row != NULL)
+				CComVariant val;
+				if (ReadCellValue(FieldIndex, i, &val))
 				{
-					if (type == DOUBLE_FIELD)	sum += _rows[i].row->values[FieldIndex]->dblVal;
-					else						sum += _rows[i].row->values[FieldIndex]->lVal;
+					if (val.vt == VT_R8)		{ sum += val.dblVal; count++; }
+					else if (val.vt == VT_I4)	{ sum += val.lVal; count++; }
 				}
 			}
-			*retval = sum / (double)_rows.size();
+			*retval = count > 0 ? sum / (double)count : 0.0;
 		}
 		else
 		{
@@ -2179,15 +2406,17 @@ STDMETHODIMP CTableClass::get_StandardDeviation(long FieldIndex, double* retval)
 			double mean;
 			get_MeanValue(FieldIndex, &mean);
 			double std = 0.0;
+			long count = 0;
 			for (unsigned long i = 0; i < _rows.size(); i++)
 			{
-				if (ReadRecord(i) && _rows[i].row != NULL)
+				CComVariant val;
+				if (ReadCellValue(FieldIndex, i, &val))
 				{
-					if (type == DOUBLE_FIELD)	std += pow(_rows[i].row->values[FieldIndex]->dblVal - mean, 2);
-					else						std += pow((double)_rows[i].row->values[FieldIndex]->lVal - mean, 2);
+					if (val.vt == VT_R8)		{ std += pow(val.dblVal - mean, 2); count++; }
+					else if (val.vt == VT_I4)	{ std += pow((double)val.lVal - mean, 2); count++; }
 				}
 			}
-			*retval = sqrt(std / (_rows.size() - 1));
+			*retval = count > 1 ? sqrt(std / (count - 1)) : 0.0;
 		}
 		else
 		{
@@ -2634,6 +2863,8 @@ bool CTableClass::get_FieldValuesDouble(int FieldIndex, std::vector<double>& val
 
 	int index = _fields[FieldIndex]->oldIndex;	// real index of the field
 
+	TableColumnStore* store = GetColumnStore();
+
 	values.reserve(_rows.size());
 	for (unsigned int i = 0; i < _rows.size(); i++)
 	{
@@ -2651,7 +2882,14 @@ bool CTableClass::get_FieldValuesDouble(int FieldIndex, std::vector<double>& val
 		}
 		else
 		{
-			values.push_back(DBFReadDoubleAttribute(_dbfHandle, _rows[i].oldIndex, index));
+			double value;
+			if (!store || !store->GetDouble(index, _rows[i].oldIndex, type, value))
+			{
+				int record = _rows[i].oldIndex;
+				value = _dbfReader.Contains(index, record) ? _dbfReader.ReadDouble(index, record) :
+						DBFReadDoubleAttribute(_dbfHandle, record, index);
+			}
+			values.push_back(value);
 		}
 	}
 	return true;
@@ -2674,6 +2912,8 @@ bool CTableClass::get_FieldValuesInteger(int FieldIndex, std::vector<int>& value
 
 	int index = _fields[FieldIndex]->oldIndex;	// real index of the field
 
+	TableColumnStore* store = GetColumnStore();
+
 	values.reserve(_rows.size());
 	for (unsigned int i = 0; i < _rows.size(); i++)
 	{
@@ -2692,7 +2932,14 @@ bool CTableClass::get_FieldValuesInteger(int FieldIndex, std::vector<int>& value
 		}
 		else
 		{
-			values.push_back(DBFReadIntegerAttribute(_dbfHandle, _rows[i].oldIndex, index));
+			int value;
+			if (!store || !store->GetInteger(index, _rows[i].oldIndex, type, value))
+			{
+				int record = _rows[i].oldIndex;
+				value = _dbfReader.Contains(index, record) ? _dbfReader.ReadInteger(index, record) :
+						DBFReadIntegerAttribute(_dbfHandle, record, index);
+			}
+			values.push_back(value);
 		}
 	}
 	return true;
@@ -2717,6 +2964,8 @@ bool CTableClass::get_FieldValuesString(int FieldIndex, std::vector<CString>& va
 
 	int index = _fields[FieldIndex]->oldIndex;	// real index of the field
 
+	TableColumnStore* store = GetColumnStore();
+
 	values.reserve(_rows.size());
 	for (unsigned int i = 0; i < _rows.size(); i++)
 	{
@@ -2735,7 +2984,22 @@ bool CTableClass::get_FieldValuesString(int FieldIndex, std::vector<CString>& va
 		}
 		else
 		{
-			values.push_back(DBFReadStringAttribute(_dbfHandle, _rows[i].oldIndex, index));
+			const char* value;
+			int record = _rows[i].oldIndex;
+			if (store && store->GetString(index, record, type, value))
+			{
+				values.push_back(value);
+			}
+			else if (_dbfReader.Contains(index, record))
+			{
+				int length;
+				value = _dbfReader.ReadString(index, record, length);
+				values.push_back(CString(value, length));
+			}
+			else
+			{
+				values.push_back(DBFReadStringAttribute(_dbfHandle, record, index));
+			}
 		}
 	}
 	return true;
@@ -3930,6 +4194,8 @@ STDMETHODIMP CTableClass::ClearCache()
 
 	_lastRecordIndex = -1;
 
+	_columnStore.Clear();
+
 	return S_OK;
 }
 
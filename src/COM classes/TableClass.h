@@ -26,8 +26,9 @@
 #include <set>
 #include <functional>
 #include "TableRow.h"
+#include "TableColumnStore.h"
 #include "dbf.h"
-#include "CustomExpression.h"
+#include "CompiledExpression.h"
 #include "_ITableEvents_CP.H"
 
 class ATL_NO_VTABLE CTableClass : 
@@ -161,6 +162,8 @@ public:
 	STDMETHOD(ClearCache)();
 	STDMETHOD(get_RowIsModified)(LONG RowIndex, VARIANT_BOOL* pVal);
 
+	friend class CShapefileCategories;	// reads the classification field with ReadExpressionColumn
+
 private:
 	struct JoinInfo
 	{
@@ -194,6 +197,8 @@ private:
 	int _lastRecordIndex;    // last index accessed with get_CellValue
 	bool _appendMode;
 	int _appendStartShapeCount;
+	TableColumnStore _columnStore;	// dbf columns decoded on first access when GlobalSettings.CacheDbfColumns is on
+	DbfColumnReader _dbfReader;		// memory-mapped dbf; decodes single fields of the rows which aren't in memory
 
 public:
 	bool m_needToSaveAsNewFile;
@@ -206,6 +211,11 @@ private:
 	long RowCount() { return _rows.size(); }
 	long FieldCount() { return _fields.size(); }
 	bool ReadRecord(long RowIndex);
+	TableColumnStore* GetColumnStore();
+	bool ReadCellValue(long fieldIndex, long rowIndex, VARIANT* val);
+	void ReadExpressionColumn(long fieldIndex, long firstRow, long numRows, ExpressionColumn& column);
+	bool CalculateExpressions(std::vector<CompiledExpression*>& expressions, int start, int end,
+		std::function<bool(int expressionIndex, CExpressionValue* value, int rowIndex, CStringW& ErrorString)> processValue);
 	bool WriteRecord(DBFInfo* dbfHandle, long fromRowIndex, long toRowIndex, bool isUTF8 = false);
 	void ClearRow(long rowIndex);
 	FieldType GetFieldType(long fieldIndex);
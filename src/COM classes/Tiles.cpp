@@ -971,6 +971,41 @@ STDMETHODIMP CTiles::Prefetch2(int minX, int maxX, int minY, int maxY, int zoom,
     return S_OK;
 }
 
+// *********************************************************
+//	     PrefetchArea
+// *********************************************************
+// Caches the tiles of several zoom levels within a polygon or along a polyline given in decimal degrees
+STDMETHODIMP CTiles::PrefetchArea(IShape* area, int minZoom, int maxZoom, int providerId, IStopExecution* stop,
+                                  LONG maxTileCount, LONG maxBytesPerSecond, int maxConcurrency, LONG* retVal)
+{
+    AFX_MANAGE_STATE(AfxGetStaticModuleState());
+
+    *retVal = -1;
+
+    BaseProvider* provider = get_Provider(providerId);
+    if (!provider)
+    {
+        ErrorMessage(tkINVALID_PROVIDER_ID);
+        return S_OK;
+    }
+
+    if (!area)
+    {
+        ErrorMessage(tkUNEXPECTED_NULL_PARAMETER);
+        return S_OK;
+    }
+
+    PrefetchManager* manager = PrefetchManagerFactory::Create(TileCacheManager::get_Cache(tctSqliteCache));
+    if (manager)
+    {
+        manager->get_Loader()->set_MaxBytesPerSecond(maxBytesPerSecond);
+        manager->get_Loader()->set_MaxConcurrency(maxConcurrency);
+        *retVal = manager->PrefetchArea(provider, area, minZoom, maxZoom, maxTileCount, _globalCallback, stop);
+    }
+
+    return S_OK;
+}
+
 // *********************************************************
 //	     PrefetchToFolder()
 // *********************************************************
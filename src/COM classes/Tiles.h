@@ -180,6 +180,8 @@ public:
     STDMETHOD(PrefetchToFolder)(IExtents* ext, int zoom, int providerId, BSTR savePath, BSTR fileExt,
                                 IStopExecution* stop, LONG* retVal);
     STDMETHOD(get_ProjectionIsSphericalMercator)(VARIANT_BOOL* pVal);
+    STDMETHOD(PrefetchArea)(IShape* area, int minZoom, int maxZoom, int providerId, IStopExecution* stop,
+                            LONG maxTileCount, LONG maxBytesPerSecond, int maxConcurrency, LONG* retVal);
 
 private:
     long _lastErrorCode;
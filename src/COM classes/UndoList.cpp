@@ -365,6 +365,7 @@ bool CUndoList::UndoSingleItem(UndoListItem* item)
 					sf->get_Shape((long)index, &shp);
 					if (shp) {
 						shp->Rotate(item->ProjOffset.x, item->ProjOffset.y, -item->RotationAngle);
+						sf->put_ShapeModified((long)index, VARIANT_TRUE);
 					}
 				}
 				item->RotationAngle *= -1;
@@ -381,6 +382,7 @@ bool CUndoList::UndoSingleItem(UndoListItem* item)
 					sf->get_Shape((long)index, &shp);
 					if (shp) {
 						shp->Move(item->ProjOffset.x, item->ProjOffset.y);
+						sf->put_ShapeModified((long)index, VARIANT_TRUE);
 					}
 				}
 				item->ProjOffset.x *= -1;	// simply change the sign for the redo
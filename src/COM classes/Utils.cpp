@@ -48,6 +48,9 @@
 #include "GeosHelper.h"
 #include "GeosConverter.h"
 #include "GeometryHelper.h"
+#include "TerrainProcessor.h"
+#include "RasterCalculator.h"
+#include "ZonalStatistics.h"
 
 // #pragma warning(disable:4996)
 
@@ -3032,182 +3035,21 @@ STDMETHODIMP CUtils::GenerateHillShade(BSTR  bstrGridFilename, BSTR  bstrShadeFi
 			[-az Azimuth (default=315)] [-alt Altitude (default=45)]
 		Notes :
 			Scale for Feet:Latlong use scale=370400, for Meters:LatLong use scale=111120
+			The calculation itself is done by TerrainProcessor (see GenerateTerrainDerivative).
 	*/
-
 {
-	USES_CONVERSION;
-	const char  *pszGridFilename = OLE2A(bstrGridFilename);
-	const char  *pszShadeFilename = OLE2A(bstrShadeFilename);
-
-	GDALDataset *poDataset;
-	const float radiansToDegrees = (float)(180.0 / 3.14159);
-	const float degreesToRadians = (float)(3.14159 / 180.0);
-	double      adfGeoTransf[6];
-	float       *win;
-	float       *shadeBuf;
-	float  	    x;
-	float		y;
-	float       aspect;
-	float		slope;
-	float       cang;
-	int         i;
-	int         j;
-	int         n;
-	int         containsNull;
-	const char *pszFormat = "GTiff";
-
-	*retval = VARIANT_FALSE;
-
-	try
-	{
-		/* -----------------------------------
-		* Default Values
-		*/
-
-		if (z == NULL) z = 1.0;
-		if (scale == NULL) scale = 1.0;
-		if (az == NULL) az = 315.0;
-		if (alt == NULL) alt = 45.0;
-
-		/*---------------------------------------
-		* Open Dataset and get raster band (assuming it is band #1)
-		*/
-
-		GDALAllRegister();
-
-		poDataset = GdalHelper::OpenRasterDatasetW(OLE2W(bstrGridFilename), GA_ReadOnly);
-		if (poDataset == NULL)
-		{
-			CallbackHelper::ErrorMsg(Debug::Format("Generate hill shade: couldn't open dataset %s\n", pszGridFilename));
-			return S_OK;
-		}
-		GDALRasterBand  *poBnd;
-		poBnd = poDataset->GetRasterBand(1);
-		poDataset->GetGeoTransform(adfGeoTransf);
-
-		/* -------------------------------------
-		* Get variables from input dataset
-		*/
-		const double   nsres = adfGeoTransf[5];
-		const double   ewres = adfGeoTransf[1];
-		const float    nullValue = (float)poBnd->GetNoDataValue();
-		const int      nXSize = poBnd->GetXSize();
-		const int      nYSize = poBnd->GetYSize();
-		shadeBuf = (float *)CPLMalloc(sizeof(float)*nXSize);
-		win = (float *)CPLMalloc(sizeof(float) * 9);
-
-		/* -----------------------------------------
-		* Create the output dataset and copy over relevant metadata
-		*/
-		GDALDriver *poDriver;
-		poDriver = GetGDALDriverManager()->GetDriverByName(pszFormat);
-		GDALDataset      *poShadeDS;
-		GDALRasterBand   *poShadeBand;
-		char **papszOptions = NULL;
-
-		poShadeDS = poDriver->Create(pszShadeFilename, nXSize, nYSize, 1, GDT_Byte,
-			papszOptions);
-
-		if (!poShadeDS)
-			return S_OK;
-
-		poShadeDS->SetGeoTransform(adfGeoTransf);
-		poShadeDS->SetProjection(poDataset->GetProjectionRef());
-		poShadeBand = poShadeDS->GetRasterBand(1);
-		poShadeBand->SetNoDataValue(poBnd->GetNoDataValue());
-		/* ------------------------------------------
-		* Move a 3x3 window over each cell
-		* (where the cell in question is #4)
-		*
-		*                 0 1 2
-		*                 3 4 5
-		*                 6 7 8
-		*
-		*/
-		for (i = 0; i < nYSize; i++) {
-			for (j = 0; j < nXSize; j++) {
-				containsNull = 0;
-
-				// Exclude the edges 
-				if (i == 0 || j == 0 || i == nYSize - 1 || j == nXSize - 1)
-				{
-					// We are at the edge so write nullValue and move on
-					shadeBuf[j] = nullValue;
-					continue;
-				}
-
-				// Read in 3x3 window
-				poBnd->RasterIO(GF_Read, j - 1, i - 1, 3, 3,
-					win, 3, 3, GDT_Float32,
-					0, 0);
-
-				// Check if window has null value
-				for (n = 0; n <= 8; n++) {
-					if (win[n] == nullValue) {
-						containsNull = 1;
-						break;
-					}
-				}
-
-				if (containsNull == 1) {
-					// We have nulls so write nullValue and move on
-					shadeBuf[j] = nullValue;
-					continue;
-				}
-				else
-				{
-					// We have a valid 3x3 window. 
-
-					/* ---------------------------------------
-					* Compute Hillshade
-					*/
-
-					// First Slope ...
-					x = (float)(((z*win[0] + z * win[3] + z * win[3] + z * win[6]) -
-						(z*win[2] + z * win[5] + z * win[5] + z * win[8])) /
-						(8.0 * ewres * scale));
-
-					y = (float)(((z*win[6] + z * win[7] + z * win[7] + z * win[8]) -
-						(z*win[0] + z * win[1] + z * win[1] + z * win[2])) /
-						(8.0 * nsres * scale));
-
-					slope = (float)90.0 - atan(sqrt(x*x + y * y))*radiansToDegrees;
-
-					// ... then aspect...
-					aspect = atan2(x, y);
-
-					// ... then the shade value
-					cang = (float)(sin(alt*degreesToRadians) * sin(slope*degreesToRadians) +
-						cos(alt*degreesToRadians) * cos(slope*degreesToRadians) *
-						cos((az - 90.0)*degreesToRadians - aspect));
-
-					if (cang <= 0.0)
-						cang = nullValue;
-					else
-						cang = static_cast<float>(255.0 * cang);
-
-					shadeBuf[j] = cang;
-
-				}
-			}
-
-			/* -----------------------------------------
-			* Write Line to Raster
-			*/
-			poShadeBand->RasterIO(GF_Write, 0, i, nXSize, 1,
-				shadeBuf, nXSize, 1, GDT_Float32, 0, 0);
-		}
-
-		delete poShadeDS;
-		*retval = VARIANT_TRUE;
-	}
+	AFX_MANAGE_STATE(AfxGetStaticModuleState());
 
-	catch (exception e)
-	{
-		CallbackHelper::ErrorMsg("Exception in GenerateHillshade.");
-	}
+	/* -----------------------------------
+	* Default Values
+	*/
+	if (z == 0.0f) z = 1.0f;
+	if (scale == 0.0f) scale = 1.0f;
+	if (az == 0.0f) az = 315.0f;
+	if (alt == 0.0f) alt = 45.0f;
 
-	return S_OK;
+	CComBSTR format(L"GTiff");
+	return GenerateTerrainDerivative(bstrGridFilename, 1, bstrShadeFilename, tdHillshade, z, scale, az, alt, format, NULL, retval);
 }
 
 /************************************************************************/
@@ -4176,262 +4018,79 @@ STDMETHODIMP CUtils::GridStatisticsToShapefile(IGrid* grid, IShapefile* sf, VARI
 
 	header->Release();
 
-	long percent = -1;
+	// MWGIS-66:
+	ZonalStatisticsCalculator calculator(gridRowCount, gridColumnCount, xll, yll, dx, dy, noData, useCenterWithinMethod ? true : false);
+
+	double xMinGrid, yMinGrid, zMinGrid, xMaxGrid, yMaxGrid, zMaxGrid;
+	extGrid->GetBounds(&xMinGrid, &yMinGrid, &zMinGrid, &xMaxGrid, &yMaxGrid, &zMaxGrid);
+	extGrid->Release();
+	Extent gridBounds(xMinGrid, xMaxGrid, yMinGrid, yMaxGrid);
+
 	long numShapes;
 	sf->get_NumShapes(&numShapes);
 
 	for (long n = 0; n < numShapes; n++)
 	{
-		CallbackHelper::Progress(_globalCallback, n, numShapes, "Calculating...", _key, percent);
-
 		sf->get_ShapeSelected(n, &vb);
 		if (selectedOnly && !vb)
 			continue;
 
 		IShape* poly = NULL;
 		sf->get_Shape(n, &poly);
+		if (!poly)
+			continue;
 
-		IExtents* bounds = NULL;
-		poly->get_Extents(&extSf);
-		((CExtents*)extGrid)->GetIntersection(extSf, &bounds);
-		extSf->Release();
+		Extent bounds;
+		((CShape*)poly)->get_ExtentsXY(bounds.left, bounds.bottom, bounds.right, bounds.top);
 
-		if (bounds != NULL)
+		if (bounds.getIntersection(gridBounds, bounds))
 		{
 			// determine rows & cols which correspond to a poly
-			double xMin, yMin, zMin, xMax, yMax, zMax;
-			bounds->GetBounds(&xMin, &yMin, &zMin, &xMax, &yMax, &zMax);
-			bounds->Release();
-
 			long firstCol, firstRow, lastCol, lastRow;
-			grid->ProjToCell(xMin, yMin, &firstCol, &firstRow);
-			grid->ProjToCell(xMax, yMax, &lastCol, &lastRow);
-
-			long minRow = MIN(firstRow, lastRow);
-			long maxRow = MAX(firstRow, lastRow);
+			grid->ProjToCell(bounds.left, bounds.bottom, &firstCol, &firstRow);
+			grid->ProjToCell(bounds.right, bounds.top, &lastCol, &lastRow);
 
 			// Bounds returned by grid->get_Extents call return borders of outer most pixels,
-			// one of which because of rounding may be shifted to one pixel.
-			// So let's make sure that we are inside bounds.
-			// Another way to fix it is to return extents defined by centers of outer most pixels,
-			// which will eliminate possible rounding problems.
-			minRow = MAX(minRow, 0);
-			maxRow = MIN(maxRow, gridRowCount);
-
-			int cmnCount = lastCol - firstCol + 1;
-			int rowCount = maxRow - minRow + 1;
-
-			// now find the pixels inside poly and calculate stats
-			if (cmnCount > 0 && rowCount > 0)
-			{
-				float* vals = new float[cmnCount];
-				int row = 0;
-
-				int count = 0;
-				float sumWeight = 0.0f;	// a sum of cell parts which fall within polygon
-				float sum = 0.0;
-				float squares = 0.0;
-				float max = -FLT_MIN;
-				float min = FLT_MAX;
-				double minX = 0.0;
-				double minY = 0.0;
-
-				double yllWindow = yll + ((gridRowCount - 1) - maxRow) * dy;
-				double xllWindow = xll + firstCol * dx;
-				std::map<float, int> values;	// value; count
-
-				// MWGIS-66:
-				GridScanMethod method = useCenterWithinMethod ? GridScanMethod::CenterWithin : GridScanMethod::Intersection;
-
-				if (method == GridScanMethod::CenterWithin)
-				{
-					CPointInPolygon pip;
-					if (pip.SetPolygon(poly))
-					{
-						for (long i = minRow; i <= maxRow; i++)
-						{
-							grid->GetFloatWindow(i, i, firstCol, lastCol, vals, &vb);
-
-							if (vb) {
-								// double y = yllWindow + dy * (rowCount - row - 1.5);	  // (rowCount - 1) - row;  -0.5 - center of cell
-								double y = yllWindow + dy * (rowCount - row - 1.0); // MWGIS-65: yllWindow already use the center of the first cell.
-								pip.PrepareScanLine(y);
-
-								// checking values within row
-								for (long j = 0; j < cmnCount; j++)
-								{
-									if (vals[j] == noData)
-										continue;
-
-									// double x = xllWindow + dx * (j + 0.5);
-									double x = xllWindow + dx * (j); // MWGIS-65: xllWindow already use the center of the first cell.
-									if (pip.ScanPoint(x))
-									{
-										if (vals[j] < min) {
-											min = vals[j];
-											minX = x;
-											minY = y;
-										}
-										if (vals[j] > max) max = vals[j];
-										sum += vals[j];
-										squares += vals[j] * vals[j];
-										count++;
-
-										// counting unique values
-										if (values.find(vals[j]) == values.end())
-											values[vals[j]] = 1;
-										else
-											values[vals[j]] += 1;
-									}
-								}
-							}
-							row++;
-						}
-					}
-					sumWeight = (float)count;
-				}
-				else   //GridScanMethod == Intersection
-				{
-					Extent shape(xMin, xMax, yMin, yMax);
-					Extent cell;
-					Extent intersection;
-					double cellArea = dx * dy;
-
-					for (long i = minRow; i <= maxRow; i++)
-					{
-						grid->GetFloatWindow(i, i, firstCol, lastCol, vals, &vb);
-						if (vb) {
-							cell.bottom = yllWindow + dy * (rowCount - row - 1.5);
-							cell.top = yllWindow + dy * (rowCount - row - 0.5);
-							for (long j = 0; j < cmnCount; j++)
-							{
-								if (vals[j] == noData)
-									continue;
-
-								cell.left = xllWindow + dx * (j - 0.5);
-								cell.right = xllWindow + dx * (j + 0.5);
-								if (cell.getIntersection(shape, intersection))
-								{
-									float weight = (float)(intersection.getArea() / cellArea);  // the part of cell within polygon bounds
-
-									if (vals[j] < min) {
-										min = vals[j];
-										minX = (cell.right + cell.left) / 2;
-										minY = (cell.top + cell.bottom) / 2;
-									}
-									if (vals[j] > max) max = vals[j];
-									sum += vals[j] * weight;
-									squares += vals[j] * vals[j] * weight;
-									sumWeight += weight;
-									count++;
-
-									// counting unique values
-									if (values.find(vals[j]) == values.end())
-										values[vals[j]] = 1;
-									else
-										values[vals[j]] += 1;
-								}
-							}
-						}
-						row++;
-					}
-				}
-
-				if (count > 0)
-				{
-					// 0 - "Mean"
-					CComVariant vMean(sum / sumWeight);
-					sf->EditCellValue(fieldIndices[0], n, vMean, &vb);
-
-					if (!values.empty())
-					{
-						// 1 - "Median"
-						int half = count / 2;
-						int subCount = 0;
-						std::map<float, int>::iterator it = values.begin();
-						while (it != values.end())
-						{
-							subCount += it->second;
-							if (subCount > half)
-							{
-								CComVariant vMedian(it->first);
-								sf->EditCellValue(fieldIndices[1], n, vMedian, &vb);
-								break;
-							}
-							++it;
-						}
-
-						int maxCount = INT_MIN;
-						int minCount = INT_MAX;
-						float major, minor;
-						it = values.begin();
-						while (it != values.end())
-						{
-							if (it->second > maxCount) {
-								maxCount = it->second;
-								major = it->first;
-							}
-							if (it->second < minCount)
-							{
-								minCount = it->second;
-								minor = it->first;
-							}
-							++it;
-						}
-
-						// 2 - "Majority"
-						CComVariant vMajor(major);
-						sf->EditCellValue(fieldIndices[2], n, vMajor, &vb);
-
-						// 3 - "Minority"
-						CComVariant vMinor(minor);
-						sf->EditCellValue(fieldIndices[3], n, vMinor, &vb);
-					}
-
-					// 4 - "Minimum"
-					CComVariant vMin(min);
-					sf->EditCellValue(fieldIndices[4], n, vMin, &vb);
-
-					// 5 - "Maximum"
-					CComVariant vMax(max);
-					sf->EditCellValue(fieldIndices[5], n, vMax, &vb);
+			// one of which because of rounding may be shifted to one pixel;
+			// the calculator clips rows and columns by the grid.
+			calculator.AddPolygon(n, poly, MIN(firstRow, lastRow), MAX(firstRow, lastRow), firstCol, lastCol, bounds);
+		}
+		poly->Release();
+	}
 
-					// 6 - "Range"
-					CComVariant vRange(max - min);
-					sf->EditCellValue(fieldIndices[6], n, vRange, &vb);
+	// all the polygons are calculated in a single pass over the grid
+	if (!calculator.Run(grid, _globalCallback, _key))
+	{
+		ErrorMessage(calculator.get_LastErrorCode());
+	}
 
-					// 7 - "StD"
-					float stddev = sqrt(squares / sumWeight - pow(sum / sumWeight, 2));		// /count
-					CComVariant vStd(stddev);
-					sf->EditCellValue(fieldIndices[7], n, vStd, &vb);
+	for (int i = 0; i < calculator.get_Count(); i++)
+	{
+		const ZonalStatistics& stats = calculator.get_Result(i);
+		if (stats.count == 0)
+			continue;
 
-					// 8 - "Sum"
-					CComVariant vSum(sum);
-					sf->EditCellValue(fieldIndices[8], n, vSum, &vb);
+		long n = calculator.get_ShapeIndex(i);
 
-					// 9 - "MinX"
-					CComVariant vMinX(minX);
-					sf->EditCellValue(fieldIndices[9], n, vMinX, &vb);
+		double values[11] = { stats.mean, stats.median, stats.majority, stats.minority, stats.min, stats.max,
+							  stats.max - stats.min, stats.stdDev, stats.sum, stats.minX, stats.minY };
 
-					// 10 - "MinY"
-					CComVariant vMinY(minY);
-					sf->EditCellValue(fieldIndices[10], n, vMinY, &vb);
+		// "Mean", "Median", "Majority", "Minority", "Minimum", "Maximum", "Range", "StD", "Sum", "MinX", "MinY"
+		for (int j = 0; j < 11; j++)
+		{
+			CComVariant var(values[j]);
+			sf->EditCellValue(fieldIndices[j], n, var, &vb);
+		}
 
-					// 11 - "Variety"
-					int variety = values.size();
-					CComVariant vVar(variety);
-					sf->EditCellValue(fieldIndices[11], n, vVar, &vb);
+		// 11 - "Variety"
+		CComVariant vVar(stats.variety);
+		sf->EditCellValue(fieldIndices[11], n, vVar, &vb);
 
-					// 12 - "Count"
-					CComVariant vCount(count);
-					sf->EditCellValue(fieldIndices[12], n, vCount, &vb);
-				}
-				delete[] vals;
-			}
-		}
-		poly->Release();
+		// 12 - "Count"
+		CComVariant vCount(stats.count);
+		sf->EditCellValue(fieldIndices[12], n, vCount, &vb);
 	}
-	extGrid->Release();
+	CallbackHelper::ProgressCompleted(_globalCallback, _key);
 
 	if (!editing) {
 		sf->StopEditingTable(VARIANT_TRUE, this->_globalCallback, &vb);
@@ -5270,12 +4929,18 @@ GDALDriverH OpenOutputDriver(CString driverName)
 // ********************************************************
 //     OpenOutputFile()
 // ********************************************************
-GDALDataset* OpenOutputFile(GDALDriverH outputDriver, CStringW filename, int xSize, int ySize, GDALDataset* sourceTransform)
+GDALDataset* OpenOutputFile(GDALDriverH outputDriver, CStringW filename, int xSize, int ySize, GDALDataset* sourceTransform,
+							GDALDataType dataType = GDT_Float32)
 {
 	m_globalSettings.SetGdalUtf8(true);
 
 	char **papszOptions = NULL;
-	GDALDataset* outputDataset = (GDALDataset *)GDALCreate(outputDriver, Utility::ConvertToUtf8(filename), xSize, ySize, 1, GDT_Float32, papszOptions);
+	GDALDataset* outputDataset = (GDALDataset *)GDALCreate(outputDriver, Utility::ConvertToUtf8(filename), xSize, ySize, 1, dataType, papszOptions);
+	if (!outputDataset)
+	{
+		m_globalSettings.SetGdalUtf8(false);
+		return NULL;
+	}
 
 	double transform[6];
 	sourceTransform->GetGeoTransform((double*)&transform);
@@ -5479,6 +5144,32 @@ STDMETHODIMP CUtils::CalculateRaster(SAFEARRAY* InputNames, BSTR expression, BST
 		}
 	}
 
+	// --------------------------------------------------------
+	//   compiled expression over stripes of rasters
+	// --------------------------------------------------------
+	{
+		RasterCalculator calculator;
+		if (calculator.Compile(expr))
+		{
+			vector<GDALRasterBand*> bands;
+			for (int i = 0; i < numFields; i++)
+			{
+				bands.push_back(expr.get_FieldValue(i)->band());
+			}
+
+			if (calculator.Run(bands, bandOutput, outputNodataValue, callback, _key))
+			{
+				*retVal = VARIANT_TRUE;
+			}
+			else
+			{
+				ErrorMessage(tkGDAL_ERROR);
+				*errorMsg = A2BSTR(ErrorMsg(_lastErrorCode));
+			}
+			goto cleaning;
+		}
+	}
+
 	// --------------------------------------------------------
 	//   doing calculations
 	// --------------------------------------------------------
@@ -5763,6 +5454,104 @@ cleaning:
 	return S_OK;
 }
 
+// ********************************************************
+//     GenerateTerrainDerivative()
+// ********************************************************
+STDMETHODIMP CUtils::GenerateTerrainDerivative(BSTR demFilename, int bandIndex, BSTR outputFilename, tkTerrainDerivative derivative,
+	double zFactor, double scale, double azimuth, double altitude, BSTR gdalOutputFormat, ICallback* cBack, VARIANT_BOOL* retVal)
+{
+	AFX_MANAGE_STATE(AfxGetStaticModuleState());
+	*retVal = VARIANT_FALSE;
+
+	USES_CONVERSION;
+	CStringW name = OLE2W(demFilename);
+
+	if (!Utility::FileExistsW(name))
+	{
+		ErrorMessage(tkFILE_NOT_EXISTS);
+		return S_OK;
+	}
+
+	if (derivative < tdHillshade || derivative > tdCurvature || scale == 0.0)
+	{
+		ErrorMessage(tkINVALID_PARAMETER_VALUE);
+		return S_OK;
+	}
+
+	GDALDataset* dtOutput = NULL;
+	GDALRasterBand* band = NULL;
+	GDALRasterBand* bandOutput = NULL;
+	GDALDriverH driver = NULL;
+	double transform[6];
+
+	// -------------------------------------------------------
+	//		Source
+	// -------------------------------------------------------
+	GDALDataset* dt = GdalHelper::OpenRasterDatasetW(name, GDALAccess::GA_ReadOnly);
+	if (!dt)
+	{
+		ErrorMessage(tkCANT_OPEN_FILE);
+		return S_OK;
+	}
+
+	if (bandIndex < 1 || bandIndex > dt->GetRasterCount())
+	{
+		ErrorMessage(tkINDEX_OUT_OF_BOUNDS);
+		goto cleaning;
+	}
+	band = dt->GetRasterBand(bandIndex);
+
+	if (dt->GetGeoTransform(transform) != CE_None)
+	{
+		// cell size of 1 is assumed then
+		transform[0] = transform[2] = transform[3] = transform[4] = 0.0;
+		transform[1] = 1.0;
+		transform[5] = -1.0;
+	}
+
+	// -------------------------------------------------------
+	//		Creating output
+	// -------------------------------------------------------
+	driver = OpenOutputDriver(OLE2A(gdalOutputFormat));
+	if (driver != NULL)
+	{
+		dtOutput = OpenOutputFile(driver, OLE2W(outputFilename), dt->GetRasterXSize(), dt->GetRasterYSize(), dt,
+								  TerrainProcessor::GetOutputType(derivative));
+	}
+
+	if (!dtOutput)
+	{
+		ErrorMessage(tkCANT_CREATE_FILE);
+		goto cleaning;
+	}
+
+	bandOutput = dtOutput->GetRasterBand(1);
+	bandOutput->SetNoDataValue(TerrainProcessor::GetOutputNodata(derivative));
+
+	// -------------------------------------------------------
+	//	  Processing
+	// -------------------------------------------------------
+	{
+		TerrainProcessor processor(derivative, zFactor, scale, azimuth, altitude);
+		if (processor.Process(band, bandOutput, transform, cBack, _key))
+		{
+			*retVal = VARIANT_TRUE;
+		}
+		else
+		{
+			ErrorMessage(tkGDAL_ERROR);
+		}
+	}
+
+cleaning:
+	if (dt)
+		GdalHelper::CloseDataset(dt);
+	if (dtOutput)
+		GdalHelper::CloseDataset(dtOutput);
+
+	return S_OK;
+}
+
 // *************************************************
 //			IsTiffGrid()						  
 // *************************************************
@@ -193,6 +193,8 @@ public:
     STDMETHOD(GetAngle)(IPoint* firstPoint, IPoint* secondPoint, double* retVal);
 	STDMETHOD(LineInterpolatePoint)(IShape* sourceLine, IPoint* startPoint, double distance, VARIANT_BOOL normalized, IPoint **retVal);
 	STDMETHOD(LineProjectDistanceTo)(IShape* sourceLine, IShape* referenceShape, double* distance);
+	STDMETHOD(GenerateTerrainDerivative)(BSTR demFilename, int bandIndex, BSTR outputFilename, tkTerrainDerivative derivative,
+		double zFactor, double scale, double azimuth, double altitude, BSTR gdalOutputFormat, ICallback* cBack, VARIANT_BOOL* retVal);
 
 private:
 	struct RasterPoint
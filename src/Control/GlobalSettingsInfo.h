@@ -79,6 +79,9 @@ struct GlobalSettingsInfo
     bool gridUseHistogram;
     bool overrideLocalCallback;
     bool cacheDbfRecords;
+    bool cacheDbfColumns;
+    int gridDiskCacheSize;
+    bool compileExpressions;
     bool cacheShapeRenderingData;
     bool wmsDiskCaching;
     tkCallbackVerbosity callbackVerbosity;
@@ -106,6 +109,9 @@ struct GlobalSettingsInfo
         wmsDiskCaching = true;
         cacheShapeRenderingData = false;
         cacheDbfRecords = true;
+        cacheDbfColumns = false;
+        gridDiskCacheSize = 64;
+        compileExpressions = true;
         overrideLocalCallback = true;
         proxyAuthentication = asBasic;
 		httpUserAgent = "MapWinGIS/5.0"; // TODO Use VERSION Macros
@@ -29,6 +29,7 @@
 #include "ShapeEditor.h"
 #include "UndoList.h"
 #include "curl.h"
+#include "HttpConnectionPool.h"
 using namespace std;
 
 //disable some known warnings we don't care about
@@ -451,6 +452,7 @@ void CMapView::ReleaseTempObjects()
 void CMapView::Shutdown()
 {
 	// clean up cURL
+	HttpConnectionPool::Clear();
 	curl_global_cleanup();
 
 	Utility::ClosePointer(&_fontCourier);
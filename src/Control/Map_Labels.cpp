@@ -4,7 +4,6 @@
 #pragma once
 #include "stdafx.h"
 #include "Map.h"
-#include "IndexSearching.h"
 #include "LabelCategory.h"
 #include "Labels.h"
 #include "Shapefile.h"
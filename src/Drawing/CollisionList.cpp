@@ -31,18 +31,55 @@
 // ****************************************************************
 void CCollisionList::Clear()
 {
-	for (unsigned int i = 0; i < _extentsHorizontal.size(); i++)
+	_extentsHorizontal.clear();
+	_extentsRotated.clear();
+	_stampsHorizontal.clear();
+	_stampsRotated.clear();
+	_cells.clear();
+	_large.horizontal.clear();
+	_large.rotated.clear();
+	_stamp = 0;
+}
+
+// ****************************************************************
+//		NextStamp()
+// ****************************************************************
+void CCollisionList::NextStamp()
+{
+	_stamp++;
+	if (_stamp == 0)
 	{
-		delete _extentsHorizontal[i];
+		// the counter has wrapped around
+		std::fill(_stampsHorizontal.begin(), _stampsHorizontal.end(), 0);
+		std::fill(_stampsRotated.begin(), _stampsRotated.end(), 0);
+		_stamp = 1;
 	}
+}
+
+// ****************************************************************
+//		Register()
+// ****************************************************************
+void CCollisionList::Register(const CRect& bounds, int index, bool rotated)
+{
+	long xMin = MIN(bounds.left, bounds.right) >> COLLISION_GRID_SHIFT;
+	long xMax = MAX(bounds.left, bounds.right) >> COLLISION_GRID_SHIFT;
+	long yMin = MIN(bounds.top, bounds.bottom) >> COLLISION_GRID_SHIFT;
+	long yMax = MAX(bounds.top, bounds.bottom) >> COLLISION_GRID_SHIFT;
 
-	for (unsigned int i = 0; i < _extentsRotated.size(); i++)
+	if ((double)(xMax - xMin + 1) * (yMax - yMin + 1) > COLLISION_MAX_CELLS)
 	{
-		delete _extentsRotated[i];
+		(rotated ? _large.rotated : _large.horizontal).push_back(index);
+		return;
 	}
 
-	_extentsHorizontal.clear();
-	_extentsRotated.clear();
+	for (long cx = xMin; cx <= xMax; cx++)
+	{
+		for (long cy = yMin; cy <= yMax; cy++)
+		{
+			Cell& cell = _cells[CellKey(cx, cy)];
+			(rotated ? cell.rotated : cell.horizontal).push_back(index);
+		}
+	}
 }
 
 // ****************************************************************
@@ -51,27 +88,19 @@ void CCollisionList::Clear()
 // Checking overlapping with existing labels; input label isn't rotated
 bool CCollisionList::HaveCollision(CRect& rect)
 {
-	for(int i=0; i < (int)_extentsHorizontal.size(); i++)
+	auto collides = [&](int index, bool rotated)
 	{
-		CRect* r = _extentsHorizontal[i];
-		if ((rect.right < r->left) || (rect.bottom < r->top)  || (r->right < rect.left) || (r->bottom < rect.top))
-			continue;
-		else
-			return true;
-	}
-	
-	if (_extentsRotated.size() > 0) 
-	{
-		for(int i=0; i < (int)_extentsRotated.size(); i++)
+		if (rotated)
 		{
-			CRotatedRectangle* r = _extentsRotated[i];
-			if (r->BoundsIntersect(rect))
-			{
-				if (r->Intersects(rect)) return true;
-			}
+			CRotatedRectangle& r = _extentsRotated[index];
+			return r.BoundsIntersect(rect) && r.Intersects(rect);
 		}
-	}
-	return false;
+
+		const CRect& r = _extentsHorizontal[index];
+		return !((rect.right < r.left) || (rect.bottom < r.top) || (r.right < rect.left) || (r.bottom < rect.top));
+	};
+
+	return Visit(rect, collides);
 }
 
 // ****************************************************************
@@ -80,24 +109,19 @@ bool CCollisionList::HaveCollision(CRect& rect)
 // Checking overlapping with existing labels; input label is rotated
 bool CCollisionList::HaveCollision(CRotatedRectangle& rect)
 {
-	for(int i=0; i < (int)_extentsHorizontal.size(); i++)
-	{
-		CRect* r = _extentsHorizontal[i];
-		if (rect.BoundsIntersect(*r))
-		{
-			if (rect.Intersects(*r)) return true;
-		}
-	}
-	
-	for(int i=0; i < (int)_extentsRotated.size(); i++)
+	auto collides = [&](int index, bool rotated)
 	{
-		CRotatedRectangle* r = _extentsRotated[i];
-		if (rect.BoundsIntersect(*r))
+		if (rotated)
 		{
-			if (rect.Intersects(*r)) return true;
+			CRotatedRectangle& r = _extentsRotated[index];
+			return rect.BoundsIntersect(r) && rect.Intersects(r);
 		}
-	}
-	return false;
+
+		CRect& r = _extentsHorizontal[index];
+		return rect.BoundsIntersect(r) && rect.Intersects(r);
+	};
+
+	return Visit(*rect.BoundingBox(), collides);
 }
 
 // ****************************************************************
@@ -105,17 +129,15 @@ bool CCollisionList::HaveCollision(CRotatedRectangle& rect)
 // ****************************************************************
 void CCollisionList::AddRectangle(CRect* rect, int bufferX, int bufferY)
 {
-	CRect* rectNew = NULL;
+	CRect rectNew(rect->left, rect->top, rect->right, rect->bottom);
 	if (bufferX != 0 || bufferY != 0)
 	{
-		rectNew = new CRect(rect->left - bufferX/2, rect->top - bufferY/2, rect->right + bufferX/2, rect->bottom + bufferY/2);
-	}
-	else
-	{
-		rectNew = new CRect(rect->left, rect->top, rect->right, rect->bottom);
+		rectNew.SetRect(rect->left - bufferX/2, rect->top - bufferY/2, rect->right + bufferX/2, rect->bottom + bufferY/2);
 	}
 	
 	_extentsHorizontal.push_back(rectNew);
+	_stampsHorizontal.push_back(0);
+	Register(rectNew, (int)_extentsHorizontal.size() - 1, false);
 }
 
 // ****************************************************************
@@ -126,18 +148,16 @@ void CCollisionList::AddRotatedRectangle(CRotatedRectangle* rect, int bufferX, i
 	if (bufferX != 0 || bufferY != 0)
 	{
 		// TODO: the calculations here aren't precise
-		CRect* rectNew = NULL;
-		CRect* r = rect->BoundingBox();
-		r->InflateRect(bufferX, bufferY);
-		rectNew = new CRect(r->left, r->top, r->right, r->bottom);
-		_extentsHorizontal.push_back(rectNew);
+		CRect rectNew = *rect->BoundingBox();
+		rectNew.InflateRect(bufferX, bufferY);
+		AddRectangle(&rectNew);
 	}
 	else
 	{
-		CRotatedRectangle* rectNew = NULL;
-		rectNew = new CRotatedRectangle();
-		memcpy(rectNew->points, rect->points, sizeof(POINT) * 4);
+		CRotatedRectangle rectNew;
+		memcpy(rectNew.points, rect->points, sizeof(POINT) * 4);
 		_extentsRotated.push_back(rectNew);
+		_stampsRotated.push_back(0);
+		Register(*_extentsRotated.back().BoundingBox(), (int)_extentsRotated.size() - 1, true);
 	}
 }
-
@@ -24,27 +24,127 @@
  // Sergei Leschinski (lsu) 25 june 2010 - created the file.
 
 #pragma once
+#include <unordered_map>
 #include "RotatedRectangle.h"
 
+// the size of grid cell in pixels is 2 to the power of it
+#define COLLISION_GRID_SHIFT 6
+
+// labels which cover more cells than this are kept in a separate list
+#define COLLISION_MAX_CELLS 256
+
+// ****************************************************************
+//		CCollisionList
+// ****************************************************************
+// Bounds of the labels and charts which were drawn already. They are registered in the cells
+// of a uniform screen grid they cover, so a test visits only the labels nearby;
+// the exact test for rotated labels is made only when their bounding boxes intersect.
 class CCollisionList
 {
 public:
-	CCollisionList(void){}
+	CCollisionList(void)
+		: _stamp(0)
+	{
+	}
+
 	~CCollisionList(void)
 	{
 		this->Clear();
 	}
 
+private:
+	struct Cell
+	{
+		std::vector<int> horizontal;
+		std::vector<int> rotated;
+	};
+
 	// members
-	std::vector<CRect*> _extentsHorizontal;			 // extents for labels w/o rotation
-	std::vector<CRotatedRectangle*> _extentsRotated; // extents for labels with rotation
+	std::vector<CRect> _extentsHorizontal;				// extents for labels w/o rotation
+	std::vector<CRotatedRectangle> _extentsRotated;		// extents for labels with rotation
+	std::unordered_map<__int64, Cell> _cells;
+	Cell _large;										// labels covering too many cells
+	
+	// the last test each label took part in, so that it's tested once when it's in several cells
+	std::vector<unsigned int> _stampsHorizontal;
+	std::vector<unsigned int> _stampsRotated;
+	unsigned int _stamp;
+
+private:
+	static __int64 CellKey(long cx, long cy) { return ((__int64)cx << 32) | (unsigned long)cy; }
+	void Register(const CRect& bounds, int index, bool rotated);
+	void NextStamp();
+
+	// Calls visitor(index, rotated) once for each label which bounds may intersect the given ones, until it returns true.
+	template <typename Visitor>
+	bool Visit(const CRect& bounds, Visitor& visitor)
+	{
+		NextStamp();
+
+		if (VisitCell(_large, visitor))
+			return true;
+
+		if (_cells.empty())
+			return false;
+
+		long xMin = MIN(bounds.left, bounds.right) >> COLLISION_GRID_SHIFT;
+		long xMax = MAX(bounds.left, bounds.right) >> COLLISION_GRID_SHIFT;
+		long yMin = MIN(bounds.top, bounds.bottom) >> COLLISION_GRID_SHIFT;
+		long yMax = MAX(bounds.top, bounds.bottom) >> COLLISION_GRID_SHIFT;
+
+		// a huge rectangle is tested against all the labels
+		if ((double)(xMax - xMin + 1) * (yMax - yMin + 1) > (double)_cells.size())
+		{
+			for (std::unordered_map<__int64, Cell>::iterator it = _cells.begin(); it != _cells.end(); ++it)
+			{
+				if (VisitCell(it->second, visitor))
+					return true;
+			}
+			return false;
+		}
+
+		for (long cx = xMin; cx <= xMax; cx++)
+		{
+			for (long cy = yMin; cy <= yMax; cy++)
+			{
+				std::unordered_map<__int64, Cell>::iterator it = _cells.find(CellKey(cx, cy));
+				if (it != _cells.end() && VisitCell(it->second, visitor))
+					return true;
+			}
+		}
+		return false;
+	}
+
+	template <typename Visitor>
+	bool VisitCell(const Cell& cell, Visitor& visitor)
+	{
+		for (size_t i = 0; i < cell.horizontal.size(); i++)
+		{
+			int index = cell.horizontal[i];
+			if (_stampsHorizontal[index] != _stamp)
+			{
+				_stampsHorizontal[index] = _stamp;
+				if (visitor(index, false)) return true;
+			}
+		}
+
+		for (size_t i = 0; i < cell.rotated.size(); i++)
+		{
+			int index = cell.rotated[i];
+			if (_stampsRotated[index] != _stamp)
+			{
+				_stampsRotated[index] = _stamp;
+				if (visitor(index, true)) return true;
+			}
+		}
+		return false;
+	}
 
 	// functions
 public:
-	bool CCollisionList::HaveCollision(CRect& rect);
-	bool CCollisionList::HaveCollision(CRotatedRectangle& rect);
+	bool HaveCollision(CRect& rect);
+	bool HaveCollision(CRotatedRectangle& rect);
 	void Clear();
 	void AddRectangle(CRect* rect, int bufferX = 0, int bufferY = 0);
 	void AddRotatedRectangle(CRotatedRectangle* rect, int bufferX = 0, int bufferY = 0);
 };
-
@@ -162,7 +162,7 @@ bool CShapefileDrawer::Draw(const CRect & rcBounds, IShapefile* sf)
 	// --------------------------------------------------------
 	//	 Settings DC/graphics options
 	// --------------------------------------------------------
-    int* qtreeResult = nullptr;			// results of quad tree selection
+    vector<int> qtreeResult;			// results of quad tree selection
 	vector<long>* selectResult = NULL;	// results of spatial index selection
 	int offset;							// position (number) of a shape in the shapefile		
 
@@ -186,7 +186,14 @@ bool CShapefileDrawer::Draw(const CRect & rcBounds, IShapefile* sf)
 		USES_CONVERSION;
 		_sfReader = new CShapefileReader();
 
-		if (!_sfReader->ReadShapefileIndex(OLE2W(fname), file, readLock))
+		// the mapping of .shp/.shx is kept by the shapefile between redraws
+		CMappedFile* shpMapping = NULL;
+		CMappedFile* shxMapping = NULL;
+		if (((CShapefile*)sf)->get_MappedFiles(shpMapping, shxMapping))
+		{
+			_sfReader->UseMappedFiles(shpMapping, shxMapping);
+		}
+		else if (!_sfReader->ReadShapefileIndex(OLE2W(fname), file, readLock))
 		{
 			delete _sfReader; 
 			_sfReader = NULL;
@@ -199,7 +206,7 @@ bool CShapefileDrawer::Draw(const CRect & rcBounds, IShapefile* sf)
 		// ---------------------------------------------------------
 		if (_useSpatialIndex)
 		{
-			selectResult = SelectShapesFromSpatialIndex(OLE2A(fname), _extents);		// TODO: use Unicode
+			selectResult = SelectShapesFromSpatialIndex(_extents);
 			if (!selectResult)
 			{
 				_useSpatialIndex = VARIANT_FALSE;
@@ -221,6 +228,16 @@ bool CShapefileDrawer::Draw(const CRect & rcBounds, IShapefile* sf)
 	std::vector<vector<int>> categorySelIndices;  // used for selectionAppearance == saSelectionColor only
 	categoryIndices.resize(numCategories + 2);	// +1 = default options; +2 = selection options
 	categorySelIndices.resize(numCategories + 1); // +1 = default options; 
+
+	// options of categories are looked up once rather than in each of the drawing passes
+	std::vector<CDrawingOptionsEx*> categoryOptions;
+	categoryOptions.resize(numCategories + 2);
+	for (long i = 0; i < numCategories; i++)
+	{
+		categoryOptions[i] = categories->get_UnderlyingOptions(i);
+	}
+	categoryOptions[numCategories] = defaultOptions;
+	categoryOptions[numCategories + 1] = selectionOptions;
 	
 	// --------------------------------------------------------------
 	//	 Analyzing visibility expression
@@ -249,18 +266,9 @@ bool CShapefileDrawer::Draw(const CRect & rcBounds, IShapefile* sf)
 	// --------------------------------------------------------------
 	if(_useQTree & _isEditing)
 	{
-		int shapesCount;
-		IExtents * bBox = NULL;
-		ComHelper::CreateExtents(&bBox);
-		bBox->SetBounds(_extents->left,_extents->bottom,0,_extents->right, _extents->top,0);
-		((CShapefile*)sf)->QuickQueryInEditMode(bBox,&qtreeResult,&shapesCount);
-		if (qtreeResult == NULL) 
-		{
-			bBox->Release(); bBox=NULL;
-			goto cleaning; 
-		}
-
-		numShapes = (long)shapesCount;
+		QTreeExtent query(_extents->left, _extents->right, _extents->top, _extents->bottom);
+		((CShapefile*)sf)->QuickQueryInEditModeCore(query, qtreeResult);
+		numShapes = (long)qtreeResult.size();
 	}
 	
 	// --------------------------------------------------------------------
@@ -318,7 +326,7 @@ bool CShapefileDrawer::Draw(const CRect & rcBounds, IShapefile* sf)
 		{
 			if (!_isEditing && _useSpatialIndex)	
 			{
-				offset = (*selectResult)[i] - 1;	
+				offset = (*selectResult)[i];
 			}
 			else
 			{
@@ -446,17 +454,8 @@ bool CShapefileDrawer::Draw(const CRect & rcBounds, IShapefile* sf)
 		{
 			for(int i = categorySelIndices.size() - 1; i >= 0 ; i--)
 			{
-				if (i == numCategories)				
-				{
-					options = defaultOptions;
-				}
-				else if (i < numCategories)
-				{
-					options = ((CShapefileCategories*)categories)->get_UnderlyingOptions(i);
-				}
-				
 				std::vector<int>* indices = &categorySelIndices[i];
-				this->DrawCategory(options, indices, true);
+				this->DrawCategory(categoryOptions[i], indices, true);
 			}
 		}
 		else		// selection drawing options
@@ -470,21 +469,8 @@ bool CShapefileDrawer::Draw(const CRect & rcBounds, IShapefile* sf)
 	// drawing unselected shapes
 	for(int i = categoryIndices.size() - 2; i >= 0 ; i--)
 	{
-		if (i == numCategories)				
-		{
-			options = defaultOptions;
-		}
-		else if (i < numCategories)
-		{
-			options = ((CShapefileCategories*)categories)->get_UnderlyingOptions(i);
-		}
-		else
-		{
-			CallbackHelper::AssertionFailed("Drawing options for category aren't found.");
-		}
-		
 		std::vector<int>* indices = &categoryIndices[i];
-		this->DrawCategory(options, indices, false);
+		this->DrawCategory(categoryOptions[i], indices, false);
 	}
 
 	// drawing selection at the top
@@ -494,17 +480,8 @@ bool CShapefileDrawer::Draw(const CRect & rcBounds, IShapefile* sf)
 		{
 			for(int i = categorySelIndices.size() - 1; i >= 0 ; i--)
 			{
-				if (i == numCategories)				
-				{
-					options = defaultOptions;
-				}
-				else if (i < numCategories)
-				{
-					options = ((CShapefileCategories*)categories)->get_UnderlyingOptions(i);
-				}
-				
 				std::vector<int>* indices = &categorySelIndices[i];
-				this->DrawCategory(options, indices, true);
+				this->DrawCategory(categoryOptions[i], indices, true);
 			}
 		}
 		else
@@ -535,29 +512,17 @@ bool CShapefileDrawer::Draw(const CRect & rcBounds, IShapefile* sf)
 // ------------------------------------------
 //  final cleaning
 // ------------------------------------------
-cleaning:
 	if (!_isEditing)
 	{
 		delete _sfReader;
 		_sfReader = NULL;
 	}
 	
-	if(_useQTree) 
+	if (_useSpatialIndex && selectResult)
 	{
-        // make sure it was allocated
-        if (qtreeResult)
-        {
-	    	delete[] qtreeResult;
-    	}
-    }
-	else
-	{
-		if (_useSpatialIndex && selectResult)
-		{
-			selectResult->clear();
-			delete selectResult;
-			selectResult = NULL;
-		}
+		selectResult->clear();
+		delete selectResult;
+		selectResult = NULL;
 	}
 	return true;
 }
@@ -843,20 +808,20 @@ void CShapefileDrawer::DrawPointCategory( CDrawingOptionsEx* options, std::vecto
 				{
 					x = *(double*)(data + 4);	// 4 bytes on shape type
 					y = *(double*)(data + 12); 
-					delete[] data;
+					_sfReader->ReleaseShapeData(data);
 					points.push_back(PointWithId(x, y, shapeIndex));
 				}
 				else
 				{
-					PolygonData* pdata = _sfReader->ReadMultiPointData(data);
-					for(int i = 0; i < pdata->pointCount; i++)
+					PolygonData pdata;
+					_sfReader->ReadMultiPointData(data, pdata);
+					for(int i = 0; i < pdata.pointCount; i++)
 					{
-						x = pdata->points[i * 2];
-						y = pdata->points[i * 2 + 1];
+						x = pdata.points[i * 2];
+						y = pdata.points[i * 2 + 1];
 						points.push_back(PointWithId(x, y, shapeIndex));
 					}
-					delete pdata;
-					delete[] data;
+					_sfReader->ReleaseShapeData(data);
 				}
 			}
 			else
@@ -1346,7 +1311,7 @@ IShapeData* CShapefileDrawer::ReadAndCacheShapeData(int shapeIndex)
 		{
 			CShapeData* newData = new CShapeData(data, recordLength);
 			_shapefile->put_ShapeRenderingData(shapeIndex, newData);
-			delete[] data;
+			_sfReader->ReleaseShapeData(data);
 
 			shapeData = newData;
 		}
@@ -1398,9 +1363,9 @@ bool CShapefileDrawer::DrawPolygonGDIPlus(int shapeIndex, Gdiplus::GraphicsPath&
 				{
 					if ((xMax - xMin >= minSize) || (yMax - yMin >= minSize))	// the poly must be larger than a pixel at a current to be drawn
 					{
-						PolygonData* shapeData = _sfReader->ReadPolygonData(data);
-						this->AddPolygonToPath(&path, shapeData, drawingMode);
-						delete shapeData;
+						PolygonData shapeData;
+						_sfReader->ReadPolygonData(data, shapeData);
+						this->AddPolygonToPath(&path, &shapeData, drawingMode);
 						result = true;
 					}
 					else
@@ -1409,7 +1374,7 @@ bool CShapefileDrawer::DrawPolygonGDIPlus(int shapeIndex, Gdiplus::GraphicsPath&
 						result = false;
 					}
 				}
-				delete[] data;
+				_sfReader->ReleaseShapeData(data);
 				return result;
 			}
 		}
@@ -1518,16 +1483,16 @@ void CShapefileDrawer::DrawLineCategoryGDI(CDrawingOptionsEx* options, std::vect
 					{
 						if ((xMax - xMin >= delta) || (yMax - yMin >= delta))	// the poly must be larger than a pixel at a current to be drawn
 						{
-							PolygonData* shapeData = _sfReader->ReadPolygonData(data);
-							this->DrawPolyGDI( shapeData, options, *path, options->verticesVisible?true:false);
-							delete shapeData;
+							PolygonData shapeData;
+							_sfReader->ReadPolygonData(data, shapeData);
+							this->DrawPolyGDI( &shapeData, options, *path, options->verticesVisible?true:false);
 						}
 						else
 						{
 							this->DrawPolygonPoint(xMin, xMax, yMin, yMax, pointColor);
 						}
 					}
-					delete[] data;
+					_sfReader->ReleaseShapeData(data);
 				}
 			}
 		}
@@ -2336,37 +2301,16 @@ inline void CShapefileDrawer::DrawPolygonPoint(double &xMin, double& xMax, doubl
 //********************************************************************
 //*		SelectShapesFromSpatialIndex()
 //********************************************************************
-std::vector<long>* CShapefileDrawer::SelectShapesFromSpatialIndex(char* sFilename, Extent* extents)
+std::vector<long>* CShapefileDrawer::SelectShapesFromSpatialIndex(Extent* extents)
 {
-	string baseName;
-	baseName = sFilename;
-	baseName = baseName.substr(0,baseName.find_last_of("."));
-	
-	double lowVals[2], highVals[2];
-	lowVals[0] = extents->left;
-	lowVals[1] = extents->bottom;
-	highVals[0] = extents->right;
-	highVals[1] = extents->top;
-	
-	IndexSearching::CIndexSearching *res = new IndexSearching::CIndexSearching();	
-
-	if (IndexSearching::selectShapesFromIndex((char *)baseName.c_str(), lowVals, highVals, IndexSearching::intersection, 100, res) == 0)	
-	{
-		std::vector<long>* selectResult = new std::vector<long>;	
-		selectResult->reserve(res->getLength());
-		for (int i = 0 ;i < res->getLength(); i++)
-		{
-			selectResult->push_back((long)res->getValue(i));
-		}
-		
-		delete res;
-		return selectResult;
-	}
-	else
-	{
-		delete res;
+	// the index is mapped once per shapefile rather than opened for each redraw
+	CShapefile* sf = (CShapefile*)_shapefile;
+	if (!sf->LoadSpatialIndex())
 		return NULL;
-	}
+
+	std::vector<long>* selectResult = new std::vector<long>;
+	sf->get_SpatialIndex()->Search(extents->left, extents->bottom, extents->right, extents->top, false, *selectResult);
+	return selectResult;
 }
 
 #pragma endregion
@@ -0,0 +1,252 @@
+#include "StdAfx.h"
+#include "GridBlockCache.h"
+
+// ****************************************************************
+//		Open()
+// ****************************************************************
+bool GridBlockCache::Open(GDALRasterBand* band, bool useInt, __int64 memoryBudget)
+{
+	Close();
+
+	if (!band || band->GetXSize() <= 0 || band->GetYSize() <= 0)
+		return false;
+
+	_width = band->GetXSize();
+	_height = band->GetYSize();
+
+	int nativeWidth = 0, nativeHeight = 0;
+	band->GetBlockSize(&nativeWidth, &nativeHeight);
+
+	_blockWidth = nativeWidth > 0 ? min((long)nativeWidth, _width) : _width;
+	_blockHeight = nativeHeight > 0 ? min((long)nativeHeight, _height) : 1;
+
+	// both _int32 and float take 4 bytes; two rows of blocks must fit in the budget
+	__int64 rowSize = (__int64)_width * sizeof(float);
+	__int64 maxHeight = max((__int64)1, memoryBudget / (2 * rowSize));
+	_blockHeight = (long)min((__int64)_blockHeight, maxHeight);
+
+	_numBlocksX = (_width + _blockWidth - 1) / _blockWidth;
+
+	__int64 blockSize = (__int64)_blockWidth * _blockHeight * sizeof(float);
+	_maxBlocks = (size_t)max((__int64)2, memoryBudget / blockSize);
+
+	_band = band;
+	_useInt = useInt;
+	return true;
+}
+
+// ****************************************************************
+//		Close()
+// ****************************************************************
+void GridBlockCache::Close()
+{
+	Clear();
+	_band = NULL;
+}
+
+// ****************************************************************
+//		Clear()
+// ****************************************************************
+void GridBlockCache::Clear()
+{
+	for (BlockList::iterator it = _blocks.begin(); it != _blocks.end(); ++it)
+	{
+		delete *it;
+	}
+
+	_blocks.clear();
+	_index.clear();
+	_last = NULL;
+}
+
+// ****************************************************************
+//		Flush()
+// ****************************************************************
+bool GridBlockCache::Flush()
+{
+	bool result = true;
+
+	for (BlockList::iterator it = _blocks.begin(); it != _blocks.end(); ++it)
+	{
+		if ((*it)->dirty && !WriteBlock(*it))
+		{
+			result = false;
+		}
+	}
+
+	return result;
+}
+
+// ****************************************************************
+//		HasChanges()
+// ****************************************************************
+bool GridBlockCache::HasChanges()
+{
+	for (BlockList::iterator it = _blocks.begin(); it != _blocks.end(); ++it)
+	{
+		if ((*it)->dirty)
+			return true;
+	}
+	return false;
+}
+
+// ****************************************************************
+//		GetValue()
+// ****************************************************************
+bool GridBlockCache::GetValue(long row, long column, double& value)
+{
+	Block* block = GetBlock(row, column);
+	if (!block)
+		return false;
+
+	size_t index = (size_t)(row - block->y) * block->width + (column - block->x);
+	value = _useInt ? static_cast<double>(block->ints[index]) : static_cast<double>(block->floats[index]);
+	return true;
+}
+
+// ****************************************************************
+//		PutValue()
+// ****************************************************************
+bool GridBlockCache::PutValue(long row, long column, double value)
+{
+	Block* block = GetBlock(row, column);
+	if (!block)
+		return false;
+
+	size_t index = (size_t)(row - block->y) * block->width + (column - block->x);
+	if (_useInt)
+	{
+		block->ints[index] = static_cast<_int32>(value);
+	}
+	else
+	{
+		block->floats[index] = static_cast<float>(value);
+	}
+
+	block->dirty = true;
+	return true;
+}
+
+// ****************************************************************
+//		GetBlock()
+// ****************************************************************
+GridBlockCache::Block* GridBlockCache::GetBlock(long row, long column)
+{
+	if (Contains(_last, row, column))
+		return _last;
+
+	if (!_band || row < 0 || row >= _height || column < 0 || column >= _width)
+		return NULL;
+
+	long blockX = column / _blockWidth;
+	long blockY = row / _blockHeight;
+	__int64 key = (__int64)blockY * _numBlocksX + blockX;
+
+	std::unordered_map<__int64, BlockList::iterator>::iterator it = _index.find(key);
+	if (it != _index.end())
+	{
+		// splice keeps the iterator valid
+		_blocks.splice(_blocks.begin(), _blocks, it->second);
+		_last = *it->second;
+		return _last;
+	}
+
+	while (_blocks.size() >= _maxBlocks)
+	{
+		Block* oldest = _blocks.back();
+
+		// a changed block which can't be written stays in the cache, so that its values aren't lost;
+		// the caller gets the failure as for a block which can't be read, Flush retries the write
+		if (oldest->dirty && !WriteBlock(oldest))
+			return NULL;
+
+		__int64 oldestKey = (__int64)(oldest->y / _blockHeight) * _numBlocksX + oldest->x / _blockWidth;
+		_index.erase(oldestKey);
+		_blocks.pop_back();
+		ReleaseBlock(oldest);
+	}
+
+	Block* block = LoadBlock(blockX, blockY);
+	if (!block)
+		return NULL;
+
+	_blocks.push_front(block);
+	_index[key] = _blocks.begin();
+	_last = block;
+	return block;
+}
+
+// ****************************************************************
+//		LoadBlock()
+// ****************************************************************
+GridBlockCache::Block* GridBlockCache::LoadBlock(long blockX, long blockY)
+{
+	Block* block = new Block();
+	block->x = blockX * _blockWidth;
+	block->y = blockY * _blockHeight;
+	block->width = min(_blockWidth, _width - block->x);
+	block->height = min(_blockHeight, _height - block->y);
+	block->dirty = false;
+
+	size_t size = (size_t)block->width * block->height;
+	void* data = NULL;
+
+	try
+	{
+		if (_useInt)
+		{
+			block->ints.resize(size);
+			data = &block->ints[0];
+		}
+		else
+		{
+			block->floats.resize(size);
+			data = &block->floats[0];
+		}
+	}
+	catch (std::bad_alloc&)
+	{
+		delete block;
+		return NULL;
+	}
+
+	CPLErr err = _band->RasterIO(GF_Read, block->x, block->y, block->width, block->height, data,
+								 block->width, block->height, _useInt ? GDT_Int32 : GDT_Float32, 0, 0);
+	if (err != CE_None)
+	{
+		delete block;
+		return NULL;
+	}
+
+	return block;
+}
+
+// ****************************************************************
+//		WriteBlock()
+// ****************************************************************
+bool GridBlockCache::WriteBlock(Block* block)
+{
+	void* data = _useInt ? (void*)&block->ints[0] : (void*)&block->floats[0];
+
+	CPLErr err = _band->RasterIO(GF_Write, block->x, block->y, block->width, block->height, data,
+								 block->width, block->height, _useInt ? GDT_Int32 : GDT_Float32, 0, 0);
+	if (err != CE_None)
+		return false;
+
+	block->dirty = false;
+	return true;
+}
+
+// ****************************************************************
+//		ReleaseBlock()
+// ****************************************************************
+// The block must be written before if it was changed
+void GridBlockCache::ReleaseBlock(Block* block)
+{
+	if (_last == block)
+	{
+		_last = NULL;
+	}
+
+	delete block;
+}
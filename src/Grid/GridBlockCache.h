@@ -0,0 +1,85 @@
+//********************************************************************************************************
+//File name: GridBlockCache.h
+//Description: LRU cache of raster blocks for the grids which are read and written from disk
+//********************************************************************************************************
+// Values of disk-based tkGridRaster are read and written through this cache. Cached blocks
+// have the width of native GDAL blocks; their height is that of native blocks too unless two rows
+// of blocks don't fit in the memory budget, so that reading the grid row by row never
+// evicts the row being read. Changed blocks are written back when they are evicted or on Flush;
+// a block which fails to be written isn't evicted.
+//********************************************************************************************************
+#pragma once
+#include <list>
+#include <unordered_map>
+
+class GridBlockCache
+{
+public:
+	GridBlockCache()
+		: _band(NULL), _useInt(false), _width(0), _height(0), _blockWidth(0), _blockHeight(0),
+		  _numBlocksX(0), _maxBlocks(0), _last(NULL)
+	{
+	}
+
+	~GridBlockCache()
+	{
+		Close();
+	}
+
+private:
+	struct Block
+	{
+		long x;				// position of the first cell
+		long y;
+		long width;			// the blocks at the right and bottom edges can be smaller
+		long height;
+		bool dirty;
+		vector<_int32> ints;
+		vector<float> floats;
+	};
+
+	typedef std::list<Block*> BlockList;
+
+	GDALRasterBand* _band;
+	bool _useInt;			// values are stored as _int32, otherwise as float
+	long _width;
+	long _height;
+	long _blockWidth;
+	long _blockHeight;
+	long _numBlocksX;
+	size_t _maxBlocks;
+
+	BlockList _blocks;		// the most recently used first
+	std::unordered_map<__int64, BlockList::iterator> _index;
+	Block* _last;			// the block of the last access, most of them go to the same block
+
+private:
+	Block* GetBlock(long row, long column);
+	Block* LoadBlock(long blockX, long blockY);
+	bool WriteBlock(Block* block);
+	void ReleaseBlock(Block* block);
+
+	bool Contains(Block* block, long row, long column)
+	{
+		return block && row >= block->y && row < block->y + block->height &&
+			   column >= block->x && column < block->x + block->width;
+	}
+
+public:
+	// The budget is in bytes; at least two blocks are kept regardless of it.
+	bool Open(GDALRasterBand* band, bool useInt, __int64 memoryBudget);
+	void Close();
+	bool IsOpen() { return _band != NULL; }
+
+	bool GetValue(long row, long column, double& value);
+	bool PutValue(long row, long column, double value);
+
+	// writes back the changed blocks
+	bool Flush();
+
+	// drops all the blocks without writing them
+	void Clear();
+
+	bool HasChanges();
+	int get_NumBlocks() { return (int)_blocks.size(); }
+};
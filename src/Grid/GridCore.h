@@ -0,0 +1,313 @@
+//********************************************************************************************************
+//File name: GridCore.h
+//Description: storage, min/max and binary I/O shared by dGrid, fGrid, lGrid and sGrid
+//********************************************************************************************************
+// The values are held in a single contiguous block. The array of row pointers is kept
+// because getArrayPtr() returns T** and the format specific code addresses cells as data[row][col].
+// Binary grids are read and written a row at a time rather than with fread / fwrite for each cell.
+// Min/max skip nodata values and NaN; float and double are scanned 4 and 2 values at a time with SSE.
+//********************************************************************************************************
+#pragma once
+#include <limits>
+#include <algorithm>
+#include <new>
+#include <emmintrin.h>
+#include "grdTypes.h"
+
+typedef void (*GridProgressCallback)(int number, const char * message);
+
+// *******************************************************
+//		GridMinMax
+// *******************************************************
+template <typename T>
+class GridMinMax
+{
+public:
+	GridMinMax(T nodata)
+		: _nodata(nodata)
+	{
+		_min = std::numeric_limits<T>::has_infinity ? std::numeric_limits<T>::infinity() : (std::numeric_limits<T>::max)();
+		_max = std::numeric_limits<T>::has_infinity ? -std::numeric_limits<T>::infinity() : (std::numeric_limits<T>::lowest)();
+	}
+
+private:
+	T _nodata;
+	T _min;
+	T _max;
+
+public:
+	void Add(const T* values, size_t count)
+	{
+		T lo = _min, hi = _max;
+		for (size_t i = 0; i < count; i++)
+		{
+			T v = values[i];
+			bool valid = v != _nodata;
+			lo = valid && v < lo ? v : lo;
+			hi = valid && v > hi ? v : hi;
+		}
+		_min = lo;
+		_max = hi;
+	}
+
+	// nodata is returned if there were no valid values
+	T GetMin() { return _min <= _max ? _min : _nodata; }
+	T GetMax() { return _min <= _max ? _max : _nodata; }
+};
+
+// Invalid lanes are replaced by the current min/max, which leaves them unchanged;
+// _mm_min_ps / _mm_max_ps return the second operand when the first one is NaN.
+template <>
+inline void GridMinMax<float>::Add(const float* values, size_t count)
+{
+	__m128 lo = _mm_set1_ps(_min);
+	__m128 hi = _mm_set1_ps(_max);
+	__m128 nodata = _mm_set1_ps(_nodata);
+
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 v = _mm_loadu_ps(values + i);
+		__m128 valid = _mm_cmpneq_ps(v, nodata);
+		lo = _mm_min_ps(_mm_or_ps(_mm_and_ps(valid, v), _mm_andnot_ps(valid, lo)), lo);
+		hi = _mm_max_ps(_mm_or_ps(_mm_and_ps(valid, v), _mm_andnot_ps(valid, hi)), hi);
+	}
+
+	float los[4], his[4];
+	_mm_storeu_ps(los, lo);
+	_mm_storeu_ps(his, hi);
+
+	for (int k = 0; k < 4; k++)
+	{
+		if (los[k] < _min) _min = los[k];
+		if (his[k] > _max) _max = his[k];
+	}
+
+	for (; i < count; i++)
+	{
+		float v = values[i];
+		if (v != _nodata)
+		{
+			if (v < _min) _min = v;
+			if (v > _max) _max = v;
+		}
+	}
+}
+
+template <>
+inline void GridMinMax<double>::Add(const double* values, size_t count)
+{
+	__m128d lo = _mm_set1_pd(_min);
+	__m128d hi = _mm_set1_pd(_max);
+	__m128d nodata = _mm_set1_pd(_nodata);
+
+	size_t i = 0;
+	for (; i + 2 <= count; i += 2)
+	{
+		__m128d v = _mm_loadu_pd(values + i);
+		__m128d valid = _mm_cmpneq_pd(v, nodata);
+		lo = _mm_min_pd(_mm_or_pd(_mm_and_pd(valid, v), _mm_andnot_pd(valid, lo)), lo);
+		hi = _mm_max_pd(_mm_or_pd(_mm_and_pd(valid, v), _mm_andnot_pd(valid, hi)), hi);
+	}
+
+	double los[2], his[2];
+	_mm_storeu_pd(los, lo);
+	_mm_storeu_pd(his, hi);
+
+	for (int k = 0; k < 2; k++)
+	{
+		if (los[k] < _min) _min = los[k];
+		if (his[k] > _max) _max = his[k];
+	}
+
+	for (; i < count; i++)
+	{
+		double v = values[i];
+		if (v != _nodata)
+		{
+			if (v < _min) _min = v;
+			if (v > _max) _max = v;
+		}
+	}
+}
+
+// *******************************************************
+//		GridCore
+// *******************************************************
+template <typename T>
+class GridCore
+{
+public:
+	GridCore()
+		: _values(NULL), _rows(NULL), _numRows(0), _numCols(0)
+	{
+	}
+
+	~GridCore()
+	{
+		Free();
+	}
+
+private:
+	T* _values;			// all the rows one after another
+	T** _rows;			// pointers to the rows within _values
+	long _numRows;
+	long _numCols;
+
+	GridCore(const GridCore&);
+	GridCore& operator=(const GridCore&);
+
+	static void ReportProgress(GridProgressCallback callback, long row, long numRows, int& percent, const char* message)
+	{
+		if (callback != NULL)
+		{
+			int newpercent = (int)(((row + 1) * 100.0) / numRows);
+			if (newpercent > percent)
+			{
+				percent = newpercent;
+				callback(percent, message);
+			}
+		}
+	}
+
+public:
+	// Returns the row pointers or NULL if there is not enough memory.
+	T** Allocate(long numRows, long numCols)
+	{
+		Free();
+
+		if (numRows <= 0 || numCols <= 0)
+			return NULL;
+
+		_values = new (std::nothrow) T[(size_t)numRows * numCols];
+		_rows = new (std::nothrow) T*[numRows];
+		if (!_values || !_rows)
+		{
+			Free();
+			return NULL;
+		}
+
+		for (long j = 0; j < numRows; j++)
+		{
+			_rows[j] = _values + (size_t)j * numCols;
+		}
+
+		_numRows = numRows;
+		_numCols = numCols;
+		return _rows;
+	}
+
+	void Free()
+	{
+		delete[] _values;
+		delete[] _rows;
+		_values = NULL;
+		_rows = NULL;
+		_numRows = 0;
+		_numCols = 0;
+	}
+
+	T** GetRows() { return _rows; }
+
+	void Fill(T value)
+	{
+		std::fill(_values, _values + (size_t)_numRows * _numCols, value);
+	}
+
+	void GetMinMax(T nodata, T& min, T& max)
+	{
+		GridMinMax<T> stats(nodata);
+		stats.Add(_values, (size_t)_numRows * _numCols);
+		min = stats.GetMin();
+		max = stats.GetMax();
+	}
+
+	// Reads the values stored row after row, the file must be positioned at the first one.
+	bool ReadBinary(FILE* in, GridProgressCallback callback, const char* message)
+	{
+		int percent = 0;
+		for (long j = 0; j < _numRows; j++)
+		{
+			if (fread(_rows[j], sizeof(T), _numCols, in) != (size_t)_numCols)
+				return false;
+
+			ReportProgress(callback, j, _numRows, percent, message);
+		}
+		return true;
+	}
+
+	bool WriteBinary(FILE* out, GridProgressCallback callback, const char* message)
+	{
+		int percent = 0;
+		for (long j = 0; j < _numRows; j++)
+		{
+			if (fwrite(_rows[j], sizeof(T), _numCols, out) != (size_t)_numCols)
+				return false;
+
+			ReportProgress(callback, j, _numRows, percent, message);
+		}
+		return true;
+	}
+
+	// Writes the same value to all the cells of a disk-based grid.
+	static bool FillBinary(FILE* out, T value, long numRows, long numCols)
+	{
+		if (numCols <= 0)
+			return true;
+
+		vector<T> row(numCols, value);
+		for (long j = 0; j < numRows; j++)
+		{
+			if (fwrite(&row[0], sizeof(T), numCols, out) != (size_t)numCols)
+				return false;
+		}
+		return true;
+	}
+
+	// Writes the values of a disk-based grid; Grid::getValue is called to fill each row.
+	template <typename Grid>
+	static bool WriteBinaryFrom(FILE* out, Grid& grid, long numRows, long numCols, GridProgressCallback callback, const char* message)
+	{
+		if (numCols <= 0)
+			return true;
+
+		vector<T> row(numCols);
+		int percent = 0;
+		for (long j = 0; j < numRows; j++)
+		{
+			for (long i = 0; i < numCols; i++)
+			{
+				row[i] = grid.getValue(i, j);
+			}
+
+			if (fwrite(&row[0], sizeof(T), numCols, out) != (size_t)numCols)
+				return false;
+
+			ReportProgress(callback, j, numRows, percent, message);
+		}
+		return true;
+	}
+
+	// Min/max of a disk-based grid, which is read row by row.
+	template <typename Grid>
+	static void GetMinMaxFrom(Grid& grid, long numRows, long numCols, T nodata, T& min, T& max)
+	{
+		GridMinMax<T> stats(nodata);
+
+		if (numCols > 0)
+		{
+			vector<T> row(numCols);
+			for (long j = 0; j < numRows; j++)
+			{
+				for (long i = 0; i < numCols; i++)
+				{
+					row[i] = grid.getValue(i, j);
+				}
+				stats.Add(&row[0], numCols);
+			}
+		}
+
+		min = stats.GetMin();
+		max = stats.GetMax();
+	}
+};
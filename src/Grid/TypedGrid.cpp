@@ -1,12 +1,15 @@
 #include "stdafx.h"
+#include "TypedGrid.h"
+#include "dGrid.h"
 #include "fGrid.h"
+#include "lGrid.h"
+#include "sgrid.h"
 #include "EsriDll.h"
 #include "gioapi.h"
 #include "stc123.h"
 #include <math.h>
 #include <iomanip>
 
-extern ESRI_PUTWINDOWROWFLOAT_PROC putwindowrowfloat;
 extern ESRI_PUTWINDOWROW_PROC putwindowrow;
 extern ESRI_CELLLYRCLOSE_PROC celllyrclose;
 extern ESRI_GRIDCOPY_PROC gridcopy;
@@ -21,7 +24,78 @@ extern ESRI_CELLLYREXISTS_PROC celllyrexists;
 extern ESRI_GRIDDELETE_PROC griddelete;
 extern ESRI_CELLLAYERCREATE_PROC celllayercreate;
 
-fGrid::fGrid()
+// *******************************************************
+//		GridTraits
+// *******************************************************
+// What differs between the cell types: the data type stored in the header of binary grids
+// and the cells of ESRI grids, which are 32-bit floats for double and float grids
+// and 32-bit integers for long and short grids.
+template <typename T>
+struct GridTraits;
+
+struct EsriFloatCells
+{
+	typedef float EsriCell;
+
+	static int EsriCellType() { return CELLFLOAT; }
+
+	// the value of missing cells is provided by the ESRI library
+	static bool GetEsriMissing( double & missing )
+	{
+		if( getmissingfloat == NULL )
+			return false;
+
+		float value;
+		getmissingfloat( &value );
+		missing = value;
+		return true;
+	}
+};
+
+struct EsriIntCells
+{
+	typedef int EsriCell;
+
+	static int EsriCellType() { return CELLINT; }
+
+	static bool GetEsriMissing( double & missing )
+	{
+		missing = MISSINGINT;
+		return true;
+	}
+};
+
+template <>
+struct GridTraits<double> : EsriFloatCells
+{
+	static DATA_TYPE BinaryType() { return DOUBLE_TYPE; }
+	static double EsriNodata( double missing ) { return missing; }
+};
+
+template <>
+struct GridTraits<float> : EsriFloatCells
+{
+	static DATA_TYPE BinaryType() { return FLOAT_TYPE; }
+	static float EsriNodata( double missing ) { return (float)missing; }
+};
+
+template <>
+struct GridTraits<long> : EsriIntCells
+{
+	static DATA_TYPE BinaryType() { return LONG_TYPE; }
+	static long EsriNodata( double missing ) { return MISSINGINT; }
+};
+
+// missing cells are still written as MISSINGINT, but the nodata value must fit into a short
+template <>
+struct GridTraits<short> : EsriIntCells
+{
+	static DATA_TYPE BinaryType() { return SHORT_TYPE; }
+	static short EsriNodata( double missing ) { return MISSINGSHORT; }
+};
+
+template <typename T, typename THeader>
+TypedGrid<T, THeader>::TypedGrid()
 {	data = NULL;
 	isInRam = true;
 	findNewMax = false;
@@ -51,21 +125,24 @@ fGrid::fGrid()
 	lastErrorCode = tkNO_ERROR;
 }
 
-fGrid::~fGrid()
+template <typename T, typename THeader>
+TypedGrid<T, THeader>::~TypedGrid()
 {	
 	close();
 
 	shutdown_esri();
 }
 
-long fGrid::LastErrorCode()
+template <typename T, typename THeader>
+long TypedGrid<T, THeader>::LastErrorCode()
 {	long tmpec = lastErrorCode;
 	lastErrorCode = tkNO_ERROR;
 	return tmpec;
 }
 		
 //OPERATORS
-float fGrid::operator()( int Column, int Row )
+template <typename T, typename THeader>
+T TypedGrid<T, THeader>::operator()( int Column, int Row )
 {	
 	if( inGrid( Column, Row ) )
 	{
@@ -79,7 +156,8 @@ float fGrid::operator()( int Column, int Row )
 }
 
 //FUNCTIONS
-bool fGrid::open( const char * cfilename, bool InRam, GRID_TYPE GridType, void (*callback)( int number, const char * message ) )
+template <typename T, typename THeader>
+bool TypedGrid<T, THeader>::open( const char * cfilename, bool InRam, GRID_TYPE GridType, void (*callback)( int number, const char * message ) )
 {	
 	CString filename = cfilename;
 
@@ -110,7 +188,8 @@ bool fGrid::open( const char * cfilename, bool InRam, GRID_TYPE GridType, void (
 	}
 }
 
-bool fGrid::readDiskToMemory( void (*callback)(int number, const char * message ) )
+template <typename T, typename THeader>
+bool TypedGrid<T, THeader>::readDiskToMemory( void (*callback)(int number, const char * message ) )
 {	
 	if( gridType == ASCII_GRID )
 		return asciiReadDiskToMemory( callback );
@@ -124,7 +203,8 @@ bool fGrid::readDiskToMemory( void (*callback)(int number, const char * message
 	return false;	
 }
 
-bool fGrid::readDiskToDisk( void (*callback)(int number, const char * message ) )
+template <typename T, typename THeader>
+bool TypedGrid<T, THeader>::readDiskToDisk( void (*callback)(int number, const char * message ) )
 {
 	if( gridType == ASCII_GRID )
 		return asciiReadDiskToDisk( callback );
@@ -140,7 +220,8 @@ bool fGrid::readDiskToDisk( void (*callback)(int number, const char * message )
 	return false;
 }	
 
-bool fGrid::writeMemoryToDisk( void(*callback)(int number, const char * message ) )
+template <typename T, typename THeader>
+bool TypedGrid<T, THeader>::writeMemoryToDisk( void(*callback)(int number, const char * message ) )
 {
 	if( gridType == ASCII_GRID )
 		return asciiWriteMemoryToDisk( callback );
@@ -156,7 +237,8 @@ bool fGrid::writeMemoryToDisk( void(*callback)(int number, const char * message
 	return false;	
 }
 
-bool fGrid::writeDiskToDisk()
+template <typename T, typename THeader>
+bool TypedGrid<T, THeader>::writeDiskToDisk()
 {	
 	if( gridType == ASCII_GRID )
 		return asciiWriteDiskToDisk();
@@ -172,7 +254,8 @@ bool fGrid::writeDiskToDisk()
 	return false;	
 }
 
-bool fGrid::initialize( const char * cfilename, fHeader header, float initialValue, bool InRam, GRID_TYPE GridType )
+template <typename T, typename THeader>
+bool TypedGrid<T, THeader>::initialize( const char * cfilename, THeader header, T initialValue, bool InRam, GRID_TYPE GridType )
 {	
 	CString filename = cfilename;
 	close();
@@ -195,18 +278,11 @@ bool fGrid::initialize( const char * cfilename, fHeader header, float initialVal
 
 	if( isInRam == true )
 	{	
-		if (data != NULL)
-		{
-			delete [] data;
-			data = NULL;
-		}
-		data = new float*[ gridHeader.getNumberRows() ];
-		for( int y = 0; y < gridHeader.getNumberRows(); y++ )
-		{	data[y] = new float[gridHeader.getNumberCols()];
-			for( int x = 0; x < gridHeader.getNumberCols(); x++ )
-			{	data[y][x] = initialValue;
-			}
+		if( !alloc() )
+		{	lastErrorCode = tkFAILED_TO_ALLOCATE_MEMORY;
+			return false;
 		}
+		storage.Fill( initialValue );
 
 		min = initialValue;
 		max = initialValue;
@@ -234,7 +310,8 @@ bool fGrid::initialize( const char * cfilename, fHeader header, float initialVal
 }
 
 #pragma optimize("", off)
-bool fGrid::close()
+template <typename T, typename THeader>
+bool TypedGrid<T, THeader>::close()
 {	
 
 	if( isInRam == true )
@@ -295,7 +372,8 @@ bool fGrid::close()
 }
 #pragma optimize("", on)
 
-bool fGrid::save( const char * cfilename, GRID_TYPE GridType, void (*callback)(int number, const char * message ) )
+template <typename T, typename THeader>
+bool TypedGrid<T, THeader>::save( const char * cfilename, GRID_TYPE GridType, void (*callback)(int number, const char * message ) )
 {	
 	CString filename = cfilename;
 
@@ -373,7 +451,8 @@ bool fGrid::save( const char * cfilename, GRID_TYPE GridType, void (*callback)(i
 	return false;
 }
 
-inline float fGrid::getValue( int Column, int Row )
+template <typename T, typename THeader>
+T TypedGrid<T, THeader>::getValue( int Column, int Row )
 {
 	if( inGrid( Column, Row ) )
 	{
@@ -388,7 +467,8 @@ inline float fGrid::getValue( int Column, int Row )
 	}
 }
 
-inline float fGrid::getValueDisk( int Column, int Row )
+template <typename T, typename THeader>
+inline T TypedGrid<T, THeader>::getValueDisk( int Column, int Row )
 {	if( gridType == ASCII_GRID )
 		return gridHeader.getNodataValue();
 	else if( gridType == BINARY_GRID )
@@ -401,7 +481,8 @@ inline float fGrid::getValueDisk( int Column, int Row )
 	return gridHeader.getNodataValue();
 }
 
-inline void fGrid::setValue( int Column, int Row, float Value )
+template <typename T, typename THeader>
+void TypedGrid<T, THeader>::setValue( int Column, int Row, T Value )
 {		
 	if( inGrid( Column, Row ) )
 	{	
@@ -428,7 +509,8 @@ inline void fGrid::setValue( int Column, int Row, float Value )
 		lastErrorCode = tkINDEX_OUT_OF_BOUNDS;
 }
 
-inline void fGrid::setValueDisk( int Column, int Row, float Value )
+template <typename T, typename THeader>
+inline void TypedGrid<T, THeader>::setValueDisk( int Column, int Row, T Value )
 {	if( gridType == ASCII_GRID )
 		return;
 	else if( gridType == BINARY_GRID )
@@ -439,11 +521,10 @@ inline void fGrid::setValueDisk( int Column, int Row, float Value )
 		return;	
 }
 
-void fGrid::dealloc()
+template <typename T, typename THeader>
+void TypedGrid<T, THeader>::dealloc()
 {	if( isInRam && data != NULL )
-	{	for( int y = 0; y < gridHeader.getNumberRows(); y++ )
-			delete [] data[y];		
-		delete [] data;				
+	{	storage.Free();
 		data = NULL;
 	}
 	gridHeader.setNumberRows( 0 );
@@ -452,29 +533,28 @@ void fGrid::dealloc()
 	max = gridHeader.getNodataValue();
 }
 
-void fGrid::alloc()
+template <typename T, typename THeader>
+bool TypedGrid<T, THeader>::alloc()
 {	if( isInRam )
 	{
 		if( gridHeader.getNumberCols() > 0 && gridHeader.getNumberRows() > 0 )
 		{
-			if (data != NULL)
-			{
-				delete [] data;
-				data = NULL;
-			}
-			data = new float *[gridHeader.getNumberRows()];
-			for( int y = 0; y < gridHeader.getNumberRows(); y++ )
-				data[y] = new float[gridHeader.getNumberCols()];		
-		}		
+			// one block for all the values, data points to its rows
+			data = storage.Allocate( gridHeader.getNumberRows(), gridHeader.getNumberCols() );
+			return data != NULL;
+		}
 	}
+	return true;
 }
 
 //DATA MEMBER ACCESS
-inline fHeader fGrid::getHeader()
+template <typename T, typename THeader>
+THeader TypedGrid<T, THeader>::getHeader()
 {	return gridHeader;
 }
 
-void fGrid::setHeader( fHeader h )
+template <typename T, typename THeader>
+void TypedGrid<T, THeader>::setHeader( THeader h )
 {	
 	//Don't allow the Rows and Columns to Change
 	gridHeader.setDx( h.getDx() );
@@ -487,7 +567,8 @@ void fGrid::setHeader( fHeader h )
 }
 
 //MAPPING FUNCTIONS
-void fGrid::ProjToCell( double x, double y, long & column, long & row )
+template <typename T, typename THeader>
+void TypedGrid<T, THeader>::ProjToCell( double x, double y, long & column, long & row )
 {	if( gridHeader.getDx() != 0.0 && gridHeader.getDy() != 0.0 )
 	{
 		column = round( ( x - gridHeader.getXllcenter() )/gridHeader.getDx() );
@@ -495,35 +576,33 @@ void fGrid::ProjToCell( double x, double y, long & column, long & row )
 	}
 }
 
-void fGrid::CellToProj( long column, long row, double & x, double & y )
+template <typename T, typename THeader>
+void TypedGrid<T, THeader>::CellToProj( long column, long row, double & x, double & y )
 {	x = gridHeader.getXllcenter() + column*gridHeader.getDx();
 	y = gridHeader.getYllcenter() + ( ( gridHeader.getNumberRows() - row - 1)*gridHeader.getDy() );
 }
 
-inline int fGrid::round( double d )
+template <typename T, typename THeader>
+inline int TypedGrid<T, THeader>::round( double d )
 {	if( ceil(d) - d <= .5 )
 		return (int)ceil(d);
 	else
 		return (int)floor(d);
 }
 
-void fGrid::clear(float clearValue)
+template <typename T, typename THeader>
+void TypedGrid<T, THeader>::clear(T clearValue)
 {
 	if( isInRam )
-	{
-		int ncols = gridHeader.getNumberCols();
-		int nrows= gridHeader.getNumberRows();
-		for( int j = 0; j < nrows; j++ )
-		{	for( int i = 0; i < ncols; i++ )
-				data[j][i] = clearValue;					
-		}
+	{	storage.Fill( clearValue );
 	}
 	else
 	{	clearDisk(clearValue);
 	}
 }
 
-void fGrid::clearDisk(float clearValue)
+template <typename T, typename THeader>
+void TypedGrid<T, THeader>::clearDisk(T clearValue)
 {	if( gridType == ASCII_GRID )
 		return;
 	else if( gridType == BINARY_GRID )
@@ -536,7 +615,8 @@ void fGrid::clearDisk(float clearValue)
 	*/
 }
 
-inline bool fGrid::inGrid( long column, long row )
+template <typename T, typename THeader>
+inline bool TypedGrid<T, THeader>::inGrid( long column, long row )
 {
 	if( column < 0 || column >= gridHeader.getNumberCols() )
 		return false;
@@ -546,113 +626,50 @@ inline bool fGrid::inGrid( long column, long row )
 	return true;
 }
 
-float fGrid::maximum()
+template <typename T, typename THeader>
+T TypedGrid<T, THeader>::maximum()
 {	//Darrel Brown 10/10/2003
 	// I changed this code so that the min/max are both calculated
 	// at the same time, the first time anyone requests either.
 	// This is a result of me changing the open code for disk-
 	// based grids.
-	/*if( findNewMax )
-	{	float nodata_value = gridHeader.getNodataValue();
-		max = nodata_value;
-		
-		for( int j = 0; j < gridHeader.getNumberRows(); j++ )
-		{
-			for( int i = 0; i < gridHeader.getNumberCols(); i++ )
-			{	float val = getValue( i, j );
-				if( max == nodata_value )
-					max = val;
-				else if( val > max && val != nodata_value )
-					max = val;
-			}
-		}
-		findNewMax = false;
-	}*/
 	if( findNewMin || findNewMax )
-	{	float nodata_value = gridHeader.getNodataValue();
-		min = nodata_value;
-		max = nodata_value;
-
-		for( int j = 0; j < gridHeader.getNumberRows(); j++ )
-		{
-			for( int i = 0; i < gridHeader.getNumberCols(); i++ )
-			{	float val = getValue( i, j );
-				// find both min and max at the same time	
-				if( min == nodata_value )
-					min = val;
-				else if( val < min && val != nodata_value )
-					min = val;
-
-				if( max == nodata_value )
-					max = val;
-				else if( val > max && val != nodata_value )
-					max = val;
-			}
-		}
-		findNewMax = false;
-		findNewMin = false;
-	}
+		findMinMax();
 	return max;
 }
 
-float fGrid::minimum()
-{	//Darrel Brown 10/10/2003
-	// I changed this code so that the min/max are both calculated
-	// at the same time, the first time anyone requests either.
-	// This is a result of me changing the open code for disk-
-	// based grids.
-	/*if( findNewMin )
-	{	float nodata_value = gridHeader.getNodataValue();
-		min = nodata_value;
+template <typename T, typename THeader>
+T TypedGrid<T, THeader>::minimum()
+{	if( findNewMin || findNewMax )
+		findMinMax();
+	return min;
+}
 
-		for( int j = 0; j < gridHeader.getNumberRows(); j++ )
-		{
-			for( int i = 0; i < gridHeader.getNumberCols(); i++ )
-			{	float val = getValue( i, j );
-				if( min == nodata_value )
-					min = val;
-				else if( val < min && val != nodata_value )
-					min = val;
-			}
-		}
-		findNewMin = false;
-	}*/
-	if( findNewMin || findNewMax )
-	{	float nodata_value = gridHeader.getNodataValue();
-		min = nodata_value;
-		max = nodata_value;
+template <typename T, typename THeader>
+void TypedGrid<T, THeader>::findMinMax()
+{	T nodata_value = gridHeader.getNodataValue();
 
-		for( int j = 0; j < gridHeader.getNumberRows(); j++ )
-		{
-			for( int i = 0; i < gridHeader.getNumberCols(); i++ )
-			{	float val = getValue( i, j );
-				// find both min and max at the same time	
-				if( min == nodata_value )
-					min = val;
-				else if( val < min && val != nodata_value )
-					min = val;
-
-				if( max == nodata_value )
-					max = val;
-				else if( val > max && val != nodata_value )
-					max = val;
-			}
-		}
-		findNewMax = false;
-		findNewMin = false;
-	}
-	return min;
+	if( isInRam )
+		storage.GetMinMax( nodata_value, min, max );
+	else
+		GridCore<T>::GetMinMaxFrom( *this, gridHeader.getNumberRows(), gridHeader.getNumberCols(), nodata_value, min, max );
+
+	findNewMax = false;
+	findNewMin = false;
 }
 
-bool fGrid::inRam()
+template <typename T, typename THeader>
+bool TypedGrid<T, THeader>::inRam()
 {	return isInRam;
 }
 
-float ** fGrid::getArrayPtr()
+template <typename T, typename THeader>
+T ** TypedGrid<T, THeader>::getArrayPtr()
 {	return data;
 }
 
-GRID_TYPE fGrid::getGridType( const char * filename )
+template <typename T, typename THeader>
+GRID_TYPE TypedGrid<T, THeader>::getGridType( const char * filename )
 {	
 	GRID_TYPE grid_type = INVALID_GRID_TYPE;
 
@@ -760,7 +777,8 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 ///\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/
 ///\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/
 
-	bool fGrid::asciiReadDiskToMemory( void (*callback)(int number, const char * message ) )
+	template <typename T, typename THeader>
+	bool TypedGrid<T, THeader>::asciiReadDiskToMemory( void (*callback)(int number, const char * message ) )
 	{	
 		ifstream in(gridFilename);
 
@@ -772,9 +790,7 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 		{	asciiReadHeader( in );
 		
 			int percent = 0;
-			long num_read = 0;
-			double total = gridHeader.getNumberRows()*gridHeader.getNumberCols();
-			float nodata = gridHeader.getNodataValue();
+			T nodata = gridHeader.getNodataValue();
 
 			min = nodata;
 			max = nodata;
@@ -788,53 +804,49 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 			{	if( callback != NULL )
 					callback( 0, "Allocating and Initializing Memory" );
 
-				alloc();
+				if( !alloc() )
+				{	lastErrorCode = tkFAILED_TO_ALLOCATE_MEMORY;
+					return false;
+				}
 			}
 						
 			for( int j = 0; j < gridHeader.getNumberRows(); j++ )
-			{	for( int i = 0; i < gridHeader.getNumberCols(); i++ )
-				{	num_read++;
-					if( !in )
+			{	T * row = data[j];
+				for( int i = 0; i < gridHeader.getNumberCols(); i++ )
+				{	if( !in )
 					{	dealloc();
 						return false;						
 					}
 
-					in>>data[j][i];				
-					if( min == nodata )
-					{	min = data[j][i];
-						max = data[j][i];
-					}
-					else
-					{	if( data[j][i] != nodata )
-						{
-							if( data[j][i] < min )
-								min = data[j][i];
-							else if( data[j][i] > max )
-								max = data[j][i];
-						}
-					}
-					
-					if( callback != NULL )
-					{	int newpercent = (int)(((num_read)/total)*100);
-						if( newpercent > percent )
-						{	percent = newpercent;
-							callback( percent, "Reading Ascii Grid" );											
-						}
-					}					
+					in>>row[i];
 				}
+				
+				if( callback != NULL )
+				{	int newpercent = (int)(((j + 1)*100.0)/gridHeader.getNumberRows());
+					if( newpercent > percent )
+					{	percent = newpercent;
+						callback( percent, "Reading Ascii Grid" );											
+					}
+				}				
 			}
+
+			// min and max are found in a single pass once the values are read
+			storage.GetMinMax( nodata, min, max );
+
 			asciiReadFooter( in );
 			in.close();
 			return true;
-		}
+		}		
 	}
 
-	bool fGrid::asciiReadDiskToDisk( void(*callback)(int number, const char * message ) )
+	template <typename T, typename THeader>
+	bool TypedGrid<T, THeader>::asciiReadDiskToDisk( void(*callback)(int number, const char * message ) )
 	{	isInRam = true;
 		return asciiReadDiskToMemory( callback );		
 	}
 
-	bool fGrid::asciiWriteMemoryToDisk( void(*callback)(int number, const char * message ) )
+	template <typename T, typename THeader>
+	bool TypedGrid<T, THeader>::asciiWriteMemoryToDisk( void(*callback)(int number, const char * message ) )
 	{
 		ofstream out( gridFilename );
 
@@ -872,11 +884,13 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 		}		
 	}
 
-	bool fGrid::asciiWriteDiskToDisk()
+	template <typename T, typename THeader>
+	bool TypedGrid<T, THeader>::asciiWriteDiskToDisk()
 	{	return false;
 	}
 
-	void fGrid::asciiReadHeader( istream & in )
+	template <typename T, typename THeader>
+	void TypedGrid<T, THeader>::asciiReadHeader( istream & in )
 	{
 		char * header_value = new char[MAX_STRING_LENGTH];
 		in>>header_value;
@@ -902,7 +916,8 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 		delete [] header_value;
 	}
 
-	void fGrid::asciiReadFooter( istream & in )
+	template <typename T, typename THeader>
+	void TypedGrid<T, THeader>::asciiReadFooter( istream & in )
 	{	char * header_value = new char[MAX_STRING_LENGTH];
 		in>>header_value;
 		while( in )
@@ -913,7 +928,8 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 		delete [] header_value;
 	}
 
-	void fGrid::asciiWriteHeader( ostream & out )
+	template <typename T, typename THeader>
+	void TypedGrid<T, THeader>::asciiWriteHeader( ostream & out )
 	{
 		
 		out<<"NCOLS "<<gridHeader.getNumberCols()<<endl;
@@ -935,14 +951,16 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 		
 	}
 
-	void fGrid::asciiWriteFooter( ostream & out )
+	template <typename T, typename THeader>
+	void TypedGrid<T, THeader>::asciiWriteFooter( ostream & out )
 	{	if( gridHeader.getProjection() != NULL )
 			out<<"PROJECTION "<<gridHeader.getProjection()<<endl;
 		if( gridHeader.getNotes() != NULL )
 			out<<"NOTES "<<gridHeader.getNotes()<<endl;
 	}
 
-	bool fGrid::asciiIsHeaderValue( CString headerValue, istream & in )
+	template <typename T, typename THeader>
+	bool TypedGrid<T, THeader>::asciiIsHeaderValue( CString headerValue, istream & in )
 	{
 		if( headerValue.GetLength() <= 0 )
 			return false;
@@ -1011,7 +1029,7 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 			return true;
 		}
 		else if( headerValue.CompareNoCase( "NODATA_VALUE" ) == 0 )
-		{	float nodata_value;
+		{	T nodata_value;
 			in>>nodata_value;
 			gridHeader.setNodataValue( nodata_value );
 			return true;
@@ -1055,7 +1073,8 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 		return false;
 	}
 
-	bool fGrid::asciiSaveAs( CString filename, void(*callback)(int number, const char * message) )
+	template <typename T, typename THeader>
+	bool TypedGrid<T, THeader>::asciiSaveAs( CString filename, void(*callback)(int number, const char * message) )
 	{
 		ofstream out( filename );
 
@@ -1111,7 +1130,8 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 ///\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/
 ///\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/
 
-	bool fGrid::binaryReadDiskToMemory( void (*callback)(int number, const char * message ) )
+	template <typename T, typename THeader>
+	bool TypedGrid<T, THeader>::binaryReadDiskToMemory( void (*callback)(int number, const char * message ) )
 	{	FILE * in = fopen( gridFilename, "rb" );
 		
 		if( !in )
@@ -1120,69 +1140,43 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 		}
 		else
 		{	binaryReadHeader( in );
-			double total = gridHeader.getNumberRows()* gridHeader.getNumberCols();
-			float nodata = gridHeader.getNodataValue();
+			T nodata = gridHeader.getNodataValue();
 			min = nodata;
 			max = nodata;
 
 			if( gridHeader.getNumberCols() < 0 || gridHeader.getNumberRows() < 0 || 
 				gridHeader.getDx() < 0 || gridHeader.getDy() < 0 ||
-				data_type != FLOAT_TYPE )
+				data_type != GridTraits<T>::BinaryType() )
 				{	dealloc();
 					fclose( in );
 					lastErrorCode = tkINCOMPATIBLE_DATA_TYPE;
 					return false;
 				}
 			
-			alloc();
+			if( !alloc() )
+			{	dealloc();
+				fclose( in );
+				lastErrorCode = tkFAILED_TO_ALLOCATE_MEMORY;
+				return false;
+			}
 
-			int percent = 0;
-			long num_read = 0;
-						
-			for( int j = 0; j < gridHeader.getNumberRows(); j++ )
-			{	for( int i = 0; i < gridHeader.getNumberCols(); i++ )
-				{	num_read++;
-					if( feof(in) )
-					{	dealloc();
-						fclose( in );
-						return false;
-					}
+			// the values are read a row at a time
+			if( !storage.ReadBinary( in, callback, "Reading Binary Grid" ) )
+			{	dealloc();
+				fclose( in );
+				lastErrorCode = tkINVALID_FILE;
+				return false;
+			}
+
+			storage.GetMinMax( nodata, min, max );
 
-					fread( &data[j][i],sizeof(float),1,in );
-								
-					if( min == nodata )
-					{	min = data[j][i];
-						max = data[j][i];
-					}
-					else
-					{	if( data[j][i] != nodata )
-						{
-							if( data[j][i] < min )
-								min = data[j][i];
-							else if( data[j][i] > max )
-								max = data[j][i];
-						}
-					}
-					
-					if( callback != NULL )
-					{
-						int newpercent = (int)(((num_read)/total)*100);
-						if( newpercent > percent )
-						{	percent = newpercent;
-							callback( percent, "Reading Binary Grid" );
-						}
-					}
-							
-				}
-			}	
-			
 			fclose(in);
 			return true;			
 		}
-				
 	}
 
-	bool fGrid::binaryReadDiskToDisk()
+	template <typename T, typename THeader>
+	bool TypedGrid<T, THeader>::binaryReadDiskToDisk()
 	{	
 		file_in_out = fopen( gridFilename, "r+b" );
 		
@@ -1196,7 +1190,7 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 			
 			if( gridHeader.getNumberCols() < 0 || gridHeader.getNumberRows() < 0 || 
 				gridHeader.getDx() < 0 || gridHeader.getDy() < 0 ||
-				data_type != FLOAT_TYPE )
+				data_type != GridTraits<T>::BinaryType() )
 				{	dealloc();
 					fclose( file_in_out );
 					file_in_out = NULL;
@@ -1211,8 +1205,8 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 			// based binary grids.  Now the min/max are calculated when first
 			// requested, not at load time.
 			//
-			/*float value;
-			float nodata = gridHeader.getNodataValue();
+			/*T value;
+			T nodata = gridHeader.getNodataValue();
 			min = nodata;
 			max = nodata;
 
@@ -1228,7 +1222,7 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 					}
 							
 
-					fread( &value,sizeof(float),1,file_in_out );
+					fread( &value,sizeof(T),1,file_in_out );
 
 					if( min == nodata )
 					{	min = value;
@@ -1253,9 +1247,9 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 
 			if( gridHeader.getNumberCols() > 0 )
 			{	
-				row_one = new float[gridHeader.getNumberCols()];
-				row_two = new float[gridHeader.getNumberCols()];
-				row_three = new float[gridHeader.getNumberCols()];
+				row_one = new T[gridHeader.getNumberCols()];
+				row_two = new T[gridHeader.getNumberCols()];
+				row_three = new T[gridHeader.getNumberCols()];
 					
 				binaryBufferRows( 1 );				
 			}				
@@ -1263,7 +1257,8 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 		}		
 	}
 
-	bool fGrid::binaryWriteMemoryToDisk( void(*callback)(int number, const char * message ) )
+	template <typename T, typename THeader>
+	bool TypedGrid<T, THeader>::binaryWriteMemoryToDisk( void(*callback)(int number, const char * message ) )
 	{	
 		FILE * out = fopen( gridFilename, "wb" );
 		
@@ -1274,32 +1269,14 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 		else
 		{	
 			binaryWriteHeader(out);
-			double total = gridHeader.getNumberRows() * gridHeader.getNumberCols();
-			int percent = 0;
-			long num_written = 0;
-
-			for( int j = 0; j < gridHeader.getNumberRows(); j++ )
-			{	for( int i = 0; i < gridHeader.getNumberCols(); i++ )
-				{	num_written++;
-					
-					fwrite( &data[j][i],sizeof(float),1,out);
-
-					if( callback != NULL )
-					{
-						int newpercent = (int)((num_written/total)*100);
-						if( newpercent > percent )
-						{	percent = newpercent;
-							callback( percent, "Binary Grid Write");
-						}											
-					}
-				}				
-			}
+			bool result = storage.WriteBinary( out, callback, "Binary Grid Write" );
 			fclose( out );
-			return true;			
+			return result;			
 		}		
 	}
 
-	bool fGrid::binaryWriteDiskToDisk()
+	template <typename T, typename THeader>
+	bool TypedGrid<T, THeader>::binaryWriteDiskToDisk()
 	{
 		if( !file_in_out )
 			return false;
@@ -1311,7 +1288,8 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 	
 	}
 
-	bool fGrid::binaryInitializeDisk( float initialValue )
+	template <typename T, typename THeader>
+	bool TypedGrid<T, THeader>::binaryInitializeDisk( T initialValue )
 	{			
 		file_in_out = fopen( gridFilename, "w+b" );
 
@@ -1324,20 +1302,15 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 			binaryWriteHeader(file_in_out);
 			file_position_beg_of_data = ftell( file_in_out);
 			
-			for( int j = gridHeader.getNumberRows() - 1; j >= 0; j-- )
-			{	for( int i = 0; i < gridHeader.getNumberCols(); i++ )
-				{	
-					fwrite( &initialValue,sizeof(float),1,file_in_out);																						
-				}				
-			}
+			GridCore<T>::FillBinary( file_in_out, initialValue, gridHeader.getNumberRows(), gridHeader.getNumberCols() );
 			
 			min = initialValue;
 			max = initialValue;
 			
 			current_row = 0;
-			row_one = new float[gridHeader.getNumberCols()];
-			row_two = new float[gridHeader.getNumberCols()];
-			row_three = new float[gridHeader.getNumberCols()];
+			row_one = new T[gridHeader.getNumberCols()];
+			row_two = new T[gridHeader.getNumberCols()];
+			row_three = new T[gridHeader.getNumberCols()];
 
 			for( int i = 0; i < gridHeader.getNumberCols(); i++ )
 			{	row_one[i] = initialValue;
@@ -1348,7 +1321,8 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 		return true;		
 	}
 
-	void fGrid::binaryReadHeader( FILE * in )
+	template <typename T, typename THeader>
+	void TypedGrid<T, THeader>::binaryReadHeader( FILE * in )
 	{	
 		rewind(in);
 		long ncols;
@@ -1377,8 +1351,8 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 
 		fread( &data_type, sizeof(DATA_TYPE),1,in);
 		
-		float nodata_value;
-		fread( &nodata_value, sizeof(float),1,in);		
+		T nodata_value;
+		fread( &nodata_value, sizeof(T),1,in);		
 		gridHeader.setNodataValue( nodata_value );
 
 		char * projection = new char[MAX_STRING_LENGTH + 1];
@@ -1392,7 +1366,8 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 		delete [] notes;
 	}
 
-	void fGrid::binaryWriteHeader( FILE * out )
+	template <typename T, typename THeader>
+	void TypedGrid<T, THeader>::binaryWriteHeader( FILE * out )
 	{
 		rewind(out);
 		long ncols = gridHeader.getNumberCols();
@@ -1407,10 +1382,10 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 		fwrite( &xllcenter, sizeof(double),1,out);
 		double yllcenter = gridHeader.getYllcenter();
 		fwrite( &yllcenter, sizeof(double),1,out);
-		DATA_TYPE type = FLOAT_TYPE;
+		DATA_TYPE type = GridTraits<T>::BinaryType();
 		fwrite( &type, sizeof(DATA_TYPE),1,out);
-		float nodata = gridHeader.getNodataValue();
-		fwrite( &nodata, sizeof(float),1,out);
+		T nodata = gridHeader.getNodataValue();
+		fwrite( &nodata, sizeof(T),1,out);
 		
 		char * projection = new char[MAX_STRING_LENGTH + 1];
 		strcpy( projection, gridHeader.getProjection() );
@@ -1441,7 +1416,8 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 		delete [] notes;
 	}
 
-	float fGrid::binaryGetValueDisk( int Column, int Row )
+	template <typename T, typename THeader>
+	T TypedGrid<T, THeader>::binaryGetValueDisk( int Column, int Row )
 	{
 		if( Row == current_row - 1 )
 			return row_one[ Column ];
@@ -1455,15 +1431,16 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 		}	
 	}
 
-	void fGrid::binarySetValueDisk( int Column, int Row, float Value )
+	template <typename T, typename THeader>
+	void TypedGrid<T, THeader>::binarySetValueDisk( int Column, int Row, T Value )
 	{
-		long file_position = file_position_beg_of_data + sizeof(float)*Row*gridHeader.getNumberCols() + sizeof(float)*Column;
+		long file_position = file_position_beg_of_data + sizeof(T)*Row*gridHeader.getNumberCols() + sizeof(T)*Column;
 		
 		if( fseek( file_in_out, file_position, SEEK_SET ) == -1L )
 		{}
 		else
 		{	
-			if( fwrite( &Value, sizeof(float), 1, file_in_out ) < 1 )
+			if( fwrite( &Value, sizeof(T), 1, file_in_out ) < 1 )
 			{}								
 			else
 			{	if( Row == current_row - 1 )
@@ -1476,32 +1453,27 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 		}		
 	}
 	
-	void fGrid::binaryClearDisk(float clearValue)
+	template <typename T, typename THeader>
+	void TypedGrid<T, THeader>::binaryClearDisk(T clearValue)
 	{
 		if( fseek( file_in_out, file_position_beg_of_data, SEEK_SET ) == -1L )
 			return;
 		else
-		{	
-			for( int j = 0; j < gridHeader.getNumberRows(); j++ )
-			{	for( int i = 0; i < gridHeader.getNumberCols(); i++ )
-				{	if( fwrite( &clearValue, sizeof(float), 1, file_in_out ) < 1 )
-						return;
-				}
-			}					
-		}		
+			GridCore<T>::FillBinary( file_in_out, clearValue, gridHeader.getNumberRows(), gridHeader.getNumberCols() );
 	}
 
-	void fGrid::binaryBufferRows( int center_row )
+	template <typename T, typename THeader>
+	void TypedGrid<T, THeader>::binaryBufferRows( int center_row )
 	{
 		bool nd_fill_one = false;
 		bool nd_fill_two = false;
 		bool nd_fill_three = false;
 
 		if( gridHeader.getNumberRows() >= center_row - 1 && center_row - 1 >= 0 )
-		{	long file_position = file_position_beg_of_data + sizeof(float)*(center_row-1)*gridHeader.getNumberCols();
+		{	long file_position = file_position_beg_of_data + sizeof(T)*(center_row-1)*gridHeader.getNumberCols();
 
 			if( fseek( file_in_out, file_position, SEEK_SET ) != -1L )
-				fread( row_one, sizeof(float), gridHeader.getNumberCols(), file_in_out );
+				fread( row_one, sizeof(T), gridHeader.getNumberCols(), file_in_out );
 			else
 				nd_fill_one = true;
 		}
@@ -1509,10 +1481,10 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 			nd_fill_one = true;
 				
 		if( gridHeader.getNumberRows() >= center_row && center_row >= 0 )
-		{	long file_position = file_position_beg_of_data + sizeof(float)*(center_row)*gridHeader.getNumberCols();
+		{	long file_position = file_position_beg_of_data + sizeof(T)*(center_row)*gridHeader.getNumberCols();
 
 			if( fseek( file_in_out, file_position, SEEK_SET ) != -1L )
-				fread( row_two, sizeof(float), gridHeader.getNumberCols(), file_in_out );
+				fread( row_two, sizeof(T), gridHeader.getNumberCols(), file_in_out );
 			else
 				nd_fill_two = true;
 		}
@@ -1520,10 +1492,10 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 			nd_fill_two = true;
 
 		if( gridHeader.getNumberRows() >= center_row + 1 && center_row + 1 >= 0 )
-		{	long file_position = file_position_beg_of_data + sizeof(float)*(center_row+1)*gridHeader.getNumberCols();
+		{	long file_position = file_position_beg_of_data + sizeof(T)*(center_row+1)*gridHeader.getNumberCols();
 
 			if( fseek( file_in_out, file_position, SEEK_SET ) != -1L )
-				fread( row_three, sizeof(float), gridHeader.getNumberCols(), file_in_out );
+				fread( row_three, sizeof(T), gridHeader.getNumberCols(), file_in_out );
 			else
 				nd_fill_three = true;
 		}
@@ -1547,7 +1519,8 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 	}
 
 
-	bool fGrid::binarySaveAs( CString filename, void(*callback)(int number, const char * message) )
+	template <typename T, typename THeader>
+	bool TypedGrid<T, THeader>::binarySaveAs( CString filename, void(*callback)(int number, const char * message) )
 	{	
 		// Write to a temporary file first.
 		char tempName[ FILENAME_MAX ] = {0};
@@ -1559,27 +1532,12 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 
 		binaryWriteHeader(out);
 
-		double total = gridHeader.getNumberRows() * gridHeader.getNumberCols();
-		int percent = 0;
-		long num_written = 0;
-		float value;
-
-		for( int j = 0; j < gridHeader.getNumberRows(); j++ )
-		{	for( int i = 0; i < gridHeader.getNumberCols(); i++ )
-			{	num_written++;
-				value = getValue( i, j );
-				fwrite( &value,sizeof(float),1,out);
+		// grids in memory are written directly from the buffer, the disk-based ones a row at a time
+		if( isInRam )
+			storage.WriteBinary( out, callback, "Binary Grid Write" );
+		else
+			GridCore<T>::WriteBinaryFrom( out, *this, gridHeader.getNumberRows(), gridHeader.getNumberCols(), callback, "Binary Grid Write" );
 
-				if( callback != NULL )
-				{
-					int newpercent = (int)((num_written/total)*100);
-					if( newpercent > percent )
-					{	percent = newpercent;
-						callback( percent, "Binary Grid Write");
-					}											
-				}
-			}				
-		}
 		fclose( out );
 
 		if( isInRam == true )
@@ -1617,8 +1575,11 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 
 	//ESRI GRID FUNCTIONS
 	#pragma optimize("", off)
-	bool fGrid::esriReadDiskToMemory( void (*callback)(int number, const char * message ) )
+	template <typename T, typename THeader>
+	bool TypedGrid<T, THeader>::esriReadDiskToMemory( void (*callback)(int number, const char * message ) )
 	{	
+		typedef typename GridTraits<T>::EsriCell EsriCell;
+
 		if( celllayeropen == NULL ||
 			celllyrclose == NULL ||
 			bndcellread == NULL ||
@@ -1626,7 +1587,7 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 			privatewindowcols == NULL ||
 			privatewindowrows == NULL ||
 			getwindowrow == NULL ||
-			getmissingfloat == NULL )
+			!GridTraits<T>::GetEsriMissing( esri_null ) )
 			{	grid_layer = -1;
 				lastErrorCode = tkESRI_DLL_NOT_INITIALIZED;
 				return false;
@@ -1635,7 +1596,7 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 		double csize;	
 		double bndbox[4];
 		double adjbndbox[4];
-		float nodata = -1;
+		T nodata = -1;
 		int cell_type;
 		
 		char * fname = new char[_MAX_PATH+1];		
@@ -1657,11 +1618,7 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 			}		
 			
 			//Need to find cell_type
-			if( cell_type == CELLFLOAT )
-			{	getmissingfloat(&float_null);	
-				nodata = float_null;
-			}
-			if( cell_type == CELLINT )
+			if( cell_type != GridTraits<T>::EsriCellType() )
 			{	dealloc();
 				//Close handle
 				celllyrclose(grid_layer);
@@ -1669,6 +1626,7 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 				lastErrorCode = tkINVALID_GRID_FILE_TYPE;
 				return false;				
 			}
+			nodata = GridTraits<T>::EsriNodata( esri_null );
 
 			gridHeader.setXllcenter( bndbox[0] + .5*csize );
 			gridHeader.setYllcenter( bndbox[1] + .5*csize );
@@ -1700,7 +1658,13 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 			}
 
 			//Create space for the data
-			alloc();
+			if( !alloc() )
+			{	//Close handle
+				celllyrclose(grid_layer);
+				grid_layer = -1;
+				lastErrorCode = tkFAILED_TO_ALLOCATE_MEMORY;
+				return false;
+			}
 
 			//Now copy row major into array
 			//Allocate row buffer				
@@ -1717,32 +1681,18 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 			int percent = 0;
 			double total = gridHeader.getNumberRows();
 			
-			//Find the min and max
-			float nodata = gridHeader.getNodataValue();
-			min = nodata;
-			max = nodata;
+			T nodata = gridHeader.getNodataValue();
 			for ( int j = 0; j < gridHeader.getNumberRows(); j++)
 			{	
 				getwindowrow(grid_layer, j, (CELLTYPE*)row_buf1);
 
-				register float *buf = (float *)row_buf1;
+				register EsriCell *buf = (EsriCell *)row_buf1;
 				for( int i = 0; i < gridHeader.getNumberCols(); i++)
 				{	
-					if( buf[i] == float_null )
+					if( buf[i] == esri_null )
 						data[j][i] = nodata;
 					else
-					{	data[j][i] = buf[i];
-						
-						if( min == nodata )
-							min = buf[i];
-						else if( buf[i] < min )
-							min = buf[i];
-
-						if( max == nodata )
-							max = buf[i];
-						else if( buf[i] > max )
-							max = buf[i];							
-					}
+						data[j][i] = buf[i];
 				}             
 							 
 
@@ -1755,6 +1705,9 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 
 			}
 
+			// min and max are found in a single pass once the values are read
+			storage.GetMinMax( nodata, min, max );
+
 			//Free row buffer
 			CFree1((char *)row_buf1);
 			row_buf1 = NULL;
@@ -1774,7 +1727,8 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 	#pragma optimize("", on)
 
 	#pragma optimize("", off)
-	bool fGrid::esriReadDiskToDisk()
+	template <typename T, typename THeader>
+	bool TypedGrid<T, THeader>::esriReadDiskToDisk()
 	{	
 		//Check for the needed functions
 		if( bndcellread == NULL ||
@@ -1784,7 +1738,7 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 			privatewindowcols == NULL ||
 			privatewindowrows == NULL ||
 			getwindowrow == NULL ||
-			getmissingfloat == NULL )
+			!GridTraits<T>::GetEsriMissing( esri_null ) )
 			{	grid_layer = -1;
 				lastErrorCode = tkESRI_DLL_NOT_INITIALIZED;
 				return false;
@@ -1793,7 +1747,7 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 		double csize;	
 		double bndbox[4];
 		double adjbndbox[4];
-		float nodata = -1;
+		T nodata = -1;
 		int cell_type;
 
 		char * fname = new char[_MAX_PATH+1];		
@@ -1817,11 +1771,7 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 			}
 			
 			//Needed to find type
-			if( cell_type == CELLFLOAT )
-			{	getmissingfloat(&float_null);
-				nodata = float_null;
-			}
-			if( cell_type == CELLINT )
+			if( cell_type != GridTraits<T>::EsriCellType() )
 			{	dealloc();
 				//Close handle
 				celllyrclose(grid_layer);
@@ -1830,6 +1780,7 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 				delete [] fname;
 				return false;				
 			}
+			nodata = GridTraits<T>::EsriNodata( esri_null );
 
 			gridHeader.setXllcenter( bndbox[0] + .5*csize );
 			gridHeader.setYllcenter( bndbox[1] + .5*csize );
@@ -1877,7 +1828,7 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 			}
 			
 			//Find the min and max
-			float nodata = gridHeader.getNodataValue();
+			T nodata = gridHeader.getNodataValue();
 			min = nodata;
 			max = nodata;
 			findNewMin = true;
@@ -1887,10 +1838,10 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 			{	
 				getwindowrow(grid_layer, j, (CELLTYPE*)row_buf1);
 
-				register float *buf = (float *)row_buf1;
+				register EsriCell *buf = (EsriCell *)row_buf1;
 				for( int i = 0; i < gridHeader.getNumberCols(); i++)
 				{	
-					if( buf[i] != float_null )
+					if( buf[i] != esri_null )
 					{	if( min == nodata )
 							min = buf[i];
 						else if( buf[i] < min )
@@ -1919,22 +1870,25 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 	#pragma optimize("", on)
 
 	#pragma optimize("", off)
-	bool fGrid::esriWriteMemoryToDisk( void(*callback)(int number, const char * message ) )
+	template <typename T, typename THeader>
+	bool TypedGrid<T, THeader>::esriWriteMemoryToDisk( void(*callback)(int number, const char * message ) )
 	{
+		typedef typename GridTraits<T>::EsriCell EsriCell;
+
 		//Check the needed functions
 		if( celllyrclose == NULL ||
 			celllyrexists == NULL ||
 			celllayercreate == NULL ||
 			griddelete == NULL ||			
 			privateaccesswindowset == NULL ||
-			getmissingfloat == NULL ||
-			putwindowrow == NULL )
+			putwindowrow == NULL ||
+			!GridTraits<T>::GetEsriMissing( esri_null ) )
 			{	grid_layer = -1;
 				lastErrorCode = tkESRI_DLL_NOT_INITIALIZED;
 				return false;
 			}
 
-		int cell_type = CELLFLOAT;
+		int cell_type = GridTraits<T>::EsriCellType();
 		
 		double csize = gridHeader.getDx();
 		//Bounding box is xllcorner, yllcorner, xurcorner, yurcorner
@@ -1966,8 +1920,6 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 			return false;
 		}
 		
-		getmissingfloat(&float_null);				
-
 		//Allocate row buffer				
 		row_buf1 = (CELLTYPE*)CAllocate1(gridHeader.getNumberCols() + 1, sizeof(CELLTYPE));
 		if ( row_buf1 == NULL )
@@ -1982,17 +1934,17 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 		double total = gridHeader.getNumberRows();
 		int percent = 0;
 
-		float nodata = gridHeader.getNodataValue();
-		register float *buf = (float *)row_buf1;					
+		T nodata = gridHeader.getNodataValue();
+		register EsriCell *buf = (EsriCell *)row_buf1;					
 		for( int j = 0; j < gridHeader.getNumberRows(); j++)
 		{
 			for( int i = 0; i < gridHeader.getNumberCols(); i++)
 			{
-				buf[i] = (float)data[j][i];
-				if(buf[i] == nodata)
-					buf[i] = float_null;
+				buf[i] = (EsriCell)data[j][i];
+				if(data[j][i] == nodata)
+					buf[i] = (EsriCell)esri_null;
 			}
-			putwindowrowfloat( grid_layer, j, (float*)row_buf1);				
+			putwindowrow( grid_layer, j, (CELLTYPE*)row_buf1);				
 
 			int newpercent = (int)((j/total)*100);
 			if( newpercent > percent )
@@ -2012,27 +1964,31 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 	}
 	#pragma optimize("", on)
 
-	bool fGrid::esriWriteDiskToDisk()
+	template <typename T, typename THeader>
+	bool TypedGrid<T, THeader>::esriWriteDiskToDisk()
 	{	//Header info cannot be changed!!!
 		return true;
 	}
 
 	#pragma optimize("", off)
-	bool fGrid::esriInitializeDisk( float InitialValue )
+	template <typename T, typename THeader>
+	bool TypedGrid<T, THeader>::esriInitializeDisk( T InitialValue )
 	{	
+		typedef typename GridTraits<T>::EsriCell EsriCell;
+
 		if( celllyrexists == NULL ||
 			celllyrclose == NULL ||
 			griddelete == NULL ||
 			celllayercreate == NULL ||
 			privateaccesswindowset == NULL ||
 			putwindowrow == NULL ||
-			getmissingfloat == NULL )	
+			!GridTraits<T>::GetEsriMissing( esri_null ) )
 			{	grid_layer = -1;
 				lastErrorCode = tkESRI_DLL_NOT_INITIALIZED;
 				return false;
 			}
 
-		int cell_type = CELLFLOAT;
+		int cell_type = GridTraits<T>::EsriCellType();
 		
 		double csize = gridHeader.getDx();
 		//Bounding box is xllcorner, yllcorner, xurcorner, yurcorner
@@ -2064,8 +2020,6 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 			return false;
 		}
 		
-		getmissingfloat(&float_null);
-
 		double adjbndbox[4];
 		if( privateaccesswindowset( grid_layer, bndbox, csize, adjbndbox) < 0 )
 		{	celllyrclose(grid_layer);
@@ -2090,20 +2044,20 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 			return false;
 		}	
 
-		float nodata = gridHeader.getNodataValue();	
+		T nodata = gridHeader.getNodataValue();	
 		max = nodata;
 		min = nodata;
 
-		register float *buf = (float *)row_buf1;					
+		register EsriCell *buf = (EsriCell *)row_buf1;					
 		
 		if( InitialValue == nodata )
 		{
 			for( int i = 0; i < gridHeader.getNumberCols(); i++)
-				buf[i] = float_null;
+				buf[i] = (EsriCell)esri_null;
 		}
 		else
 		{	for( int i = 0; i < gridHeader.getNumberCols(); i++)
-				buf[i] = InitialValue;
+				buf[i] = (EsriCell)InitialValue;
 		}
 			
 		for( int j = 0; j < gridHeader.getNumberRows(); j++)
@@ -2121,8 +2075,11 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 	#pragma optimize("", on)
 
 	#pragma optimize("", off)
-	float fGrid::esriGetValueDisk( int Column, int Row )
+	template <typename T, typename THeader>
+	T TypedGrid<T, THeader>::esriGetValueDisk( int Column, int Row )
 	{			
+		typedef typename GridTraits<T>::EsriCell EsriCell;
+
 		if( Column < 0 || Column >= gridHeader.getNumberCols() )
 			return gridHeader.getNodataValue();
 		if( Row < 0 || Row >= gridHeader.getNumberRows() )
@@ -2130,28 +2087,28 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 
 		if( Row == current_row - 1 )
 		{	
-			if( ((float *)row_buf1)[Column] == float_null )
+			if( ((EsriCell *)row_buf1)[Column] == esri_null )
 				return gridHeader.getNodataValue();
-			return float((((float *)row_buf1)[Column]));						
+			return T((((EsriCell *)row_buf1)[Column]));						
 		}
 		else if( Row == current_row )
 		{	
-			if( ((float *)row_buf2)[Column] == float_null )
+			if( ((EsriCell *)row_buf2)[Column] == esri_null )
 				return gridHeader.getNodataValue();
-			return float((((float *)row_buf2)[Column]));						
+			return T((((EsriCell *)row_buf2)[Column]));						
 		}
 		else if( Row == current_row + 1 )
 		{	
-			if( ((float *)row_buf3)[Column] == float_null )
+			if( ((EsriCell *)row_buf3)[Column] == esri_null )
 				return gridHeader.getNodataValue();
-			return float((((float *)row_buf3)[Column]));						
+			return T((((EsriCell *)row_buf3)[Column]));						
 		}
 		else
 		{	esriBufferRows( Row );
 			
-			if( ((float *)row_buf2)[Column] == float_null )
+			if( ((EsriCell *)row_buf2)[Column] == esri_null )
 				return gridHeader.getNodataValue();
-			return float((((float *)row_buf2)[Column]));								
+			return T((((EsriCell *)row_buf2)[Column]));								
 		}
 		
 		return gridHeader.getNodataValue();
@@ -2159,38 +2116,35 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 	#pragma optimize("", on)
 
 	#pragma optimize("", off)
-	void fGrid::esriSetValueDisk( int Column, int Row, float Value )
+	template <typename T, typename THeader>
+	void TypedGrid<T, THeader>::esriSetValueDisk( int Column, int Row, T Value )
 	{
+		typedef typename GridTraits<T>::EsriCell EsriCell;
+
 		if( putwindowrow == NULL )
 			return;
 		
-		float value = Value;
+		EsriCell value = (EsriCell)Value;
+		if( Value == gridHeader.getNodataValue() )
+			value = (EsriCell)esri_null;
+
 		//Load the buffers with the current row
 		getValueDisk( Column, Row );
 		if( Row == current_row - 1 )
 		{
-			if( value == gridHeader.getNodataValue() )
-				value = float_null;
-
-			register float *buf = (float *)row_buf1;			
+			register EsriCell *buf = (EsriCell *)row_buf1;			
 			buf[Column] = value;					
 			putwindowrow( grid_layer, Row, (CELLTYPE*)row_buf1);
 		}
 		else if( Row == current_row )
 		{
-			if( value == gridHeader.getNodataValue() )
-				value = float_null;
-				
-			register float *buf = (float *)row_buf2;			
+			register EsriCell *buf = (EsriCell *)row_buf2;			
 			buf[Column] = value;
 			putwindowrow( grid_layer, Row, (CELLTYPE*)row_buf2);			
 		}
 		else if( Row == current_row + 1 )
 		{
-			if( value == gridHeader.getNodataValue() )
-				value = float_null;
-
-			register float *buf = (float *)row_buf3;			
+			register EsriCell *buf = (EsriCell *)row_buf3;			
 			buf[Column] = value;
 			putwindowrow( grid_layer, Row, (CELLTYPE*)row_buf3);			
 		}		
@@ -2198,17 +2152,20 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 	#pragma optimize("", on)
 
 	#pragma optimize("", off)
-	void fGrid::esriClearDisk(float clearValue)
+	template <typename T, typename THeader>
+	void TypedGrid<T, THeader>::esriClearDisk(T clearValue)
 	{	
+		typedef typename GridTraits<T>::EsriCell EsriCell;
+
 		if( putwindowrow == NULL )
 			return;
 		
-		register float *buf = (float *)row_buf1;					
+		register EsriCell *buf = (EsriCell *)row_buf1;					
 		for( int j = 0; j < gridHeader.getNumberRows(); j++)
 		{
-			float val = clearValue;
-			if( val == gridHeader.getNodataValue() )
-				val = float_null;
+			EsriCell val = (EsriCell)clearValue;
+			if( clearValue == gridHeader.getNodataValue() )
+				val = (EsriCell)esri_null;
 
 			for( int i = 0; i < gridHeader.getNumberCols(); i++)
 			{
@@ -2218,7 +2175,7 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 		}
 		for( int i = 0; i < gridHeader.getNumberCols(); i++)
 		{
-			buf[i]=clearValue;
+			buf[i]=(EsriCell)clearValue;
 		}					
 
 		esriBufferRows( 0 );				
@@ -2226,19 +2183,22 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 	#pragma optimize("", on)
 
 	#pragma optimize("", off)
-	void fGrid::esriBufferRows( int center_row )
+	template <typename T, typename THeader>
+	void TypedGrid<T, THeader>::esriBufferRows( int center_row )
 	{
+		typedef typename GridTraits<T>::EsriCell EsriCell;
+
 		if( getwindowrow == NULL )
-		{	register float *ibuf;
+		{	register EsriCell *ibuf;
 		
 			for( int i = 0; i < gridHeader.getNumberCols(); i++ )
 			{	
-				ibuf = (float *)row_buf1;
-				ibuf[i] = float_null;
-				ibuf = (float *)row_buf2;
-				ibuf[i] = float_null;
-				ibuf = (float *)row_buf3;
-				ibuf[i] = float_null;																	
+				ibuf = (EsriCell *)row_buf1;
+				ibuf[i] = (EsriCell)esri_null;
+				ibuf = (EsriCell *)row_buf2;
+				ibuf[i] = (EsriCell)esri_null;
+				ibuf = (EsriCell *)row_buf3;
+				ibuf[i] = (EsriCell)esri_null;																	
 			}	
 			return;
 		}
@@ -2276,21 +2236,21 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 		//Initialize row to nodata
 		if( nd_fill_one || nd_fill_two || nd_fill_three )
 		{	
-			register float *ibuf;
+			register EsriCell *ibuf;
 			
 			for( int i = 0; i < gridHeader.getNumberCols(); i++ )
 			{	
 				if( nd_fill_one )
-				{	ibuf = (float *)row_buf1;
-					ibuf[i] = float_null;
+				{	ibuf = (EsriCell *)row_buf1;
+					ibuf[i] = (EsriCell)esri_null;
 				}
 				if( nd_fill_two )
-				{	ibuf = (float *)row_buf2;
-					ibuf[i] = float_null;
+				{	ibuf = (EsriCell *)row_buf2;
+					ibuf[i] = (EsriCell)esri_null;
 				}
 				if( nd_fill_three )
-				{	ibuf = (float *)row_buf3;
-					ibuf[i] = float_null;
+				{	ibuf = (EsriCell *)row_buf3;
+					ibuf[i] = (EsriCell)esri_null;
 				}												
 			}			
 		}
@@ -2298,8 +2258,11 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 	#pragma optimize("", on)
 
 	#pragma optimize("", off)
-	bool fGrid::esriSaveAs( CString filename, void(*callback)(int number, const char * message) )
+	template <typename T, typename THeader>
+	bool TypedGrid<T, THeader>::esriSaveAs( CString filename, void(*callback)(int number, const char * message) )
 	{
+		typedef typename GridTraits<T>::EsriCell EsriCell;
+
 		long temp_grid_layer = -1;
 		//Check the needed functions
 		if( celllyrclose == NULL ||
@@ -2307,14 +2270,14 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 			celllayercreate == NULL ||
 			griddelete == NULL ||			
 			privateaccesswindowset == NULL ||
-			getmissingfloat == NULL ||
-			putwindowrow == NULL )
+			putwindowrow == NULL ||
+			!GridTraits<T>::GetEsriMissing( esri_null ) )
 			{	temp_grid_layer = -1;
 				lastErrorCode = tkESRI_DLL_NOT_INITIALIZED;
 				return false;
 			}
 
-		int cell_type = CELLFLOAT;
+		int cell_type = GridTraits<T>::EsriCellType();
 		
 		double csize = gridHeader.getDx();
 		//Bounding box is xllcorner, yllcorner, xurcorner, yurcorner
@@ -2348,8 +2311,6 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 			return false;
 		}
 
-		getmissingfloat(&float_null);
-									
 		//Allocate row buffer				
 		void * temp_row_buf = (CELLTYPE*)CAllocate1(gridHeader.getNumberCols() + 1, sizeof(CELLTYPE));
 		if ( temp_row_buf == NULL )
@@ -2365,15 +2326,16 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 		double total = gridHeader.getNumberRows();
 		int percent = 0;
 
-		float nodata = gridHeader.getNodataValue();
-		register float *buf = (float *)temp_row_buf;					
+		T nodata = gridHeader.getNodataValue();
+		register EsriCell *buf = (EsriCell *)temp_row_buf;					
 		for( int j = 0; j < gridHeader.getNumberRows(); j++)
 		{
 			for( int i = 0; i < gridHeader.getNumberCols(); i++)
 			{
-				buf[i] = (float)getValue( i, j );
-				if(buf[i] == nodata)
-					buf[i] = float_null;
+				T value = getValue( i, j );
+				buf[i] = (EsriCell)value;
+				if(value == nodata)
+					buf[i] = (EsriCell)esri_null;
 			}
 			putwindowrow( temp_grid_layer, j, (CELLTYPE*)temp_row_buf);				
 
@@ -2419,7 +2381,8 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 ///\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/
 
 	# define null 0
-	bool fGrid::sdtsReadDiskToMemory( void(*callback)(int number, const char * message ) )
+	template <typename T, typename THeader>
+	bool TypedGrid<T, THeader>::sdtsReadDiskToMemory( void(*callback)(int number, const char * message ) )
 	{	
 		
 		//Initialize the grid
@@ -2437,13 +2400,17 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 			return false;
 		}
 		
-		alloc();
+		if( !alloc() )
+		{	lastErrorCode = tkFAILED_TO_ALLOCATE_MEMORY;
+			delete [] fname;
+			return false;
+		}
 					
 		cells_out( gridFilename, status, fillvalue, callback );
 
 		//Check for -255 Value that can be produced on extraction
-		float nodata_value = gridHeader.getNodataValue();
-		float value = gridHeader.getNodataValue();
+		T nodata_value = gridHeader.getNodataValue();
+		T value = gridHeader.getNodataValue();
 		double average = 0;
 		int cnt = 0;
 		
@@ -2456,42 +2423,42 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 				cnt = 0;
 				if( value == -255 )
 				{				
-					float up = getValue( column, row + 1 );
+					T up = getValue( column, row + 1 );
 					if( up != nodata_value && up != -255 )
 					{	average += up;
 						cnt++;
 					}
-					float up_left = getValue( column - 1, row + 1 );
+					T up_left = getValue( column - 1, row + 1 );
 					if( up_left != nodata_value && up_left != -255 )
 					{	average += up_left;
 						cnt++;
 					}
-					float left = getValue( column - 1, row );
+					T left = getValue( column - 1, row );
 					if( left != nodata_value && left != -255 )
 					{	average += left;
 						cnt++;
 					}
-					float down_left = getValue( column - 1, row - 1 );
+					T down_left = getValue( column - 1, row - 1 );
 					if( down_left != nodata_value && down_left != -255 )
 					{	average += down_left;
 						cnt++;
 					}
-					float down = getValue( column, row - 1 );
+					T down = getValue( column, row - 1 );
 					if( down != nodata_value && down != -255 )
 					{	average += down;
 						cnt++;
 					}
-					float down_right = getValue( column + 1, row - 1 );
+					T down_right = getValue( column + 1, row - 1 );
 					if( down_right != nodata_value && down_right != -255 )
 					{	average += down_right;
 						cnt++;
 					}
-					float right = getValue( column + 1, row );
+					T right = getValue( column + 1, row );
 					if( right != nodata_value && right != -255 )
 					{	average += right;
 						cnt++;
 					}
-					float up_right = getValue( column + 1, row + 1 );
+					T up_right = getValue( column + 1, row + 1 );
 					if( up_right != nodata_value && up_right != -255 )
 					{	average += up_right;
 						cnt++;
@@ -2502,7 +2469,7 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 					else
 						average = nodata_value;
 
-					setValue( column, row, (float)average );
+					setValue( column, row, (T)average );
 				}
 			}
 		}
@@ -2511,7 +2478,8 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 		return true;	
 	}
 
-	bool fGrid::read_sdts_header(char * filename, fHeader & h, long & fillvalue)
+	template <typename T, typename THeader>
+	bool TypedGrid<T, THeader>::read_sdts_header(char * filename, THeader & h, long & fillvalue)
 	{	
 		strcpy( file_name, filename );
 		baseAndId();
@@ -2523,7 +2491,7 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 		dem_head(status);
 		long voidvalue;
 		cell_range(status, voidvalue, fillvalue);
-		h.setNodataValue( (float)voidvalue );
+		h.setNodataValue( (T)voidvalue );
 
 		double xhrs, yhrs;
 		get_iref(xhrs, yhrs);
@@ -2563,7 +2531,8 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 		return true;
 	}
 
- 	void fGrid::baseAndId()
+ 	template <typename T, typename THeader>
+ 	void TypedGrid<T, THeader>::baseAndId()
 	{
 		int len,j;
 		//parse out base_name 
@@ -2573,7 +2542,8 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 		base_name[j] = '\0';
 	}
 
-	void fGrid::dem_rc(int status, int & ncol, int & nrow)
+	template <typename T, typename THeader>
+	void TypedGrid<T, THeader>::dem_rc(int status, int & ncol, int & nrow)
 	{
 
 	  strcpy (file_name,base_name);
@@ -2655,7 +2625,8 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 	  return;
 	}
 	/*********************************************/
-	void fGrid::get_iref(double & xhrs, double & yhrs)
+	template <typename T, typename THeader>
+	void TypedGrid<T, THeader>::get_iref(double & xhrs, double & yhrs)
 	{
 	/* set some default values */
 	sfax = 1.0;
@@ -2751,7 +2722,8 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 
 
 	/*********************************************/
-	void fGrid::get_xref(void)
+	template <typename T, typename THeader>
+	void TypedGrid<T, THeader>::get_xref(void)
 	{
 	/* set some default values */
 	strcpy(rsnm,"??1")  ;
@@ -2843,7 +2815,8 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 
 	/***************************************/
 
-	void fGrid::dem_head(int status)
+	template <typename T, typename THeader>
+	void TypedGrid<T, THeader>::dem_head(int status)
 	{
 	/*      Open Identification module */
 
@@ -2937,7 +2910,8 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 
 	/*********************************************/
 
-	void fGrid::dem_mbr(int status, double & SWX, double & SWY, double & NWX, double & NWY, double & NEX, double & NEY, double & SEX, double & SEY)
+	template <typename T, typename THeader>
+	void TypedGrid<T, THeader>::dem_mbr(int status, double & SWX, double & SWY, double & NWX, double & NWY, double & NEX, double & NEY, double & SEX, double & SEY)
 	{
 	
 	  int i;
@@ -3066,7 +3040,8 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 	}
 
 	/*********************************************/
-	void fGrid::cell_range(int status, long & voidvalue, long & fillvalue)
+	template <typename T, typename THeader>
+	void TypedGrid<T, THeader>::cell_range(int status, long & voidvalue, long & fillvalue)
 	{
 	int seq=0;
 	int recid;
@@ -3207,7 +3182,8 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 	*****************************************************************************/
 	/*#include "stc123.h"*/
 
-	int fGrid::s123tol2(char* string,long* num,int reverse)
+	template <typename T, typename THeader>
+	int TypedGrid<T, THeader>::s123tol2(char* string,long* num,int reverse)
 	{
 	   /* INTERNAL VARIABLES */
 				char MSB; 
@@ -3241,7 +3217,8 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 	}
 
 	/********************************************/
-	void fGrid::cells_out(const char * filename, int status, long fillvalue, void (*callback)(int number, const char * message ) )
+	template <typename T, typename THeader>
+	void TypedGrid<T, THeader>::cells_out(const char * filename, int status, long fillvalue, void (*callback)(int number, const char * message ) )
 	{
 		int i = 0;
 		int j = 0;
@@ -3313,7 +3290,7 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 						if( li == 32767 || li == -32767 )
 							setValue( i, j, -255 );
 						else
-							setValue( i, j, (float)li );
+							setValue( i, j, (T)li );
 
 						int newpercent = (cnt/total)*100;
 						if( newpercent > percent )
@@ -3364,7 +3341,7 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 					if( li == 32767 || li == -32767 )
 						setValue( i, j, -255 );
 					else
-						setValue( i, j, (float)li );
+						setValue( i, j, (T)li );
 
 					int newpercent = (int)((cnt/total)*100);
 					if( newpercent > percent )
@@ -3374,7 +3351,7 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 					}
 				}
 				else
-					setValue( i, j, (float)nodata_value );
+					setValue( i, j, (T)nodata_value );
 				cnt++;
 				i++;
 			}
@@ -3395,7 +3372,8 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 
 
 	/*********************************************/
-	void fGrid::get_nw_corner(double & upperlx, double & upperly)
+	template <typename T, typename THeader>
+	void TypedGrid<T, THeader>::get_nw_corner(double & upperlx, double & upperly)
 	{
 	long sadr_x,sadr_y;
 
@@ -3498,7 +3476,8 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 	return;
 	}
 
-	char fGrid::FeetOrMeters()
+	template <typename T, typename THeader>
+	char TypedGrid<T, THeader>::FeetOrMeters()
 	{
 		const int	MAX = 1000;
 		char		data[1000];
@@ -3541,4 +3520,9 @@ GRID_TYPE fGrid::getGridType( const char * filename )
 ///\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/
 //			SDTS GRID FUNCTIONS
 ///\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/
-///\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/
\ No newline at end of file
+///\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/
+
+template class TypedGrid<double, dHeader>;
+template class TypedGrid<float, fHeader>;
+template class TypedGrid<long, lHeader>;
+template class TypedGrid<short, sHeader>;
@@ -117,6 +117,10 @@ void tkGridRaster::SaveHeaderInfo()
 	}
 
 	// Force reopen to update the nodata value
+	bool reopenCache = _blockCache.IsOpen();
+	_blockCache.Flush();
+	_blockCache.Close();
+
 	_poBand->FlushCache();
 	_rasterDataset->FlushCache();
 
@@ -128,6 +132,9 @@ void tkGridRaster::SaveHeaderInfo()
 	if( _rasterDataset != NULL )
 	{
 		_poBand = _rasterDataset->GetRasterBand(1);
+
+		if (reopenCache)
+			OpenBlockCache();
 	}
 }
 
@@ -146,7 +153,6 @@ bool tkGridRaster::LoadRasterCore(char* filenameA, bool InRam, GridFileType file
 {
 	__try
 	{
-		_canScanlineBuffer = false;
 		_currentFileType = fileType;
 
 		GDALAllRegister();
@@ -202,18 +208,11 @@ bool tkGridRaster::LoadRasterCore(char* filenameA, bool InRam, GridFileType file
 			LoadFullBuffer();
 		}
 
-		// Determine if scanline buffer can be done in case
-		// of inram==false, whether passed or forced by LoadFullBuffer
-		if (_genericType == GDT_Int32 || _genericType == GDT_Byte)
-		{
-			// Chris M 1/28/2007 -- multiply this by two, since we use two buffers
-			if (MemoryAvailable(2 * _width * sizeof(_int32)))
-				_canScanlineBuffer = true;
-		}
-		else
+		// in case of inram==false, whether passed or forced by LoadFullBuffer,
+		// values are read through the cache of blocks
+		if (!_inRam)
 		{
-			if (MemoryAvailable(2 * _width * sizeof(float)))
-				_canScanlineBuffer = true;
+			OpenBlockCache();
 		}
 	}
 	__except(1)
@@ -236,6 +235,11 @@ bool tkGridRaster::OpenBand(int bandIndex)
 {
 	int count = _rasterDataset->GetRasterCount();
 	
+	// the changes of the previous band must be written before it's replaced
+	bool reopenCache = _blockCache.IsOpen();
+	_blockCache.Flush();
+	_blockCache.Close();
+
 	_poBand = _rasterDataset->GetRasterBand(bandIndex);
 	if (!_poBand) {
 		return false;
@@ -312,9 +316,24 @@ bool tkGridRaster::OpenBand(int bandIndex)
 		_poBand->SetNoDataValue(_noDataValue);
 	}
 
+	if (reopenCache)
+	{
+		OpenBlockCache();
+	}
+
 	return true;
 }
 
+// *****************************************************
+//		OpenBlockCache()
+// *****************************************************
+void tkGridRaster::OpenBlockCache()
+{
+	bool useInt = _genericType == GDT_Int32 || _genericType == GDT_Byte;
+	__int64 memoryBudget = (__int64)m_globalSettings.gridDiskCacheSize * 1024 * 1024;
+	_blockCache.Open(_poBand, useInt, memoryBudget);
+}
+
 // *****************************************************
 //		ReadProjection()
 // *****************************************************
@@ -475,6 +494,11 @@ bool tkGridRaster::CreateNew(CStringW filename, GridFileType newFileType, double
 		}
 	}
 
+	if (!_inRam)
+	{
+		OpenBlockCache();
+	}
+
 	// Write the initial value
 	if (applyInitialValue)
 		clear(initialValue);
@@ -606,6 +630,9 @@ bool tkGridRaster::Close()
 {
 	try
 	{
+		// changes which weren't saved are discarded
+		_blockCache.Close();
+
 		if (_rasterDataset != NULL)
 		{
 			delete _rasterDataset;
@@ -624,30 +651,6 @@ bool tkGridRaster::Close()
 			_floatbuffer = NULL;
 		}
 
-		if( _int32ScanlineBufferA != NULL )
-		{
-			CPLFree( _int32ScanlineBufferA );
-			_int32ScanlineBufferA = NULL;
-		}
-
-		if( _floatScanlineBufferA != NULL )
-		{
-			CPLFree( _floatScanlineBufferA );
-			_floatScanlineBufferA = NULL;
-		}
-
-		if( _int32ScanlineBufferB != NULL )
-		{
-			CPLFree( _int32ScanlineBufferB );
-			_int32ScanlineBufferB = NULL;
-		}
-
-		if( _floatScanlineBufferB != NULL )
-		{
-			CPLFree( _floatScanlineBufferB );
-			_floatScanlineBufferB = NULL;
-		}
-
 		_cachedMax = -9999;
 		_cachedMin = 9999;
 		_genericType = GDT_Unknown;
@@ -787,8 +790,7 @@ bool tkGridRaster::GetFloatWindow(void *Vals, long StartRow, long EndRow, long S
 	if (_poBand == NULL) return false;
 
 	// Load from buffer if it exists, otherwise use RasterIO.
-	// Since there are lots of potential buffers, just call getValue
-	if (_int32buffer != NULL || _floatbuffer != NULL || _int32ScanlineBufferB != NULL || _floatScanlineBufferB != NULL || _int32ScanlineBufferA != NULL || _floatScanlineBufferA != NULL)
+	if (_int32buffer != NULL || _floatbuffer != NULL)
 	{
 		long position = 0;
 
@@ -816,6 +818,9 @@ bool tkGridRaster::GetFloatWindow(void *Vals, long StartRow, long EndRow, long S
 	{
 		// Use Rasterio Directly from disk -- faster for large grids,
 		// which is likely when this function will be called anyway.
+		// Changed blocks must be written first to be read back.
+		_blockCache.Flush();
+
 		try
 		{
 			GDALDataType type = useDouble ? GDT_Float64 : GDT_Float32;
@@ -841,8 +846,7 @@ bool tkGridRaster::PutFloatWindow(void *Vals, long StartRow, long EndRow, long S
 	_cachedMax = -9999;
 
 	// Save to buffer if it exists, otherwise use RasterIO.
-	if (_int32buffer != NULL || _floatbuffer != NULL || _int32ScanlineBufferB != NULL || 
-		_floatScanlineBufferB != NULL || _int32ScanlineBufferA != NULL || _floatScanlineBufferA != NULL)
+	if (_int32buffer != NULL || _floatbuffer != NULL)
 	{
 		
 		double* ValsDouble = reinterpret_cast<double*>(Vals);
@@ -872,6 +876,10 @@ bool tkGridRaster::PutFloatWindow(void *Vals, long StartRow, long EndRow, long S
 	{
 		// Use Rasterio Directly to disk -- faster for large grids,
 		// which is likely when this function will be called anyway.
+		// Cached blocks would overwrite the window or return stale values otherwise.
+		_blockCache.Flush();
+		_blockCache.Clear();
+
 		try
 		{
 			GDALDataType type = useDouble ? GDT_Float64 : GDT_Float32;
@@ -901,6 +909,8 @@ void tkGridRaster::clear(double value)
 	}
 	else if (!_inRam)
 	{
+		_blockCache.Clear();
+
 		if (_poBand != NULL)
 			_poBand->Fill(value);
 	}
@@ -908,46 +918,16 @@ void tkGridRaster::clear(double value)
 
 bool tkGridRaster::SaveFullBuffer()
 {
-	// First, check to see if scanline buffering has been used. This will likely be the most common.
+	// First, check to see if blocks of disk-based grid were changed. This will likely be the most common.
 	// If not, drop down to "buffer save"
 	bool retVal = false;
 
-	// Chris Michaelis 1/28/2007
-	// Do not use ELSE's here -- otherwise only every other line will be saved
-
-	if (_genericType != GDT_Int32 && _scanlineADataChanged && _floatScanlineBufferA != NULL)
-	{
-		_poBand->RasterIO( GF_Write, 0, _scanlineBufferNumberA, _width, 1,
-									_floatScanlineBufferA, _width, 1, GDT_Float32,0, 0 );
-		retVal = true;
-		_scanlineADataChanged = false;
-	}
-
-	if ((_genericType == GDT_Int32 || _genericType == GDT_Byte) && _scanlineADataChanged && _int32ScanlineBufferA != NULL)
+	if (_blockCache.HasChanges())
 	{
-		_poBand->RasterIO( GF_Write, 0, _scanlineBufferNumberA, _width, 1,
-									_int32ScanlineBufferA, _width, 1, GDT_Int32,0, 0 );
-		retVal = true;
-		_scanlineADataChanged = false;
-	}
-
-	if (_genericType != GDT_Int32 && _scanlineBDataChanged && _floatScanlineBufferB != NULL)
-	{
-		_poBand->RasterIO( GF_Write, 0, _scanlineBufferNumberB, _width, 1,
-									_floatScanlineBufferB, _width, 1, GDT_Float32,0, 0 );
-		retVal = true;
-		_scanlineBDataChanged = false;
+		retVal = _blockCache.Flush();
 	}
 
-	if ((_genericType == GDT_Int32 || _genericType == GDT_Byte) && _scanlineBDataChanged && _int32ScanlineBufferB != NULL)
-	{
-		_poBand->RasterIO( GF_Write, 0, _scanlineBufferNumberB, _width, 1,
-									_int32ScanlineBufferB, _width, 1, GDT_Int32,0, 0 );
-		retVal = true;
-		_scanlineBDataChanged = false;
-	}
-
-	// Buffer save -- if not scanlining.
+	// Buffer save -- if disk-based.
 	if ((_genericType == GDT_Int32 || _genericType == GDT_Byte) && _int32buffer != NULL)
 	{
 		_poBand->RasterIO( GF_Write, 0, 0, _width, _height,
@@ -1017,7 +997,7 @@ bool tkGridRaster::Save(CStringW saveToFilename, GridFileType newFileFormat)
 	{
 		// Before saving to a different file type,
 		// save out any scanline memory buffers to the current file
-		if (_scanlineADataChanged || _scanlineBDataChanged)
+		if (_blockCache.HasChanges())
 			SaveFullBuffer();
 		
 		// Note that if it's inram fully, the above isn't necessary;
@@ -1104,186 +1084,26 @@ double tkGridRaster::getValue( long Row, long Column )
 			return static_cast<double>(_int32buffer[Column + Row * _width]);
 	else if (_inRam == true && _floatbuffer != NULL)
 			return static_cast<double>(_floatbuffer[Column + Row * _width]);
-	else
-	{
-		// Read from disk - buffering one line at a time if possible
-		if (Row == _scanlineBufferNumberA)
-		{
-			// Return from one-row buffer
-			_scanlineLastAccessed = 'A';
-			if ((_genericType == GDT_Int32 || _genericType == GDT_Byte) && _int32ScanlineBufferA != NULL)
-				return static_cast<double>(_int32ScanlineBufferA[Column]);
-			else if (_floatScanlineBufferA != NULL)
-				return static_cast<double>(_floatScanlineBufferA[Column]);
-		}
-		else if (Row == _scanlineBufferNumberB)
-		{
-			// Return from one-row buffer
-			_scanlineLastAccessed = 'B';
-			if ((_genericType == GDT_Int32 || _genericType == GDT_Byte) && _int32ScanlineBufferB != NULL)
-				return static_cast<double>(_int32ScanlineBufferB[Column]);
-			else if (_floatScanlineBufferB != NULL)
-				return static_cast<double>(_floatScanlineBufferB[Column]);
-		}
-
-		// If we're still in the function, need to load a buffer
-		// or get a single value
-		if (_canScanlineBuffer)
-		{
-			if (_scanlineLastAccessed == 'A')
-			{
-				// Load B
-				if (_genericType == GDT_Int32 || _genericType == GDT_Byte)
-				{
-					// If put_Value was called and wrote into the memory buffer,
-					// save that before dumping the old buffer data.
-					if (_scanlineBDataChanged)
-						SaveFullBuffer();
-
-					if (_int32ScanlineBufferB == NULL)
-						_int32ScanlineBufferB = (_int32*) CPLMalloc( sizeof(_int32)*_width);
-
-					// If we get here and the buffer is still null, apparently
-					// there's not really enough memory to do this...!
-					if (_int32ScanlineBufferB == NULL)
-					{
-						// Clear and prevent buffering
-						_scanlineBufferNumberA = -1;
-						_scanlineBufferNumberB = -1;
-						_canScanlineBuffer = false;
-
-						// Return the requested value with a recursive call
-						return getValue(Row, Column);
-					}
-
-					_poBand->RasterIO( GF_Read, 0, Row, _width, 1,
-								_int32ScanlineBufferB, _width, 1, GDT_Int32,0, 0 );
-					_scanlineBufferNumberB = Row;
-					_scanlineLastAccessed = 'B';
-					_scanlineBDataChanged = false;
-					return static_cast<double>(_int32ScanlineBufferB[Column]);
-				}
-				else
-				{
-					// If put_Value was called and wrote into the memory buffer,
-					// save that before dumping the old buffer data.
-					if (_scanlineBDataChanged)
-						SaveFullBuffer();
-
-					if (_floatScanlineBufferB == NULL)
-						_floatScanlineBufferB = (float *) CPLMalloc( sizeof(float)*_width);
-
-					// If we get here and the buffer is still null, apparently
-					// there's not really enough memory to do this...!
-					if (_floatScanlineBufferB == NULL)
-					{
-						// Clear and prevent buffering
-						_scanlineBufferNumberA = -1;
-						_scanlineBufferNumberB = -1;
-						_canScanlineBuffer = false;
-
-						// Return the requested value with a recursive call
-						return getValue(Row, Column);
-					}
-
-					_poBand->RasterIO( GF_Read, 0, Row, _width, 1,
-									_floatScanlineBufferB, _width, 1, GDT_Float32,0, 0 );
-					_scanlineBufferNumberB = Row;
-					_scanlineLastAccessed = 'B';
-					_scanlineBDataChanged = false;
-					return static_cast<double>(_floatScanlineBufferB[Column]);
-				}
-			}
-			else
-			{
-				// Load A
-				if (_genericType == GDT_Int32 || _genericType == GDT_Byte)
-				{
-					// If put_Value was called and wrote into the memory buffer,
-					// save that before dumping the old buffer data.
-					if (_scanlineADataChanged)
-						SaveFullBuffer();
-
-					if (_int32ScanlineBufferA == NULL)
-						_int32ScanlineBufferA = (_int32*) CPLMalloc( sizeof(_int32)*_width);
-
-					// If we get here and the buffer is still null, apparently
-					// there's not really enough memory to do this...!
-					if (_int32ScanlineBufferA == NULL)
-					{
-						// Clear and prevent buffering
-						_scanlineBufferNumberA = -1;
-						_scanlineBufferNumberB = -1;
-						_canScanlineBuffer = false;
-
-						// Return the requested value with a recursive call
-						return getValue(Row, Column);
-					}
-
-					_poBand->RasterIO( GF_Read, 0, Row, _width, 1,
-								_int32ScanlineBufferA, _width, 1, GDT_Int32,0, 0 );
-					_scanlineBufferNumberA = Row;
-					_scanlineLastAccessed = 'A';
-					_scanlineADataChanged = false;
-					return static_cast<double>(_int32ScanlineBufferA[Column]);
-				}
-				else
-				{
-					// If put_Value was called and wrote into the memory buffer,
-					// save that before dumping the old buffer data.
-					if (_scanlineADataChanged)
-						SaveFullBuffer();
-
-					if (_floatScanlineBufferA == NULL)
-						_floatScanlineBufferA = (float *) CPLMalloc( sizeof(float)*_width);
-
-					// If we get here and the buffer is still null, apparently
-					// there's not really enough memory to do this...!
-					if (_floatScanlineBufferA == NULL)
-					{
-						// Clear and prevent buffering
-						_scanlineBufferNumberA = -1;
-						_scanlineBufferNumberB = -1;
-						_canScanlineBuffer = false;
-
-						// Return the requested value with a recursive call
-						return getValue(Row, Column);
-					}
-
-					_poBand->RasterIO( GF_Read, 0, Row, _width, 1,
-									_floatScanlineBufferA, _width, 1, GDT_Float32,0, 0 );
-					_scanlineBufferNumberA = Row;
-					_scanlineLastAccessed = 'A';
-					_scanlineADataChanged = false;
-					return static_cast<double>(_floatScanlineBufferA[Column]);
-				}
-
-			}
-		}
-		else
-		{
-			// Read one value at a time. Performance hit...
-			_int32 pafScanAreaInt;
-			float pafScanAreaFloat;
 
-			if (_genericType == GDT_Int32 || _genericType == GDT_Byte)
-			{
-				//poBand->AdviseRead ( Column, Row, 1, 1, 1, 1, GDT_Int32, NULL);
-				_poBand->RasterIO( GF_Read, Column, Row, 1, 1,
-									&pafScanAreaInt, 1, 1, GDT_Int32,0, 0 );
-			}
-			else
-			{
-				//poBand->AdviseRead ( Column, Row, 1, 1, 1, 1, GDT_Float32, NULL);
-				_poBand->RasterIO( GF_Read, Column, Row, 1, 1,
-								&pafScanAreaFloat, 1, 1, GDT_Float32,0, 0 );
-			}
+	// Read from disk - through the cache of blocks if possible
+	double value;
+	if (_blockCache.GetValue(Row, Column, value))
+		return value;
 
-			if (_genericType == GDT_Int32 || _genericType == GDT_Byte)
-				return static_cast<double>(pafScanAreaInt);
-			else
-				return static_cast<double>(pafScanAreaFloat);
-		}
+	// Read one value at a time. Performance hit...
+	if (_genericType == GDT_Int32 || _genericType == GDT_Byte)
+	{
+		_int32 pafScanAreaInt = 0;
+		_poBand->RasterIO( GF_Read, Column, Row, 1, 1,
+							&pafScanAreaInt, 1, 1, GDT_Int32,0, 0 );
+		return static_cast<double>(pafScanAreaInt);
+	}
+	else
+	{
+		float pafScanAreaFloat = 0.0f;
+		_poBand->RasterIO( GF_Read, Column, Row, 1, 1,
+						&pafScanAreaFloat, 1, 1, GDT_Float32,0, 0 );
+		return static_cast<double>(pafScanAreaFloat);
 	}
 }
 
@@ -1298,37 +1118,10 @@ void tkGridRaster::putValue( long Row, long Column, double Value )
 	else if (_inRam == true && _floatbuffer != NULL)
 			_floatbuffer[Column + Row * _width] = static_cast<float>(Value);
 
-	// If there is a loaded scanline buffer for this row, use it and set the modified flag.
-	else if ((_genericType == GDT_Int32 || _genericType == GDT_Byte) && _scanlineBufferNumberB == Row && _int32ScanlineBufferB != NULL)
-	{
-		_int32ScanlineBufferB[Column] = static_cast<_int32>(Value);
-		_scanlineBDataChanged = true;
-	}
-	else if (_genericType != GDT_Int32 && _scanlineBufferNumberB == Row && _floatScanlineBufferB != NULL)
-	{
-		_floatScanlineBufferB[Column] = static_cast<float>(Value);
-		_scanlineBDataChanged = true;
-	}
-	else if ((_genericType == GDT_Int32 || _genericType == GDT_Byte) && _scanlineBufferNumberA == Row && _int32ScanlineBufferA != NULL)
-	{
-		_int32ScanlineBufferA[Column] = static_cast<_int32>(Value);
-		_scanlineADataChanged = true;
-	}
-	else if (_genericType != GDT_Int32 && _scanlineBufferNumberA == Row && _floatScanlineBufferA != NULL)
-	{
-		_floatScanlineBufferA[Column] = static_cast<float>(Value);
-		_scanlineADataChanged = true;
-	}
-	else if (_canScanlineBuffer)
-	{
-		// We can use scanline buffering but the row we're writing to isn't loaded.
-		// Request a value from this row to force it to load into one of the buffers.
-		// If existing data was changed, it will be saved by getValue before the buffer is loaded.
-		getValue(Row, Column);  // Return value is junked (not assigned to anything)
+	// The block is marked as changed and written back when it's evicted or the grid is saved.
+	else if (_blockCache.PutValue(Row, Column, Value))
+		return;
 
-		// It is loaded now -- the else blocks above can now catch it and write it. So, call myself.
-		putValue(Row, Column, Value);
-	}
 	else
 	{
 		// Write directly to disk. Big performance hit.
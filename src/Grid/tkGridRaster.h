@@ -32,6 +32,7 @@
 #include "HashTable.h"
 #include "ImageStructs.h"
 #include "colour.h"
+#include "GridBlockCache.h"
 
 class tkGridRaster
 {
@@ -44,14 +45,7 @@ public:
 		_rasterDataset = NULL;
 		_floatbuffer = NULL;
 		_int32buffer = NULL;
-		_int32ScanlineBufferA = NULL;
-		_floatScanlineBufferA = NULL;
-		_int32ScanlineBufferB = NULL;
-		_floatScanlineBufferB = NULL;
 		_noDataValue = static_cast<double>(-3.40282346638529E+38);
-		_canScanlineBuffer = false;
-		_scanlineBufferNumberA = -1;
-		_scanlineBufferNumberB = -1;
 		_cachedMax = -9999;
 		_cachedMin = 9999;
 		_genericType = GDT_Unknown;
@@ -78,16 +72,8 @@ private:
 	_int32 * _int32buffer;
 	float * _floatbuffer;
 
-	_int32 * _int32ScanlineBufferA;
-	float * _floatScanlineBufferA;
-	long _scanlineBufferNumberA;
-	_int32 * _int32ScanlineBufferB;
-	float * _floatScanlineBufferB;
-	long _scanlineBufferNumberB;
-	bool _canScanlineBuffer;
-	bool _scanlineADataChanged;
-	bool _scanlineBDataChanged;
-	char _scanlineLastAccessed;
+	// blocks of the raster when it isn't loaded in memory
+	GridBlockCache _blockCache;
 
 	bool _inRam;
 
@@ -130,6 +116,7 @@ private:
 private:
 	inline bool inColorMap(colort c);
 	void LoadFullBuffer();
+	void OpenBlockCache();
 	bool SaveFullBuffer();
 	void WriteBGDHeader(CString filename, FILE * out);
 	void ReadBGDHeader(CString filename, FILE * in, DATA_TYPE &bgdDataType);
@@ -20,9 +20,14 @@
 #include "Vector.h"
 #include "gdalwarper.h"
 #include "GridColorScheme.h"
+#include <algorithm>
+#include <limits>
 
 using namespace std;
 
+// the largest range of integer values which colors are calculated in advance
+#define GRID_COLOR_LUT_MAX_SIZE 65536
+
 // ReSharper disable CppUseAuto
 
 // *************************************************************
@@ -1043,86 +1048,143 @@ bool GdalRaster::ReadColorTableToMemoryBuffer(colour ** imageData, int* srcDataI
 // *************************************************************
 //	  GdalBufferToMemoryBuffer
 // *************************************************************
+// The rendering mode is chosen once for each row: the grey values are calculated first 
+// and then written to the channel(s) of the destination.
 template <typename T>
 bool GdalRaster::GdalBufferToMemoryBuffer(colour ** dst, T* src, int xBuff, int yBuff,
 	int nominalRgbBand, int realBandIndex, double shift, double range, double noDataValue, double min, double max)
 {
-	T val = 0;		// value from source buffer	(_int32, float, unsigned char)
-	colour* color;	// position in the resulting buffer
-
 	bool singleBand = _nBands == 1 || _forceSingleBandRendering;
 
 	bool histogram = /*singleBand &&*/ _useHistogram && _histogram.CanUse();
 	bool floatOrInt = _genericType == GDT_Float32 || _genericType == GDT_Int32;
 	double ratio = 255.0 / (double)range;
 
-	unsigned char b;
+	// NaN fails both comparisons, so it's treated as out of range
+	auto isValid = [&](T val) {
+		return val != noDataValue && val >= min && val <= max;
+	};
+
+	auto toGrey = [&](T val) {
+		if (histogram)
+			return static_cast<unsigned char>(_histogram.GetColorValue(realBandIndex, static_cast<double>(val)));
+		
+		if (floatOrInt)
+			return static_cast<unsigned char>(double(val + shift) * ratio);
+		
+		return static_cast<unsigned char>(val);
+	};
+
+	// byte values are looked up in a table
+	const bool useTable = sizeof(T) == 1 && !std::numeric_limits<T>::is_signed;
+	unsigned char tableValid[256];
+	unsigned char tableGrey[256];
+	if (useTable)
+	{
+		for (int v = 0; v < 256; v++)
+		{
+			tableValid[v] = isValid((T)v) ? 1 : 0;
+			tableGrey[v] = tableValid[v] ? toGrey((T)v) : 0;
+		}
+	}
+
+	// 255 - b, when greyscale is reversed; alpha band is never reversed
+	const unsigned char flip = _reverseGreyscale ? 255 : 0;
+
+	vector<unsigned char> valid(xBuff);
+	vector<unsigned char> grey(xBuff);
+
 	for (int i = 0; i < yBuff; i++) 
 	{
-		for (int j = 0; j < xBuff; j++)	
+		const T* row = src + i * xBuff;
+		colour* color = (*dst) + i * xBuff;
+
+		if (useTable)
 		{
-			val = src[i * xBuff + j];	
-			color = (*dst) + i * xBuff + j;
-				
-			if (val == noDataValue || val < min || val > max)
+			for (int j = 0; j < xBuff; j++)
 			{
-				color->blue = _transColor.b;
-				color->green = _transColor.g;
-				color->red = _transColor.r;
-				color->alpha = 0;		// in fact the rest isn't much needed
-				continue;
+				unsigned char v = (unsigned char)row[j];
+				valid[j] = tableValid[v];
+				grey[j] = tableGrey[v];
 			}
-
-			if (histogram)
+		}
+		else if (histogram || !floatOrInt)
+		{
+			for (int j = 0; j < xBuff; j++)
 			{
-				b = static_cast<unsigned char>(_histogram.GetColorValue(realBandIndex, static_cast<double>(val)));
+				valid[j] = isValid(row[j]) ? 1 : 0;
+				grey[j] = valid[j] ? toGrey(row[j]) : 0;
 			}
-			else if (floatOrInt)
+		}
+		else
+		{
+			for (int j = 0; j < xBuff; j++)
 			{
-				b = static_cast<unsigned char>(double(val + shift) * ratio);
+				T val = row[j];
+				valid[j] = val != noDataValue && val >= min && val <= max;
+				grey[j] = valid[j] ? static_cast<unsigned char>(double(val + shift) * ratio) : 0;
 			}
-			else
+		}
+
+		for (int j = 0; j < xBuff; j++)
+		{
+			if (!valid[j])
 			{
-				b = static_cast<unsigned char>(val);
+				color[j].blue = _transColor.b;
+				color[j].green = _transColor.g;
+				color[j].red = _transColor.r;
+				color[j].alpha = 0;		// in fact the rest isn't much needed
 			}
+		}
 
-			if (_reverseGreyscale) 
+		if (singleBand)
+		{
+			for (int j = 0; j < xBuff; j++)
 			{
-				b = 255 - b;
+				if (!valid[j]) continue;
+
+				unsigned char b = grey[j] ^ flip;
+				color[j].red = b;
+				color[j].green = b;
+				color[j].blue = b;
 			}
 
-			if (singleBand)
+			if (_alphaRendering)
 			{
-				color->red = b;
-				color->green = b;
-				color->blue = b;
-
-				if (_alphaRendering) 
+				for (int j = 0; j < xBuff; j++)
 				{
-					if (_reverseGreyscale) {
-						b = 255 - b;		// alpha band must not be reversed
-					}
-					color->alpha = b;
+					if (valid[j]) color[j].alpha = grey[j];
 				}
 			}
-			else
+		}
+		else if (nominalRgbBand == 1)
+		{
+			for (int j = 0; j < xBuff; j++)
 			{
-				if (nominalRgbBand == 1)      color->red = b;
-				else if (nominalRgbBand == 2) color->green = b;
-				else if (nominalRgbBand == 3) color->blue = b;
-				else if (nominalRgbBand == 4) 
-				{
-					if (_reverseGreyscale) {
-						b = 255 - b;		// alpha band must not be reversed
-					}
-
-					// to honor no data values previously set
-					// TODO: in fact better to process the alpha band first
-					if (color->alpha != 0)
-					{
-						color->alpha = b;
-					}
-				}
+				if (valid[j]) color[j].red = grey[j] ^ flip;
+			}
+		}
+		else if (nominalRgbBand == 2)
+		{
+			for (int j = 0; j < xBuff; j++)
+			{
+				if (valid[j]) color[j].green = grey[j] ^ flip;
+			}
+		}
+		else if (nominalRgbBand == 3)
+		{
+			for (int j = 0; j < xBuff; j++)
+			{
+				if (valid[j]) color[j].blue = grey[j] ^ flip;
+			}
+		}
+		else if (nominalRgbBand == 4)
+		{
+			// to honor no data values previously set
+			// TODO: in fact better to process the alpha band first
+			for (int j = 0; j < xBuff; j++)
+			{
+				if (valid[j] && color[j].alpha != 0) color[j].alpha = grey[j];
 			}
 		}
 	}
@@ -1390,7 +1452,6 @@ bool GdalRaster::ReadBandDataAsGridCore(colour** ImageData, int xOff, int yOff,
 		band->RasterIO(GF_Read, xOff, yOff, width, height, pafScanArea, xBuff, yBuff, GDT_Float32, 0, 0);
 	}
 
-	const float total = static_cast<float>(yBuff * xBuff);
 	const float xll = static_cast<float>(_xllCenter);
 	const float yll = static_cast<float>(_yllCenter);
 
@@ -1400,122 +1461,173 @@ bool GdalRaster::ReadBandDataAsGridCore(colour** ImageData, int xOff, int yOff,
 	cppVector lightSource;
 	ReadColorScheme(bvals, ai, li, lightSource);
 
+	if (!_allowHillshade)
+	{
+		for (size_t i = 0; i < bvals.size(); i++)
+		{
+			if (bvals[i].colortype == Hillshade)
+				bvals[i].colortype = Gradient;
+		}
+	}
+
+	BreakIndex breakIndex;
+	breakIndex.Build(bvals);
+
+	const double lsi = lightSource.geti();
+	const double lsj = lightSource.getj();
+	const double lsk = lightSource.getk();
+
+	// for integer data with a narrow range of values the colors are calculated once for each value
+	const int size = xBuff * yBuff;
+	DataType minValue = 0;
+	std::vector<int> lutBreaks;		// break for value - minValue, -1 for transparent
+	std::vector<colour> lutColors;	// the color when the break has no hillshade
+
+	if (std::numeric_limits<DataType>::is_integer && size > 0)
+	{
+		DataType maxValue = minValue = pafScanArea[0];
+		for (int i = 1; i < size; i++)
+		{
+			DataType val = pafScanArea[i];
+			minValue = val < minValue ? val : minValue;
+			maxValue = val > maxValue ? val : maxValue;
+		}
+
+		double lutSize = (double)maxValue - (double)minValue + 1;
+		if (lutSize <= GRID_COLOR_LUT_MAX_SIZE && lutSize <= size)
+		{
+			lutBreaks.resize((size_t)lutSize);
+			lutColors.resize((size_t)lutSize);
+
+			for (size_t k = 0; k < lutBreaks.size(); k++)
+			{
+				float tmp = (float)(minValue + (DataType)k);
+				int index = tmp == noDataValue ? -1 : breakIndex.Find(tmp);
+				lutBreaks[k] = index;
+
+				if (index != -1 && HasPlainColor(bvals[index]))
+					SetBreakColor(bvals[index], tmp, &lutColors[k]);
+			}
+		}
+	}
+
+	const bool useLut = !lutBreaks.empty();
+
 	for (int i = 0; i < yBuff; i++)
 	{
+		const DataType* row = pafScanArea + i * xBuff;
+		colour* dst = (*ImageData) + i * xBuff;
+
 		for (int j = 0; j < xBuff; j++)
 		{
-			float tmp = (float)pafScanArea[i * xBuff + j];
+			float tmp = (float)row[j];
+			int index;
 
-			if (tmp == noDataValue)
+			if (useLut)
 			{
-				SetTransparentColor((*ImageData) + i * xBuff + j);
-				continue;
-			}
+				size_t k = (size_t)(row[j] - minValue);
+				index = lutBreaks[k];
 
-			const BreakVal* colorBreak = FindBreak(bvals, tmp);
+				if (index != -1 && HasPlainColor(bvals[index]))
+				{
+					dst[j].red = lutColors[k].red;
+					dst[j].green = lutColors[k].green;
+					dst[j].blue = lutColors[k].blue;
+					continue;
+				}
+			}
+			else
+			{
+				index = tmp == noDataValue ? -1 : breakIndex.Find(tmp);
+			}
 
-			if (colorBreak == nullptr) //A break is not defined for this value
+			if (index == -1) //A break is not defined for this value
 			{
-				SetTransparentColor((*ImageData) + i * xBuff + j);
+				SetTransparentColor(dst + j);
 				continue;
 			}
 
- 			OLE_COLOR hiColor = colorBreak->hiColor;
-			OLE_COLOR lowColor = colorBreak->lowColor;
+			const BreakVal& colorBreak = bvals[index];
+			if (colorBreak.colortype != Hillshade)
+			{
+				SetBreakColor(colorBreak, tmp, dst + j);
+				continue;
+			}
 
-			float hiVal = colorBreak->highVal;
-			float lowVal = colorBreak->lowVal;
-			float biRange = hiVal - lowVal;
-			if( biRange <= 0.0 )
-				biRange = 1.0;
+ 			OLE_COLOR hiColor = colorBreak.hiColor;
+			OLE_COLOR lowColor = colorBreak.lowColor;
 
-			ColoringType colortype = colorBreak->colortype;
-			GradientModel gradmodel = colorBreak->gradmodel;
-				
-			if (!_allowHillshade && colortype == Hillshade)
-				colortype = Gradient;
+			float yone = 0, ytwo = 0, ythree = 0;
 
-			if( colortype == Hillshade )
+			// Exclude the edges 
+			if (i == 0 || j == 0 || i == yBuff - 1 || j == xBuff - 1)
 			{
-				float yone = 0, ytwo = 0, ythree = 0;
-
-				// Exclude the edges 
-				if (i == 0 || j == 0 || i == yBuff - 1 || j == xBuff - 1)
-				{
-					// We are at the edge so write doDataValue and move on
-					yone = tmp;
-					ytwo = tmp;
-					ythree = tmp;
-				}
-				else
-				{
-					yone = tmp;
-					ytwo = (float)(pafScanArea[(i - 1) * xBuff + j + 1]);
-					ythree = (float)(pafScanArea[(i - 1) * xBuff + j]);
-				}
+				// We are at the edge so write doDataValue and move on
+				yone = tmp;
+				ytwo = tmp;
+				ythree = tmp;
+			}
+			else
+			{
+				yone = tmp;
+				ytwo = (float)(pafScanArea[(i - 1) * xBuff + j + 1]);
+				ythree = (float)(pafScanArea[(i - 1) * xBuff + j]);
+			}
 				
-				float xone = xll + csize * (i);
-				float xtwo = xone + csize;
-				float xthree = xone;
+			float xone = xll + csize * (i);
+			float xtwo = xone + csize;
+			float xthree = xone;
 					
-				float zone = yll + csize * j;
-				float ztwo = zone;
-				float zthree = zone - csize;
-
-				//check for nodata on triangle corners
-				if( yone == noDataValue || ytwo == noDataValue || ythree == noDataValue )
-				{	
-					SetTransparentColor((*ImageData) + i * xBuff + j);
-					continue;
-				}
-				
-				if (lowColor == hiColor)
-				{
-					(*ImageData)[i * xBuff + j].red = (unsigned char)(GetRValue(lowColor) % 256);
-					(*ImageData)[i * xBuff + j].green = (unsigned char)(GetGValue(lowColor) % 256);
-					(*ImageData)[i * xBuff + j].blue = (unsigned char)(GetBValue(lowColor) % 256);
-				}
-				else
-				{
-					//Make Two Vectors
-					cppVector one(
-						xone - xtwo,
-						yone - ytwo,
-						zone - ztwo );
-					cppVector two(
-						xone - xthree,
-						yone - ythree,
-						zone - zthree );
-						
-					//Compute Normal
-					cppVector normal = two.crossProduct( one );
-
-					//Compute I
-					double I = ai + li * lightSource.dot(normal);
-					if( I > 1.0 )
-						I = 1.0;
-
-					GradientPercent gradient = computeGradient(tmp, lowVal, biRange, gradmodel);
-
-					(*ImageData)[i * xBuff + j].red =  (unsigned char) (((double)GetRValue(lowColor)*gradient.left + (double)GetRValue(hiColor)*gradient.right )*I) %256;
-					(*ImageData)[i * xBuff + j].green = (unsigned char) (((double)GetGValue(lowColor)*gradient.left + (double)GetGValue(hiColor)*gradient.right )*I) %256;
-					(*ImageData)[i * xBuff + j].blue =  (unsigned char) (((double)GetBValue(lowColor)*gradient.left + (double)GetBValue(hiColor)*gradient.right )*I) %256;
-				}
+			float zone = yll + csize * j;
+			float ztwo = zone;
+			float zthree = zone - csize;
+
+			//check for nodata on triangle corners
+			if( yone == noDataValue || ytwo == noDataValue || ythree == noDataValue )
+			{	
+				SetTransparentColor(dst + j);
+				continue;
 			}
-			else if( colortype == Gradient )
+				
+			if (lowColor == hiColor)
 			{
-				GradientPercent gradient = computeGradient(tmp, lowVal, biRange, gradmodel);
-
-				(*ImageData)[i * xBuff + j].red = (int)((float)GetRValue(lowColor)*gradient.left + (float)GetRValue(hiColor)*gradient.right) % 256;
-				(*ImageData)[i * xBuff + j].green = (int)((float)GetGValue(lowColor)*gradient.left + (float)GetGValue(hiColor)*gradient.right) % 256;
-				(*ImageData)[i * xBuff + j].blue = (int)((float)GetBValue(lowColor)*gradient.left + (float)GetBValue(hiColor)*gradient.right) % 256;
+				dst[j].red = (unsigned char)(GetRValue(lowColor) % 256);
+				dst[j].green = (unsigned char)(GetGValue(lowColor) % 256);
+				dst[j].blue = (unsigned char)(GetBValue(lowColor) % 256);
+				continue;
 			}
-			else if( colortype == Random )
+
+			//Make Two Vectors
+			double i1 = xone - xtwo, j1 = yone - ytwo, k1 = zone - ztwo;
+			double i2 = xone - xthree, j2 = yone - ythree, k2 = zone - zthree;
+
+			//Compute Normal (the same as cppVector::crossProduct, without temporary objects)
+			double ni = j2 * k1 - k2 * j1;
+			double nj = k2 * i1 - i2 * k1;
+			double nk = i2 * j1 - j2 * i1;
+
+			double length = sqrt(ni * ni + nj * nj + nk * nk);
+			if (length > 0)
 			{
-				(*ImageData)[i * xBuff + j].red = GetRValue(lowColor);
-				(*ImageData)[i * xBuff + j].green = GetGValue(lowColor);
-				(*ImageData)[i * xBuff + j].blue = GetBValue(lowColor);
+				ni /= length;
+				nj /= length;
+				nk /= length;
 			}
+
+			//Compute I
+			double I = ai + li * (lsi * ni + lsj * nj + lsk * nk);
+			if( I > 1.0 )
+				I = 1.0;
+
+			float biRange = colorBreak.highVal - colorBreak.lowVal;
+			if( biRange <= 0.0 )
+				biRange = 1.0;
+
+			GradientPercent gradient = computeGradient(tmp, colorBreak.lowVal, biRange, colorBreak.gradmodel);
+
+			dst[j].red =  (unsigned char) (((double)GetRValue(lowColor)*gradient.left + (double)GetRValue(hiColor)*gradient.right )*I) %256;
+			dst[j].green = (unsigned char) (((double)GetGValue(lowColor)*gradient.left + (double)GetGValue(hiColor)*gradient.right )*I) %256;
+			dst[j].blue =  (unsigned char) (((double)GetBValue(lowColor)*gradient.left + (double)GetBValue(hiColor)*gradient.right )*I) %256;
 		} 
 	}
 	
@@ -1526,21 +1638,105 @@ bool GdalRaster::ReadBandDataAsGridCore(colour** ImageData, int xOff, int yOff,
 	return true;
 }
 
+// *************************************************************
+//	  HasPlainColor()
+// *************************************************************
+// The color doesn't depend on the neighbouring cells.
+inline bool GdalRaster::HasPlainColor(const BreakVal& colorBreak)
+{
+	return colorBreak.colortype == Gradient || colorBreak.colortype == Random;
+}
+
+// *************************************************************
+//	  SetBreakColor()
+// *************************************************************
+// The color of the value for gradient and random breaks; hillshading is calculated by the caller.
+void GdalRaster::SetBreakColor(const BreakVal& colorBreak, float val, colour* result)
+{
+	OLE_COLOR hiColor = colorBreak.hiColor;
+	OLE_COLOR lowColor = colorBreak.lowColor;
+
+	if (colorBreak.colortype == Gradient)
+	{
+		float biRange = colorBreak.highVal - colorBreak.lowVal;
+		if( biRange <= 0.0 )
+			biRange = 1.0;
+
+		GradientPercent gradient = computeGradient(val, colorBreak.lowVal, biRange, colorBreak.gradmodel);
+
+		result->red = (int)((float)GetRValue(lowColor)*gradient.left + (float)GetRValue(hiColor)*gradient.right) % 256;
+		result->green = (int)((float)GetGValue(lowColor)*gradient.left + (float)GetGValue(hiColor)*gradient.right) % 256;
+		result->blue = (int)((float)GetBValue(lowColor)*gradient.left + (float)GetBValue(hiColor)*gradient.right) % 256;
+	}
+	else if (colorBreak.colortype == Random)
+	{
+		result->red = GetRValue(lowColor);
+		result->green = GetGValue(lowColor);
+		result->blue = GetBValue(lowColor);
+	}
+}
 
 // *************************************************************
-//	  findBreak
+//	  BreakIndex::Build()
 // *************************************************************
-inline const GdalRaster::BreakVal* GdalRaster::FindBreak(const std::vector<BreakVal> & bvals, double val) const
+void GdalRaster::BreakIndex::Build(const std::vector<BreakVal>& bvals)
 {
-	register int sizeBVals = (int)bvals.size();
-	for(register int i = 0; i < sizeBVals; i++ )
-	{	
-		if( val >= bvals[i].lowVal &&
-			val <= bvals[i].highVal )
-			return &bvals[i];
+	bounds.clear();
+	atBound.clear();
+	afterBound.clear();
+
+	for (size_t i = 0; i < bvals.size(); i++)
+	{
+		bounds.push_back(bvals[i].lowVal);
+		bounds.push_back(bvals[i].highVal);
+	}
+
+	// NaN bounds match no values
+	bounds.erase(remove_if(bounds.begin(), bounds.end(), [](float v) { return v != v; }), bounds.end());
+	sort(bounds.begin(), bounds.end());
+	bounds.erase(unique(bounds.begin(), bounds.end()), bounds.end());
+
+	atBound.resize(bounds.size(), -1);
+	afterBound.resize(bounds.size(), -1);
+
+	for (size_t k = 0; k < bounds.size(); k++)
+	{
+		for (size_t i = 0; i < bvals.size(); i++)
+		{
+			if (bounds[k] >= bvals[i].lowVal && bounds[k] <= bvals[i].highVal)
+			{
+				atBound[k] = (int)i;
+				break;
+			}
+		}
+
+		if (k + 1 == bounds.size())
+			continue;
+
+		// the break contains the interval as a whole, since its bounds are among those of the breaks
+		for (size_t i = 0; i < bvals.size(); i++)
+		{
+			if (bounds[k] >= bvals[i].lowVal && bounds[k + 1] <= bvals[i].highVal)
+			{
+				afterBound[k] = (int)i;
+				break;
+			}
+		}
 	}
+}
+
+// *************************************************************
+//	  BreakIndex::Find()
+// *************************************************************
+int GdalRaster::BreakIndex::Find(float val) const
+{
+	// the first bound greater than the value
+	size_t k = upper_bound(bounds.begin(), bounds.end(), val) - bounds.begin();
+	if (k == 0 || val != val)
+		return -1;
 
-	return nullptr;
+	k--;
+	return bounds[k] == val ? atBound[k] : afterBound[k];
 }
 
 // *********************************************************
@@ -100,6 +100,22 @@ private:
 		}
 	};
 
+	// ***********************************************************
+	//		BreakIndex
+	// ***********************************************************
+	// Breaks of color scheme sorted for the binary search. The low and high values of all the breaks split 
+	// the axis into the bounds themselves and the open intervals between them; for each of those the first break
+	// containing it is stored, so a value gets the same break as with the linear search through the list.
+	struct BreakIndex
+	{
+		std::vector<float> bounds;		// distinct low and high values of the breaks, ascending
+		std::vector<int> atBound;		// the break for the value equal to the bound, -1 if there is none
+		std::vector<int> afterBound;	// the break for the values between the bound and the next one
+
+		void Build(const std::vector<BreakVal>& bvals);
+		int Find(float val) const;
+	};
+
 	struct BandMinMax
 	{
 		BandMinMax() {
@@ -200,7 +216,8 @@ private:
 	void ComputeBandMinMax(GDALRasterBand* band, BandMinMax& minMax, bool force);
 	void GDALColorEntry2Colour(int band, double colorValue, double shift, double range, double noDataValue, const GDALColorEntry * poCE, bool useHistogram, colour* result);
 	bool ComputeHistogramCore(double **ppadfScaleMin, double **ppadfScaleMax, int ***ppapanLUTs);
-	const BreakVal* FindBreak(const std::vector<BreakVal> & bvals, double val) const;
+	static void SetBreakColor(const BreakVal& colorBreak, float val, colour* result);
+	static bool HasPlainColor(const BreakVal& colorBreak);
 
 	template <typename T> 
 	bool GdalBufferToMemoryBuffer(colour ** dst, T* src, int xBuff, int yBuff, 
@@ -17,6 +17,7 @@
 #include "MercatorProjection.h"
 #include "PrefetchManager.h"
 #include "TileCacheManager.h"
+#include "ParallelHelper.h"
 
 class CMapWinGISModule :
     public ATL::CAtlMfcModule
@@ -113,6 +114,8 @@ int CMapWinGISApp::ExitInstance()
 
     PrefetchManagerFactory::Clear();
 
+    ParallelHelper::ShutdownPool();
+
     parser::ReleaseFunctions();
 
     //CMapView::GdiplusShutdown(); // moved back to CMapView destructor
@@ -22,6 +22,13 @@
 #include "GeosConverter.h"
 #include "GeosHelper.h"
 #include "OgrConverter.h"
+#include "Shape.h"
+#include "ShapeUtility.h"
+#include "ParallelHelper.h"
+#include <algorithm>
+
+// maximum number of entries in a node of STR tree, which determines the number of slices
+#define GEOS_UNION_NODE_CAPACITY 16
 
 // ReSharper disable CppUseAuto
 
@@ -89,10 +96,10 @@ bool GeosConverter::GeomToShapes(GEOSGeom gsGeom, vector<IShape*>* vShapes, bool
 }
 
 // *********************************************************************
-//			Shape2GEOSGeom()
+//			ShapeToGeomOgr()
 // *********************************************************************
-//  Converts MapWinGis shape to GEOS geometry
-GEOSGeom GeosConverter::ShapeToGeom(IShape* shp)
+//  Converts MapWinGis shape to GEOS geometry through OGR geometry
+static GEOSGeom ShapeToGeomOgr(IShape* shp)
 {
 	OGRGeometry* const oGeom = OgrConverter::ShapeToGeometry(shp);
 	if (oGeom != nullptr)
@@ -104,6 +111,494 @@ GEOSGeom GeosConverter::ShapeToGeom(IShape* shp)
     return nullptr;
 }
 
+// *********************************************************************
+//			Shape2GEOSGeom()
+// *********************************************************************
+//  Converts MapWinGis shape to GEOS geometry. Coordinates are passed to GEOS directly; 
+//  the shapes which can't be converted this way in the same manner as OGR does it 
+//  (empty shapes, rings which aren't closed, etc.) are converted through OGR geometry.
+GEOSGeom GeosConverter::ShapeToGeom(IShape* shp)
+{
+#ifdef GEOS_NEW
+	GeosShapeData data;
+	if (ReadShapeData(shp, data))
+	{
+		GEOSGeometry* const result = ShapeDataToGeom(getGeosHandle(), data);
+		if (result)
+			return result;
+	}
+#endif
+	return ShapeToGeomOgr(shp);
+}
+
+// *********************************************************************
+//			ShapesToGeoms()
+// *********************************************************************
+// Coordinates are read in the calling thread, while the conversion is shared between the threads 
+// of the pool, each with its own GEOS context. The resulting geometries can be used with any context.
+void GeosConverter::ShapesToGeoms(vector<IShape*>& shapes, vector<GEOSGeometry*>& geoms)
+{
+	const int count = (int)shapes.size();
+	geoms.assign(count, nullptr);
+
+#ifdef GEOS_NEW
+	vector<GeosShapeData> data(count);
+	vector<char> read(count, 0);
+	for (int i = 0; i < count; i++)
+	{
+		read[i] = ReadShapeData(shapes[i], data[i]) ? 1 : 0;
+	}
+
+	auto convert = [&](int begin, int end)
+	{
+		GEOSContextHandle_t handle = OGRGeometry::createGEOSContext();
+		for (int i = begin; i < end; i++)
+		{
+			if (read[i])
+				geoms[i] = ShapeDataToGeom(handle, data[i]);
+		}
+		OGRGeometry::freeGEOSContext(handle);
+	};
+
+	ParallelHelper::For(count, 0, convert, 64);
+#endif
+
+	for (int i = 0; i < count; i++)
+	{
+		if (!geoms[i] && shapes[i])
+			geoms[i] = ShapeToGeomOgr(shapes[i]);
+	}
+}
+
+// *********************************************************************
+//			ReadShapeData()
+// *********************************************************************
+bool GeosConverter::ReadShapeData(IShape* shp, GeosShapeData& data)
+{
+	if (!shp)
+		return false;
+
+	IShapeWrapper* wrapper = ((CShape*)shp)->get_ShapeWrapper();
+	if (!wrapper)
+		return false;
+
+	data.shapeType = wrapper->get_ShapeType();
+	const bool isM = ShapeUtility::IsM(data.shapeType);
+	data.dimension = isM || ShapeUtility::IsZ(data.shapeType) ? 3 : 2;
+
+	const int numPoints = wrapper->get_PointCount();
+	data.xy.resize(numPoints * 2);
+	data.z.resize(data.dimension == 3 ? numPoints : 0);
+
+	for (int i = 0; i < numPoints; i++)
+	{
+		wrapper->get_PointXY(i, data.xy[i * 2], data.xy[i * 2 + 1]);
+
+		if (data.dimension == 3)
+		{
+			double z = 0.0;
+			if (isM)
+				wrapper->get_PointM(i, z);
+			else
+				wrapper->get_PointZ(i, z);
+			data.z[i] = z;
+		}
+	}
+
+	const int numParts = wrapper->get_PartCount();
+	data.parts.resize(numParts);
+	for (int j = 0; j < numParts; j++)
+	{
+		data.parts[j] = wrapper->get_PartStartPoint(j);
+	}
+	return true;
+}
+
+#ifdef GEOS_NEW
+
+// Outer ring or hole of polygon.
+struct GeosRingInfo
+{
+	int first;
+	int last;
+	double area;
+	bool clockwise;
+	double xMin;
+	double yMin;
+	double xMax;
+	double yMax;
+	double x;			// a point of ring, not on its bounds if possible
+	double y;
+	int enclosing;		// the outer ring a hole belongs to, -1 for outer rings
+};
+
+// *********************************************************************
+//			GetPartRange()
+// *********************************************************************
+static bool GetPartRange(const GeosShapeData& data, int partIndex, int& first, int& last)
+{
+	const int numPoints = (int)data.xy.size() / 2;
+	const int numParts = (int)data.parts.size();
+
+	first = data.parts[partIndex];
+	last = partIndex == numParts - 1 ? numPoints - 1 : data.parts[partIndex + 1] - 1;
+	return first >= 0 && first <= last && last < numPoints;
+}
+
+// *********************************************************************
+//			IsClosedRing()
+// *********************************************************************
+// GEOS rejects the rings with less than 4 points or different first and last points
+static bool IsClosedRing(const GeosShapeData& data, int first, int last)
+{
+	return last - first >= 3 && 
+		   data.xy[first * 2] == data.xy[last * 2] && 
+		   data.xy[first * 2 + 1] == data.xy[last * 2 + 1];
+}
+
+// *********************************************************************
+//			CreateSequence()
+// *********************************************************************
+static GEOSCoordSequence* CreateSequence(GEOSContextHandle_t handle, const GeosShapeData& data, int first, int last)
+{
+	GEOSCoordSequence* seq = GEOSCoordSeq_create_r(handle, last - first + 1, data.dimension);
+	if (!seq)
+		return nullptr;
+
+	for (int i = first; i <= last; i++)
+	{
+		const unsigned int index = i - first;
+		GEOSCoordSeq_setX_r(handle, seq, index, data.xy[i * 2]);
+		GEOSCoordSeq_setY_r(handle, seq, index, data.xy[i * 2 + 1]);
+		if (data.dimension == 3)
+			GEOSCoordSeq_setZ_r(handle, seq, index, data.z[i]);
+	}
+	return seq;
+}
+
+// *********************************************************************
+//			CreateLineString()
+// *********************************************************************
+static GEOSGeometry* CreateLineString(GEOSContextHandle_t handle, const GeosShapeData& data, int first, int last)
+{
+	// GEOS rejects lines with a single point
+	if (last - first < 1)
+		return nullptr;
+
+	GEOSCoordSequence* seq = CreateSequence(handle, data, first, last);
+	return seq ? GEOSGeom_createLineString_r(handle, seq) : nullptr;
+}
+
+// *********************************************************************
+//			CreateRing()
+// *********************************************************************
+static GEOSGeometry* CreateRing(GEOSContextHandle_t handle, const GeosShapeData& data, int first, int last)
+{
+	if (!IsClosedRing(data, first, last))
+		return nullptr;
+
+	GEOSCoordSequence* seq = CreateSequence(handle, data, first, last);
+	return seq ? GEOSGeom_createLinearRing_r(handle, seq) : nullptr;
+}
+
+// *********************************************************************
+//			DestroyGeometries()
+// *********************************************************************
+static void DestroyGeometries(GEOSContextHandle_t handle, vector<GEOSGeometry*>& geoms)
+{
+	for (size_t i = 0; i < geoms.size(); i++)
+	{
+		if (geoms[i])
+			GEOSGeom_destroy_r(handle, geoms[i]);
+	}
+	geoms.clear();
+}
+
+// *********************************************************************
+//			CreateCollection()
+// *********************************************************************
+// Takes ownership of geometries; returns NULL if any of them is missing.
+static GEOSGeometry* CreateCollection(GEOSContextHandle_t handle, int type, vector<GEOSGeometry*>& geoms)
+{
+	for (size_t i = 0; i < geoms.size(); i++)
+	{
+		if (!geoms[i])
+		{
+			DestroyGeometries(handle, geoms);
+			return nullptr;
+		}
+	}
+
+	if (geoms.empty())
+		return nullptr;
+
+	return GEOSGeom_createCollection_r(handle, type, &geoms[0], (unsigned int)geoms.size());
+}
+
+// *********************************************************************
+//			CreatePolygon()
+// *********************************************************************
+static GEOSGeometry* CreatePolygon(GEOSContextHandle_t handle, GEOSGeometry* shell, vector<GEOSGeometry*>& holes)
+{
+	for (size_t i = 0; i < holes.size(); i++)
+	{
+		if (!holes[i])
+		{
+			GEOSGeom_destroy_r(handle, shell);
+			DestroyGeometries(handle, holes);
+			return nullptr;
+		}
+	}
+
+	return GEOSGeom_createPolygon_r(handle, shell, holes.empty() ? nullptr : &holes[0], (unsigned int)holes.size());
+}
+
+// *********************************************************************
+//			InitRing()
+// *********************************************************************
+static void InitRing(const GeosShapeData& data, GeosRingInfo& ring)
+{
+	const double* xy = &data.xy[0];
+
+	ring.xMin = ring.xMax = xy[ring.first * 2];
+	ring.yMin = ring.yMax = xy[ring.first * 2 + 1];
+
+	double area = 0.0;
+	for (int i = ring.first; i < ring.last; i++)
+	{
+		const double x1 = xy[i * 2], y1 = xy[i * 2 + 1];
+		const double x2 = xy[i * 2 + 2], y2 = xy[i * 2 + 3];
+		area += x1 * y2 - x2 * y1;
+
+		ring.xMin = MIN(ring.xMin, x2);
+		ring.xMax = MAX(ring.xMax, x2);
+		ring.yMin = MIN(ring.yMin, y2);
+		ring.yMax = MAX(ring.yMax, y2);
+	}
+
+	ring.area = fabs(area / 2.0);
+	ring.clockwise = area < 0.0;
+	ring.enclosing = -1;
+
+	ring.x = xy[ring.first * 2];
+	ring.y = xy[ring.first * 2 + 1];
+	for (int i = ring.first; i <= ring.last; i++)
+	{
+		const double x = xy[i * 2], y = xy[i * 2 + 1];
+		if (x != ring.xMin && x != ring.xMax && y != ring.yMin && y != ring.yMax)
+		{
+			ring.x = x;
+			ring.y = y;
+			break;
+		}
+	}
+}
+
+// *********************************************************************
+//			PointOnRingBoundary()
+// *********************************************************************
+static bool PointOnRingBoundary(const GeosShapeData& data, const GeosRingInfo& ring, double x, double y)
+{
+	const double* xy = &data.xy[0];
+	for (int i = ring.first; i < ring.last; i++)
+	{
+		const double x1 = xy[i * 2], y1 = xy[i * 2 + 1];
+		const double x2 = xy[i * 2 + 2], y2 = xy[i * 2 + 3];
+
+		if (x < MIN(x1, x2) || x > MAX(x1, x2) || y < MIN(y1, y2) || y > MAX(y1, y2))
+			continue;
+
+		if ((x - x1) * (y2 - y1) == (y - y1) * (x2 - x1))
+			return true;
+	}
+	return false;
+}
+
+// *********************************************************************
+//			PointInRing()
+// *********************************************************************
+// The same crossing rule as that of OGRLinearRing::isPointInRing.
+static bool PointInRing(const GeosShapeData& data, const GeosRingInfo& ring, double x, double y)
+{
+	const double* xy = &data.xy[0];
+	int numCrossings = 0;
+
+	for (int i = ring.first; i <= ring.last; i++)
+	{
+		const int prev = i == ring.first ? ring.last : i - 1;
+		const double x1 = xy[i * 2] - x, y1 = xy[i * 2 + 1] - y;
+		const double x2 = xy[prev * 2] - x, y2 = xy[prev * 2 + 1] - y;
+
+		if ((y1 > 0 && y2 <= 0) || (y2 > 0 && y1 <= 0))
+		{
+			if ((x1 * y2 - x2 * y1) / (y2 - y1) > 0.0)
+				numCrossings++;
+		}
+	}
+	return numCrossings % 2 == 1;
+}
+
+// *********************************************************************
+//			RingWithinRing()
+// *********************************************************************
+static bool RingWithinRing(const GeosShapeData& data, const GeosRingInfo& inner, const GeosRingInfo& outer)
+{
+	if (!PointOnRingBoundary(data, outer, inner.x, inner.y))
+		return PointInRing(data, outer, inner.x, inner.y);
+
+	// the first point which isn't on the boundary decides
+	for (int i = inner.first; i <= inner.last; i++)
+	{
+		const double x = data.xy[i * 2], y = data.xy[i * 2 + 1];
+		if (!PointOnRingBoundary(data, outer, x, y))
+			return PointInRing(data, outer, x, y);
+	}
+	return false;
+}
+
+// *********************************************************************
+//			CreateMultiPartPolygon()
+// *********************************************************************
+// Rings are organized as OGRGeometryFactory::organizePolygons does it with METHOD=ONLY_CCW: 
+// clockwise rings are outer ones, a counter-clockwise ring is a hole of the smallest clockwise ring 
+// which contains it (or of the largest ring if its extents contain the ring), otherwise it's an outer ring as well. 
+// The largest ring is always an outer one. Rings are taken by decreasing area.
+static GEOSGeometry* CreateMultiPartPolygon(GEOSContextHandle_t handle, const GeosShapeData& data)
+{
+	const int numParts = (int)data.parts.size();
+
+	vector<GeosRingInfo> rings(numParts);
+	for (int j = 0; j < numParts; j++)
+	{
+		GeosRingInfo& ring = rings[j];
+		if (!GetPartRange(data, j, ring.first, ring.last) || !IsClosedRing(data, ring.first, ring.last))
+			return nullptr;
+
+		InitRing(data, ring);
+	}
+
+	std::stable_sort(rings.begin(), rings.end(), [](const GeosRingInfo& a, const GeosRingInfo& b) { return a.area > b.area; });
+
+	int numOuter = 1;
+	for (int i = 1; i < numParts; i++)
+	{
+		GeosRingInfo& ring = rings[i];
+		if (ring.clockwise)
+		{
+			numOuter++;
+			continue;
+		}
+
+		for (int j = i - 1; j >= 0; j--)
+		{
+			const GeosRingInfo& outer = rings[j];
+			if (!outer.clockwise)
+				continue;
+
+			if (outer.xMin > ring.xMin || outer.yMin > ring.yMin || outer.xMax < ring.xMax || outer.yMax < ring.yMax)
+				continue;
+
+			if (j == 0 || RingWithinRing(data, ring, outer))
+			{
+				ring.enclosing = j;
+				break;
+			}
+		}
+
+		if (ring.enclosing == -1)
+			numOuter++;
+	}
+
+	vector<GEOSGeometry*> polygons;
+	for (int j = 0; j < numParts; j++)
+	{
+		if (rings[j].enclosing != -1)
+			continue;
+
+		GEOSGeometry* shell = CreateRing(handle, data, rings[j].first, rings[j].last);
+		if (!shell)
+		{
+			DestroyGeometries(handle, polygons);
+			return nullptr;
+		}
+
+		vector<GEOSGeometry*> holes;
+		for (int i = j + 1; i < numParts; i++)
+		{
+			if (rings[i].enclosing == j)
+				holes.push_back(CreateRing(handle, data, rings[i].first, rings[i].last));
+		}
+
+		polygons.push_back(CreatePolygon(handle, shell, holes));
+	}
+
+	if (numOuter == 1)
+		return polygons[0];
+
+	return CreateCollection(handle, GEOS_MULTIPOLYGON, polygons);
+}
+
+// *********************************************************************
+//			ShapeDataToGeom()
+// *********************************************************************
+// Returns NULL for the shapes which should be converted through OGR.
+GEOSGeometry* GeosConverter::ShapeDataToGeom(GEOSContextHandle_t handle, const GeosShapeData& data)
+{
+	const int numPoints = (int)data.xy.size() / 2;
+	const int numParts = (int)data.parts.size();
+
+	if (numPoints == 0)
+		return nullptr;
+
+	switch (ShapeUtility::Convert2D(data.shapeType))
+	{
+		case SHP_POINT:
+		{
+			GEOSCoordSequence* seq = CreateSequence(handle, data, 0, 0);
+			return seq ? GEOSGeom_createPoint_r(handle, seq) : nullptr;
+		}
+		case SHP_MULTIPOINT:
+		{
+			vector<GEOSGeometry*> points;
+			for (int i = 0; i < numPoints; i++)
+			{
+				GEOSCoordSequence* seq = CreateSequence(handle, data, i, i);
+				points.push_back(seq ? GEOSGeom_createPoint_r(handle, seq) : nullptr);
+			}
+			return CreateCollection(handle, GEOS_MULTIPOINT, points);
+		}
+		case SHP_POLYLINE:
+		{
+			if (numParts <= 1)
+				return CreateLineString(handle, data, 0, numPoints - 1);
+
+			vector<GEOSGeometry*> lines;
+			for (int j = 0; j < numParts; j++)
+			{
+				int first, last;
+				lines.push_back(GetPartRange(data, j, first, last) ? CreateLineString(handle, data, first, last) : nullptr);
+			}
+			return CreateCollection(handle, GEOS_MULTILINESTRING, lines);
+		}
+		case SHP_POLYGON:
+		{
+			if (numParts > 1)
+				return CreateMultiPartPolygon(handle, data);
+
+			GEOSGeometry* shell = CreateRing(handle, data, 0, numPoints - 1);
+			if (!shell)
+				return nullptr;
+
+			vector<GEOSGeometry*> holes;
+			return CreatePolygon(handle, shell, holes);
+		}
+		default:
+			return nullptr;
+	}
+}
+
+#endif
+
 // *****************************************************
 //		SimplifyPolygon()
 // *****************************************************
@@ -196,16 +691,191 @@ void GeosConverter::NormalizeSplitResults(GEOSGeometry* result, GEOSGeometry* su
 	}
 }
 
-// ********************************************************************
-//		MergeGeosGeometries
-// ********************************************************************
-// Returns GEOS geometry which is result of the union operation for the geometries passed
-GEOSGeometry* GeosConverter::MergeGeometries(vector<GEOSGeometry*>& data, ICallback* callback, bool deleteInput /*= true*/, bool displayProgress /*= true*/)
+#ifdef GEOS_NEW
+
+// A geometry to be united with its neighbours.
+struct GeosUnionItem
 {
-	if (data.empty())
+	GEOSGeometry* geom;
+	bool owned;			// interim results and input geometries which may be deleted
+	double x;			// centre of bounds
+	double y;
+};
+
+// *********************************************************************
+//			ForEachRange()
+// *********************************************************************
+// Calls func(handle, begin, end) for [0, count) either in the calling thread with the given context
+// or in the threads of pool, with a context of its own for each chunk.
+template <typename Func>
+static void ForEachRange(GEOSContextHandle_t handle, bool parallel, int count, int minChunkSize, Func& func)
+{
+	if (!parallel)
+	{
+		func(handle, 0, count);
+		return;
+	}
+
+	auto run = [&](int begin, int end)
+	{
+		GEOSContextHandle_t context = OGRGeometry::createGEOSContext();
+		func(context, begin, end);
+		OGRGeometry::freeGEOSContext(context);
+	};
+
+	ParallelHelper::For(count, 0, run, minChunkSize);
+}
+
+// *********************************************************************
+//			GetCenter()
+// *********************************************************************
+static void GetCenter(GEOSContextHandle_t handle, const GEOSGeometry* geom, double& x, double& y)
+{
+	x = y = 0.0;
+
+	GEOSGeometry* envelope = GEOSEnvelope_r(handle, geom);
+	if (!envelope)
+		return;
+
+	// it's a point for a single point, and a rectangle otherwise
+	const GEOSGeometry* shell = GEOSGeomTypeId_r(handle, envelope) == GEOS_POLYGON ? GEOSGetExteriorRing_r(handle, envelope) : envelope;
+	const GEOSCoordSequence* seq = shell ? GEOSGeom_getCoordSeq_r(handle, shell) : nullptr;
+
+	unsigned int size = 0;
+	if (seq && GEOSCoordSeq_getSize_r(handle, seq, &size) && size > 0)
+	{
+		double xMin = DBL_MAX, yMin = DBL_MAX, xMax = -DBL_MAX, yMax = -DBL_MAX;
+		for (unsigned int i = 0; i < size; i++)
+		{
+			double px = 0.0, py = 0.0;
+			GEOSCoordSeq_getX_r(handle, seq, i, &px);
+			GEOSCoordSeq_getY_r(handle, seq, i, &py);
+			xMin = MIN(xMin, px);
+			xMax = MAX(xMax, px);
+			yMin = MIN(yMin, py);
+			yMax = MAX(yMax, py);
+		}
+		x = (xMin + xMax) / 2.0;
+		y = (yMin + yMax) / 2.0;
+	}
+
+	GEOSGeom_destroy_r(handle, envelope);
+}
+
+// *********************************************************************
+//			SortSTR()
+// *********************************************************************
+// Orders items as the leaves of STR tree: vertical slices by x, each of them by y. Every other slice
+// goes downwards, so that the last item of a slice is close to the first item of the next one.
+static void SortSTR(vector<GeosUnionItem>& items)
+{
+	std::sort(items.begin(), items.end(), [](const GeosUnionItem& a, const GeosUnionItem& b) { return a.x < b.x; });
+
+	const size_t size = items.size();
+	const size_t numSlices = MAX((size_t)1, (size_t)ceil(sqrt((double)size / GEOS_UNION_NODE_CAPACITY)));
+	const size_t sliceSize = (size + numSlices - 1) / numSlices;
+
+	for (size_t first = 0, slice = 0; first < size; first += sliceSize, slice++)
+	{
+		const vector<GeosUnionItem>::iterator begin = items.begin() + first;
+		const vector<GeosUnionItem>::iterator end = items.begin() + MIN(first + sliceSize, size);
+
+		if (slice % 2 == 0)
+			std::sort(begin, end, [](const GeosUnionItem& a, const GeosUnionItem& b) { return a.y < b.y; });
+		else
+			std::sort(begin, end, [](const GeosUnionItem& a, const GeosUnionItem& b) { return a.y > b.y; });
+	}
+}
+
+// *********************************************************************
+//			CascadedUnion()
+// *********************************************************************
+// Geometries in STR order are united pairwise, level after level, so that each union joins neighbouring
+// geometries of about the same size. As before, geometries for which the union fails are dropped.
+static GEOSGeometry* CascadedUnion(GEOSContextHandle_t handle, vector<GEOSGeometry*>& data, bool deleteInput, bool parallel,
+								   ICallback* callback, bool displayProgress)
+{
+	vector<GeosUnionItem> items;
+	items.reserve(data.size());
+
+	for (size_t i = 0; i < data.size(); i++)
+	{
+		if (!data[i])
+			continue;
+
+		GeosUnionItem item = { data[i], deleteInput, 0.0, 0.0 };
+		items.push_back(item);
+
+		if (deleteInput)
+			data[i] = nullptr;
+	}
+
+	auto locate = [&](GEOSContextHandle_t context, int begin, int end)
+	{
+		for (int i = begin; i < end; i++)
+		{
+			GetCenter(context, items[i].geom, items[i].x, items[i].y);
+		}
+	};
+
+	ForEachRange(handle, parallel, (int)items.size(), 1024, locate);
+	SortSTR(items);
+
+	const int numUnions = (int)items.size() - 1;
+	int count = 0;
+	long percent = 0;
+	vector<GeosUnionItem> next;
+
+	while (items.size() > 1)
+	{
+		const int numPairs = (int)items.size() / 2;
+		next.resize((items.size() + 1) / 2);
+
+		auto unite = [&](GEOSContextHandle_t context, int begin, int end)
+		{
+			for (int i = begin; i < end; i++)
+			{
+				const GeosUnionItem& item1 = items[i * 2];
+				const GeosUnionItem& item2 = items[i * 2 + 1];
+
+				GeosUnionItem result = { GEOSUnion_r(context, item1.geom, item2.geom), true, 0.0, 0.0 };
+				next[i] = result;
+
+				if (item1.owned)
+					GEOSGeom_destroy_r(context, item1.geom);
+				if (item2.owned)
+					GEOSGeom_destroy_r(context, item2.geom);
+			}
+		};
+
+		ForEachRange(handle, parallel, numPairs, 1, unite);
+
+		if (items.size() % 2 == 1)
+			next.back() = items.back();
+
+		next.erase(std::remove_if(next.begin(), next.end(), [](const GeosUnionItem& item) { return item.geom == nullptr; }), next.end());
+		items.swap(next);
+
+		count += numPairs;
+		if (displayProgress)
+			CallbackHelper::Progress(callback, count, numUnions, "Merging shapes...", percent);
+	}
+
+	if (items.empty())
 		return nullptr;
 
-	USES_CONVERSION;
+	// a single input geometry must be cloned to leave the input intact
+	return items[0].owned ? items[0].geom : GEOSGeom_clone_r(handle, items[0].geom);
+}
+
+#else
+
+// *********************************************************************
+//			MergeGeometriesLinear()
+// *********************************************************************
+// Unites the geometries in linear passes.
+static GEOSGeometry* MergeGeometriesLinear(vector<GEOSGeometry*>& data, ICallback* callback, bool deleteInput, bool displayProgress)
+{
 	GEOSGeometry* g1 = nullptr;
 	GEOSGeometry* g2 = nullptr;
 
@@ -216,15 +886,6 @@ GEOSGeometry* GeosConverter::MergeGeometries(vector<GEOSGeometry*>& data, ICallb
     const int size = data.size();
 	int depth = 0;
 
-	if (size == 1)
-	{
-		// no need for calculation
-		if (deleteInput)
-			return data[0];	 // no need to clone; it will be exactly the same
-	    GEOSGeometry* geomTemp = GeosHelper::CloneGeometry(data[0]);
-	    return geomTemp;
-	}
-
 	while (!stop)
 	{
 		stop = true;
@@ -281,4 +942,127 @@ GEOSGeometry* GeosConverter::MergeGeometries(vector<GEOSGeometry*>& data, ICallb
 	return g1;
 }
 
+#endif
+
+// ********************************************************************
+//		MergeGeosGeometries
+// ********************************************************************
+// Returns GEOS geometry which is result of the union operation for the geometries passed.
+// The unions are shared between the threads of pool when there are enough geometries.
+GEOSGeometry* GeosConverter::MergeGeometries(vector<GEOSGeometry*>& data, ICallback* callback, bool deleteInput /*= true*/, bool displayProgress /*= true*/)
+{
+	if (data.empty())
+		return nullptr;
+
+    const int size = data.size();
+
+	if (size == 1)
+	{
+		// no need for calculation
+		if (deleteInput)
+			return data[0];	 // no need to clone; it will be exactly the same
+	    GEOSGeometry* geomTemp = GeosHelper::CloneGeometry(data[0]);
+	    return geomTemp;
+	}
+
+#ifdef GEOS_NEW
+	return CascadedUnion(getGeosHandle(), data, deleteInput, size >= GEOS_UNION_MIN_PARALLEL_SIZE, callback, displayProgress);
+#else
+	return MergeGeometriesLinear(data, callback, deleteInput, displayProgress);
+#endif
+}
+
+// ********************************************************************
+//		MergeGeometries
+// ********************************************************************
+// The same using the given context in the calling thread, so that it can be called from the threads of pool.
+GEOSGeometry* GeosConverter::MergeGeometries(GEOSContextHandle_t handle, vector<GEOSGeometry*>& data, bool deleteInput)
+{
+	if (data.empty())
+		return nullptr;
+
+#ifdef GEOS_NEW
+	return CascadedUnion(handle, data, deleteInput, false, nullptr, false);
+#else
+	if (data.size() == 1)
+		return deleteInput ? data[0] : GeosHelper::CloneGeometry(data[0]);
+
+	return MergeGeometriesLinear(data, nullptr, deleteInput, false);
+#endif
+}
+
+// ********************************************************************
+//		CacheEnvelopes
+// ********************************************************************
+// GEOS calculates the envelope of geometry (and of each of its parts and rings) on the first use and caches it;
+// it's done beforehand for the geometries which are going to be read from several threads at once.
+void GeosConverter::CacheEnvelopes(GEOSGeometry* gsGeom)
+{
+	if (!gsGeom)
+		return;
+
+	GEOSGeometry* envelope = GeosHelper::Envelope(gsGeom);
+	if (envelope)
+		GeosHelper::DestroyGeometry(envelope);
+
+	const int type = GeosHelper::GetGeometryTypeId(gsGeom);
+	if (type == GEOS_POLYGON)
+	{
+		CacheEnvelopes((GEOSGeometry*)GeosHelper::GetExteriorRing(gsGeom));
+
+		const int numRings = GeosHelper::GetNumInteriorRings(gsGeom);
+		for (int i = 0; i < numRings; i++)
+		{
+			CacheEnvelopes((GEOSGeometry*)GeosHelper::GetInteriorRingN(gsGeom, i));
+		}
+	}
+	else if (type == GEOS_MULTIPOINT || type == GEOS_MULTILINESTRING || type == GEOS_MULTIPOLYGON || type == GEOS_GEOMETRYCOLLECTION)
+	{
+		const int numGeometries = GeosHelper::GetNumGeometries(gsGeom);
+		for (int i = 0; i < numGeometries; i++)
+		{
+			CacheEnvelopes((GEOSGeometry*)GeosHelper::GetGeometryN(gsGeom, i));
+		}
+	}
+}
+
+// ********************************************************************
+//		MergeGeometryGroups
+// ********************************************************************
+// Merges each group of geometries, which are left intact. Small groups are shared between the threads 
+// of pool, each of them merged in a single thread; large ones are merged one after another, 
+// with the unions of each of them shared between the threads.
+void GeosConverter::MergeGeometryGroups(vector<vector<GEOSGeometry*>*>& groups, vector<GEOSGeometry*>& results, ICallback* callback, BSTR& key)
+{
+	const int size = (int)groups.size();
+	results.assign(size, nullptr);
+
+#ifdef GEOS_NEW
+	auto mergeSmall = [&](int begin, int end)
+	{
+		GEOSContextHandle_t handle = OGRGeometry::createGEOSContext();
+		for (int i = begin; i < end; i++)
+		{
+			if ((int)groups[i]->size() < GEOS_UNION_MIN_PARALLEL_SIZE)
+				results[i] = MergeGeometries(handle, *groups[i], false);
+		}
+		OGRGeometry::freeGEOSContext(handle);
+	};
+
+	ParallelHelper::For(size, 0, mergeSmall, 16);
+#endif
+
+	long percent = 0;
+	for (int i = 0; i < size; i++)
+	{
+		CallbackHelper::Progress(callback, i, size, "Merging shapes...", key, percent);
+
+#ifdef GEOS_NEW
+		if ((int)groups[i]->size() < GEOS_UNION_MIN_PARALLEL_SIZE)
+			continue;
+#endif
+		results[i] = MergeGeometries(*groups[i], nullptr, false, false);
+	}
+}
+
 // ReSharper restore CppUseAuto
\ No newline at end of file
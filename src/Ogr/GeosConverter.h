@@ -1,11 +1,34 @@
 #pragma once
+
+// Coordinates of a shape copied from its wrapper, so that it can be converted to GEOS
+// geometry in any thread, without calls to COM objects.
+struct GeosShapeData
+{
+	ShpfileType shapeType;
+	int dimension;			// 3 for Z and M types; M values are stored as Z, as OGR conversion does
+	vector<double> xy;		// pairs of x, y
+	vector<double> z;
+	vector<int> parts;		// the first points of parts
+};
+
+// geometries are united in the threads of pool when there are at least that many of them
+#define GEOS_UNION_MIN_PARALLEL_SIZE 256
+
 class GeosConverter
 {
 public:
 	static bool GeomToShapes(GEOSGeom gsGeom, vector<IShape*>* vShapes, bool isM);
 	static GEOSGeom ShapeToGeom(IShape* shp);
+	static void ShapesToGeoms(vector<IShape*>& shapes, vector<GEOSGeometry*>& geoms);
+	static bool ReadShapeData(IShape* shp, GeosShapeData& data);
+#ifdef GEOS_NEW
+	static GEOSGeometry* ShapeDataToGeom(GEOSContextHandle_t handle, const GeosShapeData& data);
+#endif
+	static GEOSGeometry* MergeGeometries(GEOSContextHandle_t handle, vector<GEOSGeometry*>& data, bool deleteInput);
 	static GEOSGeometry* MergeGeometries(vector<GEOSGeometry*>& data, ICallback* callback, bool deleteInput = true, bool displayProgress = true);
+	static void MergeGeometryGroups(vector<vector<GEOSGeometry*>*>& groups, vector<GEOSGeometry*>& results, ICallback* callback, BSTR& key);
 	static GEOSGeometry* SimplifyPolygon(const GEOSGeometry *gsGeom, double tolerance);
+	static void CacheEnvelopes(GEOSGeometry* gsGeom);
 	static void NormalizeSplitResults(GEOSGeometry* result, GEOSGeometry* subject, ShpfileType shpType,	vector<GEOSGeometry*>& results);
 };
 
@@ -41,6 +41,15 @@ public:
 		#endif
 	}
 
+	static GEOSGeometry* Envelope(const GEOSGeometry* g)
+	{
+		#ifdef GEOS_NEW
+			return GEOSEnvelope_r(getGeosHandle(), g);
+		#else
+			return GEOSEnvelope(g);
+		#endif
+	}
+
 	static int BufferParams_setEndCapStyle(GEOSBufferParams* p, tkBufferCap style)
 	{
 		#ifdef GEOS_NEW
@@ -221,6 +230,105 @@ public:
         #endif
     }
 
+	static const GEOSPreparedGeometry* Prepare(const GEOSGeometry* gsGeom)
+	{
+		#ifdef GEOS_NEW
+			return GEOSPrepare_r(getGeosHandle(), gsGeom);
+		#else
+			return GEOSPrepare(gsGeom);
+		#endif
+	}
+
+	static void DestroyPrepared(const GEOSPreparedGeometry* gsPrepared)
+	{
+		#ifdef GEOS_NEW
+			GEOSPreparedGeom_destroy_r(getGeosHandle(), gsPrepared);
+		#else
+			GEOSPreparedGeom_destroy(gsPrepared);
+		#endif
+	}
+
+	static char PreparedContains(const GEOSPreparedGeometry* gsBase, const GEOSGeometry* gsGeom)
+	{
+		#ifdef GEOS_NEW
+			return GEOSPreparedContains_r(getGeosHandle(), gsBase, gsGeom);
+		#else
+			return GEOSPreparedContains(gsBase, gsGeom);
+		#endif
+	}
+
+	static char PreparedCrosses(const GEOSPreparedGeometry* gsBase, const GEOSGeometry* gsGeom)
+	{
+		#ifdef GEOS_NEW
+			return GEOSPreparedCrosses_r(getGeosHandle(), gsBase, gsGeom);
+		#else
+			return GEOSPreparedCrosses(gsBase, gsGeom);
+		#endif
+	}
+
+	static char PreparedIntersects(const GEOSPreparedGeometry* gsBase, const GEOSGeometry* gsGeom)
+	{
+		#ifdef GEOS_NEW
+			return GEOSPreparedIntersects_r(getGeosHandle(), gsBase, gsGeom);
+		#else
+			return GEOSPreparedIntersects(gsBase, gsGeom);
+		#endif
+	}
+
+	static char PreparedOverlaps(const GEOSPreparedGeometry* gsBase, const GEOSGeometry* gsGeom)
+	{
+		#ifdef GEOS_NEW
+			return GEOSPreparedOverlaps_r(getGeosHandle(), gsBase, gsGeom);
+		#else
+			return GEOSPreparedOverlaps(gsBase, gsGeom);
+		#endif
+	}
+
+	static char PreparedTouches(const GEOSPreparedGeometry* gsBase, const GEOSGeometry* gsGeom)
+	{
+		#ifdef GEOS_NEW
+			return GEOSPreparedTouches_r(getGeosHandle(), gsBase, gsGeom);
+		#else
+			return GEOSPreparedTouches(gsBase, gsGeom);
+		#endif
+	}
+
+	static char PreparedWithin(const GEOSPreparedGeometry* gsBase, const GEOSGeometry* gsGeom)
+	{
+		#ifdef GEOS_NEW
+			return GEOSPreparedWithin_r(getGeosHandle(), gsBase, gsGeom);
+		#else
+			return GEOSPreparedWithin(gsBase, gsGeom);
+		#endif
+	}
+
+	static char PreparedCovers(const GEOSPreparedGeometry* gsBase, const GEOSGeometry* gsGeom)
+	{
+		#ifdef GEOS_NEW
+			return GEOSPreparedCovers_r(getGeosHandle(), gsBase, gsGeom);
+		#else
+			return GEOSPreparedCovers(gsBase, gsGeom);
+		#endif
+	}
+
+	static char PreparedCoveredBy(const GEOSPreparedGeometry* gsBase, const GEOSGeometry* gsGeom)
+	{
+		#ifdef GEOS_NEW
+			return GEOSPreparedCoveredBy_r(getGeosHandle(), gsBase, gsGeom);
+		#else
+			return GEOSPreparedCoveredBy(gsBase, gsGeom);
+		#endif
+	}
+
+	static char PreparedDisjoint(const GEOSPreparedGeometry* gsBase, const GEOSGeometry* gsGeom)
+	{
+		#ifdef GEOS_NEW
+			return GEOSPreparedDisjoint_r(getGeosHandle(), gsBase, gsGeom);
+		#else
+			return GEOSPreparedDisjoint(gsBase, gsGeom);
+		#endif
+	}
+
 	static void Free(void* buffer)
 	{
 		#ifdef GEOS_NEW
@@ -509,4 +617,94 @@ public:
             return GEOSSnap(g1, g2, tolerance);
         #endif
     }
+
+	// The versions below take the context explicitly, so that they can be called from the threads of pool, 
+	// each with a context of its own. Without reentrant API there is a single global context.
+	static GEOSContextHandle_t CreateContext()
+	{
+		#ifdef GEOS_NEW
+			return OGRGeometry::createGEOSContext();
+		#else
+			return NULL;
+		#endif
+	}
+
+	static void DestroyContext(GEOSContextHandle_t handle)
+	{
+		#ifdef GEOS_NEW
+			OGRGeometry::freeGEOSContext(handle);
+		#endif
+	}
+
+	static GEOSGeometry* Intersection(GEOSContextHandle_t handle, const GEOSGeometry* gsGeom1, const GEOSGeometry* gsGeom2)
+	{
+		#ifdef GEOS_NEW
+			return GEOSIntersection_r(handle, gsGeom1, gsGeom2);
+		#else
+			return GEOSIntersection(gsGeom1, gsGeom2);
+		#endif
+	}
+
+	static GEOSGeometry* Difference(GEOSContextHandle_t handle, const GEOSGeometry* gsGeom1, const GEOSGeometry* gsGeom2)
+	{
+		#ifdef GEOS_NEW
+			return GEOSDifference_r(handle, gsGeom1, gsGeom2);
+		#else
+			return GEOSDifference(gsGeom1, gsGeom2);
+		#endif
+	}
+
+	static GEOSGeometry* CloneGeometry(GEOSContextHandle_t handle, const GEOSGeometry* gsGeom)
+	{
+		#ifdef GEOS_NEW
+			return GEOSGeom_clone_r(handle, gsGeom);
+		#else
+			return GEOSGeom_clone(gsGeom);
+		#endif
+	}
+
+	static void DestroyGeometry(GEOSContextHandle_t handle, GEOSGeometry* gsGeom)
+	{
+		#ifdef GEOS_NEW
+			GEOSGeom_destroy_r(handle, gsGeom);
+		#else
+			GEOSGeom_destroy(gsGeom);
+		#endif
+	}
+
+	static char Intersects(GEOSContextHandle_t handle, const GEOSGeometry* gsBase, const GEOSGeometry* gsGeom)
+	{
+		#ifdef GEOS_NEW
+			return GEOSIntersects_r(handle, gsBase, gsGeom);
+		#else
+			return GEOSIntersects(gsBase, gsGeom);
+		#endif
+	}
+
+	static const GEOSPreparedGeometry* Prepare(GEOSContextHandle_t handle, const GEOSGeometry* gsGeom)
+	{
+		#ifdef GEOS_NEW
+			return GEOSPrepare_r(handle, gsGeom);
+		#else
+			return GEOSPrepare(gsGeom);
+		#endif
+	}
+
+	static void DestroyPrepared(GEOSContextHandle_t handle, const GEOSPreparedGeometry* gsPrepared)
+	{
+		#ifdef GEOS_NEW
+			GEOSPreparedGeom_destroy_r(handle, gsPrepared);
+		#else
+			GEOSPreparedGeom_destroy(gsPrepared);
+		#endif
+	}
+
+	static char PreparedIntersects(GEOSContextHandle_t handle, const GEOSPreparedGeometry* gsBase, const GEOSGeometry* gsGeom)
+	{
+		#ifdef GEOS_NEW
+			return GEOSPreparedIntersects_r(handle, gsBase, gsGeom);
+		#else
+			return GEOSPreparedIntersects(gsBase, gsGeom);
+		#endif
+	}
 };
@@ -0,0 +1,689 @@
+#include "stdafx.h"
+#include "CompiledExpression.h"
+
+// *******************************************************************
+//		CompareValues()
+// *******************************************************************
+template <typename T>
+inline bool CompareValues(tkOperation operation, T left, T right)
+{
+	switch (operation)
+	{
+		case operLess:		return left < right;
+		case operLessEqual:	return left <= right;
+		case operGreater:	return left > right;
+		case operGrEqual:	return left >= right;
+		case operEqual:		return left == right;
+		case operNotEqual:	return left != right;
+	}
+	return false;
+}
+
+// *******************************************************************
+//		Parse()
+// *******************************************************************
+bool CompiledExpression::Parse(ITable* table, CStringW expression, CString floatFormat, CStringW& errorMessage)
+{
+	_program.clear();
+	_result = NULL;
+	_hasProgram = false;
+
+	_expr.SetFloatFormat(floatFormat);
+	if (!_expr.ReadFieldNames(table))
+	{
+		errorMessage = "Failed to read field names";
+		return false;
+	}
+
+	if (!_expr.Parse(expression, true, errorMessage))
+	{
+		return false;
+	}
+
+	_floatFormat = floatFormat;
+
+	_usesGeometry = false;
+	for (size_t i = 0; i < _expr._parts.size(); i++)
+	{
+		CustomFunction* fn = _expr._parts[i]->function;
+		if (fn && fn->useGeometry())
+		{
+			_usesGeometry = true;
+		}
+	}
+
+	ReadFieldTypes(table);
+
+	_hasProgram = m_globalSettings.compileExpressions && Compile();
+	return true;
+}
+
+// *******************************************************************
+//		ReadFieldTypes()
+// *******************************************************************
+// Numeric fields always hold numbers: nulls keep the previous value which is 0.0 initially.
+// String fields hold strings once the first non-null value was read.
+void CompiledExpression::ReadFieldTypes(ITable* table)
+{
+	_fieldTypes.clear();
+
+	for (int i = 0; i < _expr.get_NumFields(); i++)
+	{
+		FieldType type = DOUBLE_FIELD;
+
+		CComPtr<IField> fld = NULL;
+		table->get_Field(_expr.get_FieldIndex(i), &fld);
+		if (fld)
+		{
+			fld->get_Type(&type);
+		}
+
+		_fieldTypes.push_back(type == STRING_FIELD ? vtString : vtDouble);
+	}
+}
+
+// *******************************************************************
+//		SetFieldValues()
+// *******************************************************************
+void CompiledExpression::SetFieldValues(const vector<ExpressionColumn*>& columns, int index)
+{
+	for (size_t i = 0; i < columns.size(); i++)
+	{
+		ExpressionColumn* column = columns[i];
+		switch (column->kinds[index])
+		{
+			case ExpressionColumn::vkDouble:
+				_expr.put_FieldValue(i, column->doubles[index]);
+				break;
+			case ExpressionColumn::vkString:
+				_expr.get_FieldValue(i)->str(column->strings[index]);
+				break;
+		}
+	}
+}
+
+// *******************************************************************
+//		Calculate()
+// *******************************************************************
+CExpressionValue* CompiledExpression::Calculate(CStringW& errorMessage)
+{
+	if (_hasProgram && FieldTypesMatch() && RunProgram())
+	{
+		return _result;
+	}
+
+	// the interpreter starts the row from scratch, so whatever was calculated by the program is overwritten
+	return _expr.Calculate(errorMessage);
+}
+
+// *******************************************************************
+//		FieldTypesMatch()
+// *******************************************************************
+bool CompiledExpression::FieldTypesMatch()
+{
+	for (size_t i = 0; i < _fieldTypes.size(); i++)
+	{
+		if (_expr.get_FieldValue(i)->type() != _fieldTypes[i])
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// *******************************************************************
+//		Compile()
+// *******************************************************************
+bool CompiledExpression::Compile()
+{
+	_program.clear();
+	_result = NULL;
+
+	vector<CExpressionPart*>& parts = _expr._parts;
+	if (parts.size() == 0)
+	{
+		return false;
+	}
+
+	map<CExpressionValue*, tkValueType> types;
+	set<CExpressionValue*> literals;
+
+	for (size_t i = 0; i < parts.size(); i++)
+	{
+		// the type of result of a function may depend on the values of arguments
+		if (parts[i]->isFunction())
+		{
+			return false;
+		}
+
+		for (size_t j = 0; j < parts[i]->elements.size(); j++)
+		{
+			CElement* el = parts[i]->elements[j];
+			if (el->type == etValue && !el->isField && el->partIndex == -1)
+			{
+				types[el->val] = el->val->type();
+				literals.insert(el->val);
+			}
+		}
+	}
+
+	for (int i = 0; i < _expr.get_NumFields(); i++)
+	{
+		types[_expr.get_FieldValue(i)] = _fieldTypes[i];
+	}
+
+	vector<Node> nodes;
+	vector<CExpressionValue*> partValues(parts.size(), NULL);
+
+	// the interpreter state is used for simulation only; operations must not be cached by it
+	bool saveOperations = _expr._saveOperations;
+	_expr._saveOperations = false;
+	_expr.Reset();
+	_expr.ResetActiveCountForParts();
+
+	bool result = CompileParts(types, literals, nodes, partValues);
+
+	_expr._saveOperations = saveOperations;
+	_expr.Reset();
+
+	if (!result)
+	{
+		return false;
+	}
+
+	_result = partValues[parts.size() - 1];
+
+	int root = -1;
+	for (size_t i = 0; i < nodes.size(); i++)
+	{
+		if (nodes[i].instruction.result == _result)
+		{
+			root = i;
+		}
+	}
+
+	BuildProgram(nodes, root);
+	return true;
+}
+
+// *******************************************************************
+//		CompileParts()
+// *******************************************************************
+// Repeats the steps of CustomExpression::Calculate without calculating anything.
+bool CompiledExpression::CompileParts(map<CExpressionValue*, tkValueType>& types, set<CExpressionValue*>& literals,
+									  vector<Node>& nodes, vector<CExpressionValue*>& partValues)
+{
+	vector<CExpressionPart*>& parts = _expr._parts;
+	map<CExpressionValue*, int> writers;		// the last operation which has written to the value
+
+	for (size_t i = 0; i < parts.size(); i++)
+	{
+		CExpressionPart* part = parts[i];
+
+		while (part->activeCount > 1)
+		{
+			COperation operation;
+			if (!_expr.FindOperation(part, operation))
+			{
+				return false;
+			}
+
+			if (!CompileOperation(part, operation, types, literals, writers, nodes, partValues))
+			{
+				return false;
+			}
+
+			part->activeCount -= operation.binaryOperation ? 2 : 1;
+		}
+
+		if (part->activeCount != 1)
+		{
+			return false;
+		}
+
+		// see CustomExpression::FinishPart
+		for (size_t j = 0; j < part->elements.size(); j++)
+		{
+			if (!part->elements[j]->turnedOff)
+			{
+				partValues[i] = GetValue(part, j, partValues);
+				part->elements[j]->turnedOff = true;
+				break;
+			}
+		}
+
+		if (!partValues[i])
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// *******************************************************************
+//		CompileOperation()
+// *******************************************************************
+bool CompiledExpression::CompileOperation(CExpressionPart* part, COperation& operation, map<CExpressionValue*, tkValueType>& types,
+										  set<CExpressionValue*>& literals, map<CExpressionValue*, int>& writers,
+										  vector<Node>& nodes, vector<CExpressionValue*>& partValues)
+{
+	tkOperation oper = part->elements[operation.id]->operation;
+	bool unary = oper == operNOT || oper == operChangeSign;
+
+	// unary operators write to the right operand, binary ones to the left
+	CElement* target = part->elements[unary ? operation.right : operation.left];
+
+	Node node;
+	Instruction& instruction = node.instruction;
+	instruction.operation = oper;
+	instruction.right = GetValue(part, operation.right, partValues);
+	instruction.left = unary ? NULL : GetValue(part, operation.left, partValues);
+	instruction.result = target->calcVal;
+	instruction.skipTo = -1;
+	instruction.skipValue = false;
+
+	if (!instruction.right || (!unary && !instruction.left))
+	{
+		return false;
+	}
+
+	map<CExpressionValue*, tkValueType>::iterator right = types.find(instruction.right);
+	map<CExpressionValue*, tkValueType>::iterator left = unary ? types.end() : types.find(instruction.left);
+	if (right == types.end() || (!unary && left == types.end()))
+	{
+		return false;
+	}
+
+	tkValueType resultType;
+	if (!SetInstructionCode(instruction, unary ? vtDouble : left->second, right->second, literals, resultType))
+	{
+		return false;
+	}
+
+	map<CExpressionValue*, int>::iterator it = writers.find(instruction.right);
+	node.right = it != writers.end() ? it->second : -1;
+
+	it = unary ? writers.end() : writers.find(instruction.left);
+	node.left = it != writers.end() ? it->second : -1;
+
+	writers[instruction.result] = nodes.size();
+	types[instruction.result] = resultType;
+	nodes.push_back(node);
+
+	// the same flags as CustomExpression::CalculateOperation sets
+	target->wasCalculated = true;
+	part->elements[operation.id]->turnedOff = true;
+	if (!unary)
+	{
+		part->elements[operation.right]->turnedOff = true;
+	}
+
+	return true;
+}
+
+// *******************************************************************
+//		GetValue()
+// *******************************************************************
+// The same as CustomExpression::GetValue, but the results of parts are taken from the simulation.
+CExpressionValue* CompiledExpression::GetValue(CExpressionPart* part, int elementId, vector<CExpressionValue*>& partValues)
+{
+	CElement* element = part->elements[elementId];
+
+	if (element->wasCalculated)
+	{
+		return element->calcVal;
+	}
+
+	if (element->partIndex != -1)
+	{
+		return element->partIndex < (int)partValues.size() ? partValues[element->partIndex] : NULL;
+	}
+
+	return element->val;
+}
+
+// *******************************************************************
+//		SetInstructionCode()
+// *******************************************************************
+// Type checks of CustomExpression::CalculateOperation. Operations which would fail
+// for these types aren't compiled, so the interpreter reports the error for each row.
+bool CompiledExpression::SetInstructionCode(Instruction& instruction, tkValueType left, tkValueType right,
+											set<CExpressionValue*>& literals, tkValueType& resultType)
+{
+	resultType = vtBoolean;
+
+	switch (instruction.operation)
+	{
+		case operOR:
+		case operAND:
+		case operXOR:
+		case operCONSEQ:
+			if (left != vtBoolean || right != vtBoolean)
+				return false;
+
+			switch (instruction.operation)
+			{
+				case operOR:	instruction.code = icOr; break;
+				case operAND:	instruction.code = icAnd; break;
+				case operXOR:	instruction.code = icXor; break;
+				default:		instruction.code = icConseq; break;
+			}
+			return true;
+
+		case operNOT:
+			instruction.code = icNot;
+			return right == vtBoolean;
+
+		case operLike:
+		case operILike:
+			if (left != vtString || right != vtString)
+				return false;
+
+			instruction.code = instruction.operation == operLike ? icLike : icILike;
+
+			// the pattern is constant, no need to build it for each row
+			if (literals.find(instruction.right) != literals.end())
+			{
+				CStringW pattern = instruction.right->str();
+				if (instruction.code == icILike)
+				{
+					pattern.MakeLower();
+				}
+				pattern.Replace(L"%", L".*");
+				pattern.Replace(L"_", L".");
+
+				try
+				{
+					instruction.regex.reset(new std::wregex((LPCWSTR)pattern));
+				}
+				catch (std::regex_error&)
+				{
+					return false;
+				}
+			}
+			return true;
+
+		case operLess:
+		case operLessEqual:
+		case operGreater:
+		case operGrEqual:
+		case operEqual:
+		case operNotEqual:
+			if (left != right)
+				return false;
+
+			switch (left)
+			{
+				case vtDouble:	instruction.code = icCompareDouble; return true;
+				case vtBoolean:	instruction.code = icCompareBoolean; return true;
+				case vtString:	instruction.code = icCompareString; return true;
+			}
+			return false;
+
+		case operChangeSign:
+			instruction.code = icChangeSign;
+			resultType = vtDouble;
+			return right == vtDouble;
+
+		case operPlus:
+			if (left == vtDouble && right == vtDouble)
+			{
+				instruction.code = icPlus;
+				resultType = vtDouble;
+				return true;
+			}
+
+			resultType = vtString;
+			if (left == vtString && right == vtString)			instruction.code = icConcat;
+			else if (left == vtDouble && right == vtString)		instruction.code = icConcatDoubleString;
+			else if (left == vtString && right == vtDouble)		instruction.code = icConcatStringDouble;
+			else												return false;
+			return true;
+
+		case operMinus:
+		case operMult:
+		case operExpon:
+		case operMOD:
+		case operDiv:
+		case operDivInt:
+			if (left != vtDouble || right != vtDouble)
+				return false;
+
+			switch (instruction.operation)
+			{
+				case operMinus:	instruction.code = icMinus; break;
+				case operMult:	instruction.code = icMult; break;
+				case operExpon:	instruction.code = icExpon; break;
+				case operMOD:	instruction.code = icMod; break;
+				case operDiv:	instruction.code = icDiv; break;
+				default:		instruction.code = icDivInt; break;
+			}
+			resultType = vtDouble;
+			return true;
+	}
+
+	return false;
+}
+
+// *******************************************************************
+//		BuildProgram()
+// *******************************************************************
+void CompiledExpression::BuildProgram(vector<Node>& nodes, int root)
+{
+	_program.clear();
+
+	if (root != -1)
+	{
+		EmitNode(nodes, root);
+
+		size_t count = 0;
+		for (size_t i = 0; i < _program.size(); i++)
+		{
+			if (_program[i].code != icSkipIfFalse && _program[i].code != icSkipIfTrue)
+				count++;
+		}
+
+		if (count == nodes.size())
+		{
+			return;
+		}
+	}
+
+	// the operations don't make a single tree; keep the order of the interpreter
+	_program.clear();
+	for (size_t i = 0; i < nodes.size(); i++)
+	{
+		_program.push_back(nodes[i].instruction);
+	}
+}
+
+// *******************************************************************
+//		EmitNode()
+// *******************************************************************
+// Operands go before the operation. For AND, OR and CONSEQ the right operand is skipped
+// when the left one decides the result.
+void CompiledExpression::EmitNode(vector<Node>& nodes, int index)
+{
+	Node& node = nodes[index];
+	InstructionCode code = node.instruction.code;
+
+	if (node.left != -1)
+	{
+		EmitNode(nodes, node.left);
+	}
+
+	int skip = -1;
+	if ((code == icAnd || code == icOr || code == icConseq) && node.right != -1 && CanSkip(nodes, node.right))
+	{
+		Instruction instruction = node.instruction;
+		instruction.code = code == icOr ? icSkipIfTrue : icSkipIfFalse;
+		instruction.skipValue = code != icAnd;
+		instruction.regex.reset();
+
+		skip = _program.size();
+		_program.push_back(instruction);
+	}
+
+	if (node.right != -1)
+	{
+		EmitNode(nodes, node.right);
+	}
+
+	_program.push_back(node.instruction);
+
+	if (skip != -1)
+	{
+		_program[skip].skipTo = _program.size();
+	}
+}
+
+// *******************************************************************
+//		CanSkip()
+// *******************************************************************
+// Division by zero leaves the previous value of the result, i.e. the one calculated for one
+// of the previous rows. It must be the same one the interpreter would have, so divisions
+// are always calculated.
+bool CompiledExpression::CanSkip(vector<Node>& nodes, int index)
+{
+	Node& node = nodes[index];
+
+	if (node.instruction.code == icDiv || node.instruction.code == icDivInt)
+		return false;
+
+	return (node.left == -1 || CanSkip(nodes, node.left)) &&
+		   (node.right == -1 || CanSkip(nodes, node.right));
+}
+
+// *******************************************************************
+//		RunProgram()
+// *******************************************************************
+// Returns false on division by zero; the row is then calculated by the interpreter.
+bool CompiledExpression::RunProgram()
+{
+	int size = _program.size();
+	for (int i = 0; i < size; i++)
+	{
+		Instruction& in = _program[i];
+
+		switch (in.code)
+		{
+			case icOr:
+				in.result->bln(in.left->bln() || in.right->bln());
+				break;
+			case icAnd:
+				in.result->bln(in.left->bln() && in.right->bln());
+				break;
+			case icXor:
+				in.result->bln((in.left->bln() || in.right->bln()) && !(in.left->bln() && in.right->bln()));
+				break;
+			case icConseq:
+				in.result->bln(!in.left->bln() || in.left->bln() && in.right->bln());
+				break;
+			case icNot:
+				in.result->bln(!in.right->bln());
+				break;
+
+			case icSkipIfFalse:
+				if (!in.left->bln())
+				{
+					in.result->bln(in.skipValue);
+					i = in.skipTo - 1;
+				}
+				break;
+			case icSkipIfTrue:
+				if (in.left->bln())
+				{
+					in.result->bln(in.skipValue);
+					i = in.skipTo - 1;
+				}
+				break;
+
+			case icCompareDouble:
+				in.result->bln(CompareValues(in.operation, in.left->dbl(), in.right->dbl()));
+				break;
+			case icCompareBoolean:
+				in.result->bln(CompareValues(in.operation, in.left->bln(), in.right->bln()));
+				break;
+			case icCompareString:
+				// the same as comparison of lower-case strings
+				in.result->bln(CompareValues(in.operation, _wcsicmp(in.left->str(), in.right->str()), 0));
+				break;
+
+			case icPlus:
+				in.result->dbl(in.left->dbl() + in.right->dbl());
+				break;
+			case icMinus:
+				in.result->dbl(in.left->dbl() - in.right->dbl());
+				break;
+			case icMult:
+				in.result->dbl(in.left->dbl() * in.right->dbl());
+				break;
+			case icExpon:
+				in.result->dbl(pow(in.left->dbl(), in.right->dbl()));
+				break;
+			case icDiv:
+				if (in.right->dbl() == 0.0)
+					return false;
+				in.result->dbl(in.left->dbl() / in.right->dbl());
+				break;
+			case icDivInt:
+				if ((int)in.right->dbl() == 0)
+					return false;
+				in.result->dbl(double((int)in.left->dbl() / (int)in.right->dbl()));
+				break;
+			case icMod:
+				if ((int)in.right->dbl() == 0)
+					return false;
+				in.result->dbl(double((int)in.left->dbl() % (int)in.right->dbl()));
+				break;
+			case icChangeSign:
+				in.result->dbl(-in.right->dbl());
+				break;
+
+			case icConcat:
+				in.result->str(in.left->str() + in.right->str());
+				break;
+			case icConcatDoubleString:
+				{
+					CStringW s;
+					s.Format(_floatFormat, in.left->dbl());
+					in.result->str(s + in.right->str());
+				}
+				break;
+			case icConcatStringDouble:
+				{
+					CStringW s;
+					s.Format(_floatFormat, in.right->dbl());
+					in.result->str(in.left->str() + s);
+				}
+				break;
+
+			case icILike:
+				// the interpreter changes the operands as well
+				in.left->str(in.left->str().MakeLower());
+				if (!in.regex)
+				{
+					in.right->str(in.right->str().MakeLower());
+				}
+				// don't break; just fall into LIKE logic
+			case icLike:
+				if (in.regex)
+				{
+					in.result->bln(std::regex_match((LPCWSTR)in.left->str(), *in.regex));
+				}
+				else
+				{
+					CStringW pattern = in.right->str();
+					pattern.Replace(L"%", L".*");
+					pattern.Replace(L"_", L".");
+					std::wregex reg(pattern);
+
+					in.result->bln(std::regex_match((LPCWSTR)in.left->str(), reg));
+				}
+				break;
+		}
+	}
+
+	return true;
+}
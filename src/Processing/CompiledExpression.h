@@ -0,0 +1,169 @@
+/////////////////////////////////////////////
+// CompiledExpression.h
+// Description: parsed expression compiled to a flat list of typed instructions
+////////////////////////////////////////////
+// CustomExpression looks up the next operation, resolves operands and checks their
+// types for each row. Here it's done once: operations are taken in the same order
+// the interpreter uses and typed for the types fields are expected to have,
+// so each row is a single pass over the instructions. Operands are the same
+// CExpressionValue objects the interpreter works with, therefore a row which
+// doesn't fit the program (a string field which was null in all the rows so far,
+// division by zero) is simply passed to CustomExpression::Calculate.
+// Expressions with functions are left to the interpreter entirely.
+//////////////////////////////////////////////////////////
+#pragma once
+#include <set>
+#include <regex>
+#include <memory>
+#include "CustomExpression.h"
+
+#define EXPRESSION_BATCH_SIZE 1024
+
+// ********************************************************
+//     ExpressionColumn
+// ********************************************************
+// Values of a field for a batch of rows in the form TableHelper::SetFieldValues passes them
+// to the expression: integers and doubles as numbers, strings as strings. Nulls, booleans
+// and dates aren't passed at all, so the expression keeps the value of the previous row.
+class ExpressionColumn
+{
+public:
+	enum ValueKind
+	{
+		vkNone = 0,
+		vkDouble = 1,
+		vkString = 2,
+	};
+
+	vector<unsigned char> kinds;
+	vector<double> doubles;
+	vector<CStringW> strings;		// allocated for string fields only
+
+	void Reset(int size)
+	{
+		kinds.assign(size, vkNone);
+		doubles.resize(size);
+	}
+
+	void SetDouble(int index, double value)
+	{
+		kinds[index] = vkDouble;
+		doubles[index] = value;
+	}
+
+	void SetString(int index, const CStringW& value)
+	{
+		if (strings.size() < kinds.size())
+			strings.resize(kinds.size());
+
+		kinds[index] = vkString;
+		strings[index] = value;
+	}
+
+	void SetVariant(int index, const VARIANT& var)
+	{
+		switch (var.vt)
+		{
+			case VT_BSTR: SetString(index, CStringW(var.bstrVal)); break;
+			case VT_I4:	  SetDouble(index, (double)var.lVal); break;
+			case VT_R8:	  SetDouble(index, var.dblVal); break;
+		}
+	}
+};
+
+// ********************************************************
+//     CompiledExpression
+// ********************************************************
+class CompiledExpression
+{
+public:
+	CompiledExpression()
+		: _result(NULL), _hasProgram(false), _usesGeometry(false)
+	{
+	}
+
+private:
+	enum InstructionCode
+	{
+		icOr,
+		icAnd,
+		icXor,
+		icConseq,
+		icNot,
+		icCompareDouble,
+		icCompareBoolean,
+		icCompareString,
+		icPlus,
+		icMinus,
+		icMult,
+		icDiv,
+		icDivInt,
+		icMod,
+		icExpon,
+		icChangeSign,
+		icConcat,
+		icConcatDoubleString,
+		icConcatStringDouble,
+		icLike,
+		icILike,
+		icSkipIfFalse,			// short-circuiting of AND, CONSEQ
+		icSkipIfTrue,			// short-circuiting of OR
+	};
+
+	struct Instruction
+	{
+		InstructionCode code;
+		tkOperation operation;
+		CExpressionValue* left;		// NULL for unary operations
+		CExpressionValue* right;
+		CExpressionValue* result;
+		int skipTo;					// the position after the operation which is short-circuited
+		bool skipValue;				// its result in this case
+		std::shared_ptr<std::wregex> regex;		// LIKE pattern set by literal
+	};
+
+	// operation with references to the operations which calculate its operands
+	struct Node
+	{
+		Instruction instruction;
+		int left;					// -1 for fields and literals
+		int right;
+	};
+
+	CustomExpression _expr;
+	vector<Instruction> _program;
+	vector<tkValueType> _fieldTypes;	// the types the program was built for
+	CExpressionValue* _result;
+	CStringW _floatFormat;
+	bool _hasProgram;
+	bool _usesGeometry;
+
+private:
+	void ReadFieldTypes(ITable* table);
+	bool Compile();
+	bool CompileParts(map<CExpressionValue*, tkValueType>& types, set<CExpressionValue*>& literals,
+					  vector<Node>& nodes, vector<CExpressionValue*>& partValues);
+	bool CompileOperation(CExpressionPart* part, COperation& operation, map<CExpressionValue*, tkValueType>& types,
+						  set<CExpressionValue*>& literals, map<CExpressionValue*, int>& writers,
+						  vector<Node>& nodes, vector<CExpressionValue*>& partValues);
+	bool SetInstructionCode(Instruction& instruction, tkValueType left, tkValueType right,
+							set<CExpressionValue*>& literals, tkValueType& resultType);
+	CExpressionValue* GetValue(CExpressionPart* part, int elementId, vector<CExpressionValue*>& partValues);
+	void BuildProgram(vector<Node>& nodes, int root);
+	void EmitNode(vector<Node>& nodes, int index);
+	bool CanSkip(vector<Node>& nodes, int index);
+	bool FieldTypesMatch();
+	bool RunProgram();
+
+public:
+	bool Parse(ITable* table, CStringW expression, CString floatFormat, CStringW& errorMessage);
+	CExpressionValue* Calculate(CStringW& errorMessage);
+
+	int get_NumFields() { return _expr.get_NumFields(); }
+	int get_FieldIndex(int fieldId) { return _expr.get_FieldIndex(fieldId); }
+	void SetFieldValues(const vector<ExpressionColumn*>& columns, int index);
+
+	bool UsesGeometry() { return _usesGeometry; }
+	void put_Shape(IShape* shape) { _expr.put_Shape(shape); }
+	bool HasProgram() { return _hasProgram; }
+};
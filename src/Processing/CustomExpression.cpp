@@ -651,16 +651,22 @@ bool CustomExpression::CalculateOperation( CExpressionPart* part, COperation& op
 					}
 					else if ( oper == operMult )	elLeft->calcVal->dbl(valLeft->dbl() * valRight->dbl());
 					else if ( oper == operExpon )	elLeft->calcVal->dbl(pow(valLeft->dbl(), valRight->dbl()));
-					else if ( oper == operDivInt )	
-						if (valRight->dbl() == 0.0)
+					else if ( oper == operDivInt || oper == operMOD )
+					{
+						// the operands are truncated to integers, so 0.5 is zero as well
+						if ((int)valRight->dbl() == 0)
 						{
 							_errorMessage = "Division by zero";
 						}
-						else
+						else if ( oper == operDivInt )
 						{
 							elLeft->calcVal->dbl(double((int)valLeft->dbl() / (int)valRight->dbl()));
 						}
-					else if ( oper == operMOD )		elLeft->calcVal->dbl(double((int)valLeft->dbl() % (int)valRight->dbl()));
+						else
+						{
+							elLeft->calcVal->dbl(double((int)valLeft->dbl() % (int)valRight->dbl()));
+						}
+					}
 				}
 				else if (valLeft->IsFloatArray() && valRight->IsFloatArray() )
 				{
@@ -28,7 +28,10 @@
 class CustomExpression
 {
 private:
-	
+	// shares parsed parts and values with the interpreter
+	friend class CompiledExpression;
+	friend class RasterCalculator;
+
 public:
 	CustomExpression() 
 		: _useFields(true), _saveOperations(true), _floatFormat(m_globalSettings.floatNumberFormat),
@@ -0,0 +1,215 @@
+/////////////////////////////////////////////
+// PackedRTree.cpp
+// Description: static R-tree bulk loaded in Hilbert order and stored in flat arrays
+////////////////////////////////////////////
+#include "stdafx.h"
+#include "PackedRTree.h"
+#include <algorithm>
+
+// *******************************************************
+//		Reserve()
+// *******************************************************
+void CPackedRTree::Reserve(int numItems)
+{
+	_boxes.reserve(numItems * 4);
+	_indices.reserve(numItems);
+}
+
+// *******************************************************
+//		AddItem()
+// *******************************************************
+void CPackedRTree::AddItem(int index, double xMin, double yMin, double xMax, double yMax)
+{
+	if (_finished)
+		return;
+
+	_boxes.push_back(xMin);
+	_boxes.push_back(yMin);
+	_boxes.push_back(xMax);
+	_boxes.push_back(yMax);
+	_indices.push_back(index);
+	_numItems++;
+
+	if (xMin < _bounds[0]) _bounds[0] = xMin;
+	if (yMin < _bounds[1]) _bounds[1] = yMin;
+	if (xMax > _bounds[2]) _bounds[2] = xMax;
+	if (yMax > _bounds[3]) _bounds[3] = yMax;
+}
+
+// *******************************************************
+//		Finish()
+// *******************************************************
+// Sorts the items by Hilbert value and packs them bottom-up into nodes of _nodeSize.
+void CPackedRTree::Finish()
+{
+	if (_finished)
+		return;
+
+	_finished = true;
+
+	if (_numItems == 0)
+		return;
+
+	// size of each level
+	int n = _numItems;
+	int numNodes = n;
+	_levelBounds.push_back(numNodes);
+	do
+	{
+		n = (n + _nodeSize - 1) / _nodeSize;
+		numNodes += n;
+		_levelBounds.push_back(numNodes);
+	} while (n != 1);
+
+	SortByHilbertValue();
+
+	// inner nodes are appended level by level after the leaves
+	_boxes.resize(numNodes * 4);
+	_indices.resize(numNodes);
+
+	int pos = 0;
+	int writePos = _numItems;
+	for (size_t level = 0; level < _levelBounds.size() - 1; level++)
+	{
+		int end = _levelBounds[level];
+		while (pos < end)
+		{
+			double nodeBox[4] = { DBL_MAX, DBL_MAX, -DBL_MAX, -DBL_MAX };
+			int firstChild = pos;
+			for (int i = 0; i < _nodeSize && pos < end; i++, pos++)
+			{
+				double* box = &_boxes[pos * 4];
+				if (box[0] < nodeBox[0]) nodeBox[0] = box[0];
+				if (box[1] < nodeBox[1]) nodeBox[1] = box[1];
+				if (box[2] > nodeBox[2]) nodeBox[2] = box[2];
+				if (box[3] > nodeBox[3]) nodeBox[3] = box[3];
+			}
+			memcpy(&_boxes[writePos * 4], nodeBox, sizeof(nodeBox));
+			_indices[writePos] = firstChild;
+			writePos++;
+		}
+	}
+}
+
+// *******************************************************
+//		SortByHilbertValue()
+// *******************************************************
+void CPackedRTree::SortByHilbertValue()
+{
+	double width = _bounds[2] - _bounds[0];
+	double height = _bounds[3] - _bounds[1];
+	const double hilbertMax = 65535.0;
+
+	std::vector<std::pair<unsigned int, int>> values(_numItems);
+	for (int i = 0; i < _numItems; i++)
+	{
+		double* box = &_boxes[i * 4];
+		unsigned int x = width > 0 ? (unsigned int)(hilbertMax * ((box[0] + box[2]) / 2 - _bounds[0]) / width) : 0;
+		unsigned int y = height > 0 ? (unsigned int)(hilbertMax * ((box[1] + box[3]) / 2 - _bounds[1]) / height) : 0;
+		values[i] = std::make_pair(HilbertValue(x, y), i);
+	}
+
+	std::sort(values.begin(), values.end());
+
+	std::vector<double> sortedBoxes(_numItems * 4);
+	std::vector<int> sortedIndices(_numItems);
+	for (int i = 0; i < _numItems; i++)
+	{
+		int source = values[i].second;
+		memcpy(&sortedBoxes[i * 4], &_boxes[source * 4], sizeof(double) * 4);
+		sortedIndices[i] = _indices[source];
+	}
+
+	_boxes.swap(sortedBoxes);
+	_indices.swap(sortedIndices);
+}
+
+// *******************************************************
+//		HilbertValue()
+// *******************************************************
+// Position of the point on the Hilbert curve filling 2^16 x 2^16 grid
+// (non-recursive algorithm by Rawrunprotected, public domain).
+unsigned int CPackedRTree::HilbertValue(unsigned int x, unsigned int y)
+{
+	unsigned int a = x ^ y;
+	unsigned int b = 0xFFFF ^ a;
+	unsigned int c = 0xFFFF ^ (x | y);
+	unsigned int d = x & (y ^ 0xFFFF);
+
+	unsigned int A = a | (b >> 1);
+	unsigned int B = (a >> 1) ^ a;
+	unsigned int C = ((c >> 1) ^ (b & (d >> 1))) ^ c;
+	unsigned int D = ((a & (c >> 1)) ^ (d >> 1)) ^ d;
+
+	a = A; b = B; c = C; d = D;
+	A = ((a & (a >> 2)) ^ (b & (b >> 2)));
+	B = ((a & (b >> 2)) ^ (b & ((a ^ b) >> 2)));
+	C ^= ((a & (c >> 2)) ^ (b & (d >> 2)));
+	D ^= ((b & (c >> 2)) ^ ((a ^ b) & (d >> 2)));
+
+	a = A; b = B; c = C; d = D;
+	A = ((a & (a >> 4)) ^ (b & (b >> 4)));
+	B = ((a & (b >> 4)) ^ (b & ((a ^ b) >> 4)));
+	C ^= ((a & (c >> 4)) ^ (b & (d >> 4)));
+	D ^= ((b & (c >> 4)) ^ ((a ^ b) & (d >> 4)));
+
+	a = A; b = B; c = C; d = D;
+	C ^= ((a & (c >> 8)) ^ (b & (d >> 8)));
+	D ^= ((b & (c >> 8)) ^ ((a ^ b) & (d >> 8)));
+
+	a = C ^ (C >> 1);
+	b = D ^ (D >> 1);
+
+	unsigned int i0 = x ^ y;
+	unsigned int i1 = b | (0xFFFF ^ (i0 | a));
+
+	i0 = (i0 | (i0 << 8)) & 0x00FF00FF;
+	i0 = (i0 | (i0 << 4)) & 0x0F0F0F0F;
+	i0 = (i0 | (i0 << 2)) & 0x33333333;
+	i0 = (i0 | (i0 << 1)) & 0x55555555;
+
+	i1 = (i1 | (i1 << 8)) & 0x00FF00FF;
+	i1 = (i1 | (i1 << 4)) & 0x0F0F0F0F;
+	i1 = (i1 | (i1 << 2)) & 0x33333333;
+	i1 = (i1 | (i1 << 1)) & 0x55555555;
+
+	return (i1 << 1) | i0;
+}
+
+// *******************************************************
+//		get_MemoryUsage()
+// *******************************************************
+size_t CPackedRTree::get_MemoryUsage()
+{
+	return sizeof(CPackedRTree) + _boxes.capacity() * sizeof(double) + 
+		   _indices.capacity() * sizeof(int) + _levelBounds.capacity() * sizeof(int);
+}
+
+// *******************************************************
+//		GetNodes()
+// *******************************************************
+// Writes the indices of items intersecting the extent to the caller's buffer. 
+// Returns the total number of such items, which may be larger than bufferSize; 
+// in this case the query should be repeated with larger buffer.
+int CPackedRTree::GetNodes(const QTreeExtent& query, int* buffer, int bufferSize)
+{
+	int count = 0;
+	auto add = [&](int index) {
+		if (count < bufferSize)
+			buffer[count] = index;
+		count++;
+	};
+	Search(query.left, query.bottom, query.right, query.top, false, add);
+	return count;
+}
+
+// *******************************************************
+//		GetNodes()
+// *******************************************************
+// The vector is cleared but keeps its capacity, so it can be reused between the queries.
+void CPackedRTree::GetNodes(const QTreeExtent& query, vector<int>& result)
+{
+	result.clear();
+	auto add = [&result](int index) { result.push_back(index); };
+	Search(query.left, query.bottom, query.right, query.top, false, add);
+}
@@ -0,0 +1,123 @@
+/////////////////////////////////////////////
+// PackedRTree.h
+// Description: static R-tree bulk loaded in Hilbert order and stored in flat arrays
+////////////////////////////////////////////
+// Unlike QTree it doesn't support insertion or removal after the tree is built,
+// so it's meant for the trees which are built once and then queried (geoprocessing,
+// disk-based spatial index). The layout:
+//   - boxes: xMin, yMin, xMax, yMax for each node; leaves go first, sorted by Hilbert value
+//     of their centres, followed by the upper levels, the root is the last one;
+//   - indices: index of the item for leaves, position of the first child for the inner nodes;
+//   - levelBounds: position right after the last node of each level.
+//////////////////////////////////////////////////////////
+#pragma once
+#include "QTree.h"
+
+#define PACKED_RTREE_MAX_LEVELS 32
+#define PACKED_RTREE_MAX_NODE_SIZE 64
+#define PACKED_RTREE_DEFAULT_NODE_SIZE 16
+
+// *******************************************************
+//		PackedRTreeSearch()
+// *******************************************************
+// Calls visitor(index) for each leaf intersecting the box (or contained by it).
+// Shared by the in-memory and memory-mapped trees; the traversal stack is kept
+// on the stack so no allocations are made.
+template <typename Visitor>
+void PackedRTreeSearch(const double* boxes, const int* indices, const int* levelBounds, int numItems, int numNodes, int nodeSize,
+					   double xMin, double yMin, double xMax, double yMax, bool contained, Visitor& visitor)
+{
+	if (numItems == 0)
+		return;
+
+	int stack[PACKED_RTREE_MAX_LEVELS * PACKED_RTREE_MAX_NODE_SIZE];
+	int stackSize = 0;
+	int nodeIndex = numNodes - 1;		// the root
+
+	while (true)
+	{
+		// the group of nodes ends either after nodeSize entries or at the end of the level
+		int level = 0;
+		while (levelBounds[level] <= nodeIndex) level++;
+		int end = min(nodeIndex + nodeSize, levelBounds[level]);
+
+		for (int pos = nodeIndex; pos < end; pos++)
+		{
+			const double* box = boxes + pos * 4;
+			if (xMax < box[0] || yMax < box[1] || xMin > box[2] || yMin > box[3])
+				continue;
+
+			if (pos >= numItems)
+			{
+				stack[stackSize++] = indices[pos];
+			}
+			else if (!contained || (box[0] >= xMin && box[1] >= yMin && box[2] <= xMax && box[3] <= yMax))
+			{
+				visitor(indices[pos]);
+			}
+		}
+
+		if (stackSize == 0)
+			break;
+
+		nodeIndex = stack[--stackSize];
+	}
+}
+
+class CPackedRTree
+{
+public:
+	CPackedRTree(int nodeSize = PACKED_RTREE_DEFAULT_NODE_SIZE)
+	{
+		_nodeSize = max(2, min(PACKED_RTREE_MAX_NODE_SIZE, nodeSize));
+		_numItems = 0;
+		_finished = false;
+		_bounds[0] = _bounds[1] = DBL_MAX;
+		_bounds[2] = _bounds[3] = -DBL_MAX;
+	}
+
+private:
+	int _nodeSize;
+	int _numItems;
+	bool _finished;
+	double _bounds[4];
+	vector<double> _boxes;
+	vector<int> _indices;
+	vector<int> _levelBounds;
+
+	void SortByHilbertValue();
+
+public:
+	static unsigned int HilbertValue(unsigned int x, unsigned int y);
+
+	// building
+	void Reserve(int numItems);
+	void AddItem(int index, double xMin, double yMin, double xMax, double yMax);
+	void AddNode(const QTreeNode& node) { AddItem(node.index, node.Extent.left, node.Extent.bottom, node.Extent.right, node.Extent.top); }
+	void Finish();
+
+	// properties
+	int get_NodeSize() { return _nodeSize; }
+	int get_NumItems() { return _numItems; }
+	int get_NumNodes() { return (int)_indices.size(); }
+	int get_NumLevels() { return (int)_levelBounds.size(); }
+	const double* get_Bounds() { return _bounds; }
+	const double* get_Boxes() { return _boxes.empty() ? NULL : &_boxes[0]; }
+	const int* get_Indices() { return _indices.empty() ? NULL : &_indices[0]; }
+	const int* get_LevelBounds() { return _levelBounds.empty() ? NULL : &_levelBounds[0]; }
+	size_t get_MemoryUsage();
+
+	// querying; the tree must be finished
+	int GetNodes(const QTreeExtent& query, int* buffer, int bufferSize);
+	void GetNodes(const QTreeExtent& query, vector<int>& result);
+
+	template <typename Visitor>
+	void Search(double xMin, double yMin, double xMax, double yMax, bool contained, Visitor& visitor)
+	{
+		if (!_finished)
+			return;
+
+		PackedRTreeSearch(get_Boxes(), get_Indices(), get_LevelBounds(), _numItems, get_NumNodes(), _nodeSize,
+						  xMin, yMin, xMax, yMax, contained, visitor);
+	}
+};
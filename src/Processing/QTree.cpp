@@ -258,61 +258,26 @@ bool QTree::RemoveNode(int index)
 vector<int> QTree::GetNodes(QTreeExtent QueryExtent)
 {
 	vector<int> result;
+	GetNodes(QueryExtent, result);
+	return result;
+}
+
+void QTree::GetNodes(const QTreeExtent& QueryExtent, vector<int>& result)
+{
 	if(!this->extent.IntersectIn(QueryExtent))
-	/*if(QueryExtent.right <= this->extent.left 
-		|| QueryExtent.left >= this->extent.right
-		|| QueryExtent.top <= this->extent.bottom
-		|| QueryExtent.bottom >= this->extent.top)*/
 	{
-		return result;
+		return;
 	}
 	
-	unsigned int nodeNumber = nodes.size();
-	double middleX = (this->extent.left + this->extent.right) /2;
-	double middleY = (this->extent.top + this->extent.bottom) /2;
-	
-	if(LT != NULL)
-	{
-		vector<int> lt = LT->GetNodes(QueryExtent);
-		if(lt.size()>0)
-		{
-			for(unsigned int i = 0; i< lt.size(); i++)
-				result.push_back(lt[i]);
-		}
-	}
-	if(RT != NULL)
-	{
-		vector<int> rt = RT->GetNodes(QueryExtent);
-		if(rt.size()>0)
-		{
-			for(unsigned int i = 0; i< rt.size(); i++)
-				result.push_back(rt[i]);
-		}
-	}
-	if(LB != NULL)
-	{
-		vector<int> lb = LB->GetNodes(QueryExtent);
-		if(lb.size()>0)
-		{
-			for(unsigned int i = 0; i< lb.size(); i++)
-				result.push_back(lb[i]);
-		}
-	}
+	//children append directly to the same vector, no temporary results
+	if(LT != NULL) LT->GetNodes(QueryExtent, result);
+	if(RT != NULL) RT->GetNodes(QueryExtent, result);
+	if(LB != NULL) LB->GetNodes(QueryExtent, result);
+	if(RB != NULL) RB->GetNodes(QueryExtent, result);
 
-	if(RB != NULL)
-	{
-		vector<int> rb = RB->GetNodes(QueryExtent);
-		if(rb.size()>0)
-		{
-			for(unsigned int i = 0; i< rb.size(); i++)
-				result.push_back(rb[i]);
-		}
-	}
 	for(int i = nodes.size()-1; i>=0; i--)
 	{
 		if(nodes[i]->Extent.IntersectIn(QueryExtent))
 			result.push_back(nodes[i]->index);
 	}
-	return result;
-
 }
@@ -64,7 +64,7 @@ public:
 
 	}
 
-	bool IntersectIn(QTreeExtent& o)
+	bool IntersectIn(const QTreeExtent& o)
 	{
 		return !(o.right < left
 			||o.left > right
@@ -111,6 +111,7 @@ public:
 	void AddNode(const QTreeNode&);
 	bool RemoveNode(int index);//return if success
 	vector<int> GetNodes(QTreeExtent QueryExtent);//Query Nodes
+	void GetNodes(const QTreeExtent& QueryExtent, vector<int>& result);//Query Nodes, appending them to the result
 
 	
 };
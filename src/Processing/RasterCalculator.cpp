@@ -0,0 +1,518 @@
+#include "stdafx.h"
+#include "RasterCalculator.h"
+#include <limits>
+#include "ParallelHelper.h"
+
+// *******************************************************************
+//		ApplyBinary()
+// *******************************************************************
+// Separate loop for each operation, so that it can be vectorized.
+template <typename Op>
+inline void ApplyBinary(const float* left, const float* right, float* result, int count, Op op)
+{
+	for (int i = 0; i < count; i++)
+	{
+		result[i] = op(left[i], right[i]);
+	}
+}
+
+// *******************************************************************
+//		WithNodata()
+// *******************************************************************
+// For operations which don't carry NaN through by themselves.
+inline float WithNodata(float left, float right, float value)
+{
+	return left == left && right == right ? value : std::numeric_limits<float>::quiet_NaN();
+}
+
+// *******************************************************************
+//		Compile()
+// *******************************************************************
+bool RasterCalculator::Compile(CustomExpression& expr)
+{
+	_program.clear();
+	_constants.clear();
+	_result = -1;
+
+	vector<CExpressionPart*>& parts = expr._parts;
+	_numFields = expr.get_NumFields();
+	_numRegisters = _numFields;
+
+	if (parts.size() == 0 || _numFields == 0)
+	{
+		return false;
+	}
+
+	map<CExpressionValue*, Operand> operands;
+
+	for (size_t i = 0; i < parts.size(); i++)
+	{
+		if (parts[i]->isFunction())
+		{
+			return false;
+		}
+
+		for (size_t j = 0; j < parts[i]->elements.size(); j++)
+		{
+			CElement* el = parts[i]->elements[j];
+			if (el->type == etValue && !el->isField && el->partIndex == -1)
+			{
+				if (el->val->type() != vtDouble)
+				{
+					return false;
+				}
+
+				Operand literal = { -1, el->val->dbl() };
+				operands[el->val] = literal;
+			}
+		}
+	}
+
+	for (int i = 0; i < _numFields; i++)
+	{
+		Operand field = { i, 0.0 };
+		operands[expr.get_FieldValue(i)] = field;
+	}
+
+	vector<CExpressionValue*> partValues(parts.size(), NULL);
+
+	// the same steps as CustomExpression::Calculate takes, see CompiledExpression::CompileParts
+	bool saveOperations = expr._saveOperations;
+	expr._saveOperations = false;
+	expr.Reset();
+	expr.ResetActiveCountForParts();
+
+	bool result = true;
+	for (size_t i = 0; i < parts.size() && result; i++)
+	{
+		CExpressionPart* part = parts[i];
+
+		while (part->activeCount > 1)
+		{
+			COperation operation;
+			if (!expr.FindOperation(part, operation) || !CompileOperation(part, operation, operands, partValues))
+			{
+				result = false;
+				break;
+			}
+
+			part->activeCount -= operation.binaryOperation ? 2 : 1;
+		}
+
+		if (!result || part->activeCount != 1)
+		{
+			result = false;
+			break;
+		}
+
+		for (size_t j = 0; j < part->elements.size(); j++)
+		{
+			if (!part->elements[j]->turnedOff)
+			{
+				partValues[i] = GetValue(part, j, partValues);
+				part->elements[j]->turnedOff = true;
+				break;
+			}
+		}
+
+		result = partValues[i] != NULL;
+	}
+
+	expr._saveOperations = saveOperations;
+	expr.Reset();
+
+	if (!result)
+	{
+		return false;
+	}
+
+	// the result of the expression must be raster, numbers or booleans can't be written
+	map<CExpressionValue*, Operand>::iterator it = operands.find(partValues[parts.size() - 1]);
+	if (it == operands.end() || it->second.reg == -1)
+	{
+		return false;
+	}
+
+	_result = it->second.reg;
+	return true;
+}
+
+// *******************************************************************
+//		CompileOperation()
+// *******************************************************************
+// Type checks of CustomExpression::CalculateOperation for float arrays.
+bool RasterCalculator::CompileOperation(CExpressionPart* part, COperation& operation,
+										map<CExpressionValue*, Operand>& operands, vector<CExpressionValue*>& partValues)
+{
+	tkOperation oper = part->elements[operation.id]->operation;
+	bool unary = oper == operNOT || oper == operChangeSign;
+
+	// unary operators write to the right operand, binary ones to the left
+	CElement* target = part->elements[unary ? operation.right : operation.left];
+
+	CExpressionValue* rightValue = GetValue(part, operation.right, partValues);
+	CExpressionValue* leftValue = unary ? NULL : GetValue(part, operation.left, partValues);
+
+	map<CExpressionValue*, Operand>::iterator right = operands.find(rightValue);
+	map<CExpressionValue*, Operand>::iterator left = unary ? operands.end() : operands.find(leftValue);
+	if (right == operands.end() || (!unary && left == operands.end()))
+	{
+		return false;
+	}
+
+	Operand result = { -1, 0.0 };
+
+	if (oper == operChangeSign)
+	{
+		if (right->second.reg == -1)
+		{
+			result.constant = -right->second.constant;
+		}
+		else
+		{
+			Instruction instruction = { icChangeSign, right->second.reg, right->second.reg, _numRegisters++ };
+			_program.push_back(instruction);
+			result.reg = instruction.result;
+		}
+	}
+	else if (unary)
+	{
+		return false;
+	}
+	else if (left->second.reg == -1 && right->second.reg == -1)
+	{
+		if (!FoldConstants(oper, left->second.constant, right->second.constant, result.constant))
+		{
+			return false;
+		}
+	}
+	else
+	{
+		InstructionCode code;
+		if (!GetInstructionCode(oper, code))
+		{
+			return false;
+		}
+
+		// the interpreter applies logical operators to two float arrays only
+		if ((code == icAnd || code == icOr) && (left->second.reg == -1 || right->second.reg == -1))
+		{
+			return false;
+		}
+
+		Instruction instruction = { code, GetRegister(left->second), GetRegister(right->second), _numRegisters++ };
+		_program.push_back(instruction);
+		result.reg = instruction.result;
+	}
+
+	operands[target->calcVal] = result;
+
+	// the same flags as CustomExpression::CalculateOperation sets
+	target->wasCalculated = true;
+	part->elements[operation.id]->turnedOff = true;
+	if (!unary)
+	{
+		part->elements[operation.right]->turnedOff = true;
+	}
+
+	return true;
+}
+
+// *******************************************************************
+//		FoldConstants()
+// *******************************************************************
+// Arithmetic on numbers the way the interpreter does it; comparisons give
+// booleans which can't be combined with rasters.
+bool RasterCalculator::FoldConstants(tkOperation operation, double left, double right, double& result)
+{
+	switch (operation)
+	{
+		case operPlus:	result = left + right; return true;
+		case operMinus:	result = left - right; return true;
+		case operMult:	result = left * right; return true;
+		case operExpon:	result = pow(left, right); return true;
+		case operDiv:
+			if (right == 0.0)
+				return false;
+			result = left / right;
+			return true;
+		case operDivInt:
+			if ((int)right == 0)
+				return false;
+			result = double((int)left / (int)right);
+			return true;
+		case operMOD:
+			if ((int)right == 0)
+				return false;
+			result = double((int)left % (int)right);
+			return true;
+	}
+	return false;
+}
+
+// *******************************************************************
+//		GetInstructionCode()
+// *******************************************************************
+// Binary operations which the interpreter applies to float arrays (see CustomExpression::GetMatrixOperation).
+bool RasterCalculator::GetInstructionCode(tkOperation operation, InstructionCode& code)
+{
+	switch (operation)
+	{
+		case operPlus:		code = icPlus; return true;
+		case operMinus:		code = icMinus; return true;
+		case operMult:		code = icMult; return true;
+		case operDiv:		code = icDiv; return true;
+		case operDivInt:	code = icDiv; return true;		// as RasterMatrix does it
+		case operExpon:		code = icExpon; return true;
+		case operEqual:		code = icEqual; return true;
+		case operNotEqual:	code = icNotEqual; return true;
+		case operGreater:	code = icGreater; return true;
+		case operLess:		code = icLess; return true;
+		case operGrEqual:	code = icGrEqual; return true;
+		case operLessEqual:	code = icLessEqual; return true;
+		case operAND:		code = icAnd; return true;
+		case operOR:		code = icOr; return true;
+	}
+	return false;
+}
+
+// *******************************************************************
+//		GetRegister()
+// *******************************************************************
+int RasterCalculator::GetRegister(const Operand& operand)
+{
+	if (operand.reg != -1)
+	{
+		return operand.reg;
+	}
+
+	// the same conversion RasterMatrix is built with
+	int reg = _numRegisters++;
+	_constants.push_back(pair<int, float>(reg, (float)operand.constant));
+	return reg;
+}
+
+// *******************************************************************
+//		GetValue()
+// *******************************************************************
+// See CompiledExpression::GetValue.
+CExpressionValue* RasterCalculator::GetValue(CExpressionPart* part, int elementId, vector<CExpressionValue*>& partValues)
+{
+	CElement* element = part->elements[elementId];
+
+	if (element->wasCalculated)
+	{
+		return element->calcVal;
+	}
+
+	if (element->partIndex != -1)
+	{
+		return element->partIndex < (int)partValues.size() ? partValues[element->partIndex] : NULL;
+	}
+
+	return element->val;
+}
+
+// *******************************************************************
+//		RunProgram()
+// *******************************************************************
+void RasterCalculator::RunProgram(float* registers, int count)
+{
+	for (size_t i = 0; i < _program.size(); i++)
+	{
+		RunInstruction(_program[i], registers, count);
+	}
+}
+
+// *******************************************************************
+//		RunInstruction()
+// *******************************************************************
+// Values are calculated in double precision and stored as float, as RasterMatrix does.
+void RasterCalculator::RunInstruction(const Instruction& instruction, float* registers, int count)
+{
+	const float* a = registers + (size_t)instruction.left * RASTER_CALCULATOR_CHUNK_SIZE;
+	const float* b = registers + (size_t)instruction.right * RASTER_CALCULATOR_CHUNK_SIZE;
+	float* r = registers + (size_t)instruction.result * RASTER_CALCULATOR_CHUNK_SIZE;
+	const float nan = std::numeric_limits<float>::quiet_NaN();
+
+	switch (instruction.code)
+	{
+		case icChangeSign:
+			for (int i = 0; i < count; i++)
+			{
+				r[i] = -a[i];
+			}
+			break;
+		case icPlus:
+			ApplyBinary(a, b, r, count, [](float x, float y) { return (float)((double)x + y); });
+			break;
+		case icMinus:
+			ApplyBinary(a, b, r, count, [](float x, float y) { return (float)((double)x - y); });
+			break;
+		case icMult:
+			ApplyBinary(a, b, r, count, [](float x, float y) { return (float)((double)x * y); });
+			break;
+		case icDiv:
+			ApplyBinary(a, b, r, count, [nan](float x, float y) { return y != 0.0f ? (float)((double)x / y) : nan; });
+			break;
+		case icExpon:
+			for (int i = 0; i < count; i++)
+			{
+				// no complex numbers
+				double base = a[i], power = b[i];
+				bool valid = !((base == 0 && power < 0) || (power < 0 && (power - floor(power)) > 0));
+				r[i] = WithNodata(a[i], b[i], valid ? (float)pow(base, power) : nan);
+			}
+			break;
+		case icEqual:
+			ApplyBinary(a, b, r, count, [](float x, float y) { return WithNodata(x, y, x == y ? 1.0f : 0.0f); });
+			break;
+		case icNotEqual:
+			ApplyBinary(a, b, r, count, [](float x, float y) { return WithNodata(x, y, x == y ? 0.0f : 1.0f); });
+			break;
+		case icGreater:
+			ApplyBinary(a, b, r, count, [](float x, float y) { return WithNodata(x, y, x > y ? 1.0f : 0.0f); });
+			break;
+		case icLess:
+			ApplyBinary(a, b, r, count, [](float x, float y) { return WithNodata(x, y, x < y ? 1.0f : 0.0f); });
+			break;
+		case icGrEqual:
+			ApplyBinary(a, b, r, count, [](float x, float y) { return WithNodata(x, y, x >= y ? 1.0f : 0.0f); });
+			break;
+		case icLessEqual:
+			ApplyBinary(a, b, r, count, [](float x, float y) { return WithNodata(x, y, x <= y ? 1.0f : 0.0f); });
+			break;
+		case icAnd:
+			ApplyBinary(a, b, r, count, [](float x, float y) { return WithNodata(x, y, x != 0.0f && y != 0.0f ? 1.0f : 0.0f); });
+			break;
+		case icOr:
+			ApplyBinary(a, b, r, count, [](float x, float y) { return WithNodata(x, y, x != 0.0f || y != 0.0f ? 1.0f : 0.0f); });
+			break;
+	}
+}
+
+// *******************************************************************
+//		Run()
+// *******************************************************************
+bool RasterCalculator::Run(vector<GDALRasterBand*>& bands, GDALRasterBand* output, float outputNodata, ICallback* cBack, BSTR& key)
+{
+	if (_result == -1 || (int)bands.size() != _numFields)
+	{
+		return false;
+	}
+
+	const int xSize = output->GetXSize();
+	const int ySize = output->GetYSize();
+
+	// as RasterMatrix compares them: float value with double nodata
+	vector<float> nodata(_numFields);
+	vector<bool> hasNodata(_numFields);
+	for (int i = 0; i < _numFields; i++)
+	{
+		double value = bands[i]->GetNoDataValue();
+		nodata[i] = (float)value;
+		hasNodata[i] = (double)nodata[i] == value;
+	}
+
+	// stripes are made of whole blocks unless a single row of blocks doesn't fit in memory
+	int blockX = 0, blockY = 0;
+	bands[0]->GetBlockSize(&blockX, &blockY);
+	blockY = max(1, blockY);
+
+	__int64 rowSize = (__int64)xSize * sizeof(float) * (_numFields + 1);
+	int rowsPerStripe = max(1, (int)(RASTER_CALCULATOR_STRIPE_MEMORY / rowSize));
+	if (rowsPerStripe >= blockY)
+		rowsPerStripe = rowsPerStripe / blockY * blockY;
+	rowsPerStripe = min(rowsPerStripe, ySize);
+
+	vector<vector<float>> inputs(_numFields);
+	vector<float> results;
+
+	try
+	{
+		for (int i = 0; i < _numFields; i++)
+		{
+			inputs[i].resize((size_t)rowsPerStripe * xSize);
+		}
+		results.resize((size_t)rowsPerStripe * xSize);
+	}
+	catch (std::bad_alloc&)
+	{
+		return false;
+	}
+
+	long percent = 0;
+
+	for (int firstRow = 0; firstRow < ySize; firstRow += rowsPerStripe)
+	{
+		const int numRows = min(rowsPerStripe, ySize - firstRow);
+
+		for (int i = 0; i < _numFields; i++)
+		{
+			if (bands[i]->RasterIO(GF_Read, 0, firstRow, xSize, numRows, &inputs[i][0], xSize, numRows, GDT_Float32, 0, 0) != CE_None)
+			{
+				return false;
+			}
+		}
+
+		const int count = numRows * xSize;
+		const int numChunks = (count + RASTER_CALCULATOR_CHUNK_SIZE - 1) / RASTER_CALCULATOR_CHUNK_SIZE;
+
+		auto calculate = [&](int begin, int end)
+		{
+			const float nan = std::numeric_limits<float>::quiet_NaN();
+
+			vector<float> registers((size_t)_numRegisters * RASTER_CALCULATOR_CHUNK_SIZE);
+			for (size_t i = 0; i < _constants.size(); i++)
+			{
+				float* reg = &registers[(size_t)_constants[i].first * RASTER_CALCULATOR_CHUNK_SIZE];
+				std::fill(reg, reg + RASTER_CALCULATOR_CHUNK_SIZE, _constants[i].second);
+			}
+
+			for (int chunk = begin; chunk < end; chunk++)
+			{
+				const int first = chunk * RASTER_CALCULATOR_CHUNK_SIZE;
+				const int size = min(RASTER_CALCULATOR_CHUNK_SIZE, count - first);
+
+				for (int i = 0; i < _numFields; i++)
+				{
+					const float* source = &inputs[i][first];
+					float* reg = &registers[(size_t)i * RASTER_CALCULATOR_CHUNK_SIZE];
+
+					if (hasNodata[i])
+					{
+						const float nodv = nodata[i];
+						for (int j = 0; j < size; j++)
+						{
+							reg[j] = source[j] == nodv ? nan : source[j];
+						}
+					}
+					else
+					{
+						memcpy(reg, source, size * sizeof(float));
+					}
+				}
+
+				RunProgram(&registers[0], size);
+
+				const float* values = &registers[(size_t)_result * RASTER_CALCULATOR_CHUNK_SIZE];
+				float* target = &results[first];
+				for (int j = 0; j < size; j++)
+				{
+					target[j] = values[j] == values[j] ? values[j] : outputNodata;
+				}
+			}
+		};
+
+		ParallelHelper::For(numChunks, 0, calculate, 16);
+
+		if (output->RasterIO(GF_Write, 0, firstRow, xSize, numRows, &results[0], xSize, numRows, GDT_Float32, 0, 0) != CE_None)
+		{
+			return false;
+		}
+
+		CallbackHelper::Progress(cBack, firstRow + numRows, ySize, "Calculating", key, percent);
+	}
+
+	return true;
+}
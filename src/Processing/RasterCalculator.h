@@ -0,0 +1,88 @@
+/////////////////////////////////////////////
+// RasterCalculator.h
+// Description: map algebra expression evaluated over stripes of rasters
+////////////////////////////////////////////
+// The interpreter applies each operation to a whole row of pixels and allocates
+// a RasterMatrix for each of them. Here the operations of CustomExpression
+// are compiled once to a list of instructions over registers (one for each field,
+// literal and result of operation), which is then run for chunks of pixels small
+// enough for all the registers to stay in cache. The inputs are read in stripes
+// of rows aligned with the blocks of the first band, the chunks of a stripe are
+// shared between the threads of the pool, and the result is written before
+// the next stripe is read, so memory usage doesn't depend on the size of rasters.
+//
+// Nodata pixels of inputs become NaN within the program; they are passed through
+// by all the operations, as well as division by zero and invalid powers.
+// Expressions the interpreter can't apply to float arrays (functions, boolean
+// values, XOR, MOD) aren't compiled and are left to the interpreter.
+//////////////////////////////////////////////////////////
+#pragma once
+#include "CustomExpression.h"
+
+#define RASTER_CALCULATOR_CHUNK_SIZE 1024
+#define RASTER_CALCULATOR_STRIPE_MEMORY (64 * 1024 * 1024)
+
+class RasterCalculator
+{
+public:
+	RasterCalculator()
+		: _numRegisters(0), _numFields(0), _result(-1)
+	{
+	}
+
+private:
+	// register or literal; literals are folded while they aren't combined with rasters
+	struct Operand
+	{
+		int reg;				// -1 for literals
+		double constant;
+	};
+
+	enum InstructionCode
+	{
+		icPlus,
+		icMinus,
+		icMult,
+		icDiv,
+		icExpon,
+		icEqual,
+		icNotEqual,
+		icGreater,
+		icLess,
+		icGrEqual,
+		icLessEqual,
+		icAnd,
+		icOr,
+		icChangeSign,			// unary, the operand is in the left register
+	};
+
+	struct Instruction
+	{
+		InstructionCode code;
+		int left;					// registers
+		int right;
+		int result;
+	};
+
+	vector<Instruction> _program;
+	vector<pair<int, float>> _constants;	// registers which hold literals
+	int _numRegisters;
+	int _numFields;
+	int _result;
+
+private:
+	bool CompileOperation(CExpressionPart* part, COperation& operation,
+						  map<CExpressionValue*, Operand>& operands, vector<CExpressionValue*>& partValues);
+	bool FoldConstants(tkOperation operation, double left, double right, double& result);
+	static bool GetInstructionCode(tkOperation operation, InstructionCode& code);
+	int GetRegister(const Operand& operand);
+	CExpressionValue* GetValue(CExpressionPart* part, int elementId, vector<CExpressionValue*>& partValues);
+	void RunProgram(float* registers, int count);
+	static void RunInstruction(const Instruction& instruction, float* registers, int count);
+
+public:
+	// Fields of the expression must be in the same order as bands passed to Run.
+	bool Compile(CustomExpression& expr);
+
+	bool Run(vector<GDALRasterBand*>& bands, GDALRasterBand* output, float outputNodata, ICallback* cBack, BSTR& key);
+};
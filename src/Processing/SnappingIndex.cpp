@@ -0,0 +1,307 @@
+#include "StdAfx.h"
+#include "SnappingIndex.h"
+#include "Shape.h"
+#include "ShapeUtility.h"
+
+// cell coordinates are kept far from the limits of long, so that their differences don't overflow
+#define SNAPPING_INDEX_MAX_CELL (1L << 29)
+
+// *******************************************************************
+//		Init()
+// *******************************************************************
+void SnappingIndex::Init(const Extent& bounds, long numShapes)
+{
+	Clear();
+
+	Extent box = bounds;
+	double count = MAX(1.0, (double)numShapes);
+
+	_cellSize = sqrt(box.Width() * box.Height() / count);
+	if (!(_cellSize > 0.0))
+		_cellSize = MAX(box.Width(), box.Height()) / count;
+	if (!(_cellSize > 0.0))
+		_cellSize = 1.0;
+
+	_originX = box.left;
+	_originY = box.bottom;
+}
+
+// *******************************************************************
+//		Clear()
+// *******************************************************************
+void SnappingIndex::Clear()
+{
+	for (size_t i = 0; i < _items.size(); i++)
+	{
+		delete _items[i];
+	}
+	_items.clear();
+	_cells.clear();
+
+	_minCellX = _minCellY = LONG_MAX;
+	_maxCellX = _maxCellY = LONG_MIN;
+}
+
+// *******************************************************************
+//		CellX(), CellY()
+// *******************************************************************
+long SnappingIndex::CellX(double x)
+{
+	double cx = floor((x - _originX) / _cellSize);
+	return cx < -SNAPPING_INDEX_MAX_CELL ? -SNAPPING_INDEX_MAX_CELL : cx > SNAPPING_INDEX_MAX_CELL ? SNAPPING_INDEX_MAX_CELL : (long)cx;
+}
+
+long SnappingIndex::CellY(double y)
+{
+	double cy = floor((y - _originY) / _cellSize);
+	return cy < -SNAPPING_INDEX_MAX_CELL ? -SNAPPING_INDEX_MAX_CELL : cy > SNAPPING_INDEX_MAX_CELL ? SNAPPING_INDEX_MAX_CELL : (long)cy;
+}
+
+// *******************************************************************
+//		InsertShape()
+// *******************************************************************
+// The shapes with the same or greater index are shifted.
+void SnappingIndex::InsertShape(long shapeIndex, IShape* shape)
+{
+	if (shapeIndex < 0 || shapeIndex > (long)_items.size())
+		return;
+
+	Item* item = new Item();
+	item->shapeIndex = shapeIndex;
+	ReadShape(item, shape);
+	RegisterItem(item);
+
+	_items.insert(_items.begin() + shapeIndex, item);
+
+	for (size_t i = shapeIndex + 1; i < _items.size(); i++)
+	{
+		_items[i]->shapeIndex++;
+	}
+}
+
+// *******************************************************************
+//		UpdateShape()
+// *******************************************************************
+void SnappingIndex::UpdateShape(long shapeIndex, IShape* shape)
+{
+	if (shapeIndex < 0 || shapeIndex >= (long)_items.size())
+		return;
+
+	Item* item = _items[shapeIndex];
+	UnregisterItem(item);
+	ReadShape(item, shape);
+	RegisterItem(item);
+}
+
+// *******************************************************************
+//		IsCurrent()
+// *******************************************************************
+// Whether the points of shape weren't changed since they were read.
+bool SnappingIndex::IsCurrent(long shapeIndex, IShape* shape)
+{
+	if (shapeIndex < 0 || shapeIndex >= (long)_items.size())
+		return false;
+
+	return shape ? _items[shapeIndex]->stamp == ((CShape*)shape)->get_ModificationStamp() : _items[shapeIndex]->points.empty();
+}
+
+// *******************************************************************
+//		RemoveShape()
+// *******************************************************************
+void SnappingIndex::RemoveShape(long shapeIndex)
+{
+	if (shapeIndex < 0 || shapeIndex >= (long)_items.size())
+		return;
+
+	Item* item = _items[shapeIndex];
+	UnregisterItem(item);
+	delete item;
+
+	_items.erase(_items.begin() + shapeIndex);
+
+	for (size_t i = shapeIndex; i < _items.size(); i++)
+	{
+		_items[i]->shapeIndex--;
+	}
+}
+
+// *******************************************************************
+//		ReadShape()
+// *******************************************************************
+void SnappingIndex::ReadShape(Item* item, IShape* shape)
+{
+	item->points.clear();
+	item->segments.clear();
+	item->stamp = 0;
+
+	if (!shape)
+		return;
+
+	CShape* shp = (CShape*)shape;
+	item->stamp = shp->get_ModificationStamp();
+
+	long numPoints = 0;
+	shape->get_NumPoints(&numPoints);
+	if (numPoints <= 0)
+		return;
+
+	item->points.resize(numPoints);
+	for (long i = 0; i < numPoints; i++)
+	{
+		shp->get_XY(i, &item->points[i].x, &item->points[i].y);
+	}
+
+	ShpfileType shpType;
+	shape->get_ShapeType(&shpType);
+	shpType = ShapeUtility::Convert2D(shpType);
+
+	if (shpType == SHP_POINT || shpType == SHP_MULTIPOINT)
+	{
+		for (int i = 0; i < numPoints; i++)
+		{
+			item->segments.push_back(pair<int, int>(i, i));
+		}
+		return;
+	}
+
+	long numParts = 0;
+	shape->get_NumParts(&numParts);
+
+	vector<long> parts;
+	for (long j = 0; j < numParts; j++)
+	{
+		long part = 0;
+		shape->get_Part(j, &part);
+		parts.push_back(part);
+	}
+	if (parts.empty())
+		parts.push_back(0);
+
+	for (size_t j = 0; j < parts.size(); j++)
+	{
+		long start = parts[j];
+		long end = j == parts.size() - 1 ? numPoints : MIN(parts[j + 1], numPoints);
+
+		if (start < 0 || start >= end)
+			continue;
+
+		if (end - start == 1)
+		{
+			item->segments.push_back(pair<int, int>(start, start));
+			continue;
+		}
+
+		// polygon rings are treated as polylines
+		for (long i = start; i < end - 1; i++)
+		{
+			item->segments.push_back(pair<int, int>(i, i + 1));
+		}
+	}
+}
+
+// *******************************************************************
+//		AddCell()
+// *******************************************************************
+SnappingIndex::Cell& SnappingIndex::AddCell(long cx, long cy, Item* item)
+{
+	__int64 key = CellKey(cx, cy);
+	item->cells.push_back(key);
+
+	if (cx < _minCellX) _minCellX = cx;
+	if (cx > _maxCellX) _maxCellX = cx;
+	if (cy < _minCellY) _minCellY = cy;
+	if (cy > _maxCellY) _maxCellY = cy;
+
+	return _cells[key];
+}
+
+// *******************************************************************
+//		RegisterItem()
+// *******************************************************************
+void SnappingIndex::RegisterItem(Item* item)
+{
+	item->cells.clear();
+
+	for (size_t i = 0; i < item->points.size(); i++)
+	{
+		const Point2D& pnt = item->points[i];
+		Entry entry = { item, (int)i };
+		AddCell(CellX(pnt.x), CellY(pnt.y), item).vertices.push_back(entry);
+	}
+
+	// a segment is added to the cells it passes through, column by column
+	for (size_t i = 0; i < item->segments.size(); i++)
+	{
+		const Point2D& p1 = item->points[item->segments[i].first];
+		const Point2D& p2 = item->points[item->segments[i].second];
+		Entry entry = { item, (int)i };
+
+		double xMin = MIN(p1.x, p2.x), xMax = MAX(p1.x, p2.x);
+		long firstCol = CellX(xMin), lastCol = CellX(xMax);
+
+		for (long cx = firstCol; cx <= lastCol; cx++)
+		{
+			double yMin = MIN(p1.y, p2.y), yMax = MAX(p1.y, p2.y);
+
+			if (p1.x != p2.x)
+			{
+				// the part of the segment within the column
+				double x1 = MAX(xMin, _originX + cx * _cellSize);
+				double x2 = MIN(xMax, _originX + (cx + 1) * _cellSize);
+				double y1 = p1.y + (p2.y - p1.y) * (x1 - p1.x) / (p2.x - p1.x);
+				double y2 = p1.y + (p2.y - p1.y) * (x2 - p1.x) / (p2.x - p1.x);
+				yMin = MAX(yMin, MIN(y1, y2));
+				yMax = MIN(yMax, MAX(y1, y2));
+			}
+
+			// a margin for rounding; queries rely on the segment being in all the cells it crosses
+			double margin = _cellSize * 1e-9;
+			long firstRow = CellY(yMin - margin), lastRow = CellY(yMax + margin);
+			for (long cy = firstRow; cy <= lastRow; cy++)
+			{
+				AddCell(cx, cy, item).segments.push_back(entry);
+			}
+		}
+	}
+
+	sort(item->cells.begin(), item->cells.end());
+	item->cells.erase(unique(item->cells.begin(), item->cells.end()), item->cells.end());
+}
+
+// *******************************************************************
+//		UnregisterItem()
+// *******************************************************************
+void SnappingIndex::UnregisterItem(Item* item)
+{
+	for (size_t i = 0; i < item->cells.size(); i++)
+	{
+		std::unordered_map<__int64, Cell>::iterator it = _cells.find(item->cells[i]);
+		if (it == _cells.end())
+			continue;
+
+		Cell& cell = it->second;
+		cell.vertices.erase(remove_if(cell.vertices.begin(), cell.vertices.end(), [item](const Entry& e) { return e.item == item; }), cell.vertices.end());
+		cell.segments.erase(remove_if(cell.segments.begin(), cell.segments.end(), [item](const Entry& e) { return e.item == item; }), cell.segments.end());
+
+		if (cell.vertices.empty() && cell.segments.empty())
+			_cells.erase(it);
+	}
+	item->cells.clear();
+}
+
+// *******************************************************************
+//		GetDistanceToSegment()
+// *******************************************************************
+double SnappingIndex::GetDistanceToSegment(double x, double y, const Point2D& p1, const Point2D& p2, double& fx, double& fy)
+{
+	double dx = p2.x - p1.x;
+	double dy = p2.y - p1.y;
+	double length2 = dx * dx + dy * dy;
+
+	double t = length2 > 0.0 ? ((x - p1.x) * dx + (y - p1.y) * dy) / length2 : 0.0;
+	t = t < 0.0 ? 0.0 : t > 1.0 ? 1.0 : t;
+
+	fx = p1.x + t * dx;
+	fy = p1.y + t * dy;
+	return sqrt((x - fx) * (x - fx) + (y - fy) * (y - fy));
+}
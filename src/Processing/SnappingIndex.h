@@ -0,0 +1,218 @@
+/////////////////////////////////////////////
+// SnappingIndex.h
+// Description: uniform grid of vertices and segments for snapping queries
+////////////////////////////////////////////
+// The coordinates of shapes are copied into the index, and each vertex and segment
+// is registered in the cells of the grid it passes through. A query visits the rings of cells
+// around the point and stops as soon as the closest item found so far is nearer than
+// the next ring, so it reads only a few cells regardless of the size of shapefile.
+// The cell size is chosen so that there is about one shape per cell; cells
+// are kept in a hash map, so shapes added outside the initial bounds are fine.
+//
+// Entries reference shapes by pointer rather than by index, so insertion and removal
+// of a shape only renumber the indices held by the shapes after it.
+// Points of point and multipoint shapes are stored as segments of zero length,
+// so that snapping to lines returns them as well.
+//////////////////////////////////////////////////////////
+#pragma once
+#include <unordered_map>
+
+class SnappingIndex
+{
+public:
+	SnappingIndex()
+		: _cellSize(1.0), _originX(0.0), _originY(0.0),
+		  _minCellX(LONG_MAX), _minCellY(LONG_MAX), _maxCellX(LONG_MIN), _maxCellY(LONG_MIN)
+	{
+	}
+
+	~SnappingIndex()
+	{
+		Clear();
+	}
+
+private:
+	struct Item
+	{
+		long shapeIndex;
+		long stamp;							// CShape modification stamp of the points
+		vector<Point2D> points;
+		vector<pair<int, int>> segments;	// the first and last point; they are the same for single points
+		vector<__int64> cells;				// cells with the entries of the shape
+	};
+
+	struct Entry
+	{
+		Item* item;
+		int index;		// of point or segment
+	};
+
+	struct Cell
+	{
+		vector<Entry> vertices;
+		vector<Entry> segments;
+	};
+
+	double _cellSize;
+	double _originX;
+	double _originY;
+	long _minCellX;		// bounds of cells which were ever used
+	long _minCellY;
+	long _maxCellX;
+	long _maxCellY;
+
+	vector<Item*> _items;		// by shape index
+	std::unordered_map<__int64, Cell> _cells;
+
+private:
+	long CellX(double x);
+	long CellY(double y);
+	static __int64 CellKey(long cx, long cy) { return ((__int64)cx << 32) | (unsigned long)cy; }
+
+	Cell& AddCell(long cx, long cy, Item* item);
+	void ReadShape(Item* item, IShape* shape);
+	void RegisterItem(Item* item);
+	void UnregisterItem(Item* item);
+
+	static double GetDistanceToSegment(double x, double y, const Point2D& p1, const Point2D& p2, double& fx, double& fy);
+
+	// Calls visitor(cell) for the cells at the distance r (in cells) from the given one.
+	template <typename Visitor>
+	void VisitRing(long cx, long cy, long r, Visitor& visitor)
+	{
+		long xMin = MAX(cx - r, _minCellX), xMax = MIN(cx + r, _maxCellX);
+		long yMin = MAX(cy - r + 1, _minCellY), yMax = MIN(cy + r - 1, _maxCellY);
+
+		for (long i = xMin; i <= xMax; i++)
+		{
+			VisitCell(i, cy - r, visitor);
+			if (r > 0) VisitCell(i, cy + r, visitor);
+		}
+
+		if (r == 0)
+			return;
+
+		for (long j = yMin; j <= yMax; j++)
+		{
+			VisitCell(cx - r, j, visitor);
+			VisitCell(cx + r, j, visitor);
+		}
+	}
+
+	template <typename Visitor>
+	void VisitCell(long cx, long cy, Visitor& visitor)
+	{
+		std::unordered_map<__int64, Cell>::iterator it = _cells.find(CellKey(cx, cy));
+		if (it != _cells.end())
+			visitor(it->second);
+	}
+
+	// Visits the rings of cells around the point until the closest item found is nearer than the next ring.
+	template <typename Visitor>
+	void Search(double x, double y, double maxDistance, double& minDistance, Visitor& visitor)
+	{
+		if (_items.empty() || _minCellX > _maxCellX)
+			return;
+
+		long cx = CellX(x);
+		long cy = CellY(y);
+
+		// the rings before the used cells are empty
+		long first = MAX(MAX(_minCellX - cx, cx - _maxCellX), MAX(_minCellY - cy, cy - _maxCellY));
+		first = MAX(first, 0L);
+
+		long last = MAX(MAX(cx - _minCellX, _maxCellX - cx), MAX(cy - _minCellY, _maxCellY - cy));
+		if (maxDistance < DBL_MAX)
+		{
+			double rings = ceil(maxDistance / _cellSize) + 1;
+			if (rings < last) last = (long)rings;
+		}
+
+		for (long r = first; r <= last; r++)
+		{
+			VisitRing(cx, cy, r, visitor);
+
+			// the cells of the next ring are at least r cells away
+			if (minDistance <= r * _cellSize)
+				break;
+		}
+	}
+
+public:
+	// Bounds and number of shapes are used to choose the cell size only.
+	void Init(const Extent& bounds, long numShapes);
+	void Clear();
+
+	void InsertShape(long shapeIndex, IShape* shape);
+	void UpdateShape(long shapeIndex, IShape* shape);
+	void RemoveShape(long shapeIndex);
+	long get_NumShapes() { return (long)_items.size(); }
+	bool IsCurrent(long shapeIndex, IShape* shape);
+
+	// *******************************************************
+	//		FindClosestVertex()
+	// *******************************************************
+	// Only vertices nearer than maxDistance of the shapes accepted by filter(shapeIndex) are considered.
+	template <typename Filter>
+	bool FindClosestVertex(double x, double y, double maxDistance, Filter& filter, long& shapeIndex, long& pointIndex, double& distance)
+	{
+		double minDistance = DBL_MAX;
+
+		auto visitor = [&](Cell& cell)
+		{
+			for (size_t i = 0; i < cell.vertices.size(); i++)
+			{
+				const Entry& entry = cell.vertices[i];
+				const Point2D& pnt = entry.item->points[entry.index];
+				double dist = sqrt((x - pnt.x) * (x - pnt.x) + (y - pnt.y) * (y - pnt.y));
+
+				if (dist < minDistance && dist < maxDistance && filter(entry.item->shapeIndex))
+				{
+					minDistance = dist;
+					shapeIndex = entry.item->shapeIndex;
+					pointIndex = entry.index;
+				}
+			}
+		};
+
+		Search(x, y, maxDistance, minDistance, visitor);
+
+		distance = minDistance;
+		return minDistance < maxDistance;
+	}
+
+	// *******************************************************
+	//		FindClosestPoint()
+	// *******************************************************
+	// The closest point on the segments of shapes accepted by filter(shapeIndex).
+	template <typename Filter>
+	bool FindClosestPoint(double x, double y, double maxDistance, Filter& filter, long& shapeIndex, double& fx, double& fy, double& distance)
+	{
+		double minDistance = DBL_MAX;
+
+		auto visitor = [&](Cell& cell)
+		{
+			for (size_t i = 0; i < cell.segments.size(); i++)
+			{
+				const Entry& entry = cell.segments[i];
+				const pair<int, int>& segment = entry.item->segments[entry.index];
+
+				double xPnt, yPnt;
+				double dist = GetDistanceToSegment(x, y, entry.item->points[segment.first], entry.item->points[segment.second], xPnt, yPnt);
+
+				if (dist < minDistance && dist < maxDistance && filter(entry.item->shapeIndex))
+				{
+					minDistance = dist;
+					shapeIndex = entry.item->shapeIndex;
+					fx = xPnt;
+					fy = yPnt;
+				}
+			}
+		};
+
+		Search(x, y, maxDistance, minDistance, visitor);
+
+		distance = minDistance;
+		return minDistance < maxDistance;
+	}
+};
@@ -0,0 +1,275 @@
+#include "stdafx.h"
+#include "TerrainProcessor.h"
+#include <limits>
+#include "ParallelHelper.h"
+
+#define TERRAIN_PI 3.14159265358979323846
+
+// *******************************************************
+//		GetOutputType()
+// *******************************************************
+GDALDataType TerrainProcessor::GetOutputType(tkTerrainDerivative derivative)
+{
+	return derivative == tdHillshade ? GDT_Byte : GDT_Float32;
+}
+
+// *******************************************************
+//		GetOutputNodata()
+// *******************************************************
+// Shaded cells of hillshade are set to nodata as well, as GenerateHillShade always did.
+float TerrainProcessor::GetOutputNodata(tkTerrainDerivative derivative)
+{
+	return derivative == tdHillshade ? 0.0f : TERRAIN_FLOAT_NODATA;
+}
+
+// *******************************************************
+//		Process()
+// *******************************************************
+bool TerrainProcessor::Process(GDALRasterBand* input, GDALRasterBand* output, double* geoTransform, ICallback* cBack, BSTR& key)
+{
+	const int xSize = input->GetXSize();
+	const int ySize = input->GetYSize();
+	if (xSize <= 0 || ySize <= 0 || output->GetXSize() != xSize || output->GetYSize() != ySize)
+		return false;
+
+	_ewres = geoTransform[1] * _scale;
+	_nsres = geoTransform[5] * _scale;
+
+	int hasNodata = FALSE;
+	const float inputNodata = (float)input->GetNoDataValue(&hasNodata);
+
+	// stripes are made of whole blocks unless a single row of blocks doesn't fit in memory
+	int blockX = 0, blockY = 0;
+	input->GetBlockSize(&blockX, &blockY);
+	blockY = max(1, blockY);
+
+	int rowsPerStripe = max(1, (int)(TERRAIN_STRIPE_MEMORY / ((__int64)xSize * sizeof(float))));
+	if (rowsPerStripe >= blockY)
+		rowsPerStripe = rowsPerStripe / blockY * blockY;
+	rowsPerStripe = min(rowsPerStripe, ySize);
+
+	vector<float> inputRows;
+	vector<float> outputRows;
+	long percent = 0;
+
+	try
+	{
+		inputRows.resize((size_t)(rowsPerStripe + 2) * xSize);
+		outputRows.resize((size_t)rowsPerStripe * xSize);
+	}
+	catch (std::bad_alloc&)
+	{
+		return false;
+	}
+
+	for (int firstRow = 0; firstRow < ySize; firstRow += rowsPerStripe)
+	{
+		const int numRows = min(rowsPerStripe, ySize - firstRow);
+
+		// the rows above and below the stripe are needed for the window
+		const int readFirst = max(0, firstRow - 1);
+		const int readCount = min(ySize, firstRow + numRows + 1) - readFirst;
+
+		float* data = &inputRows[0];
+		float* result = &outputRows[0];
+
+		if (input->RasterIO(GF_Read, 0, readFirst, xSize, readCount, data, xSize, readCount, GDT_Float32, 0, 0) != CE_None)
+			return false;
+
+		// NaN is carried through the arithmetic, so kernels need a single check per cell
+		if (hasNodata)
+		{
+			const float nan = std::numeric_limits<float>::quiet_NaN();
+			const int count = readCount * xSize;
+
+			auto markNodata = [&](int begin, int end)
+			{
+				for (int i = begin; i < end; i++)
+				{
+					if (data[i] == inputNodata)
+						data[i] = nan;
+				}
+			};
+
+			ParallelHelper::For(count, 0, markNodata, 64 * 1024);
+		}
+
+		auto computeRows = [&](int begin, int end)
+		{
+			for (int i = begin; i < end; i++)
+			{
+				const int row = firstRow + i;
+				float* target = result + (size_t)i * xSize;
+
+				if (row == 0 || row == ySize - 1)
+				{
+					std::fill(target, target + xSize, _outputNodata);
+					continue;
+				}
+
+				const float* center = data + (size_t)(row - readFirst) * xSize;
+				ProcessRow(center - xSize, center, center + xSize, target, xSize);
+			}
+		};
+
+		ParallelHelper::For(numRows, 0, computeRows, TERRAIN_MIN_ROWS_PER_TASK);
+
+		if (output->RasterIO(GF_Write, 0, firstRow, xSize, numRows, result, xSize, numRows, GDT_Float32, 0, 0) != CE_None)
+			return false;
+
+		CallbackHelper::Progress(cBack, firstRow + numRows, ySize, "Calculating", key, percent);
+	}
+
+	CallbackHelper::ProgressCompleted(cBack, key);
+	return true;
+}
+
+// *******************************************************
+//		ProcessRow()
+// *******************************************************
+void TerrainProcessor::ProcessRow(const float* above, const float* row, const float* below, float* output, int xSize)
+{
+	output[0] = _outputNodata;
+	output[xSize - 1] = _outputNodata;
+
+	if (xSize < 3)
+		return;
+
+	switch (_derivative)
+	{
+		case tdHillshade:
+			Hillshade(above, row, below, output, xSize);
+			break;
+		case tdSlope:
+			Slope(above, row, below, output, xSize);
+			break;
+		case tdAspect:
+			Aspect(above, row, below, output, xSize);
+			break;
+		case tdCurvature:
+			Curvature(above, row, below, output, xSize);
+			break;
+		default:
+			std::fill(output, output + xSize, _outputNodata);
+			break;
+	}
+}
+
+// The loops below have no calls or early exits in the body so that the compiler
+// can vectorize them; nodata is detected by NaN in the sum of the window.
+
+// *******************************************************
+//		Hillshade()
+// *******************************************************
+// The same formula as GenerateHillShade used (Horn's gradient, Matt Perry's hillshade):
+//   cang = sin(alt) * sin(slope) + cos(alt) * cos(slope) * cos(az - 90 - aspect),
+// where slope = 90 - atan(sqrt(x^2 + y^2)) and aspect = atan2(x, y); expanded so that
+// no trigonometric functions are evaluated per cell.
+void TerrainProcessor::Hillshade(const float* above, const float* row, const float* below, float* output, int xSize)
+{
+	const double toRadians = TERRAIN_PI / 180.0;
+	const float sinAlt = (float)sin(_altitude * toRadians);
+	const float cosAlt = (float)cos(_altitude * toRadians);
+	const float sinAz = (float)(cosAlt * sin((_azimuth - 90.0) * toRadians));
+	const float cosAz = (float)(cosAlt * cos((_azimuth - 90.0) * toRadians));
+	const float kx = (float)(_zFactor / (8.0 * _ewres));
+	const float ky = (float)(_zFactor / (8.0 * _nsres));
+	const float nodata = _outputNodata;
+
+	for (int j = 1; j < xSize - 1; j++)
+	{
+		const float w0 = above[j - 1], w1 = above[j], w2 = above[j + 1];
+		const float w3 = row[j - 1], w4 = row[j], w5 = row[j + 1];
+		const float w6 = below[j - 1], w7 = below[j], w8 = below[j + 1];
+		const float sum = w0 + w1 + w2 + w3 + w4 + w5 + w6 + w7 + w8;
+
+		const float x = ((w0 + 2 * w3 + w6) - (w2 + 2 * w5 + w8)) * kx;
+		const float y = ((w6 + 2 * w7 + w8) - (w0 + 2 * w1 + w2)) * ky;
+		const float cang = (sinAlt + cosAz * y + sinAz * x) / sqrtf(1.0f + x * x + y * y);
+
+		const float value = cang > 0.0f ? 255.0f * cang : nodata;
+		output[j] = sum == sum ? value : nodata;
+	}
+}
+
+// *******************************************************
+//		Slope()
+// *******************************************************
+// In degrees.
+void TerrainProcessor::Slope(const float* above, const float* row, const float* below, float* output, int xSize)
+{
+	const float toDegrees = (float)(180.0 / TERRAIN_PI);
+	const float kx = (float)(_zFactor / (8.0 * _ewres));
+	const float ky = (float)(_zFactor / (8.0 * _nsres));
+	const float nodata = _outputNodata;
+
+	for (int j = 1; j < xSize - 1; j++)
+	{
+		const float w0 = above[j - 1], w1 = above[j], w2 = above[j + 1];
+		const float w3 = row[j - 1], w4 = row[j], w5 = row[j + 1];
+		const float w6 = below[j - 1], w7 = below[j], w8 = below[j + 1];
+		const float sum = w0 + w1 + w2 + w3 + w4 + w5 + w6 + w7 + w8;
+
+		const float x = ((w0 + 2 * w3 + w6) - (w2 + 2 * w5 + w8)) * kx;
+		const float y = ((w6 + 2 * w7 + w8) - (w0 + 2 * w1 + w2)) * ky;
+		const float value = atanf(sqrtf(x * x + y * y)) * toDegrees;
+
+		output[j] = sum == sum ? value : nodata;
+	}
+}
+
+// *******************************************************
+//		Aspect()
+// *******************************************************
+// Direction of the steepest descent in degrees clockwise from north; -1 for flat cells.
+void TerrainProcessor::Aspect(const float* above, const float* row, const float* below, float* output, int xSize)
+{
+	const float toDegrees = (float)(180.0 / TERRAIN_PI);
+	const float kx = (float)(_zFactor / (8.0 * _ewres));
+	const float ky = (float)(_zFactor / (8.0 * _nsres));
+	const float nodata = _outputNodata;
+
+	for (int j = 1; j < xSize - 1; j++)
+	{
+		const float w0 = above[j - 1], w1 = above[j], w2 = above[j + 1];
+		const float w3 = row[j - 1], w4 = row[j], w5 = row[j + 1];
+		const float w6 = below[j - 1], w7 = below[j], w8 = below[j + 1];
+		const float sum = w0 + w1 + w2 + w3 + w4 + w5 + w6 + w7 + w8;
+
+		// x is the descent towards east, y is the ascent towards north
+		const float x = ((w0 + 2 * w3 + w6) - (w2 + 2 * w5 + w8)) * kx;
+		const float y = ((w6 + 2 * w7 + w8) - (w0 + 2 * w1 + w2)) * ky;
+
+		float value = atan2f(x, -y) * toDegrees;
+		value = value < 0.0f ? value + 360.0f : value;
+		value = x == 0.0f && y == 0.0f ? -1.0f : value;
+
+		output[j] = sum == sum ? value : nodata;
+	}
+}
+
+// *******************************************************
+//		Curvature()
+// *******************************************************
+// Zevenbergen and Thorne's curvature, multiplied by 100 as ArcGIS does; positive values
+// are for convex surfaces, negative ones for concave.
+void TerrainProcessor::Curvature(const float* above, const float* row, const float* below, float* output, int xSize)
+{
+	const float kx = (float)(-200.0 * _zFactor / (_ewres * _ewres));
+	const float ky = (float)(-200.0 * _zFactor / (_nsres * _nsres));
+	const float nodata = _outputNodata;
+
+	for (int j = 1; j < xSize - 1; j++)
+	{
+		const float w0 = above[j - 1], w1 = above[j], w2 = above[j + 1];
+		const float w3 = row[j - 1], w4 = row[j], w5 = row[j + 1];
+		const float w6 = below[j - 1], w7 = below[j], w8 = below[j + 1];
+		const float sum = w0 + w1 + w2 + w3 + w4 + w5 + w6 + w7 + w8;
+
+		const float d = (w3 + w5) * 0.5f - w4;
+		const float e = (w1 + w7) * 0.5f - w4;
+		const float value = d * kx + e * ky;
+
+		output[j] = sum == sum ? value : nodata;
+	}
+}
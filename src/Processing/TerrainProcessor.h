@@ -0,0 +1,57 @@
+/////////////////////////////////////////////
+// TerrainProcessor.h
+// Description: hillshade, slope, aspect and curvature of DEM computed block by block
+////////////////////////////////////////////
+// Instead of reading a 3x3 window for each cell, the input is read in stripes of rows
+// aligned with the blocks of the band (plus a row above and below for the window),
+// each stripe is split into bands of rows which are computed by the thread pool,
+// and the output rows are written before the next stripe is read. GDAL datasets
+// are accessed from the calling thread only.
+//
+// The window is numbered like this (the cell in question is #4):
+//
+//                 0 1 2
+//                 3 4 5
+//                 6 7 8
+//
+// Edge cells and cells with nodata within the window are set to nodata.
+//////////////////////////////////////////////////////////
+#pragma once
+
+#define TERRAIN_STRIPE_MEMORY (32 * 1024 * 1024)
+#define TERRAIN_MIN_ROWS_PER_TASK 8
+#define TERRAIN_FLOAT_NODATA -9999.0f
+
+class TerrainProcessor
+{
+public:
+	TerrainProcessor(tkTerrainDerivative derivative, double zFactor, double scale, double azimuth, double altitude)
+		: _derivative(derivative), _zFactor(zFactor), _scale(scale), _azimuth(azimuth), _altitude(altitude),
+		  _ewres(1.0), _nsres(1.0), _outputNodata(0.0f)
+	{
+		_outputNodata = GetOutputNodata(derivative);
+	}
+
+private:
+	tkTerrainDerivative _derivative;
+	double _zFactor;
+	double _scale;
+	double _azimuth;		// degrees, clockwise from north
+	double _altitude;		// degrees above horizon
+	double _ewres;			// cell size in elevation units, i.e. with scale applied
+	double _nsres;
+	float _outputNodata;
+
+	void ProcessRow(const float* above, const float* row, const float* below, float* output, int xSize);
+	void Hillshade(const float* above, const float* row, const float* below, float* output, int xSize);
+	void Slope(const float* above, const float* row, const float* below, float* output, int xSize);
+	void Aspect(const float* above, const float* row, const float* below, float* output, int xSize);
+	void Curvature(const float* above, const float* row, const float* below, float* output, int xSize);
+
+public:
+	static GDALDataType GetOutputType(tkTerrainDerivative derivative);
+	static float GetOutputNodata(tkTerrainDerivative derivative);
+
+	// The output band must be of the same size as the input one.
+	bool Process(GDALRasterBand* input, GDALRasterBand* output, double* geoTransform, ICallback* cBack, BSTR& key);
+};
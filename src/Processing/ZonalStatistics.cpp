@@ -0,0 +1,399 @@
+#include "StdAfx.h"
+#include "ZonalStatistics.h"
+#include "ParallelHelper.h"
+#include "Shape.h"
+
+// *******************************************************************
+//		~ZonalStatisticsCalculator()
+// *******************************************************************
+ZonalStatisticsCalculator::~ZonalStatisticsCalculator()
+{
+	for (size_t i = 0; i < _zones.size(); i++)
+	{
+		delete _zones[i];
+	}
+	_zones.clear();
+}
+
+// *******************************************************************
+//		AddPolygon()
+// *******************************************************************
+void ZonalStatisticsCalculator::AddPolygon(long shapeIndex, IShape* polygon, long minRow, long maxRow, long firstCol, long lastCol, Extent& bounds)
+{
+	minRow = MAX(minRow, 0);
+	maxRow = MIN(maxRow, _numRows - 1);
+	firstCol = MAX(firstCol, 0);
+	lastCol = MIN(lastCol, _numCols - 1);
+
+	if (!polygon || minRow > maxRow || firstCol > lastCol)
+		return;
+
+	Zone* zone = new Zone();
+	zone->shapeIndex = shapeIndex;
+	zone->minRow = minRow;
+	zone->maxRow = maxRow;
+	zone->firstCol = firstCol;
+	zone->lastCol = lastCol;
+	zone->bounds = bounds;
+	zone->nextEdge = 0;
+	zone->count = 0;
+	zone->sumWeight = 0.0;
+	zone->sum = 0.0;
+	zone->squares = 0.0;
+	zone->min = FLT_MAX;
+	zone->max = -FLT_MAX;
+	zone->minX = 0.0;
+	zone->minY = 0.0;
+
+	if (_centerWithin)
+	{
+		CShape* shape = (CShape*)polygon;
+
+		long numParts = 0, numPoints = 0;
+		polygon->get_NumParts(&numParts);
+		polygon->get_NumPoints(&numPoints);
+
+		vector<long> parts;
+		for (long j = 0; j < numParts; j++)
+		{
+			long part = 0;
+			polygon->get_Part(j, &part);
+			parts.push_back(part);
+		}
+		if (parts.empty())
+			parts.push_back(0);
+
+		for (size_t j = 0; j < parts.size(); j++)
+		{
+			long start = parts[j];
+			long end = j == parts.size() - 1 ? numPoints : parts[j + 1];
+
+			double x1 = 0.0, y1 = 0.0;
+			if (start < end)
+				shape->get_XY(start, &x1, &y1);
+
+			for (long i = start; i < end - 1; i++)
+			{
+				Edge edge;
+				edge.x1 = x1;
+				edge.y1 = y1;
+				shape->get_XY(i + 1, &edge.x2, &edge.y2);
+				x1 = edge.x2;
+				y1 = edge.y2;
+
+				// horizontal edges are never crossed by scanlines
+				if (edge.y1 == edge.y2)
+					continue;
+
+				// the centre of row i is at yll + (numRows - 1 - i) * dy; a row of margin for rounding
+				double yMin = MIN(edge.y1, edge.y2);
+				double yMax = MAX(edge.y1, edge.y2);
+				double first = floor(_numRows - 1 - (yMax - _yll) / _dy) - 1;
+				double last = ceil(_numRows - 1 - (yMin - _yll) / _dy) + 1;
+				if (last < minRow || first > maxRow)
+					continue;
+
+				edge.firstRow = first < minRow ? minRow : (long)first;
+				edge.lastRow = last > maxRow ? maxRow : (long)last;
+				zone->edges.push_back(edge);
+			}
+		}
+
+		sort(zone->edges.begin(), zone->edges.end(), [](const Edge& a, const Edge& b) { return a.firstRow < b.firstRow; });
+	}
+
+	_zones.push_back(zone);
+}
+
+// *******************************************************************
+//		Run()
+// *******************************************************************
+bool ZonalStatisticsCalculator::Run(IGrid* grid, ICallback* cBack, BSTR& key)
+{
+	if (!grid || _zones.empty() || _numCols <= 0)
+		return true;
+
+	vector<Zone*> order(_zones);
+	stable_sort(order.begin(), order.end(), [](Zone* a, Zone* b) { return a->minRow < b->minRow; });
+
+	long stripeRows = MAX(1L, (long)(ZONAL_STATISTICS_STRIPE_MEMORY / ((__int64)_numCols * sizeof(float))));
+	stripeRows = MIN(stripeRows, _numRows);
+
+	vector<float> stripe;
+	try
+	{
+		stripe.resize((size_t)stripeRows * _numCols);
+	}
+	catch (std::bad_alloc&)
+	{
+		_lastErrorCode = tkFAILED_TO_ALLOCATE_MEMORY;
+		return false;
+	}
+
+	vector<Zone*> open;			// polygons which intersect the current stripe
+	size_t next = 0;
+	long firstRow = 0;
+	long percent = -1;
+
+	while (next < order.size() || !open.empty())
+	{
+		// rows without polygons aren't read
+		if (open.empty())
+			firstRow = MAX(firstRow, order[next]->minRow);
+
+		long lastRow = MIN(firstRow + stripeRows, _numRows) - 1;
+
+		while (next < order.size() && order[next]->minRow <= lastRow)
+		{
+			open.push_back(order[next++]);
+		}
+
+		VARIANT_BOOL vb;
+		grid->GetFloatWindow(firstRow, lastRow, 0, _numCols - 1, &stripe[0], &vb);
+		if (!vb)
+		{
+			_lastErrorCode = tkFAILED_READ_BLOCK;
+			return false;
+		}
+
+		float* data = &stripe[0];
+		auto process = [&](int begin, int end)
+		{
+			for (int i = begin; i < end; i++)
+			{
+				ProcessRows(open[i], data, firstRow, lastRow);
+			}
+		};
+
+		ParallelHelper::For((int)open.size(), 0, process, 1);
+
+		open.erase(remove_if(open.begin(), open.end(), [lastRow](Zone* zone) { return zone->maxRow <= lastRow; }), open.end());
+
+		CallbackHelper::Progress(cBack, lastRow, _numRows, "Calculating...", key, percent);
+
+		firstRow = lastRow + 1;
+	}
+
+	return true;
+}
+
+// *******************************************************************
+//		ProcessRows()
+// *******************************************************************
+void ZonalStatisticsCalculator::ProcessRows(Zone* zone, float* stripe, long firstRow, long lastRow)
+{
+	long start = MAX(firstRow, zone->minRow);
+	long end = MIN(lastRow, zone->maxRow);
+
+	for (long i = start; i <= end; i++)
+	{
+		float* row = stripe + (size_t)(i - firstRow) * _numCols;
+
+		if (_centerWithin)
+		{
+			ScanRowCenterWithin(zone, row, i);
+		}
+		else
+		{
+			ScanRowIntersection(zone, row, i);
+		}
+	}
+
+	if (zone->maxRow <= lastRow)
+	{
+		Finish(zone);
+	}
+}
+
+// *******************************************************************
+//		FirstColumnAfter()
+// *******************************************************************
+// The first column which centre is to the right of x, or numCols if there is none.
+inline long FirstColumnAfter(double x, double xllWindow, double dx, long numCols)
+{
+	double d = floor((x - xllWindow) / dx) + 1.0;
+	long j = d <= 0.0 ? 0 : d >= numCols ? numCols : (long)d;
+
+	// the centres are calculated as CPointInPolygon was given them
+	while (j > 0 && xllWindow + dx * (j - 1) > x) j--;
+	while (j < numCols && xllWindow + dx * j <= x) j++;
+	return j;
+}
+
+// *******************************************************************
+//		ScanRowCenterWithin()
+// *******************************************************************
+void ZonalStatisticsCalculator::ScanRowCenterWithin(Zone* zone, float* row, long rowIndex)
+{
+	// activating the edges which may be crossed by this row and dropping the passed ones
+	while (zone->nextEdge < zone->edges.size() && zone->edges[zone->nextEdge].firstRow <= rowIndex)
+	{
+		zone->activeEdges.push_back((int)zone->nextEdge++);
+	}
+
+	vector<int>& active = zone->activeEdges;
+	active.erase(remove_if(active.begin(), active.end(), [&](int index) { return zone->edges[index].lastRow < rowIndex; }), active.end());
+
+	if (active.empty())
+		return;
+
+	double yllWindow = _yll + ((_numRows - 1) - zone->maxRow) * _dy;
+	double xllWindow = _xll + zone->firstCol * _dx;
+	double y = yllWindow + _dy * (zone->maxRow - rowIndex);
+
+	// the same rule as CPointInPolygon::PrepareScanLine
+	vector<double>& crossings = zone->crossings;
+	crossings.clear();
+
+	for (size_t k = 0; k < active.size(); k++)
+	{
+		const Edge& edge = zone->edges[active[k]];
+		double y1 = edge.y1 - y;
+		double y2 = edge.y2 - y;
+
+		if (y1 * y2 < 0 || (y1 == 0 && y2 != 0))
+		{
+			crossings.push_back(edge.x1 + (edge.x2 - edge.x1) * abs(y1 / (y1 - y2)));
+		}
+	}
+
+	if (crossings.empty())
+		return;
+
+	sort(crossings.begin(), crossings.end());
+
+	// a centre is within polygon when the number of crossings to the left of it is odd,
+	// i.e. it lies in (c[0], c[1]], (c[2], c[3]], ... or to the right of the last odd one
+	long numCols = zone->lastCol - zone->firstCol + 1;
+	float* vals = row + zone->firstCol;
+
+	for (size_t k = 0; k < crossings.size(); k += 2)
+	{
+		long first = FirstColumnAfter(crossings[k], xllWindow, _dx, numCols);
+		long last = k + 1 < crossings.size() ? FirstColumnAfter(crossings[k + 1], xllWindow, _dx, numCols) : numCols;
+
+		for (long j = first; j < last; j++)
+		{
+			if (vals[j] == _noData)
+				continue;
+
+			double x = xllWindow + _dx * j;
+			AddValue(zone, vals[j], 1.0, x, y);
+		}
+	}
+}
+
+// *******************************************************************
+//		ScanRowIntersection()
+// *******************************************************************
+void ZonalStatisticsCalculator::ScanRowIntersection(Zone* zone, float* row, long rowIndex)
+{
+	double yllWindow = _yll + ((_numRows - 1) - zone->maxRow) * _dy;
+	double xllWindow = _xll + zone->firstCol * _dx;
+	double cellArea = _dx * _dy;
+
+	Extent cell;
+	Extent intersection;
+	cell.bottom = yllWindow + _dy * (zone->maxRow - rowIndex - 0.5);
+	cell.top = yllWindow + _dy * (zone->maxRow - rowIndex + 0.5);
+
+	long numCols = zone->lastCol - zone->firstCol + 1;
+	float* vals = row + zone->firstCol;
+
+	for (long j = 0; j < numCols; j++)
+	{
+		if (vals[j] == _noData)
+			continue;
+
+		cell.left = xllWindow + _dx * (j - 0.5);
+		cell.right = xllWindow + _dx * (j + 0.5);
+		if (cell.getIntersection(zone->bounds, intersection))
+		{
+			double weight = intersection.getArea() / cellArea;	// the part of cell within polygon bounds
+			AddValue(zone, vals[j], weight, (cell.right + cell.left) / 2, (cell.top + cell.bottom) / 2);
+		}
+	}
+}
+
+// *******************************************************************
+//		AddValue()
+// *******************************************************************
+inline void ZonalStatisticsCalculator::AddValue(Zone* zone, float value, double weight, double x, double y)
+{
+	if (value < zone->min)
+	{
+		zone->min = value;
+		zone->minX = x;
+		zone->minY = y;
+	}
+	if (value > zone->max) zone->max = value;
+
+	zone->sum += value * weight;
+	zone->squares += (double)value * value * weight;
+	zone->sumWeight += weight;
+	zone->count++;
+
+	zone->values[value]++;
+}
+
+// *******************************************************************
+//		Finish()
+// *******************************************************************
+void ZonalStatisticsCalculator::Finish(Zone* zone)
+{
+	ZonalStatistics& r = zone->result;
+	r.count = zone->count;
+
+	if (zone->count > 0 && zone->sumWeight > 0.0)
+	{
+		r.mean = zone->sum / zone->sumWeight;
+		r.min = zone->min;
+		r.max = zone->max;
+		r.sum = zone->sum;
+		r.minX = zone->minX;
+		r.minY = zone->minY;
+
+		double variance = zone->squares / zone->sumWeight - r.mean * r.mean;
+		r.stdDev = variance > 0.0 ? sqrt(variance) : 0.0;
+
+		vector<pair<float, int>> values(zone->values.begin(), zone->values.end());
+		sort(values.begin(), values.end());
+		r.variety = (int)values.size();
+
+		// the first value past the half of cells
+		int half = zone->count / 2;
+		int subCount = 0;
+		for (size_t i = 0; i < values.size(); i++)
+		{
+			subCount += values[i].second;
+			if (subCount > half)
+			{
+				r.median = values[i].first;
+				break;
+			}
+		}
+
+		// the lowest of values with the same count
+		int maxCount = INT_MIN;
+		int minCount = INT_MAX;
+		for (size_t i = 0; i < values.size(); i++)
+		{
+			if (values[i].second > maxCount)
+			{
+				maxCount = values[i].second;
+				r.majority = values[i].first;
+			}
+			if (values[i].second < minCount)
+			{
+				minCount = values[i].second;
+				r.minority = values[i].first;
+			}
+		}
+	}
+
+	// only the result is kept
+	std::unordered_map<float, int>().swap(zone->values);
+	vector<Edge>().swap(zone->edges);
+	vector<int>().swap(zone->activeEdges);
+	vector<double>().swap(zone->crossings);
+}
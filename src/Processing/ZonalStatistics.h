@@ -0,0 +1,125 @@
+/////////////////////////////////////////////
+// ZonalStatistics.h
+// Description: statistics of grid values within polygons calculated in a single pass over the grid
+////////////////////////////////////////////
+// Polygons are rasterized with an edge table: for each row the crossings of the active
+// edges with the line through the centres of cells are sorted and the cells between
+// pairs of crossings are taken. The rule is that of CPointInPolygon (a cell is within
+// polygon when the number of crossings to the left of its centre is odd), so the same
+// cells are selected, but there is no test for each cell.
+//
+// The grid is read in stripes of full rows. The polygons which intersect a stripe are shared
+// between the threads of the pool; each of them is processed by a single thread, so
+// the accumulators need no locking. A polygon is finished as soon as its last row is read,
+// so unique values are kept in memory only for the polygons which cross the current stripe.
+//////////////////////////////////////////////////////////
+#pragma once
+#include <unordered_map>
+
+#define ZONAL_STATISTICS_STRIPE_MEMORY (32 * 1024 * 1024)
+
+struct ZonalStatistics
+{
+	ZonalStatistics()
+		: count(0), variety(0), mean(0.0), median(0.0), majority(0.0), minority(0.0), min(0.0), max(0.0),
+		  stdDev(0.0), sum(0.0), minX(0.0), minY(0.0)
+	{
+	}
+
+	int count;			// no values within polygon if 0
+	int variety;
+	double mean;
+	double median;
+	double majority;
+	double minority;
+	double min;
+	double max;
+	double stdDev;
+	double sum;
+	double minX;		// centre of the first cell with the minimum value
+	double minY;
+};
+
+class ZonalStatisticsCalculator
+{
+public:
+	// The grid parameters are those of its header; with centerWithin the cells with centres within
+	// polygon are taken, otherwise the cells are weighted by their intersection with polygon bounds.
+	ZonalStatisticsCalculator(long numRows, long numCols, double xllCenter, double yllCenter, double dx, double dy,
+							  float noData, bool centerWithin)
+		: _numRows(numRows), _numCols(numCols), _xll(xllCenter), _yll(yllCenter), _dx(dx), _dy(dy),
+		  _noData(noData), _centerWithin(centerWithin), _lastErrorCode(tkNO_ERROR)
+	{
+	}
+
+	~ZonalStatisticsCalculator();
+
+private:
+	struct Edge
+	{
+		double x1;
+		double y1;
+		double x2;
+		double y2;
+		long firstRow;		// the rows which scanlines may cross the edge
+		long lastRow;
+	};
+
+	struct Zone
+	{
+		long shapeIndex;
+		long minRow;
+		long maxRow;
+		long firstCol;
+		long lastCol;
+		Extent bounds;			// intersection of polygon and grid extents
+
+		vector<Edge> edges;		// sorted by the first row
+		size_t nextEdge;
+		vector<int> activeEdges;
+		vector<double> crossings;
+
+		int count;
+		double sumWeight;		// a sum of cell parts which fall within polygon bounds
+		double sum;
+		double squares;
+		float min;
+		float max;
+		double minX;
+		double minY;
+		std::unordered_map<float, int> values;	// value; count
+
+		ZonalStatistics result;
+	};
+
+	long _numRows;
+	long _numCols;
+	double _xll;
+	double _yll;
+	double _dx;
+	double _dy;
+	float _noData;
+	bool _centerWithin;
+	long _lastErrorCode;
+
+	vector<Zone*> _zones;
+
+private:
+	void ProcessRows(Zone* zone, float* stripe, long firstRow, long lastRow);
+	void ScanRowCenterWithin(Zone* zone, float* row, long rowIndex);
+	void ScanRowIntersection(Zone* zone, float* row, long rowIndex);
+	void AddValue(Zone* zone, float value, double weight, double x, double y);
+	void Finish(Zone* zone);
+
+public:
+	// Polygon is copied. The rows and columns are those of polygon bounds; they are clipped by the grid.
+	void AddPolygon(long shapeIndex, IShape* polygon, long minRow, long maxRow, long firstCol, long lastCol, Extent& bounds);
+
+	bool Run(IGrid* grid, ICallback* cBack, BSTR& key);
+	long get_LastErrorCode() { return _lastErrorCode; }
+
+	// results in the order polygons were added
+	int get_Count() { return (int)_zones.size(); }
+	long get_ShapeIndex(int index) { return _zones[index]->shapeIndex; }
+	const ZonalStatistics& get_Result(int index) { return _zones[index]->result; }
+};
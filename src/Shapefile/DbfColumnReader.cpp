@@ -0,0 +1,298 @@
+#include "stdafx.h"
+#include "DbfColumnReader.h"
+
+// exactly representable powers of ten
+static const double DbfPowersOfTen[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// *******************************************************
+//		Open()
+// *******************************************************
+bool DbfColumnReader::Open(CStringW filename, DBFInfo* dbf)
+{
+	Close();
+
+	if (!dbf || dbf->nRecordLength <= 0 || !_file.Open(filename))
+		return false;
+
+	if (_file.get_Size() < dbf->nHeaderLength)
+	{
+		Close();
+		return false;
+	}
+
+	for (int i = 0; i < dbf->nFields; i++)
+	{
+		FieldInfo info;
+		info.offset = dbf->panFieldOffset[i];
+		info.width = dbf->panFieldSize[i];
+		info.type = dbf->pachFieldType[i];
+
+		if (info.offset < 0 || info.width < 0 || info.offset + info.width > dbf->nRecordLength)
+		{
+			Close();
+			return false;
+		}
+
+		_fields.push_back(info);
+	}
+
+	// the file can be truncated, only the complete records are taken
+	__int64 available = (_file.get_Size() - dbf->nHeaderLength) / dbf->nRecordLength;
+	_numRecords = (int)min((__int64)dbf->nRecords, available);
+	_recordLength = dbf->nRecordLength;
+	_records = _file.get_Data() + dbf->nHeaderLength;
+
+	const char* codePage = DBFGetCodePage(dbf);
+	_isUtf8 = codePage == nullptr || strcmp(codePage, "UTF-8") == 0;
+
+	return true;
+}
+
+// *******************************************************
+//		Close()
+// *******************************************************
+void DbfColumnReader::Close()
+{
+	_file.Close();
+	_fields.clear();
+	_records = NULL;
+	_numRecords = 0;
+	_recordLength = 0;
+}
+
+// *******************************************************
+//		GetRaw()
+// *******************************************************
+// The field as DBFReadAttribute copies it with strncpy: up to the first zero byte.
+const char* DbfColumnReader::GetRaw(int field, int record, int& length)
+{
+	const FieldInfo& info = _fields[field];
+	const char* s = _records + (__int64)record * _recordLength + info.offset;
+
+	const char* end = (const char*)memchr(s, '\0', info.width);
+	length = end ? (int)(end - s) : info.width;
+	return s;
+}
+
+// *******************************************************
+//		GetTrimmed()
+// *******************************************************
+// Leading and trailing spaces are removed the same way as for TRIM_DBF_WHITESPACE in shapelib.
+const char* DbfColumnReader::GetTrimmed(int field, int record, int& length)
+{
+	const char* s = GetRaw(field, record, length);
+
+	while (length > 0 && *s == ' ')
+	{
+		s++;
+		length--;
+	}
+
+	while (length > 0 && s[length - 1] == ' ')
+		length--;
+
+	return s;
+}
+
+// *******************************************************
+//		IsNull()
+// *******************************************************
+bool DbfColumnReader::IsNull(int field, int record)
+{
+	int length;
+	const char* s = GetTrimmed(field, record, length);
+
+	switch (_fields[field].type)
+	{
+		case 'N':
+		case 'F':
+			// nulls are either empty or filled with asterisks
+			return length == 0 || s[0] == '*';
+		case 'D':
+			return length >= 8 && memcmp(s, "00000000", 8) == 0;
+		case 'L':
+			return length > 0 && s[0] == '?';
+		default:
+			return length == 0;
+	}
+}
+
+// *******************************************************
+//		ReadDouble()
+// *******************************************************
+double DbfColumnReader::ReadDouble(int field, int record)
+{
+	int length;
+	const char* s = GetRaw(field, record, length);
+	return ParseDouble(s, length);
+}
+
+// *******************************************************
+//		ParseDouble()
+// *******************************************************
+// Numbers as dbf writers usually store them (spaces, sign, up to 15 significant digits, point)
+// are parsed directly; the division of an exact mantissa by an exact power of ten is correctly
+// rounded, so it's the same value atof gives. Anything else (exponent, other whitespace,
+// trailing characters) is passed to atof, as DBFReadAttribute does.
+double DbfColumnReader::ParseDouble(const char* s, int length)
+{
+	const char* p = s;
+	const char* end = s + length;
+
+	while (p < end && *p == ' ') p++;
+
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+'))
+	{
+		negative = *p == '-';
+		p++;
+	}
+
+	__int64 mantissa = 0;
+	int numDigits = 0;			// significant ones, i.e. after the leading zeros
+	int numDecimals = 0;
+	bool hasDigits = false;
+
+	for (; p < end && *p >= '0' && *p <= '9'; p++)
+	{
+		int digit = *p - '0';
+		if (mantissa > 0 || digit > 0) numDigits++;
+		if (numDigits > 15) break;
+		mantissa = mantissa * 10 + digit;
+		hasDigits = true;
+	}
+
+	if (p < end && *p == '.' && numDigits <= 15)
+	{
+		for (p++; p < end && *p >= '0' && *p <= '9'; p++)
+		{
+			int digit = *p - '0';
+			if (mantissa > 0 || digit > 0) numDigits++;
+			if (numDigits > 15) break;
+			mantissa = mantissa * 10 + digit;
+			numDecimals++;
+			hasDigits = true;
+		}
+	}
+
+	while (p < end && *p == ' ') p++;
+
+	if (hasDigits && p == end && numDecimals <= 22)
+	{
+		double value = (double)mantissa;
+		if (numDecimals > 0)
+			value /= DbfPowersOfTen[numDecimals];
+		return negative ? -value : value;
+	}
+
+	// the field is at most 255 characters long
+	char buffer[256];
+	length = min(length, 255);
+	memcpy(buffer, s, length);
+	buffer[length] = '\0';
+	return atof(buffer);
+}
+
+// *******************************************************
+//		ReadLogical()
+// *******************************************************
+bool DbfColumnReader::ReadLogical(int field, int record)
+{
+	int length;
+	const char* s = GetTrimmed(field, record, length);
+
+	// depending on who wrote the record, we will accept any of 'Y', 'y', 'T', or 't'
+	return length > 0 && (s[0] == 'Y' || s[0] == 'y' || s[0] == 'T' || s[0] == 't');
+}
+
+// *******************************************************
+//		ReadString()
+// *******************************************************
+const char* DbfColumnReader::ReadString(int field, int record, int& length)
+{
+	return GetTrimmed(field, record, length);
+}
+
+// *******************************************************
+//		ReadWideString()
+// *******************************************************
+CStringW DbfColumnReader::ReadWideString(int field, int record)
+{
+	if (IsNull(field, record))
+		return L"";
+
+	int length;
+	const char* s = GetTrimmed(field, record, length);
+	CStringA v(s, length);
+
+	// see the comments in CTableClass::ReadRecord on the choice of encoding
+	return _isUtf8 ? Utility::ConvertFromUtf8(v) : CStringW(v);
+}
+
+// *******************************************************
+//		GetValue()
+// *******************************************************
+bool DbfColumnReader::GetValue(int field, int record, FieldType type, VARIANT* val)
+{
+	USES_CONVERSION;
+
+	if (!Contains(field, record))
+		return false;
+
+	VariantClear(val);
+
+	if (type == STRING_FIELD)
+	{
+		val->vt = VT_BSTR;
+
+		if (IsNull(field, record))
+		{
+			val->bstrVal = A2BSTR("");
+		}
+		else
+		{
+			int length;
+			const char* s = GetTrimmed(field, record, length);
+			CStringA v(s, length);
+			val->bstrVal = _isUtf8 ? W2BSTR(Utility::ConvertFromUtf8(v)) : A2BSTR(v);
+		}
+		return true;
+	}
+
+	if (IsNull(field, record))
+	{
+		val->vt = VT_NULL;
+		return true;
+	}
+
+	switch (type)
+	{
+		case INTEGER_FIELD:
+			val->vt = VT_I4;
+			val->lVal = ReadInteger(field, record);
+			break;
+		case DOUBLE_FIELD:
+			val->vt = VT_R8;
+			val->dblVal = ReadDouble(field, record);
+			break;
+		case BOOLEAN_FIELD:
+			val->vt = VT_BOOL;
+			val->boolVal = ReadLogical(field, record) ? VARIANT_TRUE : VARIANT_FALSE;
+			break;
+		case DATE_FIELD:
+		{
+			int nFullDate = ReadInteger(field, record);
+			COleDateTime dt(nFullDate / 10000, (nFullDate / 100) % 100, nFullDate % 100, 0, 0, 0);
+			val->vt = VT_DATE;
+			val->date = dt.m_dt;
+			break;
+		}
+		default:
+			return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include "dbf.h"
+#include "MappedFile.h"
+
+// ---------------------------------------------------------
+//   Memory-mapped access to single fields of dbf records
+// ---------------------------------------------------------
+// DBFReadAttribute loads the whole record into the buffer of DBFInfo and copies
+// the field before parsing it. Here the requested field is decoded right from
+// the fixed-width bytes of the mapping, so reading one or two columns doesn't touch
+// the rest of the record. The layout is taken from the header shapelib has parsed,
+// the values are exactly the same as DBFRead*Attribute return. Nothing is modified
+// after opening, so the reader can be used from several threads at once.
+// The records appended after the file was mapped aren't covered by it.
+class DbfColumnReader
+{
+public:
+	DbfColumnReader()
+	{
+		_records = NULL;
+		_numRecords = 0;
+		_recordLength = 0;
+		_isUtf8 = true;
+	}
+
+	~DbfColumnReader()
+	{
+		Close();
+	}
+
+private:
+	struct FieldInfo
+	{
+		int offset;			// within the record
+		int width;
+		char type;			// as it's stored in dbf: 'C', 'N', 'F', 'D', 'L'
+	};
+
+	CMappedFile _file;
+	const char* _records;	// the first record in the mapping
+	int _numRecords;
+	int _recordLength;
+	vector<FieldInfo> _fields;
+	bool _isUtf8;
+
+	const char* GetRaw(int field, int record, int& length);
+	const char* GetTrimmed(int field, int record, int& length);
+	static double ParseDouble(const char* s, int length);
+
+public:
+	bool Open(CStringW filename, DBFInfo* dbf);
+	void Close();
+	bool IsOpen() { return _records != NULL; }
+	bool IsUtf8() { return _isUtf8; }
+	int get_NumRecords() { return _numRecords; }
+	int get_NumFields() { return (int)_fields.size(); }
+
+	bool Contains(int field, int record)
+	{
+		return _records != NULL && field >= 0 && field < (int)_fields.size() && record >= 0 && record < _numRecords;
+	}
+
+	// The same values as DBFIsAttributeNULL / DBFReadDoubleAttribute / DBFReadIntegerAttribute return;
+	// the caller must check Contains(field, record) first.
+	bool IsNull(int field, int record);
+	double ReadDouble(int field, int record);
+	int ReadInteger(int field, int record) { return (int)ReadDouble(field, record); }
+
+	// The first character of DBFReadLogicalAttribute is 'Y', 'y', 'T' or 't'.
+	bool ReadLogical(int field, int record);
+
+	// The same characters as DBFReadStringAttribute returns, but pointing into the mapping,
+	// i.e. the value isn't zero-terminated.
+	const char* ReadString(int field, int record, int& length);
+
+	// The string CTableClass::ReadRecord puts in BSTR.
+	CStringW ReadWideString(int field, int record);
+
+	// The same conversions as in CTableClass::ReadRecord; returns false for the fields and
+	// records which aren't covered by the mapping.
+	bool GetValue(int field, int record, FieldType type, VARIANT* val);
+};
@@ -0,0 +1,180 @@
+#include "stdafx.h"
+#include <functional>
+#include "PointInShapefileIndex.h"
+
+#define POINT_IN_SHAPEFILE_EDGES_PER_BAND 8
+#define POINT_IN_SHAPEFILE_MAX_BANDS 1024
+
+// *******************************************************
+//		Clear()
+// *******************************************************
+void CPointInShapefileIndex::Clear()
+{
+	_tree = CPackedRTree();
+	_polygons.clear();
+	_bandOffsets.clear();
+	_edges.clear();
+	_finished = false;
+}
+
+// *******************************************************
+//		AddPolygon()
+// *******************************************************
+// Parts must hold numParts + 1 values, the last one being the number of points.
+void CPointInShapefileIndex::AddPolygon(int shapeIndex, double minX, double minY, double maxX, double maxY,
+										const Point2D* points, int numPoints, const int* parts, int numParts)
+{
+	if (shapeIndex < 0 || _finished)
+		return;
+
+	if (shapeIndex >= (int)_polygons.size())
+	{
+		PolygonBands empty = { 0.0, 0.0, 0.0, 0, 0 };
+		_polygons.resize(shapeIndex + 1, empty);
+	}
+
+	// the same edges as in pnpoly: i starts at the first point of the part, while j starts
+	// at the point before the closing one, then follows behind i; the horizontal edges
+	// never cross the ray, so they are skipped
+	auto forEachEdge = [&](std::function<void(const Point2D&, const Point2D&)> callback)
+	{
+		for (int nPart = 0; nPart < numParts; nPart++)
+		{
+			const int nPointMin = parts[nPart];
+			const int nPointMax = parts[nPart + 1] - 1;
+			if (nPointMin < 0 || nPointMax > numPoints || nPointMin >= nPointMax)
+				continue;
+
+			for (int i = nPointMin, j = nPointMax - 1; i < nPointMax; j = i++)
+			{
+				if (points[i].y != points[j].y)
+					callback(points[i], points[j]);
+			}
+		}
+	};
+
+	int numEdges = 0;
+	forEachEdge([&](const Point2D&, const Point2D&) { numEdges++; });
+
+	if (numEdges == 0)
+		return;
+
+	PolygonBands& polygon = _polygons[shapeIndex];
+	polygon.minY = minY;
+	polygon.maxY = maxY;
+	polygon.numBands = max(1, min(POINT_IN_SHAPEFILE_MAX_BANDS, numEdges / POINT_IN_SHAPEFILE_EDGES_PER_BAND));
+	polygon.bandHeight = (maxY - minY) / polygon.numBands;
+	if (polygon.bandHeight <= 0.0)
+	{
+		polygon.numBands = 1;
+		polygon.bandHeight = 0.0;
+	}
+	polygon.firstBand = (int)_bandOffsets.size();
+
+	auto bandOf = [&polygon](double y) -> int
+	{
+		if (polygon.bandHeight == 0.0)
+			return 0;
+		int band = (int)((y - polygon.minY) / polygon.bandHeight);
+		return max(0, min(polygon.numBands - 1, band));
+	};
+
+	// count the edges in each band; an edge is put into every band it spans
+	vector<int> counts(polygon.numBands, 0);
+	forEachEdge([&](const Point2D& pi, const Point2D& pj)
+	{
+		int last = bandOf(max(pi.y, pj.y));
+		for (int band = bandOf(min(pi.y, pj.y)); band <= last; band++)
+			counts[band]++;
+	});
+
+	int position = (int)_edges.size();
+	for (int band = 0; band < polygon.numBands; band++)
+	{
+		_bandOffsets.push_back(position);
+		position += counts[band];
+	}
+	_bandOffsets.push_back(position);
+	_edges.resize(position);
+
+	for (int band = 0; band < polygon.numBands; band++)
+		counts[band] = _bandOffsets[polygon.firstBand + band];
+
+	forEachEdge([&](const Point2D& pi, const Point2D& pj)
+	{
+		Edge edge = { pi.x, pi.y, pj.x, pj.y };
+		int last = bandOf(max(pi.y, pj.y));
+		for (int band = bandOf(min(pi.y, pj.y)); band <= last; band++)
+			_edges[counts[band]++] = edge;
+	});
+
+	_tree.AddItem(shapeIndex, minX, minY, maxX, maxY);
+}
+
+// *******************************************************
+//		Finish()
+// *******************************************************
+void CPointInShapefileIndex::Finish()
+{
+	_tree.Finish();
+	_finished = true;
+}
+
+// *******************************************************
+//		PolygonContains()
+// *******************************************************
+bool CPointInShapefileIndex::PolygonContains(const PolygonBands& polygon, double x, double y) const
+{
+	if (polygon.numBands == 0 || y < polygon.minY || y > polygon.maxY)
+		return false;
+
+	int band = 0;
+	if (polygon.bandHeight > 0.0)
+		band = max(0, min(polygon.numBands - 1, (int)((y - polygon.minY) / polygon.bandHeight)));
+
+	const int start = _bandOffsets[polygon.firstBand + band];
+	const int end = _bandOffsets[polygon.firstBand + band + 1];
+
+	int crossCount = 0;
+	for (int k = start; k < end; k++)
+	{
+		const Edge& e = _edges[k];
+		if (((e.yi > y) != (e.yj > y)) &&
+			(x < (e.xj - e.xi) * (y - e.yi) / (e.yj - e.yi) + e.xi))
+			crossCount++;
+	}
+
+	return (crossCount & 1) != 0;
+}
+
+// *******************************************************
+//		Find()
+// *******************************************************
+int CPointInShapefileIndex::Find(double x, double y)
+{
+	if (!_finished)
+		return -1;
+
+	// polygons were tested from the last to the first one before,
+	// so the highest index wins when they overlap
+	int result = -1;
+	auto test = [&](int shapeIndex)
+	{
+		if (shapeIndex > result && PolygonContains(_polygons[shapeIndex], x, y))
+			result = shapeIndex;
+	};
+
+	_tree.Search(x, y, x, y, false, test);
+	return result;
+}
+
+// *******************************************************
+//		get_MemoryUsage()
+// *******************************************************
+size_t CPointInShapefileIndex::get_MemoryUsage()
+{
+	return _tree.get_MemoryUsage() +
+		_polygons.capacity() * sizeof(PolygonBands) +
+		_bandOffsets.capacity() * sizeof(int) +
+		_edges.capacity() * sizeof(Edge);
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include "PackedRTree.h"
+
+// ---------------------------------------------------------
+//   Index for the repeated point in polygon tests
+// ---------------------------------------------------------
+// Candidate polygons are taken from a packed R-tree built on their bounds;
+// the edges of each polygon are bucketed into horizontal bands, so a test
+// checks only the edges which span the y coordinate of the point.
+// The tests are the same as in pnpoly (W. Randolph Franklin) and
+// Find() is safe to call from several threads once the index is finished.
+class CPointInShapefileIndex
+{
+public:
+	CPointInShapefileIndex()
+	{
+		_finished = false;
+	}
+
+private:
+	struct Edge
+	{
+		double xi, yi;
+		double xj, yj;
+	};
+
+	struct PolygonBands
+	{
+		double minY;
+		double maxY;
+		double bandHeight;
+		int numBands;
+		int firstBand;		// position in _bandOffsets
+	};
+
+	CPackedRTree _tree;
+	vector<PolygonBands> _polygons;		// by shape index
+	vector<int> _bandOffsets;			// numBands + 1 positions in _edges for each polygon
+	vector<Edge> _edges;
+	bool _finished;
+
+	bool PolygonContains(const PolygonBands& polygon, double x, double y) const;
+
+public:
+	void Clear();
+	void AddPolygon(int shapeIndex, double minX, double minY, double maxX, double maxY,
+					const Point2D* points, int numPoints, const int* parts, int numParts);
+	void Finish();
+	bool IsEmpty() { return !_finished || _tree.get_NumItems() == 0; }
+	size_t get_MemoryUsage();
+
+	// Returns the index of the polygon with the highest index containing the point or -1.
+	int Find(double x, double y);
+};
@@ -18,6 +18,9 @@ bool CShapefileReader::ReadShapefileIndex(CStringW filename, FILE* shpFile, CCri
 	CStringW sFilename = filename;
 	sFilename.SetAt(sFilename.GetLength() - 1, L'x');
 
+	_readLock = readLock;
+	_shpfile = shpFile;
+
 	FILE* shxfile = _wfopen(sFilename, L"rb");
 
 	if (!shxfile )
@@ -37,18 +40,29 @@ bool CShapefileReader::ReadShapefileIndex(CStringW filename, FILE* shpFile, CCri
 		
 	// 100 is for header
 	fseek(shxfile, 100, SEEK_SET);
-	_indexData = new char[indexFileSize - 100];
-	long result = fread(_indexData, sizeof(char), indexFileSize - 100, shxfile);
+	_indexSize = indexFileSize - 100;
+	_indexData = new char[_indexSize];
+	long result = fread(_indexData, sizeof(char), _indexSize, shxfile);
 	fclose(shxfile);
 
 	//_shpHeader.numShapes = (indexFileSize - 100)/8;	// 2 int on record
 
-	_readLock = readLock;
-	_shpfile = shpFile;
 	rewind(shpFile);
 	return true;
 }
 
+// ****************************************************************
+//		UseMappedFiles()
+// ****************************************************************
+// Reads from the mapping of .shp and .shx owned by the shapefile instead of the disk files
+void CShapefileReader::UseMappedFiles(CMappedFile* shpMapping, CMappedFile* shxMapping)
+{
+	// 100 is for header
+	_indexData = shxMapping->get_Data() + 100;
+	_indexSize = (int)(shxMapping->get_Size() - 100);
+	_shpMapping = shpMapping;
+}
+
 void SwapEndian(char* c)
 {
 	char ctmp;
@@ -56,65 +70,101 @@ void SwapEndian(char* c)
 	SWAP_LOCAL(c[1], c[2], ctmp);
 }
 
+// ****************************************************************
+//		ReadIndexRecord()
+// ****************************************************************
+// Returns offset of the record in .shp file and length of its content in bytes
+bool CShapefileReader::ReadIndexRecord(int shapeIndex, int& offset, int& length)
+{
+	// index records are 8 bytes; the index data must not be altered
+	// as it can be read-only mapping or the same shape can be requested several times
+	if (shapeIndex < 0 || shapeIndex * 8 + 8 > _indexSize)
+	{
+		return false;
+	}
+
+	int values[2];
+	memcpy(values, _indexData + shapeIndex * 8, 8);
+	SwapEndian((char*)&values[0]);
+	SwapEndian((char*)&values[1]);
+
+	// *2: for conversion from 16-bit words to 8-bit words
+	offset = values[0] * 2;
+	length = values[1] * 2;
+	return true;
+}
+
 // ****************************************************************
 //		ReadShapeData()
 // ****************************************************************
-// Reads a single shape from the shapefile
-char* CShapefileReader::ReadShapeData(int& offset, int& recordLength)
+// Reads a single shape from the shapefile; the returned data must be passed to ReleaseShapeData
+char* CShapefileReader::ReadShapeData(int shapeIndex, int& recordLength)
 {
 	recordLength = 0;
 
-	// index records are 8 bytes;
-	char* data = _indexData + offset*8;	
-	SwapEndian(data);
-	int readOffset =  (*(int*)data) * 2;
+	int readOffset, length;
+	if (!ReadIndexRecord(shapeIndex, readOffset, length) || length <= 0) 
+	{
+		return NULL;
+	}
 
-	data = _indexData + offset * 8 + 4;
-	SwapEndian(data);
-	int contentLength = (*(int*)data);
-	
-	if (contentLength > 0)
+	// skipping record number and content length
+	readOffset += 2 * sizeof(int);
+
+	if (_shpMapping)
 	{
-		CSingleLock lock(_readLock);
-		lock.Lock();
+		char* shapeData = _shpMapping->GetRange(readOffset, length);
+		if (shapeData) {
+			recordLength = length;
+		}
+		return shapeData;
+	}
+	
+	CSingleLock lock(_readLock);
+	lock.Lock();
 
-		int ret = fseek(_shpfile, (long)readOffset + 2 * sizeof(int), SEEK_SET);
-		if (ret != 0) return NULL;
+	int ret = fseek(_shpfile, (long)readOffset, SEEK_SET);
+	if (ret != 0) return NULL;
 		
-		// *2: for conversion from 16-bit words to 8-bit words
-		int length = contentLength * 2;
+	char* shapeData = new char[length];
+	int count = (int)fread(shapeData, sizeof(char), length, _shpfile);
 
-		char* shapeData = new char[length];
-		int count = (int)fread(shapeData, sizeof(char), length, _shpfile);
+	recordLength = length;
+	return shapeData;
+}
 
-		recordLength = length;
-		return shapeData;
+// ****************************************************************
+//		ReleaseShapeData()
+// ****************************************************************
+void CShapefileReader::ReleaseShapeData(char* data)
+{
+	// mapped data is owned by the mapping
+	if (data && !_shpMapping)
+	{
+		delete[] data;
 	}
-
-	return NULL;
 }
 
 // ****************************************************************
-//		ReadPolyShape()
+//		ReadPolygonData()
 // ****************************************************************
-PolygonData* CShapefileReader::ReadPolygonData(char* data)
+void CShapefileReader::ReadPolygonData(char* data, PolygonData& result)
 {
-	PolygonData* shapeData = new PolygonData();
-	shapeData->partCount = *(int*)(data + 36);
-	shapeData->pointCount = *(int*)(data + 40);
-	shapeData->parts = (int*)(data + 44);
-	shapeData->points = (double*)(data + 44 + sizeof(int) * shapeData->partCount);
-	return shapeData;
+	result.partCount = *(int*)(data + 36);
+	result.pointCount = *(int*)(data + 40);
+	result.parts = (int*)(data + 44);
+	result.points = (double*)(data + 44 + sizeof(int) * result.partCount);
 }
 
-PolygonData* CShapefileReader::ReadMultiPointData(char* data)
+// ****************************************************************
+//		ReadMultiPointData()
+// ****************************************************************
+void CShapefileReader::ReadMultiPointData(char* data, PolygonData& result)
 {
-	PolygonData* shapeData = new PolygonData();
-	shapeData->partCount = 0;
-	shapeData->pointCount = *(int*)(data + 36);
-	shapeData->parts = NULL;
-	shapeData->points = (double*)(data + 40);
-	return shapeData;
+	result.partCount = 0;
+	result.pointCount = *(int*)(data + 36);
+	result.parts = NULL;
+	result.points = (double*)(data + 40);
 }
 
 //// ****************************************************************
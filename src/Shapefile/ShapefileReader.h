@@ -1,6 +1,7 @@
 #pragma once
 #include "ShapeWrapper.h"
 #include "afxmt.h"
+#include "MappedFile.h"
 
 //Shapefile File Info
 #define HEADER_BYTES_16 50
@@ -24,34 +25,47 @@ public:
 // ---------------------------------------------------------
 //   class to encapsulate reading of the shapefile
 // ---------------------------------------------------------
+// When the shapefile provides memory mapped .shp and .shx, shape records are
+// returned as pointers into the mapping (no locking, no allocation per shape);
+// otherwise reading falls back to fseek/fread on the shared file handle.
+// The mapping is owned by the shapefile and must outlive the reader.
 class CShapefileReader
 {
 public:
 	CShapefileReader()
 	{
 		_indexData = NULL;
+		_indexSize = 0;
 		_shpfile = NULL;
-		_dataLoaded = false;
+		_readLock = NULL;
+		_shpMapping = NULL;
 	}
 
 	~CShapefileReader()
 	{
-		if (_indexData)
+		if (_indexData && !_shpMapping)
 		{
 			delete[] _indexData;
 		}
 	};
 
 private:
-	bool _dataLoaded;
-	char * _indexData;			// content of shx file
+	char * _indexData;			// content of shx file (without header)
+	int _indexSize;
 	FILE * _shpfile;
 	::CCriticalSection* _readLock;
+	CMappedFile* _shpMapping;	// .shp and .shx are read from memory mapping if it's set
+
+private:
+	bool ReadIndexRecord(int shapeIndex, int& offset, int& length);
 
 public:
 	// functions
 	bool ReadShapefileIndex(CStringW filename, FILE* shpFile, ::CCriticalSection* readLock);
-	char* ReadShapeData(int& offset, int& length);
-	PolygonData* ReadPolygonData(char* data);
-	PolygonData* ReadMultiPointData(char* data);
+	void UseMappedFiles(CMappedFile* shpMapping, CMappedFile* shxMapping);
+	char* ReadShapeData(int shapeIndex, int& length);
+	void ReleaseShapeData(char* data);
+	void ReadPolygonData(char* data, PolygonData& result);
+	void ReadMultiPointData(char* data, PolygonData& result);
+	bool IsMapped() { return _shpMapping != NULL; }
 };
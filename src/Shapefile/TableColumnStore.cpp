@@ -0,0 +1,323 @@
+#include "stdafx.h"
+#include "TableColumnStore.h"
+
+// *******************************************************
+//		Clear()
+// *******************************************************
+void TableColumnStore::Clear()
+{
+	for (size_t i = 0; i < _columns.size(); i++)
+		delete _columns[i];
+
+	_columns.clear();
+	_dbf = NULL;
+	_reader = NULL;
+	_numRecords = 0;
+	_failed = false;
+}
+
+// *******************************************************
+//		Open()
+// *******************************************************
+// Nothing is read at this point, columns are loaded by GetColumn.
+bool TableColumnStore::Open(DBFInfo* dbf, DbfColumnReader* reader)
+{
+	Clear();
+
+	if (!dbf)
+		return false;
+
+	_dbf = dbf;
+	_numRecords = DBFGetRecordCount(dbf);
+	_columns.resize(DBFGetFieldCount(dbf), NULL);
+
+	// the mapping can be used only if it covers all the records
+	bool mapped = reader && reader->IsOpen() && reader->get_NumRecords() == _numRecords &&
+				  reader->get_NumFields() == (int)_columns.size();
+	_reader = mapped ? reader : NULL;
+
+	const char* codePage = DBFGetCodePage(dbf);
+	_isUtf8 = codePage == nullptr || strcmp(codePage, "UTF-8") == 0;
+
+	return true;
+}
+
+// *******************************************************
+//		LoadColumn()
+// *******************************************************
+TableColumnStore::Column* TableColumnStore::LoadColumn(int field)
+{
+	if (_failed)
+		return NULL;
+
+	Column* column = NULL;
+	try
+	{
+		column = new Column();
+		LoadColumnCore(field, column);
+	}
+	catch (std::bad_alloc&)
+	{
+		delete column;
+		column = NULL;
+	}
+
+	if (!column)
+	{
+		_failed = true;
+		CallbackHelper::ErrorMsg("Failed to load dbf records into memory; they will be read from file.");
+		return NULL;
+	}
+
+	_columns[field] = column;
+	return column;
+}
+
+// *******************************************************
+//		LoadColumnCore()
+// *******************************************************
+void TableColumnStore::LoadColumnCore(int field, Column* column)
+{
+	const int numRecords = _numRecords;
+
+	column->type = (FieldType)DBFGetFieldInfo(_dbf, field, NULL, NULL, NULL);
+	column->nulls.resize((numRecords + 7) / 8, 0);
+
+	switch (column->type)
+	{
+		case DOUBLE_FIELD:
+			column->doubles.resize(numRecords, 0.0);
+			break;
+		case STRING_FIELD:
+			column->offsets.resize(numRecords + 1, 0);
+			break;
+		default:
+			column->ints.resize(numRecords, 0);
+			break;
+	}
+
+	for (int record = 0; record < numRecords; record++)
+	{
+		bool isNull = _reader ? _reader->IsNull(field, record) : DBFIsAttributeNULL(_dbf, record, field) == 1;
+		if (isNull)
+			column->SetNull(record);
+
+		switch (column->type)
+		{
+			case STRING_FIELD:
+			{
+				column->offsets[record] = column->arena.size();
+				if (!isNull)
+				{
+					if (_reader)
+					{
+						int length;
+						const char* v = _reader->ReadString(field, record, length);
+						column->arena.insert(column->arena.end(), v, v + length);
+					}
+					else
+					{
+						const char* v = DBFReadStringAttribute(_dbf, record, field);
+						if (v)
+							column->arena.insert(column->arena.end(), v, v + strlen(v));
+					}
+				}
+				column->arena.push_back('\0');
+				break;
+			}
+			case DOUBLE_FIELD:
+				if (!isNull)
+					column->doubles[record] = _reader ? _reader->ReadDouble(field, record) : DBFReadDoubleAttribute(_dbf, record, field);
+				break;
+			case BOOLEAN_FIELD:
+				if (!isNull)
+				{
+					if (_reader)
+					{
+						column->ints[record] = _reader->ReadLogical(field, record) ? 1 : 0;
+					}
+					else
+					{
+						const char* v = DBFReadLogicalAttribute(_dbf, record, field);
+						// depending on who wrote the record, we will accept any of 'Y', 'y', 'T', or 't'
+						column->ints[record] = v && (v[0] == 'Y' || v[0] == 'y' || v[0] == 'T' || v[0] == 't') ? 1 : 0;
+					}
+				}
+				break;
+			default:
+				if (!isNull)
+					column->ints[record] = _reader ? _reader->ReadInteger(field, record) : DBFReadIntegerAttribute(_dbf, record, field);
+				break;
+		}
+	}
+
+	if (column->type == STRING_FIELD)
+	{
+		column->offsets[numRecords] = column->arena.size();
+		column->arena.shrink_to_fit();
+	}
+}
+
+// *******************************************************
+//		GetValue()
+// *******************************************************
+bool TableColumnStore::GetValue(int field, int record, FieldType type, VARIANT* val)
+{
+	USES_CONVERSION;
+
+	Column* column = GetColumn(field, record, type);
+	if (!column)
+		return false;
+
+	VariantClear(val);
+
+	if (type == STRING_FIELD)
+	{
+		const char* v = &column->arena[column->offsets[record]];
+		val->vt = VT_BSTR;
+
+		// see the comments in CTableClass::ReadRecord on the choice of encoding
+		if (column->IsNull(record))
+			val->bstrVal = A2BSTR("");
+		else if (_isUtf8)
+			val->bstrVal = W2BSTR(Utility::ConvertFromUtf8(v));
+		else
+			val->bstrVal = A2BSTR(v);
+
+		return true;
+	}
+
+	if (column->IsNull(record))
+	{
+		val->vt = VT_NULL;
+		return true;
+	}
+
+	switch (type)
+	{
+		case INTEGER_FIELD:
+			val->vt = VT_I4;
+			val->lVal = column->ints[record];
+			break;
+		case DOUBLE_FIELD:
+			val->vt = VT_R8;
+			val->dblVal = column->doubles[record];
+			break;
+		case BOOLEAN_FIELD:
+			val->vt = VT_BOOL;
+			val->boolVal = column->ints[record] ? VARIANT_TRUE : VARIANT_FALSE;
+			break;
+		case DATE_FIELD:
+		{
+			int nFullDate = column->ints[record];
+			COleDateTime dt(nFullDate / 10000, (nFullDate / 100) % 100, nFullDate % 100, 0, 0, 0);
+			val->vt = VT_DATE;
+			val->date = dt.m_dt;
+			break;
+		}
+		default:
+			return false;
+	}
+
+	return true;
+}
+
+// *******************************************************
+//		GetDouble()
+// *******************************************************
+bool TableColumnStore::GetDouble(int field, int record, FieldType type, double& val)
+{
+	Column* column = GetColumn(field, record, type);
+	if (!column)
+		return false;
+
+	switch (type)
+	{
+		case DOUBLE_FIELD:
+			val = column->doubles[record];
+			return true;
+		case INTEGER_FIELD:
+			val = column->ints[record];
+			return true;
+		default:
+			return false;
+	}
+}
+
+// *******************************************************
+//		GetInteger()
+// *******************************************************
+bool TableColumnStore::GetInteger(int field, int record, FieldType type, int& val)
+{
+	Column* column = GetColumn(field, record, type);
+	if (!column)
+		return false;
+
+	switch (type)
+	{
+		case DOUBLE_FIELD:
+			val = (int)column->doubles[record];
+			return true;
+		case INTEGER_FIELD:
+			val = column->ints[record];
+			return true;
+		default:
+			return false;
+	}
+}
+
+// *******************************************************
+//		GetString()
+// *******************************************************
+bool TableColumnStore::GetString(int field, int record, FieldType type, const char*& val)
+{
+	Column* column = GetColumn(field, record, type);
+	if (!column || type != STRING_FIELD)
+		return false;
+
+	val = &column->arena[column->offsets[record]];
+	return true;
+}
+
+// *******************************************************
+//		GetWideString()
+// *******************************************************
+bool TableColumnStore::GetWideString(int field, int record, FieldType type, CStringW& val)
+{
+	Column* column = GetColumn(field, record, type);
+	if (!column || type != STRING_FIELD)
+		return false;
+
+	const char* v = &column->arena[column->offsets[record]];
+
+	if (column->IsNull(record))
+		val = L"";
+	else if (_isUtf8)
+		val = Utility::ConvertFromUtf8(v);
+	else
+		val = CStringW(v);
+
+	return true;
+}
+
+// *******************************************************
+//		get_MemoryUsage()
+// *******************************************************
+size_t TableColumnStore::get_MemoryUsage()
+{
+	size_t size = 0;
+	for (size_t i = 0; i < _columns.size(); i++)
+	{
+		Column* column = _columns[i];
+		if (!column)
+			continue;
+
+		size += sizeof(Column) +
+			column->ints.capacity() * sizeof(int) +
+			column->doubles.capacity() * sizeof(double) +
+			column->offsets.capacity() * sizeof(unsigned int) +
+			column->arena.capacity() +
+			column->nulls.capacity();
+	}
+	return size;
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include "dbf.h"
+#include "DbfColumnReader.h"
+
+// ---------------------------------------------------------
+//   Columnar in-memory copy of dbf records
+// ---------------------------------------------------------
+// Values of each field are kept in a single typed array: numbers and dates
+// in plain arrays, strings in one char arena with offsets, nulls in a bitmap.
+// A column is decoded on the first access to it (from the memory mapping when
+// it's available), so the fields which are never read don't take any memory.
+// It's indexed by the record and field index in the dbf file, so it stays
+// valid while the table is edited; edited rows and new or changed fields
+// are still read from TableRow objects.
+class TableColumnStore
+{
+public:
+	TableColumnStore()
+	{
+		_dbf = NULL;
+		_reader = NULL;
+		_numRecords = 0;
+		_failed = false;
+		_isUtf8 = true;
+	}
+
+	~TableColumnStore()
+	{
+		Clear();
+	}
+
+private:
+	struct Column
+	{
+		FieldType type;
+		vector<int> ints;				// INTEGER_FIELD, BOOLEAN_FIELD, DATE_FIELD (yyyymmdd)
+		vector<double> doubles;			// DOUBLE_FIELD
+		vector<unsigned int> offsets;	// STRING_FIELD: start of each value in the arena, numRecords + 1
+		vector<char> arena;				// STRING_FIELD: zero-terminated values as they are stored in dbf
+		vector<unsigned char> nulls;	// a bit per record
+
+		bool IsNull(int record) const { return (nulls[record >> 3] & (1 << (record & 7))) != 0; }
+		void SetNull(int record) { nulls[record >> 3] |= (unsigned char)(1 << (record & 7)); }
+	};
+
+	vector<Column*> _columns;		// by the index of field in dbf; NULL until the field is read
+	DBFInfo* _dbf;
+	DbfColumnReader* _reader;		// is used instead of dbf when it covers all the records
+	int _numRecords;
+	bool _failed;					// not enough memory, there is no point to try again
+	bool _isUtf8;
+
+	Column* LoadColumn(int field);
+	void LoadColumnCore(int field, Column* column);
+	Column* GetColumn(int field, int record, FieldType type)
+	{
+		if (field < 0 || field >= (int)_columns.size() || record < 0 || record >= _numRecords)
+			return NULL;
+
+		Column* column = _columns[field];
+		if (!column)
+			column = LoadColumn(field);
+
+		return column && column->type == type ? column : NULL;
+	}
+
+public:
+	bool Open(DBFInfo* dbf, DbfColumnReader* reader);
+	void Clear();
+	bool IsOpen() { return _dbf != NULL; }
+	int get_NumRecords() { return _numRecords; }
+	size_t get_MemoryUsage();
+
+	// All the getters return false when the value must be taken from dbf instead, i.e. for the records
+	// and fields which weren't loaded or when the type of field in the table differs from the one in dbf.
+
+	// The same conversions as in CTableClass::ReadRecord.
+	bool GetValue(int field, int record, FieldType type, VARIANT* val);
+
+	// The same values as DBFReadDoubleAttribute / DBFReadIntegerAttribute / DBFReadStringAttribute return.
+	bool GetDouble(int field, int record, FieldType type, double& val);
+	bool GetInteger(int field, int record, FieldType type, int& val);
+	bool GetString(int field, int record, FieldType type, const char*& val);
+
+	// The string CTableClass::ReadRecord puts in BSTR, without allocating it.
+	bool GetWideString(int field, int record, FieldType type, CStringW& val);
+};
@@ -54,6 +54,19 @@ public:
     virtual void InitBulkDownload(int zoom, vector<TilePoint*>& points) = 0;
     virtual long get_TileCount(int providerId, int zoom, CRect indices) = 0;
 
+    // writes the tiles passed to AddTile, for the caches which defer writing
+    virtual void Flush() { }
+
+    // checks a set of tiles at once; exists[i] is set for positions[i]
+    virtual void get_TilesExist(BaseProvider* provider, int zoom, const vector<CPoint>& positions, vector<bool>& exists)
+    {
+        exists.resize(positions.size());
+        for (size_t i = 0; i < positions.size(); i++)
+        {
+            exists[i] = get_TileExists(provider, zoom, positions[i].x, positions[i].y);
+        }
+    }
+
 public:
     double get_MaxSize() { return _maxSize; }
     void set_MaxSize(double value) { _maxSize = value; }
@@ -20,6 +20,9 @@
 
 #include "StdAfx.h"
 #include "PrefetchManager.h"
+#include "GeosConverter.h"
+#include "ShapeUtility.h"
+#include <map>
 
 // ReSharper disable CppUseAuto
 
@@ -80,16 +83,25 @@ void PrefetchManager::BuildDownloadList(BaseProvider* provider, int zoom, CRect
 
     ITileCache* cache = _loader.get_Cache();
 
+    vector<CPoint> positions;
     for (int x = minX; x <= maxX; x++)
     {
         for (int y = minY; y <= maxY; y++)
         {
-            if (!cache->get_TileExists(provider, zoom, x, y))
-            {
-                auto* pnt = new TilePoint(x, y);
-                pnt->dist = sqrt(pow(pnt->x - centX, 2.0) + pow(pnt->y - centY, 2.0));
-                points.push_back(pnt);
-            }
+            positions.push_back(CPoint(x, y));
+        }
+    }
+
+    vector<bool> exists;
+    cache->get_TilesExist(provider, zoom, positions, exists);
+
+    for (size_t i = 0; i < positions.size(); i++)
+    {
+        if (!exists[i])
+        {
+            auto* pnt = new TilePoint(positions[i].x, positions[i].y);
+            pnt->dist = sqrt(pow(pnt->x - centX, 2.0) + pow(pnt->y - centY, 2.0));
+            points.push_back(pnt);
         }
     }
 }
@@ -118,22 +130,204 @@ long PrefetchManager::Prefetch(BaseProvider* provider, CRect indices, int zoom,
     vector<TilePoint*> points;
     BuildDownloadList(provider, zoom, indices, points);
 
-    if (points.size() == 0)
+    return Download(provider, zoom, points, callback, stop);
+}
+
+// *********************************************************
+//	     PrefetchArea
+// *********************************************************
+// Downloads the tiles from minZoom to maxZoom which intersect the area (in decimal degrees) 
+// and are missing in the cache. A polyline with a route is fine as well; to get a corridor
+// along it, the buffer is to be built by the caller. With maxTileCount > 0 the lower 
+// zoom levels are taken first until the budget is spent.
+long PrefetchManager::PrefetchArea(BaseProvider* provider, IShape* area, int minZoom, int maxZoom, long maxTileCount,
+                                   ICallback* callback, IStopExecution* stop)
+{
+    if (!provider)
+    {
+        CallbackHelper::ErrorMsg("PrefetchManager", nullptr, "", "Invalid provider.");
+        return -1;
+    }
+
+    GeosShapeData data;
+    if (!GeosConverter::ReadShapeData(area, data) || data.xy.empty())
+    {
+        CallbackHelper::ErrorMsg("PrefetchManager", nullptr, "", "Invalid area.");
+        return -1;
+    }
+
+    LogBulkDownloadStarted(minZoom, maxZoom);
+
+    if (minZoom < 0 || minZoom > maxZoom || provider->get_MaxZoom() < maxZoom)
+    {
+        CallbackHelper::ErrorMsg("PrefetchManager", nullptr, "", "Invalid zoom levels for tile provider: %s, %d-%d",
+                                 provider->Name, minZoom, maxZoom);
+        return -1;
+    }
+
+    vector<TilePoint*> points;
+    BuildPyramidList(provider, data, minZoom, maxZoom, maxTileCount, points);
+
+    return Download(provider, minZoom, points, callback, stop);
+}
+
+// *********************************************************
+//	     BuildPyramidList
+// *********************************************************
+// The tiles within the bounds of area are checked at the first zoom level, and then only
+// the four children of the tiles which intersect the area, so the cost of the next level
+// depends on the area rather than its bounds. The tiles present in the cache are looked up 
+// in a single query per zoom level.
+void PrefetchManager::BuildPyramidList(BaseProvider* provider, const GeosShapeData& area, int minZoom, int maxZoom,
+                                       long maxTileCount, vector<TilePoint*>& points)
+{
+    BaseProjection* projection = provider->get_Projection();
+    ITileCache* cache = _loader.get_Cache();
+
+    Extent bounds(area.xy[0], area.xy[0], area.xy[1], area.xy[1]);
+    for (size_t i = 2; i + 1 < area.xy.size(); i += 2)
+    {
+        bounds.left = MIN(bounds.left, area.xy[i]);
+        bounds.right = MAX(bounds.right, area.xy[i]);
+        bounds.bottom = MIN(bounds.bottom, area.xy[i + 1]);
+        bounds.top = MAX(bounds.top, area.xy[i + 1]);
+    }
+
+    vector<CPoint> parents; // tiles of the previous zoom level which intersect the area
+
+    for (int zoom = minZoom; zoom <= maxZoom; zoom++)
     {
-        if (tilesLogger.IsOpened())
+        CRect indices;
+        projection->getTileRectXY(bounds, zoom, indices);
+
+        CSize size1, size2;
+        projection->GetTileMatrixMinXY(zoom, size1);
+        projection->GetTileMatrixMaxXY(zoom, size2);
+
+        const int minX = (int)BaseProjection::Clip(indices.left, size1.cx, size2.cx);
+        const int maxX = (int)BaseProjection::Clip(indices.right, size1.cx, size2.cx);
+        const int minY = (int)BaseProjection::Clip(MIN(indices.top, indices.bottom), size1.cy, size2.cy);
+        const int maxY = (int)BaseProjection::Clip(MAX(indices.top, indices.bottom), size1.cy, size2.cy);
+
+        vector<CPoint> candidates;
+        if (zoom == minZoom)
         {
-            tilesLogger.out() << "\n";
-            tilesLogger.out() << "Nothing to fetch\n";
-            tilesLogger.out() << "---------------------" << endl;
+            for (int x = minX; x <= maxX; x++)
+            {
+                for (int y = minY; y <= maxY; y++)
+                {
+                    candidates.push_back(CPoint(x, y));
+                }
+            }
+        }
+        else
+        {
+            // children of different parents are different tiles
+            for (size_t i = 0; i < parents.size(); i++)
+            {
+                for (int j = 0; j < 4; j++)
+                {
+                    const int x = parents[i].x * 2 + j % 2;
+                    const int y = parents[i].y * 2 + j / 2;
+
+                    if (x >= minX && x <= maxX && y >= minY && y <= maxY)
+                    {
+                        candidates.push_back(CPoint(x, y));
+                    }
+                }
+            }
         }
+
+        vector<CPoint> positions;
+        for (size_t i = 0; i < candidates.size(); i++)
+        {
+            RectLatLng rect = projection->CalculateGeogBounds(candidates[i], zoom);
+            const Extent tile(rect.xLng, rect.MaxLng(), rect.MinLat(), rect.yLat);
+
+            if (TileIntersectsArea(area, tile))
+            {
+                positions.push_back(candidates[i]);
+            }
+        }
+
+        vector<bool> exists;
+        cache->get_TilesExist(provider, zoom, positions, exists);
+
+        const int centX = (maxX + minX) / 2;
+        const int centY = (maxY + minY) / 2;
+
+        vector<TilePoint*> missing;
+        for (size_t i = 0; i < positions.size(); i++)
+        {
+            if (exists[i])
+            {
+                continue;
+            }
+
+            auto* pnt = new TilePoint(positions[i].x, positions[i].y);
+            pnt->dist = sqrt(pow(pnt->x - centX, 2.0) + pow(pnt->y - centY, 2.0));
+            pnt->zoom = zoom;
+            missing.push_back(pnt);
+        }
+
+        // the tiles nearest to the centre are kept when the level is cut by maxTileCount
+        sort(missing.begin(), missing.end(), [](TilePoint* p1, TilePoint* p2) { return p1->dist < p2->dist; });
+
+        for (size_t i = 0; i < missing.size(); i++)
+        {
+            if (maxTileCount > 0 && (long)points.size() >= maxTileCount)
+            {
+                for (size_t j = i; j < missing.size(); j++)
+                {
+                    delete missing[j];
+                }
+                return;
+            }
+
+            points.push_back(missing[i]);
+        }
+
+        parents.swap(positions);
+
+        if (parents.empty())
+        {
+            break;
+        }
+    }
+}
+
+// *********************************************************
+//	     Download
+// *********************************************************
+// Points with their own zoom may be passed; otherwise zoom is used.
+long PrefetchManager::Download(BaseProvider* provider, int zoom, vector<TilePoint*>& points, ICallback* callback,
+                               IStopExecution* stop)
+{
+    if (points.size() == 0)
+    {
+        LogNothingToFetch();
         return 0;
     }
 
     _loader.set_StopCallback(stop);
     _loader.set_Callback(callback);
-    _loader.get_Cache()->InitBulkDownload(zoom, points);
+
+    // the cache is prepared for each of the zoom levels
+    std::map<int, vector<TilePoint*>> levels;
+    for (size_t i = 0; i < points.size(); i++)
+    {
+        levels[points[i]->zoom == -1 ? zoom : points[i]->zoom].push_back(points[i]);
+    }
+
+    for (auto it = levels.begin(); it != levels.end(); ++it)
+    {
+        _loader.get_Cache()->InitBulkDownload(it->first, it->second);
+    }
 
     TileRequestInfo* info = _loader.CreateNextRequest("", false);
+    info->totalCount = points.size();
+
+    _loader.StartDownload();
 
     // actual call to do the job
     _loader.Load(points, provider, zoom, info);
@@ -145,16 +339,152 @@ long PrefetchManager::Prefetch(BaseProvider* provider, CRect indices, int zoom,
     return size;
 }
 
+// *********************************************************
+//	     TileIntersectsArea
+// *********************************************************
+// A tile intersects the area when a point or segment of the area falls within it,
+// or when it lies inside a polygon.
+bool PrefetchManager::TileIntersectsArea(const GeosShapeData& area, const Extent& tile)
+{
+    const ShpfileType shpType = ShapeUtility::Convert2D(area.shapeType);
+    const int numPoints = (int)area.xy.size() / 2;
+    const double* xy = &area.xy[0];
+
+    if (shpType == SHP_POINT || shpType == SHP_MULTIPOINT)
+    {
+        for (int i = 0; i < numPoints; i++)
+        {
+            if (SegmentIntersectsRect(xy[i * 2], xy[i * 2 + 1], xy[i * 2], xy[i * 2 + 1], tile))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    const int numParts = MAX(1, (int)area.parts.size());
+    for (int j = 0; j < numParts; j++)
+    {
+        const int start = area.parts.empty() ? 0 : area.parts[j];
+        const int end = j < numParts - 1 ? area.parts[j + 1] : numPoints;
+
+        if (end - start == 1 && SegmentIntersectsRect(xy[start * 2], xy[start * 2 + 1], xy[start * 2],
+                                                      xy[start * 2 + 1], tile))
+        {
+            return true;
+        }
+
+        for (int i = start; i < end - 1; i++)
+        {
+            if (SegmentIntersectsRect(xy[i * 2], xy[i * 2 + 1], xy[i * 2 + 2], xy[i * 2 + 3], tile))
+            {
+                return true;
+            }
+        }
+    }
+
+    // no boundary within the tile, so it's either entirely inside the polygon or outside of it
+    return shpType == SHP_POLYGON &&
+        PointWithinArea(area, (tile.left + tile.right) / 2.0, (tile.bottom + tile.top) / 2.0);
+}
+
+// *********************************************************
+//	     SegmentIntersectsRect
+// *********************************************************
+// Liang-Barsky clipping; the segment may be a single point.
+bool PrefetchManager::SegmentIntersectsRect(double x1, double y1, double x2, double y2, const Extent& r)
+{
+    const double p[4] = { x1 - x2, x2 - x1, y1 - y2, y2 - y1 };
+    const double q[4] = { x1 - r.left, r.right - x1, y1 - r.bottom, r.top - y1 };
+
+    double t0 = 0.0, t1 = 1.0;
+
+    for (int i = 0; i < 4; i++)
+    {
+        if (p[i] == 0.0)
+        {
+            if (q[i] < 0.0) return false; // parallel to the side and outside of it
+            continue;
+        }
+
+        const double t = q[i] / p[i];
+        if (p[i] < 0.0)
+        {
+            if (t > t1) return false;
+            if (t > t0) t0 = t;
+        }
+        else
+        {
+            if (t < t0) return false;
+            if (t < t1) t1 = t;
+        }
+    }
+
+    return true;
+}
+
+// *********************************************************
+//	     PointWithinArea
+// *********************************************************
+// Even-odd rule over all the rings, so holes are excluded.
+bool PrefetchManager::PointWithinArea(const GeosShapeData& area, double x, double y)
+{
+    const int numPoints = (int)area.xy.size() / 2;
+    const int numParts = MAX(1, (int)area.parts.size());
+    const double* xy = &area.xy[0];
+
+    bool inside = false;
+
+    for (int j = 0; j < numParts; j++)
+    {
+        const int start = area.parts.empty() ? 0 : area.parts[j];
+        const int end = j < numParts - 1 ? area.parts[j + 1] : numPoints;
+
+        for (int i = start, k = end - 1; i < end; k = i++)
+        {
+            const double xi = xy[i * 2], yi = xy[i * 2 + 1];
+            const double xk = xy[k * 2], yk = xy[k * 2 + 1];
+
+            if ((yi > y) != (yk > y) && x < (xk - xi) * (y - yi) / (yk - yi) + xi)
+            {
+                inside = !inside;
+            }
+        }
+    }
+
+    return inside;
+}
+
+// *********************************************************
+//	     LogNothingToFetch
+// *********************************************************
+void PrefetchManager::LogNothingToFetch()
+{
+    if (tilesLogger.IsOpened())
+    {
+        tilesLogger.out() << "\n";
+        tilesLogger.out() << "Nothing to fetch\n";
+        tilesLogger.out() << "---------------------" << endl;
+    }
+}
+
 // *********************************************************
 //	     LogBulkDownloadStarted
 // *********************************************************
-void PrefetchManager::LogBulkDownloadStarted(int zoom)
+void PrefetchManager::LogBulkDownloadStarted(int zoom, int maxZoom)
 {
     if (tilesLogger.IsOpened())
     {
         tilesLogger.out() << "\n";
         tilesLogger.out() << "PREFETCHING TILES:\n";
-        tilesLogger.out() << "ZOOM " << zoom << endl;
+        if (maxZoom > zoom)
+        {
+            tilesLogger.out() << "ZOOM " << zoom << " - " << maxZoom << endl;
+        }
+        else
+        {
+            tilesLogger.out() << "ZOOM " << zoom << endl;
+        }
         tilesLogger.out() << "---------------------" << endl;
     }
 }
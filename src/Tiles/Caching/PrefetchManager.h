@@ -23,6 +23,7 @@
 #include "TileBulkLoader.h"
 
 class PrefetchManager;
+struct GeosShapeData;
 
 // ******************************************************
 //    PrefetchManagerFactory
@@ -54,6 +55,14 @@ private:
 private:
     // methods
     void BuildDownloadList(BaseProvider* provider, int zoom, CRect indices, vector<TilePoint*>& points);
+    void BuildPyramidList(BaseProvider* provider, const GeosShapeData& area, int minZoom, int maxZoom,
+                          long maxTileCount, vector<TilePoint*>& points);
+    long Download(BaseProvider* provider, int zoom, vector<TilePoint*>& points, ICallback* callback,
+                  IStopExecution* stop);
+    static bool TileIntersectsArea(const GeosShapeData& area, const Extent& tile);
+    static bool SegmentIntersectsRect(double x1, double y1, double x2, double y2, const Extent& r);
+    static bool PointWithinArea(const GeosShapeData& area, double x, double y);
+    static void LogNothingToFetch();
 public:
     // properties
     TileBulkLoader* get_Loader() { return &_loader; }
@@ -61,5 +70,7 @@ public:
 public:
     // methods
     long Prefetch(BaseProvider* provider, CRect indices, int zoom, ICallback* callback, IStopExecution* stop);
-    static void LogBulkDownloadStarted(int zoom);
+    long PrefetchArea(BaseProvider* provider, IShape* area, int minZoom, int maxZoom, long maxTileCount,
+                      ICallback* callback, IStopExecution* stop);
+    static void LogBulkDownloadStarted(int zoom, int maxZoom = -1);
 };
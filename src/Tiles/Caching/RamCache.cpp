@@ -25,37 +25,22 @@
 // *********************************************************
 //	     Close()
 // *********************************************************
+// Releases all the tiles; those which are displayed stay alive until the buffer releases them as well.
 void RamCache::Close()
 {
-    // release tiles first
-    Clear();
-
-    // then release dynamically allocated containers
-    for (TilesCache::iterator it = _tilesMap.begin(); it != _tilesMap.end(); ++it)
+    for (int i = 0; i < RAM_CACHE_NUM_SHARDS; i++)
     {
-        vector<TilePoints*>* list = it->second;
-        if (list)
+        RamCacheShard& shard = _shards[i];
+        vector<TileCore*> removed;
+
+        shard.section.Lock();
+        while (!shard.items.empty())
         {
-            for (size_t i = 0; i < (int)list->size(); i++)
-            {
-                TilePoints* points = (*list)[i];
-                if (points)
-                {
-                    TilePoints::iterator it2 = points->begin();
-                    while (it2 != points->end())
-                    {
-                        TilePositions* tiles = it2->second;
-                        if (tiles)
-                        {
-                            delete tiles;
-                        }
-                        ++it2;
-                    }
-                    delete points;
-                }
-            }
-            delete list;
+            RemoveItem(shard, shard.items.begin(), removed);
         }
+        shard.section.Unlock();
+
+        ReleaseTiles(removed);
     }
 }
 
@@ -69,50 +54,23 @@ void RamCache::AddTile(TileCore* tile)
         return;
     }
 
-    _section.Lock();
+    RamCacheKey key = { tile->get_ProviderId(), tile->zoom(), tile->tileX(), tile->tileY() };
+    RamCacheShard& shard = get_Shard(key);
 
-    // seeking provider
-    std::vector<TilePoints*>* list;
-    if (_tilesMap.find(tile->get_ProviderId()) != _tilesMap.end())
-    {
-        list = _tilesMap[tile->get_ProviderId()];
-    }
-    else
-    {
-        list = new std::vector<TilePoints*>();
-        list->resize(25, nullptr);
-        _tilesMap[tile->get_ProviderId()] = list;
-    }
+    shard.section.Lock();
 
-    // seeking scale
-    TilePoints* points = (*list)[tile->zoom()];
-    if (!points)
+    if (shard.index.find(key) == shard.index.end())
     {
-        points = new TilePoints();
-        (*list)[tile->zoom()] = points;
-    }
+        RamCacheItem item = { key, tile, tile->get_ByteSize() };
+        tile->AddRef();
 
-    // seeking X
-    std::map<int, TileCore*>* map;
-    if (points->find(tile->tileX()) != points->end())
-    {
-        map = (*points)[tile->tileX()];
-    }
-    else
-    {
-        map = new std::map<int, TileCore*>();
-        (*points)[tile->tileX()] = map;
+        shard.items.push_front(item);
+        shard.index[key] = shard.items.begin();
+        shard.size += item.size;
+        InterlockedExchangeAdd64(&_size, item.size);
     }
 
-    // seeking Y
-    if (map->find(tile->tileY()) == map->end())
-    {
-        tile->AddRef();
-        (*map)[tile->tileY()] = tile;
-        _size += tile->get_ByteSize();
-        _list.push_back(tile);
-    }
-    _section.Unlock();
+    shard.section.Unlock();
 
     // automatically clear the cache if it exceeds the maximum size
     if ((double)_size / (double)(0x1 << 20) > _maxSize)
@@ -121,26 +79,79 @@ void RamCache::AddTile(TileCore* tile)
     }
 }
 
+// *********************************************************
+//	     RemoveItem()
+// *********************************************************
+// The caller must hold the lock of the shard; the tile is added to the list to be released after it's left.
+void RamCache::RemoveItem(RamCacheShard& shard, RamCacheList::iterator it, vector<TileCore*>& removed)
+{
+    shard.size -= it->size;
+    InterlockedExchangeAdd64(&_size, -it->size);
+
+    removed.push_back(it->tile);
+    shard.index.erase(it->key);
+    shard.items.erase(it);
+}
+
+// *********************************************************
+//	     ReleaseTiles()
+// *********************************************************
+// Bitmaps of the tiles are freed here, outside of shard locks, so readers don't wait for it.
+void RamCache::ReleaseTiles(vector<TileCore*>& tiles)
+{
+    for (size_t i = 0; i < tiles.size(); i++)
+    {
+        tiles[i]->Release();
+    }
+    tiles.clear();
+}
+
 // *********************************************************
 //	     ClearOldest()
 // *********************************************************
+// Each shard gives up its least recently used tiles in proportion to its size, so that
+// the oldest tiles of the whole cache are removed without holding more than one lock.
+// If another thread is already clearing the cache, the call returns at once.
 void RamCache::ClearOldest(int sizeToClearBytes)
 {
-    int size = 0;
+    if (InterlockedCompareExchange(&_evicting, 1, 0) != 0)
+    {
+        return;
+    }
 
-    for (size_t i = 0; i < _list.size(); i++)
+    __int64 total = _size;
+
+    for (int i = 0; i < RAM_CACHE_NUM_SHARDS && total > 0; i++)
     {
-        if (!_list[i]->inBuffer())
+        RamCacheShard& shard = _shards[i];
+        vector<TileCore*> removed;
+
+        shard.section.Lock();
+
+        __int64 target = (__int64)((double)sizeToClearBytes * shard.size / total) + 1;
+        __int64 size = 0;
+
+        RamCacheList::iterator it = shard.items.end();
+        while (it != shard.items.begin() && size < target)
         {
-            _list[i]->toDelete(true);
+            --it;
+
+            // tiles which are currently displayed will be requested again on the next redraw
+            if (it->tile->inBuffer())
+            {
+                continue;
+            }
 
-            size += _list[i]->get_ByteSize();
-            if (size > TILE_CACHE_SIZE_TO_CLEAR)
-                break;
+            size += it->size;
+            RemoveItem(shard, it++, removed);
         }
+
+        shard.section.Unlock();
+
+        ReleaseTiles(removed);
     }
 
-    DeleteMarkedTiles();
+    InterlockedExchange(&_evicting, 0);
 }
 
 // **********************************************************
@@ -149,101 +160,35 @@ void RamCache::ClearOldest(int sizeToClearBytes)
 // Removes tiles of the specified provider
 void RamCache::Clear(int provider, int fromScale, int toScale)
 {
-    _section.Lock();
-    for (TilesCache::iterator it = _tilesMap.begin(); it != _tilesMap.end(); ++it)
+    for (int i = 0; i < RAM_CACHE_NUM_SHARDS; i++)
     {
-        // if provider is equal -1, then all tiles are to be removed
-        if (provider != (int)tkTileProvider::ProviderNone && provider != it->first)
-            continue;
+        RamCacheShard& shard = _shards[i];
+        vector<TileCore*> removed;
 
-        vector<TilePoints*>* list = it->second;
-        if (list)
+        shard.section.Lock();
+
+        RamCacheList::iterator it = shard.items.begin();
+        while (it != shard.items.end())
         {
-            for (int i = 0; i < (int)list->size(); i++)
+            // if provider is equal -1, then all tiles are to be removed
+            bool matches = (provider == (int)tkTileProvider::ProviderNone || provider == it->key.providerId) &&
+                it->key.zoom >= fromScale && it->key.zoom <= toScale;
+
+            // it doesn't make sense to delete tiles which are currently displayed;
+            // as they will be requested again on simple refresh of the map
+            if (matches && !it->tile->inBuffer())
             {
-                if (i < fromScale || i > toScale)
-                    continue;
-
-                TilePoints* points = (*list)[i];
-                if (points)
-                {
-                    TilePoints::iterator it2 = points->begin();
-                    while (it2 != points->end())
-                    {
-                        TilePositions* tiles = it2->second;
-                        TilePositions::iterator it3 = tiles->begin();
-
-                        while (it3 != tiles->end())
-                        {
-                            TileCore* tile = it3->second;
-
-                            if (tile->inBuffer())
-                            {
-                                ++it3; // it doesn't make sense to delete tiles which are 
-                                // currently displayed; as they will be requested again on simple refresh of the map
-                            }
-                            else
-                            {
-                                tiles->erase(it3++);
-                                _size -= tile->get_ByteSize();
-
-                                // marks it to be removed from chronological vector
-                                tile->toDelete(true);
-                            }
-                        }
-
-                        // if all the Y's for given X are removed - delete the container
-                        if (tiles->empty())
-                        {
-                            points->erase(it2++);
-                            delete tiles;
-                        }
-                        else
-                            ++it2;
-                    }
-
-                    // if all the X's for a given scale are removed - delete the container,
-                    // but don't delete scale entry - 25 scales must preserved as they are accessed by index
-                    if (points->empty())
-                    {
-                        delete points;
-                        (*list)[i] = nullptr;
-                    }
-                }
+                RemoveItem(shard, it++, removed);
+            }
+            else
+            {
+                ++it;
             }
         }
-    }
-
-    _tilesMap.clear();
-
-    // now remove tiles from chronological vector
-    DeleteMarkedTiles();
 
-    _section.Unlock();
-}
+        shard.section.Unlock();
 
-// *********************************************************
-//		DeleteMarkedTiles()
-// *********************************************************
-// Removes tiles marked as "to delete" from chronological vector.
-// The tiles should removed from fast access storage before this operation.
-// It's done by either calling ClearAll(), ClearByProvider() or ClearOldest.
-// It's responsibility of caller to lock the the cache to make it thread safe
-void RamCache::DeleteMarkedTiles()
-{
-    vector<TileCore*>::iterator it = _list.begin();
-    while (it != _list.end())
-    {
-        TileCore* tile = *it;
-        if (tile->toDelete())
-        {
-            tile->Release();
-            it = _list.erase(it);
-        }
-        else
-        {
-            ++it;
-        }
+        ReleaseTiles(removed);
     }
 }
 
@@ -255,7 +200,7 @@ TileCore* RamCache::get_Tile(BaseProvider* provider, int scale, int tileX, int t
 {
     if (!provider) return nullptr;
 
-    TileCore* tile = get_TileCore(provider->Id, scale, tileX, tileY);
+    TileCore* tile = get_TileCore(provider->Id, scale, tileX, tileY, true);
 
     if (tile)
     {
@@ -273,68 +218,54 @@ TileCore* RamCache::get_Tile(BaseProvider* provider, int scale, int tileX, int t
 void RamCache::OnProviderClosed(int providerId)
 {
     // set projection for all tiles of this provider to NULL
-    if (_tilesMap.find(providerId) != _tilesMap.end())
+    for (int i = 0; i < RAM_CACHE_NUM_SHARDS; i++)
     {
-        std::vector<TilePoints*>* scales = _tilesMap[providerId];
-        for (size_t i = 0; i < scales->size(); i++)
+        RamCacheShard& shard = _shards[i];
+
+        shard.section.Lock();
+
+        for (RamCacheList::iterator it = shard.items.begin(); it != shard.items.end(); ++it)
         {
-            TilePoints* points = (*scales)[i];
-            if (points)
+            if (it->key.providerId == providerId)
             {
-                TilePoints::iterator it = points->begin();
-                while (it != points->end())
-                {
-                    TilePositions* positions = it->second;
-                    if (positions)
-                    {
-                        TilePositions::iterator it2 = positions->begin();
-                        while (it2 != positions->end())
-                        {
-                            TileCore* tile = it2->second;
-                            if (tile)
-                            {
-                                tile->set_Projection(nullptr);
-                            }
-                            ++it2;
-                        }
-                    }
-                    ++it;
-                }
+                it->tile->set_Projection(nullptr);
             }
         }
+
+        shard.section.Unlock();
     }
 }
 
 // ********************************************************
 //		get_TileCore()
 // ********************************************************
-TileCore* RamCache::get_TileCore(int providerId, int scale, int tileX, int tileY)
+// A tile which is going to be displayed is marked as being in buffer while the lock
+// is held; otherwise eviction on another thread could release it before the caller adds a reference.
+TileCore* RamCache::get_TileCore(int providerId, int scale, int tileX, int tileY, bool markInBuffer)
 {
-    _section.Lock();
+    RamCacheKey key = { providerId, scale, tileX, tileY };
+    RamCacheShard& shard = get_Shard(key);
 
     TileCore* tile = nullptr;
 
-    if (_tilesMap.find(providerId) != _tilesMap.end())
+    shard.section.Lock();
+
+    auto it = shard.index.find(key);
+    if (it != shard.index.end())
     {
-        std::vector<TilePoints*>* scales = _tilesMap[providerId];
-        if (scale >= 0 && scale < (int)scales->size())
+        tile = it->second->tile;
+
+        if (markInBuffer)
         {
-            TilePoints* points = (*scales)[scale];
-            if (points != nullptr)
-            {
-                if (points->find(tileX) != points->end())
-                {
-                    std::map<int, TileCore*>* map = (*points)[tileX];
-                    if (map->find(tileY) != map->end())
-                    {
-                        tile = (*map)[tileY];
-                    }
-                }
-            }
+            tile->inBuffer(true);
+
+            // the most recently used one goes first
+            shard.items.splice(shard.items.begin(), shard.items, it->second);
         }
     }
 
-    _section.Unlock();
+    shard.section.Unlock();
+
     return tile;
 }
 
@@ -344,38 +275,33 @@ TileCore* RamCache::get_TileCore(int providerId, int scale, int tileX, int tileY
 // Use -1 for provider and scale to retrieve all the values
 double RamCache::get_SizeMB(int provider, int scale)
 {
-    _section.Lock();
-    int sum = 0;
-    for (TilesCache::iterator it = _tilesMap.begin(); it != _tilesMap.end(); ++it)
+    if (provider == (int)tkTileProvider::ProviderNone && scale == -1)
+    {
+        return (double)_size / (double)(0x1 << 20);
+    }
+
+    __int64 sum = 0;
+
+    for (int i = 0; i < RAM_CACHE_NUM_SHARDS; i++)
     {
-        if (provider != (int)tkTileProvider::ProviderNone && provider != it->first)
-            continue;
+        RamCacheShard& shard = _shards[i];
+
+        shard.section.Lock();
 
-        std::vector<TilePoints*>* scales = it->second;
-        for (size_t i = 0; i < scales->size(); i++)
+        for (RamCacheList::iterator it = shard.items.begin(); it != shard.items.end(); ++it)
         {
-            if (scale != -1 && i != scale)
+            if (provider != (int)tkTileProvider::ProviderNone && provider != it->key.providerId)
                 continue;
 
-            TilePoints* points = (*scales)[i];
-            if (points)
-            {
-                for (TilePoints::iterator it2 = points->begin(); it2 != points->end(); ++it2)
-                {
-                    TilePositions* tiles = it2->second;
-                    if (tiles)
-                    {
-                        for (TilePositions::iterator it3 = tiles->begin(); it3 != tiles->end(); ++it3)
-                        {
-                            TileCore* tile = it3->second;
-                            sum += tile->get_ByteSize();
-                        }
-                    }
-                }
-            }
+            if (scale != -1 && scale != it->key.zoom)
+                continue;
+
+            sum += it->size;
         }
+
+        shard.section.Unlock();
     }
-    _section.Unlock();
+
     return (double)sum / (double)(0x1 << 20);
 }
 
@@ -384,7 +310,9 @@ double RamCache::get_SizeMB(int provider, int scale)
 // ***********************************************************
 bool RamCache::get_TileExists(BaseProvider* provider, int scale, int x, int y)
 {
-    return get_Tile(provider, scale, x, y) != nullptr;
+    if (!provider) return false;
+
+    return get_TileCore(provider->Id, scale, x, y, false) != nullptr;
 }
 
 // ***********************************************************
@@ -398,7 +326,7 @@ long RamCache::get_TileCount(int providerId, int zoom, CRect indices)
     {
         for (int y = indices.bottom; y <= indices.top; y++)
         {
-            TileCore* tile = get_TileCore(providerId, zoom, x, y);
+            TileCore* tile = get_TileCore(providerId, zoom, x, y, false);
             if (tile)
             {
                 count++;
@@ -21,32 +21,92 @@
 
 #pragma once
 #include "ITileCache.h"
+#include <list>
+#include <unordered_map>
 using namespace std;
 
-// provider id -> zoom -> x -> y
-typedef std::map<int, TileCore*> TilePositions; // indexed by y
-typedef std::map<int, TilePositions*> TilePoints; // indexed by x
-typedef std::map<int, std::vector<TilePoints*>*> TilesCache; // indexed by provider; indices in vector - by zoom 
+#define RAM_CACHE_NUM_SHARDS 16
+
+// ********************************************************
+//     RamCacheKey
+// ********************************************************
+struct RamCacheKey
+{
+    int providerId;
+    int zoom;
+    int x;
+    int y;
+
+    bool operator==(const RamCacheKey& other) const
+    {
+        return providerId == other.providerId && zoom == other.zoom && x == other.x && y == other.y;
+    }
+};
+
+struct RamCacheKeyHasher
+{
+    size_t operator()(const RamCacheKey& key) const
+    {
+        // neighbouring tiles must end up in different shards, so all the fields are mixed
+        unsigned __int64 h = (unsigned __int64)(unsigned int)key.x * 0x9E3779B97F4A7C15ULL;
+        h ^= ((unsigned __int64)(unsigned int)key.y + 0x632BE59BD9B4E019ULL) * 0xC2B2AE3D27D4EB4FULL;
+        h ^= ((unsigned __int64)(unsigned int)key.zoom << 32 | (unsigned int)key.providerId) * 0x165667B19E3779F9ULL;
+        return (size_t)(h ^ (h >> 29));
+    }
+};
+
+// ********************************************************
+//     RamCacheShard
+// ********************************************************
+// Part of the cache with its own lock. Tiles are kept in the list with the most
+// recently used one first, the hash map points to their positions in the list.
+struct RamCacheItem
+{
+    RamCacheKey key;
+    TileCore* tile;
+    int size;       // byte size at the moment of adding, so that removal subtracts exactly the same amount
+};
+
+typedef std::list<RamCacheItem> RamCacheList;
+
+struct RamCacheShard
+{
+    RamCacheShard() : size(0) {}
+
+    CCriticalSection section;
+    RamCacheList items;
+    std::unordered_map<RamCacheKey, RamCacheList::iterator, RamCacheKeyHasher> index;
+    __int64 size;
+};
 
 // Provides storage for map tiles in RAM
+// Tiles are distributed between shards by the hash of their key, so the loader threads
+// and the UI thread only compete when they access the same shard. Eviction frees
+// the least recently used tiles of each shard, locking one shard at a time,
+// and releases them after the lock is left.
 class RamCache : public ITileCache
 {
 public:
     RamCache()
-        : _size(0)
+        : _size(0), _evicting(0)
     {
         _maxSize = 100.0;
     }
 
 private:
-    CCriticalSection _section;
-    vector<TileCore*> _list; // the list of tiles in the chronological order
-    TilesCache _tilesMap; // the main storage
-    int _size; // size of cache in bytes
+    RamCacheShard _shards[RAM_CACHE_NUM_SHARDS];
+    volatile LONGLONG _size; // size of cache in bytes
+    volatile LONG _evicting; // one of the threads is clearing the oldest tiles
 
 private:
-    void DeleteMarkedTiles(); // deletes tiles from chronological vector	
-    TileCore* get_TileCore(int providerId, int zoom, int tileX, int tileY);
+    RamCacheShard& get_Shard(const RamCacheKey& key)
+    {
+        return _shards[RamCacheKeyHasher()(key) % RAM_CACHE_NUM_SHARDS];
+    }
+
+    TileCore* get_TileCore(int providerId, int zoom, int tileX, int tileY, bool markInBuffer);
+    void RemoveItem(RamCacheShard& shard, RamCacheList::iterator it, vector<TileCore*>& removed);
+    void ReleaseTiles(vector<TileCore*>& tiles);
 
 public:
     // interface
@@ -29,11 +29,20 @@
 // ***********************************************************
 void SQLiteCache::Close()
 {
+	Flush();
+
+	_section.Lock();
+	FinalizeStatements();
 	if (_conn)
 	{
 		sqlite3_close(_conn);
 		_conn = NULL;
 	}
+
+	// the connection is opened again on the next request
+	_createNeeded = true;
+	_openNeeded = true;
+	_section.Unlock();
 }
 
 // ***********************************************************
@@ -104,6 +113,9 @@ bool SQLiteCache::set_DbName(CStringW name)
 
 	if (name.MakeLower() != _dbName.MakeLower())
 	{
+		// queued tiles belong to the previous database
+		Flush();
+
 		_dbName = name;
 		CreateDatabase();
 	}
@@ -138,6 +150,7 @@ bool SQLiteCache::CreateDatabase()
 	
 	if (_conn)
 	{
+		FinalizeStatements();
 		int val = sqlite3_close(_conn);
 		_conn = NULL;
 	}
@@ -173,7 +186,23 @@ bool SQLiteCache::CreateDatabase()
 						  "DELETE from TilesData WHERE TilesData.Id = OLD.id; "
 						  "END;";
 
-					return !sqlite3_exec(_conn, sql, NULL, NULL, NULL);
+					val = sqlite3_exec(_conn, sql, NULL, NULL, NULL);
+				}
+
+				if (!val)
+				{
+					// otherwise each lookup by position scans the whole table
+					sql = "CREATE INDEX IF NOT EXISTS TilesPosition ON Tiles (Zoom, X, Y, Type);";
+					val = sqlite3_exec(_conn, sql, NULL, NULL, NULL);
+				}
+
+				if (!val)
+				{
+					// readers aren't blocked while a batch is written; it may fail
+					// for network drives, then the default rollback journal is used
+					sqlite3_exec(_conn, "PRAGMA journal_mode=WAL; PRAGMA synchronous=NORMAL;", NULL, NULL, NULL);
+
+					return PrepareStatements();
 				}
 			}
 		}
@@ -181,90 +210,218 @@ bool SQLiteCache::CreateDatabase()
 	return ret;
 }
 
+// ***********************************************************
+//		PrepareStatements()
+// ***********************************************************
+// Statements are reused for all the tiles until the connection is closed.
+bool SQLiteCache::PrepareStatements()
+{
+	FinalizeStatements();
+
+	bool result = 
+		sqlite3_prepare_v2(_conn, "REPLACE INTO Tiles VALUES (?, ?, ?, ?, ?, ?, ?)", -1, &_insertTile, NULL) == SQLITE_OK &&
+		sqlite3_prepare_v2(_conn, "REPLACE INTO TilesData VALUES (?, ?)", -1, &_insertData, NULL) == SQLITE_OK &&
+		sqlite3_prepare_v2(_conn, "SELECT id FROM Tiles WHERE X = ? AND Y = ? AND Zoom = ? AND Type = ?", -1, &_selectId, NULL) == SQLITE_OK &&
+		sqlite3_prepare_v2(_conn, "SELECT tile FROM TilesData WHERE Id = ?", -1, &_selectData, NULL) == SQLITE_OK &&
+		sqlite3_prepare_v2(_conn, "SELECT X, Y FROM Tiles WHERE Type = ? AND Zoom = ? AND X >= ? AND X <= ? AND Y >= ? AND Y <= ?", 
+						   -1, &_selectRange, NULL) == SQLITE_OK;
+
+	if (!result)
+	{
+		CallbackHelper::ErrorMsg("SQLiteCache: Failed to prepare statements.");
+		FinalizeStatements();
+		sqlite3_close(_conn);
+		_conn = NULL;
+	}
+
+	return result;
+}
+
+// ***********************************************************
+//		FinalizeStatements()
+// ***********************************************************
+void SQLiteCache::FinalizeStatements()
+{
+	sqlite3_stmt** statements[] = { &_insertTile, &_insertData, &_selectId, &_selectData, &_selectRange };
+	for (int i = 0; i < 5; i++)
+	{
+		if (*statements[i])
+		{
+			sqlite3_finalize(*statements[i]);
+			*statements[i] = NULL;
+		}
+	}
+}
+
 // ***********************************************************
 //		AddTile()
 // ***********************************************************
-// Pushes a single tile in the database. Called by the worker thread
+// Queues a single tile to be written in the database. Called by the worker thread.
+// The reference to the tile is released after it's written.
 void SQLiteCache::AddTile(TileCore* tile)
 {
-	static int addedCount = 0;
-	static int percent = 0;
-
-	if(!Initialize(SqliteOpenMode::OpenIfExists))
+	if (!Initialize(SqliteOpenMode::OpenIfExists))
+	{
+		tile->Release();
 		return;
-	
+	}
+
+	_queueSection.Lock();
+
+	if (_queue.empty())
+		_queueStarted = GetTickCount();
+
+	_queue.push_back(tile);
+
+	bool flush = _queue.size() >= SQLITE_CACHE_BATCH_SIZE || GetTickCount() - _queueStarted >= SQLITE_CACHE_FLUSH_INTERVAL;
+
+	_queueSection.Unlock();
+
+	if (flush)
+	{
+		Flush();
+	}
+}
+
+// ***********************************************************
+//		Flush()
+// ***********************************************************
+// Writes all the queued tiles in a single transaction.
+void SQLiteCache::Flush()
+{
 	_section.Lock();
 
-	try
+	// the tiles stay visible for IsQueued until they are committed
+	_queueSection.Lock();
+	_writing.insert(_writing.end(), _queue.begin(), _queue.end());
+	_queue.clear();
+	_queueSection.Unlock();
+
+	if (!_writing.empty() && _conn)
 	{
-		const char   *tail;
-		sqlite3_stmt *stmt;
-		for (size_t i = 0; i < tile->Overlays.size(); i++)
+		try
 		{
-			CMemoryBitmap* bmp = tile->get_Bitmap(i);
-			if (bmp)
+			sqlite3_exec(_conn, "BEGIN TRANSACTION;", NULL, NULL, NULL);
+
+			for (size_t i = 0; i < _writing.size(); i++)
 			{
-				int size = bmp->get_Size();
-				if (size > 0)
-				{
-					CString s = "REPLACE INTO Tiles VALUES (?, ?, ?, ?, ?, ?, ?)";
-					int val = sqlite3_prepare_v2(_conn, s, s.GetLength()+1, &stmt, &tail);
-					
-					if (val != SQLITE_OK)
-					{
-						CallbackHelper::ErrorMsg("SQLiteCache::DoCaching: Failed to prepare statement.");
-					}
-					else
-					{
-						val = sqlite3_bind_int(stmt, 2, tile->tileX());
-						val = sqlite3_bind_int(stmt, 3, tile->tileY());
-						val = sqlite3_bind_int(stmt, 4, tile->zoom());
-						val = sqlite3_bind_int(stmt, 5, bmp->Provider);
-						val = sqlite3_bind_int(stmt, 6, bmp->get_Size());
-						
-						val = sqlite3_step(stmt);
-						sqlite3_finalize(stmt);
-						
-						s = "REPLACE INTO TilesData VALUES (?, ?)";
-						val = sqlite3_prepare_v2(_conn, s, s.GetLength()+1, &stmt, &tail);
-						sqlite3_int64 id = sqlite3_last_insert_rowid(_conn);
-						val = sqlite3_bind_int64(stmt, 1, id);
-						
-						void* data = (void*)new char[size];
-						void* hMem = ::GlobalLock(bmp->getData());
-						memcpy(data, hMem, size);
-						::GlobalUnlock(hMem);
-
-						val = sqlite3_bind_blob(stmt, 2, data, size, NULL);
-						val = sqlite3_step(stmt);
-						
-						if (val == SQLITE_OK || val == SQLITE_DONE)
-						{
-							addedCount++;
-						}
+				WriteTile(_writing[i]);
+			}
 
-						delete[] data;
-						sqlite3_finalize(stmt);
-					}
-				}
+			if (sqlite3_exec(_conn, "COMMIT;", NULL, NULL, NULL) != SQLITE_OK)
+			{
+				CallbackHelper::ErrorMsg("SQLiteCache: Failed to commit tiles.");
+				sqlite3_exec(_conn, "ROLLBACK;", NULL, NULL, NULL);
 			}
 		}
+		catch (...)
+		{
+			CallbackHelper::ErrorMsg("SQLiteCache: exception on adding tiles.");
+		}
 	}
-	catch(...)
+
+	_queueSection.Lock();
+	vector<TileCore*> tiles;
+	tiles.swap(_writing);
+	_queueSection.Unlock();
+
+	bool autoClear = _addedCount >= 25;
+	if (autoClear)
 	{
-		CallbackHelper::ErrorMsg("SQLiteCache: exception on adding tiles.");
+		_addedCount = 0;
 	}
+
 	_section.Unlock();
-	
-	tile->Release();
+
+	for (size_t i = 0; i < tiles.size(); i++)
+	{
+		tiles[i]->Release();
+	}
 
 	// check if the database grew enough to run the cleaning routine
-	if (addedCount % 25 == 0)
+	if (autoClear)
 	{
 		AutoClear();
 	}
 }
 
+// ***********************************************************
+//		WriteTile()
+// ***********************************************************
+// Must be called inside the transaction started by Flush().
+void SQLiteCache::WriteTile(TileCore* tile)
+{
+	for (size_t i = 0; i < tile->Overlays.size(); i++)
+	{
+		CMemoryBitmap* bmp = tile->get_Bitmap(i);
+		if (!bmp)
+			continue;
+
+		int size = bmp->get_Size();
+		if (size <= 0)
+			continue;
+
+		sqlite3_bind_int(_insertTile, 2, tile->tileX());
+		sqlite3_bind_int(_insertTile, 3, tile->tileY());
+		sqlite3_bind_int(_insertTile, 4, tile->zoom());
+		sqlite3_bind_int(_insertTile, 5, bmp->Provider);
+		sqlite3_bind_int(_insertTile, 6, size);
+
+		int val = sqlite3_step(_insertTile);
+		sqlite3_reset(_insertTile);
+
+		if (val != SQLITE_DONE)
+		{
+			CallbackHelper::ErrorMsg("SQLiteCache::WriteTile: Failed to insert tile.");
+			continue;
+		}
+
+		sqlite3_int64 id = sqlite3_last_insert_rowid(_conn);
+		sqlite3_bind_int64(_insertData, 1, id);
+
+		// the data is bound without copying, so the memory stays locked until the row is written
+		void* data = ::GlobalLock(bmp->getData());
+		sqlite3_bind_blob(_insertData, 2, data, size, SQLITE_STATIC);
+		val = sqlite3_step(_insertData);
+		sqlite3_reset(_insertData);
+		sqlite3_clear_bindings(_insertData);
+		::GlobalUnlock(bmp->getData());
+
+		if (val == SQLITE_OK || val == SQLITE_DONE)
+		{
+			_addedCount++;
+		}
+	}
+}
+
+// ***********************************************************
+//		IsQueued()
+// ***********************************************************
+bool SQLiteCache::IsQueued(int providerId, int zoom, int x, int y)
+{
+	bool found = false;
+
+	_queueSection.Lock();
+
+	for (int n = 0; n < 2 && !found; n++)
+	{
+		vector<TileCore*>& tiles = n == 0 ? _queue : _writing;
+		for (size_t i = 0; i < tiles.size(); i++)
+		{
+			TileCore* tile = tiles[i];
+			if (tile->get_ProviderId() == providerId && tile->zoom() == zoom && tile->tileX() == x && tile->tileY() == y)
+			{
+				found = true;
+				break;
+			}
+		}
+	}
+
+	_queueSection.Unlock();
+
+	return found;
+}
+
 // ***********************************************************
 //		AutoClear() 
 // ***********************************************************
@@ -322,44 +479,118 @@ void SQLiteCache::AutoClear()
 // ***********************************************************
 bool SQLiteCache::get_TileExists(BaseProvider* provider, int scale, int x, int y)
 {
-	if(!Initialize(SqliteOpenMode::OpenIfExists))
+	if (!provider || !Initialize(SqliteOpenMode::OpenIfExists))
 		return false;
 
-	const char   *tail;
-	sqlite3_stmt *stmt;
+	if (IsQueued(provider->Id, scale, x, y))
+		return true;
+
 	bool exists = true;
 
+	_section.Lock();
+
 	try
 	{
-		for(size_t i = 0; i < provider->get_SubProviders()->size(); i++)
+		if (!_conn)
+		{
+			exists = false;
+		}
+
+		for (size_t i = 0; i < provider->get_SubProviders()->size() && exists; i++)
 		{
+			// the overlays are stored by the ids of sub-providers, the same as get_Tile looks for them
 			int providerId = (*provider->get_SubProviders())[i]->Id;
 
-			CString sql;
-			sql.Format("SELECT id FROM Tiles WHERE X = %d AND Y = %d AND Zoom = %d AND Type = %d", x, y, scale, provider->Id);
-			int val = sqlite3_prepare_v2(_conn, sql, sql.GetLength() + 1, &stmt, &tail);
-			
-			_section.Lock();
-			if( sqlite3_step(stmt) != SQLITE_ROW)
+			sqlite3_bind_int(_selectId, 1, x);
+			sqlite3_bind_int(_selectId, 2, y);
+			sqlite3_bind_int(_selectId, 3, scale);
+			sqlite3_bind_int(_selectId, 4, providerId);
+
+			if (sqlite3_step(_selectId) != SQLITE_ROW)
 			{
 				exists = false;
 			}
-			val = sqlite3_finalize(stmt);
-			_section.Unlock();
-
-			if (!exists)
-				break;
+			sqlite3_reset(_selectId);
 		}
-		
 	}
 	catch (...)
 	{
 		exists = false;
 	}
 
+	_section.Unlock();
+
 	return exists;
 }
 
+// ***********************************************************
+//		get_TilesExist() 
+// ***********************************************************
+// A single range query per sub-provider instead of a query per tile.
+void SQLiteCache::get_TilesExist(BaseProvider* provider, int zoom, const vector<CPoint>& positions, vector<bool>& exists)
+{
+	exists.assign(positions.size(), false);
+
+	if (!provider || positions.empty() || !Initialize(SqliteOpenMode::OpenIfExists))
+		return;
+
+	CRect bounds(positions[0].x, positions[0].y, positions[0].x, positions[0].y);
+	for (size_t i = 1; i < positions.size(); i++)
+	{
+		bounds.left = min(bounds.left, positions[i].x);
+		bounds.right = max(bounds.right, positions[i].x);
+		bounds.top = min(bounds.top, positions[i].y);
+		bounds.bottom = max(bounds.bottom, positions[i].y);
+	}
+
+	// the number of sub-providers which have each of the positions
+	std::map<std::pair<int, int>, size_t> counts;
+	size_t numProviders = provider->get_SubProviders()->size();
+
+	_section.Lock();
+
+	try
+	{
+		for (size_t i = 0; i < numProviders && _conn; i++)
+		{
+			int providerId = (*provider->get_SubProviders())[i]->Id;
+
+			sqlite3_bind_int(_selectRange, 1, providerId);
+			sqlite3_bind_int(_selectRange, 2, zoom);
+			sqlite3_bind_int(_selectRange, 3, bounds.left);
+			sqlite3_bind_int(_selectRange, 4, bounds.right);
+			sqlite3_bind_int(_selectRange, 5, bounds.top);
+			sqlite3_bind_int(_selectRange, 6, bounds.bottom);
+
+			// the same tile may be stored more than once
+			std::set<std::pair<int, int>> found;
+			while (sqlite3_step(_selectRange) == SQLITE_ROW)
+			{
+				found.insert(std::make_pair(sqlite3_column_int(_selectRange, 0), sqlite3_column_int(_selectRange, 1)));
+			}
+			sqlite3_reset(_selectRange);
+
+			for (auto it = found.begin(); it != found.end(); ++it)
+			{
+				counts[*it]++;
+			}
+		}
+	}
+	catch (...)
+	{
+		CallbackHelper::ErrorMsg("SQLiteCache: exception on checking tiles.");
+	}
+
+	_section.Unlock();
+
+	for (size_t i = 0; i < positions.size(); i++)
+	{
+		auto it = counts.find(std::make_pair(positions[i].x, positions[i].y));
+		exists[i] = (numProviders > 0 && it != counts.end() && it->second == numProviders) ||
+					IsQueued(provider->Id, zoom, positions[i].x, positions[i].y);
+	}
+}
+
 
 // ***********************************************************
 //		getTile() 
@@ -369,62 +600,60 @@ TileCore* SQLiteCache::get_Tile(BaseProvider* provider, int scale, int x, int y)
 {
 	TileCore* tile = NULL;
 	
-	if(!Initialize(SqliteOpenMode::OpenIfExists))
+	if(!provider || !Initialize(SqliteOpenMode::OpenIfExists))
 		return NULL;
 
-	_section.Lock();
+	// the tile was downloaded recently and isn't written yet
+	if (IsQueued(provider->Id, scale, x, y))
+	{
+		Flush();
+	}
 
-	const char   *tail;
-	sqlite3_stmt *stmt;
+	_section.Lock();
 
 	try
 	{
-		for(size_t i = 0; i < provider->get_SubProviders()->size(); i++)
+		for(size_t i = 0; i < provider->get_SubProviders()->size() && _conn; i++)
 		{
 			int providerId = (*provider->get_SubProviders())[i]->Id;
 
-			CString sql;
-			sql.Format("SELECT id FROM Tiles WHERE X = %d AND Y = %d AND Zoom = %d AND Type = %d", x, y, scale, providerId);
-			if (sqlite3_prepare_v2(_conn, sql, sql.GetLength() + 1, &stmt, &tail) == SQLITE_OK)
+			sqlite3_bind_int(_selectId, 1, x);
+			sqlite3_bind_int(_selectId, 2, y);
+			sqlite3_bind_int(_selectId, 3, scale);
+			sqlite3_bind_int(_selectId, 4, providerId);
+
+			if (sqlite3_step(_selectId) == SQLITE_ROW)
 			{
-				if( sqlite3_step(stmt) == SQLITE_ROW) {
-					
-					const char   *tail2;
-					sqlite3_stmt *stmt2;
-					sqlite3_int64 id = sqlite3_column_int64(stmt, 0);
-					sql.Format("SELECT tile FROM TilesData WHERE Id = %d", id);
-					
-					if (sqlite3_prepare_v2(_conn, sql, sql.GetLength() + 1, &stmt2, &tail2) == SQLITE_OK)
+				sqlite3_int64 id = sqlite3_column_int64(_selectId, 0);
+				sqlite3_bind_int64(_selectData, 1, id);
+
+				if (sqlite3_step(_selectData) == SQLITE_ROW)
+				{
+					const void* data = sqlite3_column_blob(_selectData, 0);
+					int size = sqlite3_column_bytes(_selectData, 0);
+
+					if (size > 0)
 					{
-						if (sqlite3_step(stmt2) == SQLITE_ROW)
+						CMemoryBitmap* bmp = new CMemoryBitmap();
+						if (bmp->LoadFromRawData((const char*)data, size))
 						{
-							const void* data = sqlite3_column_blob(stmt2, 0);
-							int size = sqlite3_column_bytes(stmt2, 0);
-							
-							if (size > 0)
-							{
-								CMemoryBitmap* bmp = new CMemoryBitmap();
-								if (bmp->LoadFromRawData((const char*)data, size))
-								{
-									if (i == 0)
-										tile = new TileCore(providerId, scale, CPoint(x, y), provider->get_Projection());
-
-									if (tile)
-										tile->AddOverlay(bmp);
-									else
-										delete bmp;
-								}
-								else
-								{
-									delete bmp;
-								}
-							}
+							if (i == 0)
+								tile = new TileCore(providerId, scale, CPoint(x, y), provider->get_Projection());
+
+							if (tile)
+								tile->AddOverlay(bmp);
+							else
+								delete bmp;
+						}
+						else
+						{
+							delete bmp;
 						}
-						sqlite3_finalize(stmt2);
 					}
 				}
-				sqlite3_finalize(stmt);
+				sqlite3_reset(_selectData);
 			}
+			sqlite3_reset(_selectId);
 		}
 
 		// have we found all the overlays? If not - request from server ones more
@@ -455,6 +684,8 @@ void SQLiteCache::Clear(int providerId, int fromScale, int toScale)
 {
 	if(!Initialize(SqliteOpenMode::OpenIfExists))
 		return;
+
+	Flush();
 	
 	// there is no need to delete from tilesdata table as there is ON CASCADE DELETE rule specified in foreign key constraint
 	// updated: in fact there is a trigger which does the job
@@ -523,6 +754,8 @@ double SQLiteCache::get_SizeMB(int providerId, int scale)
 {
 	if(!Initialize(SqliteOpenMode::OpenIfExists))
 		return 0.0;
+
+	Flush();
 	
 	int size = 0;
 	double result = 0.0;
@@ -575,6 +808,8 @@ long SQLiteCache::get_TileCount(int provider, int zoom, CRect indices)
 		return 0;
 	}
 
+	Flush();
+
 	const char   *tail;
 	sqlite3_stmt *stmt;
 
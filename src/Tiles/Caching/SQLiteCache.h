@@ -21,17 +21,25 @@
 #include <afxmt.h>
 #include <queue>
 #include <list>
+#include <set>
 #include "sqlite3.h"
 #include "ITileCache.h"
 
 #define DB_NAME L"mwtiles.db3"
+#define SQLITE_CACHE_BATCH_SIZE 64			// number of tiles written in a single transaction
+#define SQLITE_CACHE_FLUSH_INTERVAL 1000	// ms; tiles don't wait in the queue longer than that if new tiles keep coming
 
 // Provides storage for map tiles in SQLite database
+// Tiles passed to AddTile are queued and written in batches, each batch in a single
+// transaction with the statements prepared once per connection. Queued tiles are
+// visible to get_TileExists; get_Tile writes the queue first if the tile is there.
 class SQLiteCache: public ITileCache
 {
 public:
 	SQLiteCache()
-		:_conn(NULL), _locked(false), _createNeeded(true), _openNeeded(true)
+		:_conn(NULL), _locked(false), _createNeeded(true), _openNeeded(true),
+		_insertTile(NULL), _insertData(NULL), _selectId(NULL), _selectData(NULL), _selectRange(NULL),
+		_queueStarted(0), _addedCount(0)
 	{
 		_maxSize = 100.0;
 	}
@@ -43,10 +51,28 @@ private:
 	bool _createNeeded;
 	bool _openNeeded;
 	bool _locked;		// coarse lock to block the adding tile to cache when extracting operations are made
+	
+	// prepared for the current connection
+	sqlite3_stmt* _insertTile;
+	sqlite3_stmt* _insertData;
+	sqlite3_stmt* _selectId;
+	sqlite3_stmt* _selectData;
+	sqlite3_stmt* _selectRange;
+
+	// write-behind queue
+	::CCriticalSection _queueSection;
+	vector<TileCore*> _queue;		// tiles waiting to be written
+	vector<TileCore*> _writing;		// tiles of the transaction in progress
+	DWORD _queueStarted;			// when the first tile of the queue was added
+	int _addedCount;
 
 private:
 	CStringW get_DefaultDbName();
 	bool CreateDatabase();
+	bool PrepareStatements();
+	void FinalizeStatements();
+	void WriteTile(TileCore* tile);
+	bool IsQueued(int providerId, int zoom, int x, int y);
 	void AutoClear();
 	bool get_TilesXY(int provider, int zoom, int xMin, int xMax, int yMin, int yMax, std::list<CPoint*>& list);
 	void ProcessQueue();
@@ -68,6 +94,8 @@ public:
 	void Lock() { _locked = true; }
 	void Unlock() { _locked = false; }
 	void InitBulkDownload(int zoom, vector<TilePoint*>& points) { Initialize(SqliteOpenMode::OpenIfExists); }
+	void Flush();
+	void get_TilesExist(BaseProvider* provider, int zoom, const vector<CPoint>& positions, vector<bool>& exists);
 
 public:
 	// properties:
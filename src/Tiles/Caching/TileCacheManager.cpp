@@ -69,9 +69,10 @@ void TileCacheManager::CloseAll()
         _ramCache->Close();
     }
 
-    if (_ramCache)
+    // writes the tiles which are still queued
+    if (_sqlLiteCache)
     {
-        _ramCache->Close();
+        _sqlLiteCache->Close();
     }
 
     if (_diskCache)
@@ -29,6 +29,13 @@ void CachingTask::DoTask()
 	if (!_cacher->isStopped())
 	{
 		_cacher->get_Cache()->AddTile(_tile);
+
+		// there is nothing more to write for now, so the cache shouldn't wait for a full batch
+		if (_cacher->IsQueueEmpty())
+		{
+			_cacher->get_Cache()->Flush();
+		}
+
 		_cacher->Run();
 	}
 
@@ -45,6 +52,17 @@ void TileCacher::Enqueue(TileCore* tile)
 	_queueLock.Unlock();
 }
 
+// ***********************************************************
+//		IsQueueEmpty()
+// ***********************************************************
+bool TileCacher::IsQueueEmpty()
+{
+	_queueLock.Lock();
+	bool empty = _queue.empty();
+	_queueLock.Unlock();
+	return empty;
+}
+
 // ***********************************************************
 //		Run()
 // ***********************************************************
@@ -68,6 +68,7 @@ public:
 public:
 	// methods
 	void Enqueue(TileCore* tile);
+	bool IsQueueEmpty();
 	void Run();
 	void Stop() { _stopped = true; }
 };
@@ -0,0 +1,110 @@
+/**************************************************************************************
+ * Project: MapWindow Open Source (MapWinGis ActiveX control) 
+ **************************************************************************************
+ * The contents of this file are subject to the Mozilla Public License Version 1.1
+ * (the "License"); you may not use this file except in compliance with 
+ * the License. You may obtain a copy of the License at http://www.mozilla.org/mpl/ 
+ * See the License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ************************************************************************************** 
+ * Contributor(s): 
+ * (Open source contributors should list themselves and their modifications here). */
+
+#include "StdAfx.h"
+#include "HttpConnectionPool.h"
+
+CCriticalSection HttpConnectionPool::_lock;
+std::map<CString, vector<CURL*>> HttpConnectionPool::_handles;
+
+// ************************************************************
+//		GetHost()
+// ************************************************************
+// Scheme, host and port: the part of url which identifies the connection.
+CString HttpConnectionPool::GetHost(const CString& url)
+{
+    int start = url.Find("://");
+    start = start == -1 ? 0 : start + 3;
+
+    const int end = url.Find('/', start);
+    return end == -1 ? url : url.Left(end);
+}
+
+// ************************************************************
+//		Acquire()
+// ************************************************************
+CURL* HttpConnectionPool::Acquire(const CString& host)
+{
+    _lock.Lock();
+
+    CURL* curl = nullptr;
+
+    auto it = _handles.find(host);
+    if (it != _handles.end() && !it->second.empty())
+    {
+        curl = it->second.back();
+        it->second.pop_back();
+    }
+
+    _lock.Unlock();
+
+    return curl ? curl : curl_easy_init();
+}
+
+// ************************************************************
+//		Release()
+// ************************************************************
+// The options are reset; live connections, DNS and TLS session caches are kept by the handle.
+void HttpConnectionPool::Release(const CString& host, CURL* curl)
+{
+    if (!curl) return;
+
+    curl_easy_reset(curl);
+
+    // two pools of loader may be busy with the same host
+    const size_t maxIdle = (size_t)m_globalSettings.GetTilesThreadPoolSize() * 2;
+
+    _lock.Lock();
+
+    vector<CURL*>& handles = _handles[host];
+    const bool keep = handles.size() < maxIdle;
+    if (keep)
+    {
+        handles.push_back(curl);
+    }
+
+    _lock.Unlock();
+
+    if (!keep)
+    {
+        curl_easy_cleanup(curl);
+    }
+}
+
+// ************************************************************
+//		Clear()
+// ************************************************************
+// Closes idle connections; must be called before curl_global_cleanup.
+void HttpConnectionPool::Clear()
+{
+    _lock.Lock();
+
+    for (auto it = _handles.begin(); it != _handles.end(); ++it)
+    {
+        for (size_t i = 0; i < it->second.size(); i++)
+        {
+            curl_easy_cleanup(it->second[i]);
+        }
+    }
+
+    _handles.clear();
+
+    _lock.Unlock();
+}
@@ -0,0 +1,42 @@
+/**************************************************************************************
+ * Project: MapWindow Open Source (MapWinGis ActiveX control) 
+ **************************************************************************************
+ * The contents of this file are subject to the Mozilla Public License Version 1.1
+ * (the "License"); you may not use this file except in compliance with 
+ * the License. You may obtain a copy of the License at http://www.mozilla.org/mpl/ 
+ * See the License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ************************************************************************************** 
+ * Contributor(s): 
+ * (Open source contributors should list themselves and their modifications here). */
+
+#pragma once
+#include <map>
+#include "curl.h"
+
+// ******************************************************
+//    HttpConnectionPool
+// ******************************************************
+// Keeps cURL handles between tile requests. The handle holds the connection, so the next 
+// tile from the same host is requested over it (keep-alive) without a new TCP and TLS handshake.
+// Handles are kept by host; each of them is used by a single thread at a time.
+class HttpConnectionPool
+{
+private:
+    static CCriticalSection _lock;
+    static std::map<CString, vector<CURL*>> _handles; // idle handles by host
+
+public:
+    static CString GetHost(const CString& url);
+    static CURL* Acquire(const CString& host);
+    static void Release(const CString& host, CURL* curl);
+    static void Clear();
+};
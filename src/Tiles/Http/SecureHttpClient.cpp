@@ -22,13 +22,30 @@
 #include "StdAfx.h"
 #include "SecureHttpClient.h"
 #include "HttpProxyHelper.h"
+#include "HttpConnectionPool.h"
 #include "TileCore.h"
 
-SecureHttpClient::SecureHttpClient(): file(nullptr)
+SecureHttpClient::SecureHttpClient(): file(nullptr), _cancel(nullptr), _result(CURLE_OK)
 {
     // create CURL handle
     curl = curl_easy_init();
 
+    Init();
+}
+
+SecureHttpClient::SecureHttpClient(const CString& url): file(nullptr), _cancel(nullptr), _result(CURLE_OK)
+{
+    _host = HttpConnectionPool::GetHost(url);
+    curl = HttpConnectionPool::Acquire(_host);
+
+    Init();
+}
+
+// ************************************************************
+//		Init()
+// ************************************************************
+void SecureHttpClient::Init()
+{
     // set up write buffer
     chunk.memory = (char *)malloc(1); /* will be grown as needed */
     chunk.size = 0; /* no data yet */
@@ -41,6 +58,10 @@ SecureHttpClient::SecureHttpClient(): file(nullptr)
 
     /* we pass our 'chunk' struct to the callback function */
     curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&chunk);
+
+    // the connection is reused because the handle is returned to HttpConnectionPool;
+    // keepalive probes only keep an idle pooled connection from being dropped by firewalls
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
 }
 
 size_t SecureHttpClient::WriteMemoryCallback(void* contents, size_t size, size_t nmemb, void* userp)
@@ -66,8 +87,40 @@ size_t SecureHttpClient::WriteMemoryCallback(void* contents, size_t size, size_t
 SecureHttpClient::~SecureHttpClient()
 {
     free(chunk.memory);
-    // CURL cleanup
-    curl_easy_cleanup(curl);
+
+    if (_host.IsEmpty())
+    {
+        // CURL cleanup
+        curl_easy_cleanup(curl);
+    }
+    else
+    {
+        HttpConnectionPool::Release(_host, curl);
+    }
+}
+
+// ************************************************************
+//		SetCancellation()
+// ************************************************************
+// The transfer is aborted as soon as the result is no longer needed.
+void SecureHttpClient::SetCancellation(ICancellation* cancel)
+{
+    _cancel = cancel;
+
+    if (!curl || !cancel) return;
+
+    curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, ProgressCallback);
+    curl_easy_setopt(curl, CURLOPT_XFERINFODATA, (void *)cancel);
+    curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+}
+
+// ************************************************************
+//		ProgressCallback()
+// ************************************************************
+int SecureHttpClient::ProgressCallback(void* clientp, curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow)
+{
+    // non-zero value aborts the transfer
+    return ((ICancellation*)clientp)->IsCancelled() ? 1 : 0;
 }
 
 // ************************************************************
@@ -235,8 +288,8 @@ bool SecureHttpClient::Navigate(LPCTSTR url) const
         curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, FALSE);
 
         // perform the operation
-        const CURLcode result = curl_easy_perform(curl);
-        return result == CURLcode::CURLE_OK;
+        _result = curl_easy_perform(curl);
+        return _result == CURLcode::CURLE_OK;
     }
     // something went wrong
     return false;
@@ -22,6 +22,7 @@
 #pragma once
 
 #include "curl.h"
+#include "Threading.h"
 
 struct MemoryStruct
 {
@@ -33,14 +34,21 @@ class SecureHttpClient
 {
 public:
 	SecureHttpClient();
+	// takes a handle from connection pool for the host of url
+	explicit SecureHttpClient(const CString& url);
 	~SecureHttpClient();
 
 private:
 	CURL *curl;
 	FILE *file;
+	CString _host;		// empty if the handle isn't pooled
+	ICancellation* _cancel;
+	mutable CURLcode _result;	// of the last Navigate
 	struct MemoryStruct chunk{};
 	char errorString[CURL_ERROR_SIZE]{};
+	void Init();
 	static size_t WriteMemoryCallback(void *contents, size_t size, size_t nmemb, void *userp);
+	static int ProgressCallback(void *clientp, curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow);
 
 public:
 	long GetStatus() const;
@@ -52,6 +60,9 @@ public:
 	int GetBodyLength() const;
 	BYTE *GetBody() const;
 	bool ReadBody(char** body, int& length) const;
+	void SetCancellation(ICancellation* cancel);
+	// the transfer was stopped by cancellation rather than completed or failed
+	bool IsAborted() const { return _result == CURLE_ABORTED_BY_CALLBACK; }
 public:
 	// methods
 	bool SetProxyAndAuthentication(const CString& userName, const CString& password, const CString& domain) const;
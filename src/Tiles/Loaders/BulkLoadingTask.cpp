@@ -7,7 +7,11 @@
 // *******************************************************
 void BulkLoadingTask::BeforeRequest()
 {
-	// do nothing; log request if needed
+	TileBulkLoader* loader = dynamic_cast<TileBulkLoader*>(_loader);
+	if (loader)
+	{
+		loader->WaitForBandwidth();
+	}
 }
 
 // *******************************************************
@@ -21,39 +21,58 @@ void ILoadingTask::DoTask()
 		tilesLogger.WriteLine("Outdated tile loading; cancelled: %d\\%d\\%d", _zoom, _x, _y);
 		return;
 	}
-	
-	long timeout = _loader->get_DelayRequestTimeout();
-	if (timeout > 0 && timeout < 10000)  {
-		Sleep(timeout);
+
+	// disk cache is probed here rather than in the UI thread
+	TileCore* tile = _probeCache ? FindInCache() : NULL;
+	bool fromServer = false;
+
+	if (tile)
+	{
+		AfterCacheHit(tile);
 	}
+	else if (_requestServer)
+	{
+		long timeout = _loader->get_DelayRequestTimeout();
+		if (timeout > 0 && timeout < 10000)  {
+			Sleep(timeout);
+		}
 
-	// let descendants register the request
-	BeforeRequest();
+		// let descendants register the request
+		BeforeRequest();
 
-	// HTTP call
-	TileCore* tile = _provider->GetTileImage(CPoint(_x, _y), _zoom);		
+		// HTTP call
+		tile = _provider->GetTileImage(CPoint(_x, _y), _zoom, this);
+		fromServer = true;
 
-	if (_loader->isStopped())
-	{
-		delete tile;	// requesting from a server takes time; probably the task was already aborted
-		tile = NULL;
+		if (_loader->isStopped())
+		{
+			delete tile;	// requesting from a server takes time; probably the task was already aborted
+			tile = NULL;
+		}
+		else
+		{
+			// let descendants do something useful with the tile
+			AfterRequest(tile);
+		}
 	}
-	else
+
+	// check generation to avoid firing the event several times when outdated tiles are loaded
+	TileRequestInfo* info = _loader->FindRequest(_generation);
+	if (info && fromServer)
 	{
-		// let descendants do something useful with the tile
-		AfterRequest(tile);
+		info->fromServer = true;
 	}
 
 	unsigned int count = _loader->RegisterTile(_generation);
 
-	// check generation to avoid firing the event several times when outdated tiles are loaded
-	TileRequestInfo* info = _loader->FindRequest(_generation);
 	if (info)
 	{
 		if (count == info->totalCount)
 		{
+			_loader->RequestCompleted(info);
+
 			TileManager* manager = (TileManager*)_provider->get_Manager();
-			manager->FireTilesLoaded(info->isSnapshot, info->key, false);			
+			manager->FireTilesLoaded(info->isSnapshot, info->key, !info->fromServer);
 		}
 	}
 
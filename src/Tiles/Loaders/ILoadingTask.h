@@ -7,12 +7,13 @@ class ITileLoader;
 // *******************************************************
 //		LoadingTask
 // *******************************************************
-// Represents a single loading task (a single tile to load)
-class ILoadingTask : ITask
+// Represents a single loading task (a single tile to load).
+// ITask must stay the first base: the pool casts the request back to ITask*.
+class ILoadingTask : ITask, public ICancellation
 {
 public:
 	ILoadingTask(int x, int y, int zoom, BaseProvider* provider, int generation)
-		: _x(x), _y(y), _zoom(zoom), _loader(NULL)
+		: _x(x), _y(y), _zoom(zoom), _loader(NULL), _probeCache(false), _requestServer(true)
 	{
 		_completed = false;
 		_generation = generation;
@@ -25,6 +26,8 @@ protected:
 	int _zoom;
 	int _generation;
 	bool _completed;
+	bool _probeCache;
+	bool _requestServer;
 	ITileLoader* _loader;
 	BaseProvider* _provider;
 
@@ -37,13 +40,22 @@ public:
 	void generation(int value) { _generation = value; }
 	int completed() { return _completed; }
 	void set_Loader(ITileLoader* loader) { _loader = loader; }
+	void set_ProbeCache(bool value) { _probeCache = value; }
+	void set_RequestServer(bool value) { _requestServer = value; }
 	BaseProvider* get_Provider() { return _provider; }
 	bool Compare(ILoadingTask* other);
 	void DoTask();
 
+	// the download is aborted once another set of tiles is requested and this one wasn't reassigned to it
+	bool IsCancelled() { return _loader->IsOutdated(_generation); }
+
 public:
 	virtual void BeforeRequest() = 0;
 	virtual void AfterRequest(TileCore* tile) = 0;
+
+	// the tile is looked into the cache before the request if the task was told so
+	virtual TileCore* FindInCache() { return NULL; }
+	virtual void AfterCacheHit(TileCore* tile) {}
 };
 
 
@@ -30,7 +30,7 @@ bool ITileLoader::InitPools()
 {
     _stopped = false;
 
-    const int size = m_globalSettings.GetTilesThreadPoolSize();
+    const int size = get_PoolSize();
 
     if (!_pool)
     {
@@ -61,7 +61,7 @@ CThreadPool<ThreadWorker>* ITileLoader::PreparePool()
 
     CThreadPool<ThreadWorker>* pool = _lastGeneration % 2 == 0 ? _pool : _pool2;
 
-    pool->SetSize(m_globalSettings.GetTilesThreadPoolSize());
+    pool->SetSize(get_PoolSize());
 
     pool->SetTimeout(100000); // 100 seconds (lower rate limit may be set)
 
@@ -92,17 +92,24 @@ unsigned int ITileLoader::RegisterTile(int generation)
 //		Load()
 // *******************************************************
 //	Creates tasks for tile points and enqueues them in thread pool
+//	Lower zoom levels go first, then the tiles closest to the center
 void ITileLoader::Load(std::vector<TilePoint*>& points, BaseProvider* provider, int zoom, TileRequestInfo* requestInfo)
 {
     CThreadPool<ThreadWorker>* pool = PreparePool();
     if (!pool) return;
 
-    sort(points.begin(), points.end(), [](TilePoint* p1, TilePoint* p2) { return p1->dist < p2->dist; });
+    sort(points.begin(), points.end(), [](TilePoint* p1, TilePoint* p2)
+    {
+        return p1->zoom != p2->zoom ? p1->zoom < p2->zoom : p1->dist < p2->dist;
+    });
 
     for (size_t i = 0; i < points.size(); i++)
     {
-        ILoadingTask* task = CreateTask(points[i]->x, points[i]->y, zoom, provider, _lastGeneration);
+        const int pointZoom = points[i]->zoom == -1 ? zoom : points[i]->zoom;
+        ILoadingTask* task = CreateTask(points[i]->x, points[i]->y, pointZoom, provider, _lastGeneration);
         task->set_Loader(this);
+        task->set_ProbeCache(points[i]->probeCache);
+        task->set_RequestServer(points[i]->requestServer);
         _tasks.push_back(task);
         pool->QueueRequest((ThreadWorker::RequestType)task);
     }
@@ -26,7 +26,6 @@
 #include "ITileCache.h"
 #include "ILoadingTask.h"
 
-#define THREADPOOL_SIZE	5
 class ITileLoader;
 class ILoadingTask;
 
@@ -86,6 +85,7 @@ public:
     virtual bool IsOutdated(int generation) { return _stopped; }
     bool isStopped() { return _stopped; }
     int get_LastGeneration() { return _lastGeneration; }
+    virtual int get_PoolSize() { return m_globalSettings.GetTilesThreadPoolSize(); }
     TileRequestInfo* CreateNextRequest(const CString& key, bool isSnapshot);
     long get_DelayRequestTimeout() { return _delayRequestTimeout; }
     void set_DelayRequestTimeout(long value) { _delayRequestTimeout = value; }
@@ -93,6 +93,7 @@ public:
 public:
     //methods
     virtual ILoadingTask* CreateTask(int x, int y, int zoom, BaseProvider* provider, int generation) = 0;
+    virtual void RequestCompleted(TileRequestInfo* info) { }
     virtual void Stop();
     TileRequestInfo* FindRequest(int generation);
     void Load(vector<TilePoint*>& points, BaseProvider* provider, int zoom, TileRequestInfo* info);
@@ -22,9 +22,14 @@ void MapLoadingTask::AfterRequest(TileCore* tile)
 	TileMapLoader* loader = dynamic_cast<TileMapLoader*>(_loader);
 	if (!loader) return;
 
-	if (loader->isStopped() || tile->IsEmpty())
+	// aborted downloads leave the tile without some of the layers; such tiles are neither cached
+	// nor displayed, so that they are requested once more next time; the tiles which were
+	// downloaded completely are cached below even if they are outdated by now
+	if (loader->isStopped() || tile->IsEmpty() || tile->hasErrors())
 	{
+		tilesLogger.WriteLine("Tile dropped; aborted or with errors: %d\\%d\\%d", _zoom, _x, _y);
 		loader->RemoveActiveTask(this);
+		delete tile;
 		return;
 	}
 	
@@ -53,3 +58,35 @@ void MapLoadingTask::AfterRequest(TileCore* tile)
 	//and try to cache it
 	loader->RunCaching();		// if there is no pending tasks, the caching will be started		
 }
+
+// *******************************************************
+//		FindInCache()
+// *******************************************************
+TileCore* MapLoadingTask::FindInCache()
+{
+	TileManager* manager = (TileManager*)_provider->get_Manager();
+	return manager->GetCachedTile(Disk, _provider, _zoom, _x, _y);
+}
+
+// *******************************************************
+//		AfterCacheHit()
+// *******************************************************
+void MapLoadingTask::AfterCacheHit(TileCore* tile)
+{
+	tile->AddRef();
+
+	if (!_loader->isStopped())
+	{
+		TileManager* manager = (TileManager*)_provider->get_Manager();
+		manager->AddTileToRamCache(tile);
+
+		// there is no need to cache it once more
+		if (_generation >= _loader->get_LastGeneration())
+		{
+			manager->AddTileNoCaching(tile);
+			manager->TriggerMapRedraw();
+		}
+	}
+
+	tile->Release();
+}
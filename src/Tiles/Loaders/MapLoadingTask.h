@@ -20,6 +20,8 @@ public:
 public:
 	void BeforeRequest();
 	void AfterRequest(TileCore* tile);
+	TileCore* FindInCache();
+	void AfterCacheHit(TileCore* tile);
 };
 
 
@@ -41,12 +41,19 @@ void TileBulkLoader::TileLoaded(TileCore* tile, int generation)
 		_errorCount++;
 	}
 
+	if (!tile->IsEmpty())
+	{
+		InterlockedExchangeAdd64(&_bytesLoaded, tile->get_ByteSize());
+	}
+
 	if (_callback != NULL)
 	{
 		TileRequestInfo* info = FindRequest(generation);
 		if (info)
 		{
-			CallbackHelper::Progress(_callback, info->count >= info->totalCount ? -1 : info->count, "Caching...");
+			CString msg;
+			msg.Format("Caching... %.0f KB/s", get_BytesPerSecond() / 1024.0);
+			CallbackHelper::Progress(_callback, info->count >= info->totalCount ? -1 : info->count, msg);
 		}
 	}
 
@@ -64,6 +71,57 @@ void TileBulkLoader::TileLoaded(TileCore* tile, int generation)
 
 	if (!tile->IsEmpty())
 	{
+		// the cache releases it when the tile is written, the same as for tiles scheduled by TileMapLoader
+		tile->AddRef();
 		_cache->AddTile(tile);
 	}
-}
\ No newline at end of file
+}
+
+// *******************************************************
+//		StartDownload()
+// *******************************************************
+void TileBulkLoader::StartDownload()
+{
+	InterlockedExchange64(&_bytesLoaded, 0);
+	_startTime = GetTickCount64();
+}
+
+// *******************************************************
+//		get_BytesPerSecond()
+// *******************************************************
+// Average throughput since the start of download.
+double TileBulkLoader::get_BytesPerSecond()
+{
+	const ULONGLONG elapsed = GetTickCount64() - _startTime;
+	return elapsed > 0 ? get_BytesLoaded() * 1000.0 / elapsed : 0.0;
+}
+
+// *******************************************************
+//		WaitForBandwidth()
+// *******************************************************
+// Delays the next request while the average rate since the start of download exceeds the budget.
+void TileBulkLoader::WaitForBandwidth()
+{
+	if (_maxBytesPerSecond <= 0) return;
+
+	while (!_stopped)
+	{
+		const ULONGLONG elapsed = GetTickCount64() - _startTime;
+		const ULONGLONG due = (ULONGLONG)(get_BytesLoaded() * 1000 / _maxBytesPerSecond);
+		if (due <= elapsed)
+		{
+			break;
+		}
+
+		Sleep((DWORD)MIN(due - elapsed, 200));	// checking for stop from time to time
+	}
+}
+
+// *******************************************************
+//		get_PoolSize()
+// *******************************************************
+int TileBulkLoader::get_PoolSize()
+{
+	const int size = ITileLoader::get_PoolSize();
+	return _maxConcurrency > 0 && _maxConcurrency < size ? _maxConcurrency : size;
+}
@@ -34,6 +34,10 @@ public:
     {
         _errorCount = 0;
         _sumCount = 0;
+        _maxBytesPerSecond = 0;
+        _maxConcurrency = 0;
+        _bytesLoaded = 0;
+        _startTime = 0;
     }
 
     virtual ~TileBulkLoader()
@@ -46,9 +50,14 @@ private:
     IStopExecution* _stopCallback; // to stop execution by clients via COM interface
     int _errorCount;
     int _sumCount; // sums all requests even if generation doesn't match
+    long _maxBytesPerSecond; // 0 for no limit
+    int _maxConcurrency; // 0 for the size of pool from global settings
+    volatile LONGLONG _bytesLoaded; // since the start of download; written by the pool threads
+    ULONGLONG _startTime;
 
 private:
     void CleanTasks();
+    LONGLONG get_BytesLoaded() { return InterlockedCompareExchange64(&_bytesLoaded, 0, 0); }
 
 public:
     // properties
@@ -57,10 +66,17 @@ public:
     int get_ErrorCount() { return _errorCount; }
     int get_SumCount() { return _sumCount; }
     ITileCache* get_Cache() { return _cache; }
+    void set_MaxBytesPerSecond(long value) { _maxBytesPerSecond = value; }
+    void set_MaxConcurrency(int value) { _maxConcurrency = value; }
+    int get_PoolSize();
+    double get_BytesPerSecond();
 
 public:
     //methods
     void TileLoaded(TileCore* tile, int generation);
+    void StartDownload();
+    void WaitForBandwidth();
+    void RequestCompleted(TileRequestInfo* info) { _cache->Flush(); }
 
     void ResetErrorCount()
     {
@@ -27,19 +27,18 @@
 CString BaseProvider::_proxyUsername = "";
 CString BaseProvider::_proxyPassword = "";
 CString BaseProvider::_proxyDomain = "";
-CCriticalSection BaseProvider::_clientLock;
 const CString filePrefix = "file:///";
 
 // ************************************************************
 //		GetTileImage()
 // ************************************************************
-TileCore* BaseProvider::GetTileImage(CPoint& pos, const int zoom)
+TileCore* BaseProvider::GetTileImage(CPoint& pos, const int zoom, ICancellation* cancel)
 {
     auto* tile = new TileCore(this->Id, zoom, pos, this->_projection);
 
     for (size_t i = 0; i < _subProviders.size(); i++)
     {
-        CMemoryBitmap* bmp = _subProviders[i]->DownloadBitmap(pos, zoom);
+        CMemoryBitmap* bmp = _subProviders[i]->DownloadBitmap(pos, zoom, cancel);
         if (bmp)
         {
             tile->AddOverlay(bmp);
@@ -56,25 +55,22 @@ TileCore* BaseProvider::GetTileImage(CPoint& pos, const int zoom)
 // ************************************************************
 //		GetTileHttpData()
 // ************************************************************
-CMemoryBitmap* BaseProvider::GetTileHttpData(CString url, CString shortUrl, bool recursive)
+CMemoryBitmap* BaseProvider::GetTileHttpData(CString url, CString shortUrl, ICancellation* cancel, bool recursive)
 {
-    // single-file access to the tile load
     // MWGIS-207; allow multiple thread access
-    //CSingleLock lock(&_clientLock, TRUE);
-
-    // stack-based instance
-    SecureHttpClient client;
+    // the handle is taken from the pool, so the connection to the server is reused
+    SecureHttpClient client(url);
 
     client.SetProxyAndAuthentication(_proxyUsername, _proxyPassword, _proxyDomain);
-
-    // jf: Likewise, don't think we need this work-around.
-    // if we observe multiple retransmissions, we can reconsider.
-    //PreventParallelExecution();
+    client.SetCancellation(cancel);
 
     const bool success = client.Navigate(url);
     if (!success)
     {
-        client.LogHttpError();
+        if (!client.IsAborted())
+        {
+            client.LogHttpError();
+        }
         return nullptr;
     }
 
@@ -86,7 +82,7 @@ CMemoryBitmap* BaseProvider::GetTileHttpData(CString url, CString shortUrl, bool
         // it's a socket error, so let's try one more time
         Sleep(20);
         tilesLogger.Log("Reloading attempt: " + m_globalSettings.useShortUrlForTiles ? shortUrl : url);
-        bmp = GetTileHttpData(url, shortUrl, true);
+        bmp = GetTileHttpData(url, shortUrl, cancel, true);
     }
 
     return bmp;
@@ -123,7 +119,7 @@ CMemoryBitmap* BaseProvider::GetTileFileData(CString url)
 // ************************************************************
 //		DownloadBitmap()
 // ************************************************************
-CMemoryBitmap* BaseProvider::DownloadBitmap(CPoint& pos, int zoom)
+CMemoryBitmap* BaseProvider::DownloadBitmap(CPoint& pos, int zoom, ICancellation* cancel)
 {
     const CString url = MakeTileImageUrl(pos, zoom);
     CString shortUrl;
@@ -133,7 +129,7 @@ CMemoryBitmap* BaseProvider::DownloadBitmap(CPoint& pos, int zoom)
 	if (url.Find(filePrefix) == 0)
 		return GetTileFileData(url);
 	else
-		return GetTileHttpData(url, shortUrl);
+		return GetTileHttpData(url, shortUrl, cancel);
 }
 
 // ************************************************************
@@ -205,20 +201,6 @@ void BaseProvider::ParseServerException(const CString& s) const
     }
 }
 
-// ************************************************************
-//		PreventParallelExecution()
-// ************************************************************
-void BaseProvider::PreventParallelExecution()
-{
-    CSingleLock lock(&_clientLock, TRUE);
-
-    // there is info that ARP might have problems with simultaneous connections, 
-    // discarding the next connection if the previous one is under resolution; 
-    // since we experience periodic rertransmissions let's introduce
-    // a small delay between connections http://stackoverflow.com/questions/1875151/delay-in-multiple-tcp-connections-from-java-to-the-same-machine
-    Sleep(5);
-}
-
 // *************************************************************
 //			ReadBitmap()
 // *************************************************************
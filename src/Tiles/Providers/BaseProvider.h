@@ -23,6 +23,7 @@
 #pragma once
 #include "BaseProjection.h"
 #include "TileCore.h"
+#include "Threading.h"
 #include "afxmt.h"
 
 // ***************************************************************
@@ -52,7 +53,6 @@ private:
     void* _manager;
 
 protected:
-    static CCriticalSection _clientLock;
     static CString _proxyUsername;
     static CString _proxyPassword;
     static CString _proxyDomain;
@@ -76,12 +76,11 @@ public:
     CString LanguageStr;
 
 private:
-    CMemoryBitmap* GetTileHttpData(CString url, CString shortUrl, bool recursive = false);
+    CMemoryBitmap* GetTileHttpData(CString url, CString shortUrl, ICancellation* cancel, bool recursive = false);
 	CMemoryBitmap* GetTileFileData(CString url);
-    static void PreventParallelExecution();
     CMemoryBitmap* ProcessHttpRequest(void* secureHttpClient, const CString& url, const CString& shortUrl,
                                       bool success);
-    CMemoryBitmap* DownloadBitmap(CPoint& pos, int zoom);
+    CMemoryBitmap* DownloadBitmap(CPoint& pos, int zoom, ICancellation* cancel);
     void ParseServerException(const CString& s) const;
 
 protected:
@@ -111,5 +110,5 @@ public:
 
     void AddDynamicOverlay(BaseProvider* p);
     void ClearSubProviders();
-    TileCore* GetTileImage(CPoint& pos, int zoom);
+    TileCore* GetTileImage(CPoint& pos, int zoom, ICancellation* cancel = nullptr);
 };
@@ -27,6 +27,13 @@ public:
 	virtual void DoTask() = 0;
 };
 
+// Lets a lengthy operation find out whether its result is still needed
+class ICancellation
+{
+public:
+	virtual bool IsCancelled() = 0;
+};
+
 // A thread worker to run asyncronous task compatible with ATL CThreadPool  
 class ThreadWorker
 {
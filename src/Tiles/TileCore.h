@@ -34,7 +34,7 @@ extern Debug::Logger tilesLogger;
 struct TileRequestInfo
 {
     TileRequestInfo(CString key, bool isSnapshot)
-        : key(key), isSnapshot(isSnapshot), totalCount(10000), count(0), generation(-1)
+        : key(key), isSnapshot(isSnapshot), totalCount(10000), count(0), generation(-1), fromServer(false)
     {
     }
 
@@ -43,6 +43,7 @@ struct TileRequestInfo
     unsigned int totalCount;
     unsigned int count;
     int generation;
+    bool fromServer; // at least one of the tiles wasn't found in disk cache
 };
 
 // ******************************************************
@@ -53,12 +54,15 @@ class TilePoint : public CPoint
 {
 public:
     TilePoint(int x, int y)
-        : CPoint(x, y), dist(0.0)
+        : CPoint(x, y), dist(0.0), probeCache(false), requestServer(true), zoom(-1)
     {
     }
 
 public:
     double dist;
+    int zoom;           // -1 for the zoom of request; set when a request spans several zoom levels
+    bool probeCache;    // look into the disk cache before the request
+    bool requestServer; // false if only the cache is to be checked
 
 public:
     static void ReleaseMemory(vector<TilePoint*>& points)
@@ -91,16 +91,24 @@ void TileManager::LoadTiles(BaseProvider* provider, bool isSnapshot, const CStri
 
     if (!cacheOnly)
     {
+        // the tasks which are still needed are moved to the next generation before it's started,
+        // otherwise their downloads could be aborted as outdated in between; the lock keeps
+        // new tasks from becoming active until the generation is changed
+        _loader.LockActiveTasks(true);
+
+        GetActiveTasks(activeTasks, provider->Id, zoom, _loader.get_LastGeneration() + 1, indices);
+
         // all incoming tasks will be discarded
         requestInfo = _loader.CreateNextRequest(key, isSnapshot);
 
-        GetActiveTasks(activeTasks, provider->Id, zoom, requestInfo->generation, indices);
+        _loader.LockActiveTasks(false);
     }
 
     // loads tiles available in the cache to the buffer
     // builds list of tiles to be loaded from server
+    // snapshots need the tiles right away, so the disk cache is checked here for them
     std::vector<TilePoint*> points;
-    BuildLoadingList(provider, indices, zoom, activeTasks, points);
+    BuildLoadingList(provider, indices, zoom, activeTasks, points, !isSnapshot);
 
     // it will be considered completed when this amount of tiles is loaded
     if (!cacheOnly)
@@ -119,7 +127,7 @@ void TileManager::LoadTiles(BaseProvider* provider, bool isSnapshot, const CStri
 
     if (points.size() > 0)
     {
-        tilesLogger.WriteLine("Queued to load from server: %d", points.size());
+        tilesLogger.WriteLine("Queued to load from disk cache or server: %d", points.size());
 
         // zoom can change in the process, so we use the calculated version and not the one current for provider
         _loader.Load(points, provider, zoom, requestInfo);
@@ -174,27 +182,27 @@ bool TileManager::GetTileIndices(BaseProvider* provider, CRect& indices, int& zo
 // *********************************************************
 //	     BuildLoadingList()
 // *********************************************************
+// With probeDiskAsync the disk cache is looked into by the tasks of loader, so this thread 
+// only checks the buffer and RAM cache; the tiles found on the disk are drawn as they come.
 void TileManager::BuildLoadingList(BaseProvider* provider, CRect indices, int zoom, vector<TilePoint*>& activeTasks,
-                                   vector<TilePoint*>& points)
+                                   vector<TilePoint*>& points, bool probeDiskAsync)
 {
     const CPoint center = indices.CenterPoint();
 
+    std::unordered_set<__int64> reassigned;
+    for (size_t i = 0; i < activeTasks.size(); i++)
+    {
+        reassigned.insert(((__int64)activeTasks[i]->x << 32) | (unsigned int)activeTasks[i]->y);
+    }
+
+    const bool probeDisk = probeDiskAsync && _diskCache.useCache;
+
     for (int x = indices.left; x <= indices.right; x++)
     {
         for (int y = indices.bottom; y <= indices.top; y++)
         {
             // was it already reassigned?
-            bool found = false;
-            for (size_t i = 0; i < activeTasks.size(); i++)
-            {
-                if (activeTasks[i]->x == x && activeTasks[i]->y == y)
-                {
-                    found = true;
-                    break;
-                }
-            }
-
-            if (found)
+            if (reassigned.find(((__int64)x << 32) | (unsigned int)y) != reassigned.end())
             {
                 continue;
             }
@@ -202,57 +210,68 @@ void TileManager::BuildLoadingList(BaseProvider* provider, CRect indices, int zo
             // check maybe the tile is already in the buffer
             _tilesBufferLock.Lock();
 
-            for (size_t i = 0; i < _tiles.size(); i++)
+            TileCore* tile = FindInBuffer(provider->Id, zoom, x, y);
+            if (tile)
             {
-                TileCore* tile = _tiles[i];
-                if (tile->tileX() == x && tile->tileY() == y && tile->zoom() == zoom && tile->get_ProviderId() ==
-                    provider->Id)
-                {
-                    tile->toDelete(false);
-                    tile->inBuffer(true);
-                    found = true;
-                    break;
-                }
+                tile->toDelete(false);
+                tile->inBuffer(true);
             }
 
             _tilesBufferLock.Unlock();
 
-            if (found)
+            if (tile)
             {
                 continue;
             }
 
-            // seeking through available caches
-            for (size_t i = 0; i < _caches.size(); i++)
+            // seeking through available caches; a tile with errors is requested once more
+            tile = GetCachedTile(RAM, provider, zoom, x, y);
+            if (tile && tile->hasErrors())
             {
-                if (_caches[i]->useCache)
-                {
-                    TileCore* tile = _caches[i]->cache->get_Tile(provider, zoom, x, y);
-                    if (tile)
-                    {
-                        AddTileNoCaching(tile);
-                        found = true;
-                        break;
-                    }
-                }
+                // the cache marked it as displayed; it must stay evictable
+                tile->inBuffer(false);
+                tile = nullptr;
+            }
+
+            if (!tile && !probeDiskAsync)
+            {
+                tile = GetCachedTile(Disk, provider, zoom, x, y);
             }
 
-            if (found)
+            if (tile)
             {
+                AddTileNoCaching(tile);
                 continue;
             }
 
             // if the tile isn't present in both caches, request it from the server
-            if (_useServer)
+            if (_useServer || probeDisk)
             {
                 auto* pnt = new TilePoint(x, y);
                 pnt->dist = sqrt(pow(pnt->x - center.x, 2.0) + pow(pnt->y - center.y, 2.0));
+                pnt->probeCache = probeDisk;
+                pnt->requestServer = _useServer;
                 points.push_back(pnt);
             }
         }
     }
 }
 
+// *********************************************************
+//	     GetCachedTile()
+// *********************************************************
+// Can be called from the threads of loader, both caches have their own locks.
+TileCore* TileManager::GetCachedTile(tkCacheType type, BaseProvider* provider, int zoom, int x, int y)
+{
+    TileCacheInfo* info = get_Cache(type);
+    if (!info->useCache)
+    {
+        return nullptr;
+    }
+
+    return info->cache->get_Tile(provider, zoom, x, y);
+}
+
 // *********************************************************
 //	     Clear()
 // *********************************************************
@@ -304,25 +323,55 @@ void TileManager::DeleteMarkedTilesFromBuffer()
 {
     _tilesBufferLock.Lock();
 
-    std::vector<TileCore*>::iterator it = _tiles.begin();
-
-    while (it < _tiles.end())
+    size_t count = 0;
+    for (size_t i = 0; i < _tiles.size(); i++)
     {
-        TileCore* tile = *it;
+        TileCore* tile = _tiles[i];
         if (tile->toDelete())
         {
             tile->Release();
-            it = _tiles.erase(it);
         }
         else
         {
-            ++it;
+            _tiles[count++] = tile;
         }
     }
 
+    _tiles.resize(count);
+
+    RebuildBufferIndex();
+
     _tilesBufferLock.Unlock();
 }
 
+// *********************************************************
+//	     RebuildBufferIndex()
+// *********************************************************
+// Must be called with the buffer locked.
+void TileManager::RebuildBufferIndex()
+{
+    _tilesIndex.clear();
+
+    for (size_t i = 0; i < _tiles.size(); i++)
+    {
+        TileCore* tile = _tiles[i];
+        RamCacheKey key = { tile->get_ProviderId(), tile->zoom(), tile->tileX(), tile->tileY() };
+        _tilesIndex.emplace(key, tile);
+    }
+}
+
+// *********************************************************
+//	     FindInBuffer()
+// *********************************************************
+// Must be called with the buffer locked.
+TileCore* TileManager::FindInBuffer(int providerId, int zoom, int x, int y)
+{
+    RamCacheKey key = { providerId, zoom, x, y };
+
+    auto it = _tilesIndex.find(key);
+    return it != _tilesIndex.end() ? it->second : nullptr;
+}
+
 // *********************************************************
 //	     ClearBuffer()
 // *********************************************************
@@ -421,8 +470,11 @@ void TileManager::AddTileNoCaching(TileCore* tile)
     tile->toDelete(false);
     tile->AddRef();
 
+    RamCacheKey key = { tile->get_ProviderId(), tile->zoom(), tile->tileX(), tile->tileY() };
+
     _tilesBufferLock.Lock();
     _tiles.push_back(tile);
+    _tilesIndex.emplace(key, tile); // the first one is kept if the tile is already there
     _tilesBufferLock.Unlock();
 }
 
@@ -455,18 +507,7 @@ bool TileManager::TileIsInBuffer(int providerId, int zoom, int x, int y)
 {
     CSingleLock lock(&_tilesBufferLock, TRUE);
 
-    for (size_t i = 0; i < _tiles.size(); i++)
-    {
-        if (_tiles[i]->tileX() == x &&
-            _tiles[i]->tileY() == y &&
-            _tiles[i]->zoom() == zoom &&
-            _tiles[i]->get_ProviderId() == providerId)
-        {
-            return true;
-        }
-    }
-
-    return false;
+    return FindInBuffer(providerId, zoom, x, y) != nullptr;
 }
 
 // ************************************************************
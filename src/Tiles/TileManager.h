@@ -22,6 +22,8 @@
 #pragma once
 #include "ITileCache.h"
 #include "TileMapLoader.h"
+#include "RamCache.h"
+#include <unordered_set>
 
 class TileManager
 {
@@ -61,6 +63,7 @@ private:
     // can be wrapped in a separate class
     CCriticalSection _tilesBufferLock;
     vector<TileCore*> _tiles;
+    std::unordered_map<RamCacheKey, TileCore*, RamCacheKeyHasher> _tilesIndex; // the first tile in buffer for each key
 
     Extent _projExtents; // extents of the world under current projection; in WGS84 it'll be (-180, 180, -90, 90)
     bool _projExtentsNeedUpdate; // do we need to update bounds in m_projExtents on the next request?
@@ -86,7 +89,7 @@ private:
     void InitCaches();
     void UpdateScreenBuffer();
     void BuildLoadingList(BaseProvider* provider, CRect indices, int zoom, vector<TilePoint*>& activeTasks,
-                          vector<TilePoint*>& points);
+                          vector<TilePoint*>& points, bool probeDiskAsync);
     void GetActiveTasks(std::vector<TilePoint*>& activeTasks, int providerId, int zoom, int newGeneration,
                         CRect indices);
     bool IsNewRequest(Extent& mapExtents, CRect indices, int providerId, int zoom);
@@ -94,6 +97,8 @@ private:
     void InitializeDiskCache();
     void UnlockDiskCache();
     bool GetTileIndices(BaseProvider* provider, CRect& indices, int& zoom, bool isSnapshot);
+    TileCore* FindInBuffer(int providerId, int zoom, int x, int y);
+    void RebuildBufferIndex();
 
 public:
     // properties
@@ -101,6 +106,7 @@ public:
     void set_MapCallback(IMapViewCallback* map);
     IMapViewCallback* get_MapCallback() { return _map; }
     bool TileIsInBuffer(int providerId, int zoom, int x, int y);
+    TileCore* GetCachedTile(tkCacheType type, BaseProvider* provider, int zoom, int x, int y);
     bool useServer() { return _useServer; }
     void useServer(bool value) { _useServer = value; }
     double scalingRatio() { return _scalingRatio; }
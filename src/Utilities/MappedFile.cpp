@@ -0,0 +1,89 @@
+#include "stdafx.h"
+#include "MappedFile.h"
+
+// ****************************************************************
+//		Open()
+// ****************************************************************
+bool CMappedFile::Open(CStringW filename)
+{
+	Close();
+
+	// write sharing is needed as the file may already be opened by CShapefile or dbfopen
+	_file = CreateFileW(filename, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+						OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, NULL);
+
+	if (_file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(_file, &size) || size.QuadPart == 0)
+	{
+		// empty files can't be mapped
+		Close();
+		return false;
+	}
+
+	// the whole file must fit into the address space of the process (matters for 32-bit build)
+	if ((unsigned __int64)size.QuadPart > (SIZE_T)-1)
+	{
+		Close();
+		return false;
+	}
+
+	_mapping = CreateFileMappingW(_file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (!_mapping)
+	{
+		Close();
+		return false;
+	}
+
+	_data = (char*)MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!_data)
+	{
+		Close();
+		return false;
+	}
+
+	_size = size.QuadPart;
+	return true;
+}
+
+// ****************************************************************
+//		Close()
+// ****************************************************************
+void CMappedFile::Close()
+{
+	if (_data)
+	{
+		UnmapViewOfFile(_data);
+		_data = NULL;
+	}
+
+	if (_mapping)
+	{
+		CloseHandle(_mapping);
+		_mapping = NULL;
+	}
+
+	if (_file != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(_file);
+		_file = INVALID_HANDLE_VALUE;
+	}
+
+	_size = 0;
+}
+
+// ****************************************************************
+//		GetRange()
+// ****************************************************************
+// Returns pointer to the requested bytes or NULL if they are outside of the file
+char* CMappedFile::GetRange(__int64 offset, __int64 length)
+{
+	if (!_data || offset < 0 || length < 0 || offset + length > _size) {
+		return NULL;
+	}
+
+	return _data + offset;
+}
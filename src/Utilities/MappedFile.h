@@ -0,0 +1,37 @@
+#pragma once
+
+// ---------------------------------------------------------
+//   Read-only memory mapping of the whole file
+// ---------------------------------------------------------
+// The view stays valid until Close() is called, so pointers handed
+// out by GetRange() must not outlive the instance.
+class CMappedFile
+{
+public:
+	CMappedFile()
+	{
+		_file = INVALID_HANDLE_VALUE;
+		_mapping = NULL;
+		_data = NULL;
+		_size = 0;
+	}
+
+	~CMappedFile()
+	{
+		Close();
+	}
+
+private:
+	HANDLE _file;
+	HANDLE _mapping;
+	char* _data;
+	__int64 _size;
+
+public:
+	bool Open(CStringW filename);
+	void Close();
+	bool IsOpen() { return _data != NULL; }
+	__int64 get_Size() { return _size; }
+	char* get_Data() { return _data; }
+	char* GetRange(__int64 offset, __int64 length);
+};
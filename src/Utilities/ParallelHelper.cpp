@@ -0,0 +1,82 @@
+#include "stdafx.h"
+#include "ParallelHelper.h"
+
+// *******************************************************
+//		GetNumThreads()
+// *******************************************************
+// Zero or negative value means as many threads as there are processors.
+int ParallelHelper::GetNumThreads(int requested)
+{
+	static int numProcessors = 0;
+	if (numProcessors == 0)
+	{
+		SYSTEM_INFO info;
+		GetSystemInfo(&info);
+		numProcessors = max(1, (int)info.dwNumberOfProcessors);
+	}
+
+	if (requested <= 0)
+		return numProcessors;
+
+	// there is no point in having more threads than processors for CPU bound work
+	return min(requested, numProcessors);
+}
+
+static CThreadPool<ThreadWorker>* _pool = nullptr;
+static ::CCriticalSection _poolLock;
+static thread_local int _forDepth = 0;
+
+// *******************************************************
+//		GetPool()
+// *******************************************************
+CThreadPool<ThreadWorker>* ParallelHelper::GetPool()
+{
+	CSingleLock lock(&_poolLock, TRUE);
+
+	if (!_pool)
+	{
+		auto* pool = new CThreadPool<ThreadWorker>();
+		if (FAILED(pool->Initialize(nullptr, GetNumThreads(0))))
+		{
+			delete pool;
+			return nullptr;
+		}
+		_pool = pool;
+	}
+
+	return _pool;
+}
+
+// *******************************************************
+//		ShutdownPool()
+// *******************************************************
+// Called on DLL termination.
+void ParallelHelper::ShutdownPool()
+{
+	CSingleLock lock(&_poolLock, TRUE);
+
+	if (_pool)
+	{
+		_pool->Shutdown();
+		delete _pool;
+		_pool = nullptr;
+	}
+}
+
+// *******************************************************
+//		IsInsideFor()
+// *******************************************************
+bool ParallelHelper::IsInsideFor()
+{
+	return _forDepth > 0;
+}
+
+ParallelHelper::ForScope::ForScope()
+{
+	_forDepth++;
+}
+
+ParallelHelper::ForScope::~ForScope()
+{
+	_forDepth--;
+}
@@ -0,0 +1,125 @@
+#pragma once
+#include <atlutil.h>
+#include "Threading.h"
+
+// ---------------------------------------------------------
+//   Splits a range of indices between the threads of a pool
+// ---------------------------------------------------------
+// Work items must not touch COM objects or anything else with
+// thread affinity; it's meant for computations over plain arrays.
+namespace ParallelHelper
+{
+	int GetNumThreads(int requested);
+
+	// The pool is shared by all the calls and created on the first use; NULL if it can't be started.
+	CThreadPool<ThreadWorker>* GetPool();
+	void ShutdownPool();
+
+	// Marks the thread as running a part of range, so that the nested calls don't wait for the pool.
+	bool IsInsideFor();
+	class ForScope
+	{
+	public:
+		ForScope();
+		~ForScope();
+	};
+
+	// Chunks of the range taken one by one by the threads which run the loop.
+	template <typename Func>
+	class RangeLoop
+	{
+	public:
+		Func* func;
+		int count;
+		int chunkSize;
+		int numChunks;
+		volatile LONG nextChunk;
+
+		void Run()
+		{
+			ForScope scope;
+			for (;;)
+			{
+				int chunk = (int)InterlockedIncrement(&nextChunk) - 1;
+				if (chunk >= numChunks)
+					break;
+
+				(*func)(chunk * chunkSize, min(count, (chunk + 1) * chunkSize));
+			}
+		}
+	};
+
+	// Runs the loop on a thread of the pool and signals when the last task is done.
+	template <typename Func>
+	class RangeTask : public ITask
+	{
+	public:
+		RangeLoop<Func>* loop;
+		volatile LONG* remaining;
+		HANDLE done;
+
+		void DoTask()
+		{
+			loop->Run();
+			if (InterlockedDecrement(remaining) == 0)
+				SetEvent(done);
+		}
+	};
+
+	// *******************************************************
+	//		For()
+	// *******************************************************
+	// Calls func(begin, end) for consecutive chunks of [0, count), possibly from several
+	// threads at the same time, and returns when all of them are processed. The calling
+	// thread takes chunks as well. The range is processed in the calling thread when it's
+	// too small, the pool can't be started or the call is nested in another For.
+	template <typename Func>
+	void For(int count, int numThreads, Func& func, int minChunkSize = 256)
+	{
+		if (count <= 0)
+			return;
+
+		numThreads = GetNumThreads(numThreads);
+
+		// a few chunks per thread to even out the load
+		int numChunks = min(numThreads * 4, (count + minChunkSize - 1) / max(1, minChunkSize));
+
+		CThreadPool<ThreadWorker>* pool = numThreads <= 1 || numChunks <= 1 || IsInsideFor() ? nullptr : GetPool();
+		HANDLE done = pool ? CreateEvent(NULL, TRUE, FALSE, NULL) : NULL;
+		if (!done)
+		{
+			ForScope scope;
+			func(0, count);
+			return;
+		}
+
+		RangeLoop<Func> loop;
+		loop.func = &func;
+		loop.count = count;
+		loop.chunkSize = (count + numChunks - 1) / numChunks;
+		loop.numChunks = (count + loop.chunkSize - 1) / loop.chunkSize;
+		loop.nextChunk = 0;
+
+		// the calling thread is one of the threads
+		int numTasks = min(numThreads, loop.numChunks) - 1;
+		volatile LONG remaining = numTasks;
+		vector<RangeTask<Func>> tasks(numTasks);
+
+		for (int i = 0; i < numTasks; i++)
+		{
+			RangeTask<Func>& task = tasks[i];
+			task.loop = &loop;
+			task.remaining = &remaining;
+			task.done = done;
+			pool->QueueRequest((ThreadWorker::RequestType)(ITask*)&task);
+		}
+
+		loop.Run();
+
+		// tasks which started after the last chunk was taken finish at once
+		if (numTasks > 0)
+			WaitForSingleObject(done, INFINITE);
+
+		CloseHandle(done);
+	}
+}
@@ -0,0 +1,53 @@
+#include "stdafx.h"
+#include "PositionalFile.h"
+
+// ****************************************************************
+//		Open()
+// ****************************************************************
+bool CPositionalFile::Open(CStringW filename)
+{
+	Close();
+
+	// the file stays writable for the other handles (editing, append mode)
+	_file = CreateFileW(filename, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+						OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, NULL);
+
+	return _file != INVALID_HANDLE_VALUE;
+}
+
+// ****************************************************************
+//		Close()
+// ****************************************************************
+void CPositionalFile::Close()
+{
+	if (_file != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(_file);
+		_file = INVALID_HANDLE_VALUE;
+	}
+}
+
+// ****************************************************************
+//		Read()
+// ****************************************************************
+// Reads exactly length bytes starting from offset
+bool CPositionalFile::Read(__int64 offset, void* buffer, int length)
+{
+	if (_file == INVALID_HANDLE_VALUE || offset < 0 || length < 0) {
+		return false;
+	}
+
+	// for synchronous handle the offset in OVERLAPPED structure
+	// defines the position of this particular read
+	OVERLAPPED ov;
+	memset(&ov, 0, sizeof(OVERLAPPED));
+	ov.Offset = (DWORD)(offset & 0xFFFFFFFF);
+	ov.OffsetHigh = (DWORD)(offset >> 32);
+
+	DWORD count = 0;
+	if (!ReadFile(_file, buffer, (DWORD)length, &count, &ov)) {
+		return false;
+	}
+
+	return count == (DWORD)length;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+// ---------------------------------------------------------
+//   Read-only file with reading at explicit offsets
+// ---------------------------------------------------------
+// There is no shared file cursor, so Read() can be called
+// from several threads at the same time without locking.
+class CPositionalFile
+{
+public:
+	CPositionalFile()
+	{
+		_file = INVALID_HANDLE_VALUE;
+	}
+
+	~CPositionalFile()
+	{
+		Close();
+	}
+
+private:
+	HANDLE _file;
+
+public:
+	bool Open(CStringW filename);
+	void Close();
+	bool IsOpen() { return _file != INVALID_HANDLE_VALUE; }
+	bool Read(__int64 offset, void* buffer, int length);
+};
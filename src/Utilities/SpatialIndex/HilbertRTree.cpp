@@ -0,0 +1,208 @@
+#include "stdafx.h"
+#include "HilbertRTree.h"
+#include "Shapefile.h"
+
+#define HILBERT_RTREE_VERSION 1
+
+// ****************************************************************
+//		GetIndexFilename()
+// ****************************************************************
+CStringW CHilbertRTree::GetIndexFilename(CStringW shpFilename)
+{
+	return shpFilename.Left(shpFilename.GetLength() - 3) + L"mwr";
+}
+
+// ****************************************************************
+//		Create()
+// ****************************************************************
+// Builds the tree in a single pass over .shx, taking bounds from the headers of .shp records.
+bool CHilbertRTree::Create(CStringW shpFilename, int nodeSize)
+{
+	if (shpFilename.GetLength() <= 3)
+		return false;
+
+	CMappedFile shp, shx;
+	CStringW shxFilename = shpFilename.Left(shpFilename.GetLength() - 3) + L"shx";
+	if (!shp.Open(shpFilename) || !shx.Open(shxFilename))
+		return false;
+
+	if (shx.get_Size() < HEADER_BYTES_32)
+		return false;
+
+	int numShapes = (int)((shx.get_Size() - HEADER_BYTES_32) / 8);
+	char* shpData = shp.get_Data();
+	__int64 shpSize = shp.get_Size();
+
+	CPackedRTree tree(nodeSize);
+	tree.Reserve(numShapes);
+
+	int* records = (int*)(shx.get_Data() + HEADER_BYTES_32);
+	for (int i = 0; i < numShapes; i++)
+	{
+		int offset = records[i * 2];
+		ShapeUtility::SwapEndian((char*)&offset, sizeof(int));
+		__int64 position = (__int64)offset * 2 + RECORD_HEADER_LENGTH_32;
+
+		if (position < HEADER_BYTES_32 || position + sizeof(int) > shpSize)
+			continue;
+
+		int shapeType = *(int*)(shpData + position);
+		double box[4];
+
+		switch (shapeType)
+		{
+			case SHP_NULLSHAPE:
+				continue;
+			case SHP_POINT:
+			case SHP_POINTZ:
+			case SHP_POINTM:
+				if (position + sizeof(int) + 2 * sizeof(double) > shpSize)
+					continue;
+				memcpy(box, shpData + position + sizeof(int), 2 * sizeof(double));
+				box[2] = box[0];
+				box[3] = box[1];
+				break;
+			default:
+				// all the other types store xMin, yMin, xMax, yMax right after the shape type
+				if (position + sizeof(int) + 4 * sizeof(double) > shpSize)
+					continue;
+				memcpy(box, shpData + position + sizeof(int), 4 * sizeof(double));
+				break;
+		}
+
+		tree.AddItem(i, box[0], box[1], box[2], box[3]);
+	}
+
+	tree.Finish();
+	shp.Close();
+	shx.Close();
+
+	HilbertRTreeHeader header;
+	memset(&header, 0, sizeof(HilbertRTreeHeader));
+	memcpy(header.signature, "MWRT", 4);
+	header.version = HILBERT_RTREE_VERSION;
+	header.nodeSize = tree.get_NodeSize();
+	header.numItems = tree.get_NumItems();
+	header.numNodes = tree.get_NumNodes();
+	header.numLevels = tree.get_NumLevels();
+	header.numShapes = numShapes;
+	header.shpSize = shpSize;
+	memcpy(header.bounds, tree.get_Bounds(), sizeof(header.bounds));
+
+	if (header.numLevels > PACKED_RTREE_MAX_LEVELS)
+		return false;
+
+	memcpy(header.levelBounds, tree.get_LevelBounds(), header.numLevels * sizeof(int));
+
+	FILE* file = _wfopen(GetIndexFilename(shpFilename), L"wb");
+	if (!file)
+		return false;
+
+	bool result = fwrite(&header, sizeof(HilbertRTreeHeader), 1, file) == 1;
+	if (result && header.numNodes > 0)
+	{
+		result = fwrite(tree.get_Boxes(), sizeof(double) * 4, header.numNodes, file) == header.numNodes &&
+				 fwrite(tree.get_Indices(), sizeof(int), header.numNodes, file) == header.numNodes;
+	}
+	fclose(file);
+
+	if (!result)
+		_wremove(GetIndexFilename(shpFilename));
+
+	return result;
+}
+
+// ****************************************************************
+//		Open()
+// ****************************************************************
+bool CHilbertRTree::Open(CStringW shpFilename)
+{
+	Close();
+
+	if (!_file.Open(GetIndexFilename(shpFilename)))
+		return false;
+
+	if (_file.get_Size() < sizeof(HilbertRTreeHeader))
+	{
+		Close();
+		return false;
+	}
+
+	HilbertRTreeHeader* header = (HilbertRTreeHeader*)_file.get_Data();
+
+	bool valid = memcmp(header->signature, "MWRT", 4) == 0 &&
+				 header->version == HILBERT_RTREE_VERSION &&
+				 header->nodeSize >= 2 && header->nodeSize <= PACKED_RTREE_MAX_NODE_SIZE &&
+				 header->numLevels >= 0 && header->numLevels <= PACKED_RTREE_MAX_LEVELS &&
+				 header->numItems >= 0 && header->numNodes >= header->numItems &&
+				 (header->numItems == 0) == (header->numLevels == 0);
+
+	if (valid && header->numLevels > 0)
+	{
+		valid = header->levelBounds[0] == header->numItems &&
+				header->levelBounds[header->numLevels - 1] == header->numNodes;
+	}
+
+	__int64 expectedSize = sizeof(HilbertRTreeHeader) + (__int64)header->numNodes * (sizeof(double) * 4 + sizeof(int));
+	if (!valid || _file.get_Size() != expectedSize)
+	{
+		Close();
+		return false;
+	}
+
+	double* boxes = (double*)(_file.get_Data() + sizeof(HilbertRTreeHeader));
+	int* indices = (int*)(boxes + header->numNodes * 4);
+
+	// leaves are passed to callers as indices of shapes
+	for (int i = 0; i < header->numItems; i++)
+	{
+		if (indices[i] < 0 || indices[i] >= header->numShapes)
+		{
+			Close();
+			return false;
+		}
+	}
+
+	// inner nodes must point inside the arrays, otherwise the search can run away
+	for (int i = header->numItems; i < header->numNodes; i++)
+	{
+		if (indices[i] < 0 || indices[i] >= i)
+		{
+			Close();
+			return false;
+		}
+	}
+
+	_header = header;
+	_boxes = boxes;
+	_indices = indices;
+	return true;
+}
+
+// ****************************************************************
+//		Close()
+// ****************************************************************
+void CHilbertRTree::Close()
+{
+	_header = NULL;
+	_boxes = NULL;
+	_indices = NULL;
+	_file.Close();
+}
+
+// ****************************************************************
+//		IsValidFor()
+// ****************************************************************
+// Checks that the index was built for the current state of the shapefile.
+bool CHilbertRTree::IsValidFor(CStringW shpFilename, int numShapes)
+{
+	if (!_header || _header->numShapes != numShapes)
+		return false;
+
+	WIN32_FILE_ATTRIBUTE_DATA data;
+	if (!GetFileAttributesExW(shpFilename, GetFileExInfoStandard, &data))
+		return false;
+
+	__int64 shpSize = ((__int64)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+	return _header->shpSize == shpSize;
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include "MappedFile.h"
+#include "PackedRTree.h"
+
+// ---------------------------------------------------------
+//   Packed Hilbert R-tree stored in a sidecar file (.mwr)
+// ---------------------------------------------------------
+// CPackedRTree is built from the bounds of .shp records and its flat arrays
+// are written after the header, so the file is memory-mapped as is and searched
+// without any deserialization.
+struct HilbertRTreeHeader
+{
+	char signature[4];
+	int version;
+	int nodeSize;
+	int numItems;			// number of indexed (non-null) shapes
+	int numNodes;			// leaves and inner nodes
+	int numLevels;
+	int numShapes;			// number of records in .shx at the moment of creation
+	int reserved;
+	__int64 shpSize;		// size of .shp at the moment of creation
+	double bounds[4];		// xMin, yMin, xMax, yMax
+	int levelBounds[PACKED_RTREE_MAX_LEVELS];		// end position of each level in the arrays
+};
+
+class CHilbertRTree
+{
+public:
+	CHilbertRTree()
+	{
+		_header = NULL;
+		_boxes = NULL;
+		_indices = NULL;
+	}
+
+	~CHilbertRTree()
+	{
+		Close();
+	}
+
+private:
+	CMappedFile _file;
+	HilbertRTreeHeader* _header;
+	double* _boxes;			// 4 values per node
+	int* _indices;			// shape index for leaves, position of the first child for inner nodes
+
+public:
+	static CStringW GetIndexFilename(CStringW shpFilename);
+	static bool Create(CStringW shpFilename, int nodeSize = PACKED_RTREE_DEFAULT_NODE_SIZE);
+
+	bool Open(CStringW shpFilename);
+	void Close();
+	bool IsOpen() { return _header != NULL; }
+	bool IsValidFor(CStringW shpFilename, int numShapes);
+	int get_NumItems() { return _header ? _header->numItems : 0; }
+	int get_NumShapes() { return _header ? _header->numShapes : 0; }
+
+	// Calls visitor(shapeIndex) for each shape which bounds intersect the box (or are contained by it).
+	template <typename Visitor>
+	void Search(double xMin, double yMin, double xMax, double yMax, bool contained, Visitor& visitor)
+	{
+		if (!_header)
+			return;
+
+		PackedRTreeSearch(_boxes, _indices, _header->levelBounds, _header->numItems, _header->numNodes, _header->nodeSize,
+						  xMin, yMin, xMax, yMax, contained, visitor);
+	}
+
+	void Search(double xMin, double yMin, double xMax, double yMax, bool contained, std::vector<long>& results)
+	{
+		auto add = [&results](int shapeIndex) { results.push_back(shapeIndex); };
+		Search(xMin, yMin, xMax, yMax, contained, add);
+	}
+};
@@ -2307,6 +2307,7 @@ namespace TestApplication
             }
 
             var baseFilename = Path.Combine(path, Path.GetFileNameWithoutExtension(filename));
+            File.Delete(baseFilename + ".mwr");
             File.Delete(baseFilename + ".mwd");
             File.Delete(baseFilename + ".dat");
             File.Delete(baseFilename + ".mwx");
@@ -2360,14 +2361,9 @@ namespace TestApplication
             theForm.Progress(string.Empty, 100, "Shapefile has index: " + sf.HasSpatialIndex);
 
             // Check if the files are created:
-            if (!(File.Exists(baseFilename + ".mwd") || File.Exists(baseFilename + ".dat")))
+            if (!File.Exists(baseFilename + ".mwr"))
             {
-                theForm.Error(string.Empty, "The mwd file does not exists");
-            }
-
-            if (!(File.Exists(baseFilename + ".mwx") || File.Exists(baseFilename + ".idx")))
-            {
-                theForm.Error(string.Empty, "The mwx file does not exists");
+                theForm.Error(string.Empty, "The mwr file does not exists");
                 return false;
             }
 
@@ -0,0 +1,273 @@
+﻿using System;
+using System.Collections.Generic;
+using System.IO;
+using MapWinGIS;
+using Microsoft.VisualStudio.TestTools.UnitTesting;
+
+namespace MapWinGISTests
+{
+    [TestClass]
+    public class ExpressionTests : ICallback
+    {
+        // More rows than in a single batch of the compiled expressions:
+        private const int NumRows = 2500;
+
+        private static readonly GlobalSettings _settings = new GlobalSettings();
+
+        // Expressions the compiler handles, with short-circuiting, nulls and comparisons of strings with numbers,
+        // followed by the ones which are left to the interpreter (functions, division by zero):
+        private static readonly string[] Expressions =
+        {
+            "[value] > 10",
+            "[value] >= 3.75 AND [value] < 9",
+            "[name] = \"b\"",
+            "[name] = \"ab\" OR [count] < 2",
+            "[count] < 2 OR [name] = \"ab\"",
+            "[count] > 3 AND [name] <> \"c\"",
+            "NOT ([value] <= 6)",
+            "[name] LIKE \"a%\"",
+            "[name] ILIKE \"A%\"",
+            "[name] = 3",
+            "[count] = \"3\"",
+            "[name] + [count] = \"b4\"",
+            "[value] * 2 - [count] > 5",
+            "[count] MOD 4 = 1",
+            "[count] <> 0 AND [value] / [count] > 2",
+            "[value] / [count] > 2",
+            "abs([value] - 7) < 3",
+            "length([name]) = 2",
+            "round([value]) = 4",
+        };
+
+        [TestMethod]
+        public void CompiledQueryMatchesInterpreter()
+        {
+            ForEachTable(sf =>
+            {
+                foreach (var expression in Expressions)
+                {
+                    var interpreted = RunInterpreted(() => Query(sf, expression));
+                    var compiled = Query(sf, expression);
+                    Assert.AreEqual(interpreted, compiled, "Different results of query: " + expression);
+                }
+            });
+        }
+
+        [TestMethod]
+        public void CompiledCalculateMatchesInterpreter()
+        {
+            var expressions = new List<string>(Expressions)
+            {
+                "[value] * 2 - [count]",
+                "[name] + [count]",
+                "[count] + [name]",
+                "[value] / [count]",
+                "-[value] ^ 2",
+                "[count] \\ 4",
+            };
+
+            ForEachTable(sf =>
+            {
+                foreach (var expression in expressions)
+                {
+                    for (var row = 0; row < NumRows; row += 13)
+                    {
+                        var interpreted = RunInterpreted(() => Calculate(sf, expression, row));
+                        var compiled = Calculate(sf, expression, row);
+                        Assert.AreEqual(interpreted, compiled, $"Different result of {expression} in row {row}");
+                    }
+                }
+            });
+        }
+
+        [TestMethod]
+        public void CompiledCategoriesMatchInterpreter()
+        {
+            ForEachTable(sf =>
+            {
+                sf.Categories.Clear();
+                foreach (var expression in Expressions)
+                {
+                    var ct = sf.Categories.Add(expression);
+                    ct.Expression = expression;
+                }
+
+                var interpreted = RunInterpreted(() => ApplyCategories(sf));
+                var compiled = ApplyCategories(sf);
+                CollectionAssert.AreEqual(interpreted, compiled, "Different categories of shapes");
+                sf.Categories.Clear();
+            });
+        }
+
+        [TestMethod]
+        public void ClassifiedCategoriesMatchExpressions()
+        {
+            var classifications = new[]
+            {
+                tkClassificationType.ctUniqueValues,
+                tkClassificationType.ctEqualIntervals,
+                tkClassificationType.ctNaturalBreaks,
+            };
+
+            ForEachTable(sf =>
+            {
+                foreach (var fieldName in new[] { "name", "value", "count" })
+                {
+                    var fieldIndex = sf.FieldIndexByName[fieldName];
+                    foreach (var classification in classifications)
+                    {
+                        if (fieldName == "name" && classification != tkClassificationType.ctUniqueValues)
+                            continue;
+
+                        var message = $"Categories of {fieldName} by {classification}";
+                        Assert.IsTrue(sf.Categories.Generate(fieldIndex, classification, 5), message + " weren't generated");
+                        Assert.AreEqual(fieldIndex, sf.Categories.ClassificationField, message + " aren't classified by the field");
+                        var classified = ApplyCategories(sf);
+
+                        // the same expressions are parsed when the classification field is unknown
+                        sf.Categories.ClassificationField = -1;
+                        var compiled = ApplyCategories(sf);
+                        var interpreted = RunInterpreted(() => ApplyCategories(sf));
+
+                        CollectionAssert.AreEqual(compiled, classified, message + " differ from compiled expressions");
+                        CollectionAssert.AreEqual(interpreted, classified, message + " differ from interpreted expressions");
+
+                        if (classification != tkClassificationType.ctUniqueValues)
+                        {
+                            // the last range includes its upper bound
+                            var row = GetMaxRow(sf, fieldIndex);
+                            Assert.AreEqual(sf.Categories.Count - 1, classified[row], message + ": maximum isn't in the last range");
+                        }
+                    }
+                }
+
+                sf.Categories.Clear();
+            });
+        }
+
+        private static string Query(IShapefile sf, string expression)
+        {
+            object result = null;
+            string errorString = null;
+            var retVal = sf.Table.Query(expression, ref result, ref errorString);
+            var indices = result as int[];
+            return $"{retVal}: {(indices == null ? errorString : string.Join(",", indices))}";
+        }
+
+        private static string Calculate(IShapefile sf, string expression, int row)
+        {
+            object result;
+            string errorString;
+            var retVal = sf.Table.Calculate(expression, row, out result, out errorString);
+            return $"{retVal}: {result} {errorString}";
+        }
+
+        private static int[] ApplyCategories(IShapefile sf)
+        {
+            sf.Categories.ApplyExpressions();
+            var categories = new int[sf.NumShapes];
+            for (var i = 0; i < sf.NumShapes; i++)
+                categories[i] = sf.ShapeCategory[i];
+            return categories;
+        }
+
+        private static int GetMaxRow(IShapefile sf, int fieldIndex)
+        {
+            var maxRow = -1;
+            var max = double.MinValue;
+            for (var i = 0; i < sf.NumShapes; i++)
+            {
+                var value = sf.CellValue[fieldIndex, i];
+                if (value == null || value is DBNull) continue;
+
+                var d = Convert.ToDouble(value);
+                if (d > max)
+                {
+                    max = d;
+                    maxRow = i;
+                }
+            }
+
+            Assert.AreNotEqual(-1, maxRow, "No values in the field");
+            return maxRow;
+        }
+
+        private static T RunInterpreted<T>(Func<T> func)
+        {
+            _settings.CompileExpressions = false;
+            try
+            {
+                return func();
+            }
+            finally
+            {
+                _settings.CompileExpressions = true;
+            }
+        }
+
+        /// <summary>
+        /// Runs the check for the table in memory, and for the same table read from the dbf,
+        /// record by record and from the columns
+        /// </summary>
+        private void ForEachTable(Action<Shapefile> check)
+        {
+            var tempFilename = Path.Combine(Path.GetTempPath(), "ExpressionTests.shp");
+            var cacheDbfColumns = _settings.CacheDbfColumns;
+
+            var sf = CreateTable(tempFilename, NumRows, this);
+            try
+            {
+                check(sf);
+                Assert.IsTrue(sf.StopEditingShapes(true, true, this), "Could not save shapefile");
+                sf.Close();
+
+                foreach (var cache in new[] { false, true })
+                {
+                    _settings.CacheDbfColumns = cache;
+                    sf = Helper.OpenShapefile(tempFilename, false, this);
+                    check(sf);
+                    sf.Close();
+                }
+            }
+            finally
+            {
+                _settings.CacheDbfColumns = cacheDbfColumns;
+                sf.Close();
+            }
+        }
+
+        /// <summary>
+        /// Creates a point shapefile with string, double and integer fields, each of them with null values
+        /// </summary>
+        public static Shapefile CreateTable(string filename, int numRows, ICallback callback)
+        {
+            Helper.DeleteShapefile(filename);
+
+            var sf = new Shapefile { GlobalCallback = callback };
+            Assert.IsTrue(sf.CreateNewWithShapeID(filename, ShpfileType.SHP_POINT), "Could not create shapefile");
+            var nameIndex = sf.EditAddField("name", FieldType.STRING_FIELD, 0, 10);
+            var valueIndex = sf.EditAddField("value", FieldType.DOUBLE_FIELD, 2, 10);
+            var countIndex = sf.EditAddField("count", FieldType.INTEGER_FIELD, 0, 10);
+
+            var names = new[] { "a", "b", "ab", "c" };
+            for (var i = 0; i < numRows; i++)
+            {
+                Helper.AddPointToPointSf(sf, Helper.MakePoint(i, i));
+                Assert.IsTrue(sf.EditCellValue(nameIndex, i, i % 7 == 3 ? (object)DBNull.Value : names[i % names.Length]));
+                Assert.IsTrue(sf.EditCellValue(valueIndex, i, i % 5 == 2 ? (object)DBNull.Value : (i % 20) * 0.75));
+                Assert.IsTrue(sf.EditCellValue(countIndex, i, i % 11 == 4 ? (object)DBNull.Value : i % 6));
+            }
+
+            return sf;
+        }
+
+        public void Progress(string KeyOfSender, int Percent, string Message)
+        {
+        }
+
+        public void Error(string KeyOfSender, string ErrorMsg)
+        {
+            Console.WriteLine("Error: " + ErrorMsg);
+        }
+    }
+}
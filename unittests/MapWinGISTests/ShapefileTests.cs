@@ -693,6 +693,105 @@ namespace MapWinGISTests
             Assert.AreEqual('д', value[3]);
         }
 
+        [TestMethod]
+        public void ReadDataFromColumnStore()
+        {
+            const string sfLocation = @"Issues\MWGIS-72\point.shp";
+            var settings = new GlobalSettings();
+            var cacheDbfColumns = settings.CacheDbfColumns;
+
+            try
+            {
+                // Read all the values row by row first:
+                settings.CacheDbfColumns = false;
+                var sf = new Shapefile { GlobalCallback = this };
+                if (!sf.Open(sfLocation))
+                    Assert.Fail("Can't open " + sfLocation + " Error: " + sf.ErrorMsg[sf.LastErrorCode]);
+
+                var expected = new List<object>();
+                for (var fieldIndex = 0; fieldIndex < sf.NumFields; fieldIndex++)
+                    for (var shapeIndex = 0; shapeIndex < sf.NumShapes; shapeIndex++)
+                        expected.Add(sf.CellValue[fieldIndex, shapeIndex]);
+                sf.Close();
+
+                // The same values must come from the columns:
+                settings.CacheDbfColumns = true;
+                sf = new Shapefile { GlobalCallback = this };
+                if (!sf.Open(sfLocation))
+                    Assert.Fail("Can't open " + sfLocation + " Error: " + sf.ErrorMsg[sf.LastErrorCode]);
+
+                var index = 0;
+                for (var fieldIndex = 0; fieldIndex < sf.NumFields; fieldIndex++)
+                    for (var shapeIndex = 0; shapeIndex < sf.NumShapes; shapeIndex++)
+                        Assert.AreEqual(expected[index++], sf.CellValue[fieldIndex, shapeIndex],
+                            $"Different value in field {fieldIndex}, row {shapeIndex}");
+                sf.Close();
+            }
+            finally
+            {
+                settings.CacheDbfColumns = cacheDbfColumns;
+            }
+        }
+
+        [TestMethod]
+        public void StatisticsSkipNullValues()
+        {
+            var tempFilename = Path.Combine(Path.GetTempPath(), "StatisticsSkipNullValues.shp");
+            Helper.DeleteShapefile(tempFilename);
+
+            var settings = new GlobalSettings();
+            var cacheDbfColumns = settings.CacheDbfColumns;
+
+            var sf = new Shapefile { GlobalCallback = this };
+            try
+            {
+                Assert.IsTrue(sf.CreateNewWithShapeID(tempFilename, ShpfileType.SHP_POINT), "Could not create shapefile");
+                var doubleIndex = sf.EditAddField("double", FieldType.DOUBLE_FIELD, 3, 10);
+                var intIndex = sf.EditAddField("integer", FieldType.INTEGER_FIELD, 0, 10);
+                var emptyIndex = sf.EditAddField("empty", FieldType.DOUBLE_FIELD, 3, 10);
+
+                // Every second row is null, the empty field has nulls only:
+                var doubles = new object[] { 1.0, DBNull.Value, 3.0, DBNull.Value, 5.0 };
+                var integers = new object[] { 2, DBNull.Value, 4, DBNull.Value, 6 };
+                for (var i = 0; i < doubles.Length; i++)
+                {
+                    Helper.AddPointToPointSf(sf, Helper.MakePoint(i, i));
+                    Assert.IsTrue(sf.EditCellValue(doubleIndex, i, doubles[i]), "Could not set the value");
+                    Assert.IsTrue(sf.EditCellValue(intIndex, i, integers[i]), "Could not set the value");
+                    Assert.IsTrue(sf.EditCellValue(emptyIndex, i, DBNull.Value), "Could not set the value");
+                }
+
+                CheckStatistics(sf.Table, doubleIndex, intIndex, emptyIndex);
+                Assert.IsTrue(sf.StopEditingShapes(true, true, this), "Could not save shapefile");
+                sf.Close();
+
+                // The same from the dbf, row by row and from the columns:
+                foreach (var cache in new[] { false, true })
+                {
+                    settings.CacheDbfColumns = cache;
+                    sf = Helper.OpenShapefile(tempFilename, false, this);
+                    CheckStatistics(sf.Table, doubleIndex, intIndex, emptyIndex);
+                    sf.Close();
+                }
+            }
+            finally
+            {
+                settings.CacheDbfColumns = cacheDbfColumns;
+                sf.Close();
+            }
+        }
+
+        private static void CheckStatistics(Table table, int doubleIndex, int intIndex, int emptyIndex)
+        {
+            // mean and sample deviation of 1, 3, 5 and 2, 4, 6:
+            Assert.AreEqual(3.0, table.MeanValue[doubleIndex], 1e-9, "Wrong mean of double field");
+            Assert.AreEqual(2.0, table.StandardDeviation[doubleIndex], 1e-9, "Wrong deviation of double field");
+            Assert.AreEqual(4.0, table.MeanValue[intIndex], 1e-9, "Wrong mean of integer field");
+            Assert.AreEqual(2.0, table.StandardDeviation[intIndex], 1e-9, "Wrong deviation of integer field");
+            Assert.AreEqual(0.0, table.MeanValue[emptyIndex], "Mean of nulls must be 0");
+            Assert.AreEqual(0.0, table.StandardDeviation[emptyIndex], "Deviation of nulls must be 0");
+        }
+
         [TestMethod]
         public void ReadRussianDataFromOgrDatasource()
         {
@@ -769,6 +868,10 @@ namespace MapWinGISTests
                 var numPoints = sfPoints.NumShapes;
                 Assert.IsTrue(numPoints > 0, "No point shapes in shapefile");
 
+                var xs = new double[numPoints];
+                var ys = new double[numPoints];
+                var indices = new int[numPoints];
+
                 for (var i = 0; i < numPoints; i++)
                 {
                     var pointShape = sfPoints.Shape[i];
@@ -782,7 +885,16 @@ namespace MapWinGISTests
                     var shapeIndex = sfPolygons.PointInShapefile(x, y);
                     Console.WriteLine($"Point {i} lies within polygon {shapeIndex}");
                     found++;
+
+                    xs[i] = x;
+                    ys[i] = y;
+                    indices[i] = shapeIndex;
                 }
+
+                // The batch version must give the same results:
+                var batchIndices = (int[])sfPolygons.PointsInShapefile(xs, ys, 0);
+                Assert.IsNotNull(batchIndices, "PointsInShapefile returned null");
+                CollectionAssert.AreEqual(indices, batchIndices, "Batch results differ from PointInShapefile");
             }
             finally
             {
@@ -837,6 +949,7 @@ namespace MapWinGISTests
         private void TestSpatialIndex(string sfName)
         {
             // Delete previous spatial index files:
+            Helper.DeleteFile(Path.ChangeExtension(sfName, ".mwr"));
             Helper.DeleteFile(Path.ChangeExtension(sfName, ".mwd"));
             Helper.DeleteFile(Path.ChangeExtension(sfName, ".mwx"));
 
@@ -870,6 +983,7 @@ namespace MapWinGISTests
                 // Create spatial index:
                 retVal = sf.CreateSpatialIndex(sfName);
                 Assert.IsTrue(retVal, "Can't create spatial index: " + sf.ErrorMsg[sf.LastErrorCode]);
+                Assert.IsTrue(File.Exists(Path.ChangeExtension(sfName, ".mwr")), "Spatial index file wasn't created");
                 Assert.IsTrue(sf.IsSpatialIndexValid(), "Spatial index is invalid");
                 sf.UseSpatialIndex = true;
                 _axMap1.ZoomToLayer(layerHandle);
@@ -1335,6 +1449,7 @@ namespace MapWinGISTests
         {
             const string sfName = @"D:\dev\GIS-data\Forum\Search-speed-issue\RD12115.shp";
             // Delete previous spatial index files:
+            Helper.DeleteFile(Path.ChangeExtension(sfName, ".mwr"));
             Helper.DeleteFile(Path.ChangeExtension(sfName, ".mwd"));
             Helper.DeleteFile(Path.ChangeExtension(sfName, ".mwx"));
 
@@ -1401,6 +1516,247 @@ namespace MapWinGISTests
             Assert.IsTrue(indexes.Length > 0, "No results found");
         }
 
+        [TestMethod]
+        public void ConcurrentShapeReads()
+        {
+            // Shapes of a disk-based shapefile are read with positional reads,
+            // so several threads should be able to read from the same instance at once:
+            var sf = Helper.OpenShapefile(Path.Combine(@"sf", "embankments_buffered_split.shp"));
+            var numShapes = sf.NumShapes;
+            Assert.IsTrue(numShapes > 0, "No shapes in shapefile");
+
+            // Reference number of points, read by a single thread:
+            var expectedPoints = 0L;
+            for (var i = 0; i < numShapes; i++)
+                expectedPoints += sf.Shape[i].numPoints;
+
+            const int passes = 200;
+            var stopwatch = new Stopwatch();
+            foreach (var numThreads in new[] { 1, 2, 4, 8, 16 })
+            {
+                var totalPoints = 0L;
+                var threads = new List<Thread>();
+                stopwatch.Restart();
+                for (var t = 0; t < numThreads; t++)
+                {
+                    var threadIndex = t;
+                    var thread = new Thread(() =>
+                    {
+                        // each thread reads its own share of the shapes:
+                        var points = 0L;
+                        for (var pass = 0; pass < passes; pass++)
+                            for (var i = threadIndex; i < numShapes; i += numThreads)
+                                points += sf.Shape[i].numPoints;
+
+                        Interlocked.Add(ref totalPoints, points);
+                    });
+                    threads.Add(thread);
+                    thread.Start();
+                }
+
+                threads.ForEach(thread => thread.Join());
+                stopwatch.Stop();
+
+                Assert.AreEqual(expectedPoints * passes, totalPoints, $"Wrong number of points read by {numThreads} threads");
+                var shapesPerSecond = numShapes * passes / stopwatch.Elapsed.TotalSeconds;
+                Console.WriteLine($"{numThreads} thread(s): {stopwatch.Elapsed}, {shapesPerSecond:N0} shapes/s");
+            }
+
+            sf.Close();
+        }
+
+        // Benchmark: runs for minutes, so it is ignored by default and has to be run explicitly.
+        [TestCategory("Benchmark"), TestMethod, Ignore, Timeout(30 * 60 * 1000)]
+        public void PackedTreeVersusQTree()
+        {
+            // 1M random points, saved to disk so that the packed tree can be built for them:
+            const int numPoints = 1000000;
+            const int numQueries = 10000;
+            var filename = Path.Combine(Helper.WorkingFolder("PackedTreeVersusQTree"), "points.shp");
+            var sf = Helper.CreateSf(ShpfileType.SHP_POINT);
+            var random = new Random(42);
+            for (var i = 0; i < numPoints; i++)
+            {
+                var shp = new Shape();
+                shp.Create(ShpfileType.SHP_POINT);
+                shp.AddPoint(random.NextDouble() * 1000.0, random.NextDouble() * 1000.0);
+                sf.EditAddShape(shp);
+            }
+            Helper.SaveAsShapefile(sf, filename);
+            sf.Close();
+
+            sf = Helper.OpenShapefile(filename);
+            var process = Process.GetCurrentProcess();
+            var stopwatch = new Stopwatch();
+            object result = null;
+
+            // Both trees are measured by the growth of the working set from before the tree is enabled
+            // until its queries are done; it includes the pages of the mapped .mwr file read by the packed tree.
+            // QTree is built by inserting points one by one when editing starts:
+            Assert.IsTrue(sf.StartEditingShapes(), "Can't start editing");
+            var memoryBefore = MemoryInUse(process);
+            stopwatch.Start();
+            sf.UseQTree = true;
+            stopwatch.Stop();
+            Console.WriteLine($"QTree: build {stopwatch.Elapsed}");
+
+            var found = RunWindowQueries(sf, numQueries, stopwatch, ref result);
+            Console.WriteLine($"QTree: {numQueries} queries {stopwatch.Elapsed}, {numQueries / stopwatch.Elapsed.TotalSeconds:N0} queries/s");
+            Console.WriteLine($"QTree: memory {(MemoryInUse(process) - memoryBefore) / 1024} KB");
+            sf.UseQTree = false;
+            sf.StopEditingShapes(false, true, null);
+
+            // Packed tree is bulk loaded in Hilbert order and stored in the flat arrays:
+            stopwatch.Restart();
+            Assert.IsTrue(sf.CreateSpatialIndex(sf.Filename), "Cannot create spatial index");
+            stopwatch.Stop();
+            Console.WriteLine($"Packed tree: build {stopwatch.Elapsed}");
+
+            memoryBefore = MemoryInUse(process);
+            sf.UseSpatialIndex = true;
+            sf.SpatialIndexMaxAreaPercent = 1.0;
+            var foundPacked = RunWindowQueries(sf, numQueries, stopwatch, ref result);
+            Console.WriteLine($"Packed tree: {numQueries} queries {stopwatch.Elapsed}, {numQueries / stopwatch.Elapsed.TotalSeconds:N0} queries/s");
+            Console.WriteLine($"Packed tree: memory {(MemoryInUse(process) - memoryBefore) / 1024} KB");
+
+            Assert.AreEqual(found, foundPacked, "Both trees must find the same shapes");
+            sf.Close();
+        }
+
+        private static long MemoryInUse(Process process)
+        {
+            GC.Collect();
+            GC.WaitForPendingFinalizers();
+            process.Refresh();
+            return process.WorkingSet64;
+        }
+
+        private static long RunWindowQueries(IShapefile sf, int numQueries, Stopwatch stopwatch, ref object result)
+        {
+            // the same windows for each tree:
+            var random = new Random(7);
+            var found = 0L;
+            stopwatch.Restart();
+            for (var i = 0; i < numQueries; i++)
+            {
+                var x = random.NextDouble() * 990.0;
+                var y = random.NextDouble() * 990.0;
+                var box = new Extents();
+                box.SetBounds(x, y, 0.0, x + 10.0, y + 10.0, 0.0);
+                if (sf.SelectShapes(box, 0.0, SelectMode.INTERSECTION, ref result))
+                    found += ((int[])result).Length;
+            }
+            stopwatch.Stop();
+            return found;
+        }
+
+        [TestMethod]
+        public void SnappingMatchesBruteForce()
+        {
+            var random = new Random(16);
+            var sf = Helper.CreateSf(ShpfileType.SHP_POLYLINE);
+            for (var i = 0; i < 300; i++)
+            {
+                sf.EditAddShape(MakeRandomLine(random));
+            }
+
+            // the index is built by the first query and then updated by the edits:
+            CheckSnapping(sf, random);
+
+            sf.EditDeleteShape(0);
+            sf.EditDeleteShape(150);
+            var shapeIndex = 100;
+            Assert.IsTrue(sf.EditInsertShape(MakeRandomLine(random), ref shapeIndex), "Can't insert shape");
+            var shp = sf.Shape[42];
+            Assert.IsTrue(shp.put_XY(0, 500.5, 500.5), "Can't move point");
+            sf.ShapeModified[42] = true;
+            CheckSnapping(sf, random);
+
+            // shapes changed directly, without notification of the shapefile:
+            Assert.IsTrue(sf.Shape[7].put_XY(1, 250.5, 750.5), "Can't move point");
+            sf.Shape[99].Move(40.0, -40.0);
+            sf.Shape[200].Rotate(500.0, 500.0, 30.0);
+            CheckSnapping(sf, random);
+
+            sf.Close();
+        }
+
+        private static Shape MakeRandomLine(Random random)
+        {
+            var shp = new Shape();
+            shp.Create(ShpfileType.SHP_POLYLINE);
+            var x = random.NextDouble() * 1000.0;
+            var y = random.NextDouble() * 1000.0;
+            var numPoints = random.Next(2, 7);
+            for (var j = 0; j < numPoints; j++)
+            {
+                shp.AddPoint(x, y);
+                x += random.NextDouble() * 60.0 - 30.0;
+                y += random.NextDouble() * 60.0 - 30.0;
+            }
+            return shp;
+        }
+
+        /// <summary>
+        /// Compares the distances found by GetClosestVertex and GetClosestSnapPosition
+        /// with those to all the vertices and segments of shapefile
+        /// </summary>
+        private static void CheckSnapping(IShapefile sf, Random random)
+        {
+            for (var i = 0; i < 200; i++)
+            {
+                var x = random.NextDouble() * 1100.0 - 50.0;
+                var y = random.NextDouble() * 1100.0 - 50.0;
+
+                var minVertex = double.MaxValue;
+                var minSegment = double.MaxValue;
+                for (var n = 0; n < sf.NumShapes; n++)
+                {
+                    var shp = sf.Shape[n];
+                    for (var j = 0; j < shp.numPoints; j++)
+                    {
+                        var p1 = shp.Point[j];
+                        minVertex = Math.Min(minVertex, Distance(x, y, p1.x, p1.y));
+                        if (j == shp.numPoints - 1) continue;
+
+                        var p2 = shp.Point[j + 1];
+                        var dx = p2.x - p1.x;
+                        var dy = p2.y - p1.y;
+                        var t = Math.Max(0.0, Math.Min(1.0, ((x - p1.x) * dx + (y - p1.y) * dy) / (dx * dx + dy * dy)));
+                        minSegment = Math.Min(minSegment, Distance(x, y, p1.x + t * dx, p1.y + t * dy));
+                    }
+                }
+
+                foreach (var maxDistance in new[] { 0.0, 10.0 })
+                {
+                    int shapeIndex, pointIndex;
+                    double distance, fx, fy;
+
+                    var found = sf.GetClosestVertex(x, y, maxDistance, out shapeIndex, out pointIndex, out distance);
+                    Assert.AreEqual(maxDistance == 0.0 || minVertex < maxDistance, found, $"Vertex near ({x}, {y}) within {maxDistance}");
+                    if (found)
+                    {
+                        Assert.AreEqual(minVertex, distance, 1e-9, $"Wrong distance to the closest vertex to ({x}, {y})");
+                        var p = sf.Shape[shapeIndex].Point[pointIndex];
+                        Assert.AreEqual(minVertex, Distance(x, y, p.x, p.y), 1e-9, "Wrong closest vertex");
+                    }
+
+                    found = sf.GetClosestSnapPosition(x, y, maxDistance, out shapeIndex, out fx, out fy, out distance);
+                    Assert.AreEqual(maxDistance == 0.0 || minSegment < maxDistance, found, $"Segment near ({x}, {y}) within {maxDistance}");
+                    if (found)
+                    {
+                        Assert.AreEqual(minSegment, distance, 1e-9, $"Wrong distance to the closest segment to ({x}, {y})");
+                        Assert.AreEqual(minSegment, Distance(x, y, fx, fy), 1e-9, "Wrong snap position");
+                    }
+                }
+            }
+        }
+
+        private static double Distance(double x1, double y1, double x2, double y2)
+        {
+            return Math.Sqrt((x2 - x1) * (x2 - x1) + (y2 - y1) * (y2 - y1));
+        }
+
         private bool GetInfoShapefile(string filename)
         {
             if (!File.Exists(filename))
@@ -1,6 +1,12 @@
 ﻿using System;
+using System.Collections.Generic;
 using System.Diagnostics;
+using System.Drawing;
+using System.Drawing.Imaging;
 using System.IO;
+using System.Linq;
+using System.Net;
+using System.Net.Sockets;
 using System.Threading;
 using AxMapWinGIS;
 using MapWinGIS;
@@ -116,6 +122,341 @@ namespace MapWinGISTests
             Helper.DebugMsg("Time it took: " + stopWatch.Elapsed);
         }
 
+        [TestMethod]
+        public void CustomProviderReusesConnectionsAndCancelsDownloads()
+        {
+            const int providerId = 1999;
+            const int zoom = 10;
+
+            using (var server = new LocalTileServer())
+            {
+                var tiles = _axMap1.Tiles;
+                tiles.Providers.Remove(providerId, true);
+                Assert.IsTrue(tiles.Providers.Add(providerId, "Local test server", server.UrlPattern,
+                    tkTileProjection.SphericalMercator, 0, 18), "Can't add custom provider");
+
+                // All the tiles are served at once; the requests must share a few connections:
+                tiles.ClearCache2(tkCacheType.Disk, providerId);
+                var stop = new StopExecution(() => false);
+                var count = tiles.Prefetch2(520, 527, 330, 337, zoom, providerId, stop);
+                Assert.AreEqual(64, count, "Wrong number of tiles to prefetch");
+                Assert.IsTrue(WaitFor(() => server.NumServed == 64, TimeSpan.FromSeconds(60)), "Not all the tiles were served");
+                Console.WriteLine($"{server.NumServed} tiles served over {server.NumConnections} connections");
+                Assert.IsTrue(server.NumConnections <= _settings.TilesThreadPoolSize * 2,
+                    $"Connections aren't reused: {server.NumConnections} connections for {server.NumServed} tiles");
+
+                // The first tile is served and stops the prefetch; the requests sent by the other threads
+                // of the loader meanwhile are held:
+                server.Reset(1);
+                tiles.ClearCache2(tkCacheType.Disk, providerId);
+                stop = new StopExecution(() => true);
+                count = tiles.Prefetch2(540, 547, 350, 357, zoom, providerId, stop);
+                Assert.AreEqual(64, count, "Wrong number of tiles to prefetch");
+                Assert.IsTrue(WaitFor(() => server.NumServed == 1, TimeSpan.FromSeconds(30)), "The first tile wasn't served");
+
+                // cURL checks for cancellation about once a second while it waits for a response:
+                Thread.Sleep(3000);
+                var numHeld = server.NumHeld;
+                server.ReleaseHeld(TimeSpan.FromSeconds(10));
+                GC.KeepAlive(stop);
+
+                Console.WriteLine($"{numHeld} requests held, {server.NumAborted} aborted by the client");
+                Assert.IsTrue(numHeld > 0, "No requests were held");
+                Assert.AreEqual(numHeld, server.NumAborted, "Held downloads weren't aborted after the prefetch was stopped");
+                Assert.IsTrue(server.NumRequests < 64, "Tiles were requested after the prefetch was stopped");
+
+                tiles.Providers.Remove(providerId, true);
+            }
+        }
+
+        [TestMethod]
+        public void PrefetchAreaPlansTilesWithinPolygon()
+        {
+            const int providerId = 1998;
+            const int minZoom = 10;
+            const int maxZoom = 13;
+
+            using (var server = new LocalTileServer())
+            {
+                var tiles = _axMap1.Tiles;
+                tiles.Providers.Remove(providerId, true);
+                Assert.IsTrue(tiles.Providers.Add(providerId, "Local test server", server.UrlPattern,
+                    tkTileProjection.SphericalMercator, 0, 18), "Can't add custom provider");
+                tiles.ClearCache2(tkCacheType.Disk, providerId);
+                var stop = new StopExecution(() => false);
+
+                // All the tiles which intersect the polygon, and nothing else:
+                var expected = GetTilesOfLShape(8.0, 52.03, minZoom, maxZoom);
+                var count = tiles.PrefetchArea(MakeLShape(8.0, 52.03), minZoom, maxZoom, providerId, stop);
+                Assert.AreEqual(expected.Count, count, "Wrong number of tiles to prefetch");
+                Assert.IsTrue(WaitFor(() => server.NumServed == count, TimeSpan.FromSeconds(60)), "Not all the tiles were served");
+                CollectionAssert.AreEquivalent(expected, server.RequestedTiles, "Wrong tiles were requested");
+
+                // The lower zoom levels are taken first; the last one is cut, keeping the tiles nearest to the centre:
+                server.Reset(int.MaxValue);
+                expected = GetTilesOfLShape(9.0, 52.03, minZoom, maxZoom);
+                var lastLevel = expected.FindAll(t => t.Item1 == maxZoom);
+                var maxTileCount = expected.Count - lastLevel.Count / 2;
+                count = tiles.PrefetchArea(MakeLShape(9.0, 52.03), minZoom, maxZoom, providerId, stop, maxTileCount);
+                Assert.AreEqual(maxTileCount, count, "Wrong number of tiles to prefetch");
+                Assert.IsTrue(WaitFor(() => server.NumServed == count, TimeSpan.FromSeconds(60)), "Not all the tiles were served");
+
+                var requested = server.RequestedTiles;
+                Assert.AreEqual(count, requested.Count, "Wrong number of tiles requested");
+                foreach (var tile in expected.FindAll(t => t.Item1 < maxZoom))
+                    Assert.IsTrue(requested.Contains(tile), $"Tile {tile} of a lower zoom level wasn't requested");
+
+                var xs = lastLevel.ConvertAll(t => t.Item2);
+                var ys = lastLevel.ConvertAll(t => t.Item3);
+                var centreX = (xs.Min() + xs.Max()) / 2;
+                var centreY = (ys.Min() + ys.Max()) / 2;
+                Func<Tuple<int, int, int>, double> distance = t => Math.Sqrt(Math.Pow(t.Item2 - centreX, 2) + Math.Pow(t.Item3 - centreY, 2));
+
+                var taken = lastLevel.FindAll(requested.Contains);
+                var left = lastLevel.FindAll(t => !requested.Contains(t));
+                Assert.AreEqual(lastLevel.Count / 2, left.Count, "Wrong number of tiles of the last level");
+                Assert.IsTrue(taken.Max(distance) <= left.Min(distance), "Tiles far from the centre were taken first");
+
+                tiles.Providers.Remove(providerId, true);
+            }
+        }
+
+        /// <summary>
+        /// L-shaped polygon made of the rectangles [x, x + 0.3] x [y, y + 0.1] and [x, x + 0.1] x [y + 0.1, y + 0.3]
+        /// </summary>
+        private static Shape MakeLShape(double x, double y)
+        {
+            var shp = new Shape();
+            shp.Create(ShpfileType.SHP_POLYGON);
+            shp.AddPoint(x, y);
+            shp.AddPoint(x, y + 0.3);
+            shp.AddPoint(x + 0.1, y + 0.3);
+            shp.AddPoint(x + 0.1, y + 0.1);
+            shp.AddPoint(x + 0.3, y + 0.1);
+            shp.AddPoint(x + 0.3, y);
+            shp.AddPoint(x, y);
+            return shp;
+        }
+
+        /// <summary>
+        /// Spherical Mercator tiles (zoom, x, y) which intersect either of the rectangles of the L-shaped polygon
+        /// </summary>
+        private static List<Tuple<int, int, int>> GetTilesOfLShape(double x, double y, int minZoom, int maxZoom)
+        {
+            var rects = new[]
+            {
+                new[] { x, y, x + 0.3, y + 0.1 },
+                new[] { x, y + 0.1, x + 0.1, y + 0.3 },
+            };
+
+            var tiles = new HashSet<Tuple<int, int, int>>();
+            for (var zoom = minZoom; zoom <= maxZoom; zoom++)
+            {
+                foreach (var rect in rects)
+                {
+                    for (var tx = LngToTileX(rect[0], zoom); tx <= LngToTileX(rect[2], zoom); tx++)
+                        for (var ty = LatToTileY(rect[3], zoom); ty <= LatToTileY(rect[1], zoom); ty++)
+                            tiles.Add(Tuple.Create(zoom, tx, ty));
+                }
+            }
+            return new List<Tuple<int, int, int>>(tiles);
+        }
+
+        private static int LngToTileX(double lng, int zoom)
+        {
+            return (int)Math.Floor((lng + 180.0) / 360.0 * (1 << zoom));
+        }
+
+        private static int LatToTileY(double lat, int zoom)
+        {
+            var rad = lat * Math.PI / 180.0;
+            return (int)Math.Floor((1.0 - Math.Log(Math.Tan(rad) + 1.0 / Math.Cos(rad)) / Math.PI) / 2.0 * (1 << zoom));
+        }
+
+        private static bool WaitFor(Func<bool> condition, TimeSpan timeout)
+        {
+            var stopwatch = Stopwatch.StartNew();
+            while (!condition())
+            {
+                if (stopwatch.Elapsed > timeout) return false;
+                Thread.Sleep(100);
+            }
+            return true;
+        }
+
+        /// <summary>
+        /// Serves the same image for any tile; the requests after the given number are held
+        /// until they are released, to check that the client closes the connection
+        /// </summary>
+        private class LocalTileServer : IDisposable
+        {
+            private const int ChunkSize = 16 * 1024;
+
+            private readonly HttpListener _listener = new HttpListener();
+            private readonly ManualResetEvent _release = new ManualResetEvent(true);
+            private readonly HashSet<int> _clientPorts = new HashSet<int>();
+            private readonly List<Tuple<int, int, int>> _requestedTiles = new List<Tuple<int, int, int>>();
+            private readonly List<Thread> _heldThreads = new List<Thread>();
+            private readonly byte[] _image;
+            private int _numServedAtOnce = int.MaxValue;
+            private int _numRequests;
+            private int _numServed;
+            private int _numHeld;
+            private int _numAborted;
+
+            public LocalTileServer()
+            {
+                // a free port:
+                var tcpListener = new TcpListener(IPAddress.Loopback, 0);
+                tcpListener.Start();
+                var port = ((IPEndPoint)tcpListener.LocalEndpoint).Port;
+                tcpListener.Stop();
+
+                // noise, so that a response takes many writes:
+                using (var bitmap = new Bitmap(512, 512))
+                using (var stream = new MemoryStream())
+                {
+                    var random = new Random(23);
+                    for (var x = 0; x < bitmap.Width; x++)
+                        for (var y = 0; y < bitmap.Height; y++)
+                            bitmap.SetPixel(x, y, Color.FromArgb(random.Next(256), random.Next(256), random.Next(256)));
+                    bitmap.Save(stream, ImageFormat.Png);
+                    _image = stream.ToArray();
+                }
+
+                UrlPattern = $"http://localhost:{port}/tiles/{{zoom}}/{{x}}/{{y}}.png";
+                _listener.Prefixes.Add($"http://localhost:{port}/tiles/");
+                _listener.Start();
+                new Thread(Listen) { IsBackground = true }.Start();
+            }
+
+            public string UrlPattern { get; }
+            public int NumRequests => _numRequests;
+            public int NumServed => _numServed;
+            public int NumHeld => _numHeld;
+            public int NumAborted => _numAborted;
+
+            /// <summary>
+            /// Zoom, x and y of the requested tiles
+            /// </summary>
+            public List<Tuple<int, int, int>> RequestedTiles
+            {
+                get
+                {
+                    lock (_requestedTiles) return new List<Tuple<int, int, int>>(_requestedTiles);
+                }
+            }
+
+            public int NumConnections
+            {
+                get
+                {
+                    lock (_clientPorts) return _clientPorts.Count;
+                }
+            }
+
+            public void Reset(int numServedAtOnce)
+            {
+                _numServedAtOnce = numServedAtOnce;
+                _numRequests = _numServed = _numHeld = _numAborted = 0;
+                lock (_clientPorts) _clientPorts.Clear();
+                lock (_requestedTiles) _requestedTiles.Clear();
+                _release.Reset();
+            }
+
+            public void ReleaseHeld(TimeSpan timeout)
+            {
+                _release.Set();
+                lock (_heldThreads)
+                {
+                    foreach (var thread in _heldThreads)
+                        thread.Join(timeout);
+                }
+            }
+
+            private void Listen()
+            {
+                while (_listener.IsListening)
+                {
+                    HttpListenerContext context;
+                    try
+                    {
+                        context = _listener.GetContext();
+                    }
+                    catch (HttpListenerException)
+                    {
+                        return;
+                    }
+
+                    lock (_clientPorts) _clientPorts.Add(context.Request.RemoteEndPoint.Port);
+
+                    // the path is /tiles/{zoom}/{x}/{y}.png
+                    var segments = Path.ChangeExtension(context.Request.Url.AbsolutePath, null).Split('/');
+                    var tile = Tuple.Create(int.Parse(segments[2]), int.Parse(segments[3]), int.Parse(segments[4]));
+                    lock (_requestedTiles) _requestedTiles.Add(tile);
+
+                    if (Interlocked.Increment(ref _numRequests) <= _numServedAtOnce)
+                    {
+                        Respond(context);
+                        continue;
+                    }
+
+                    Interlocked.Increment(ref _numHeld);
+                    var thread = new Thread(() =>
+                    {
+                        _release.WaitOne();
+                        Respond(context);
+                    }) { IsBackground = true };
+
+                    lock (_heldThreads) _heldThreads.Add(thread);
+                    thread.Start();
+                }
+            }
+
+            private void Respond(HttpListenerContext context)
+            {
+                try
+                {
+                    context.Response.ContentType = "image/png";
+                    context.Response.ContentLength64 = _image.Length;
+                    var output = context.Response.OutputStream;
+                    for (var offset = 0; offset < _image.Length; offset += ChunkSize)
+                    {
+                        output.Write(_image, offset, Math.Min(ChunkSize, _image.Length - offset));
+                        output.Flush();
+                    }
+                    context.Response.Close();
+                    Interlocked.Increment(ref _numServed);
+                }
+                catch (Exception ex) when (ex is HttpListenerException || ex is IOException || ex is ObjectDisposedException)
+                {
+                    Interlocked.Increment(ref _numAborted);
+                }
+            }
+
+            public void Dispose()
+            {
+                _release.Set();
+                _listener.Close();
+            }
+        }
+
+        private class StopExecution : IStopExecution
+        {
+            private readonly Func<bool> _stop;
+
+            public StopExecution(Func<bool> stop)
+            {
+                _stop = stop;
+            }
+
+            public bool StopFunction()
+            {
+                return _stop();
+            }
+        }
+
+
         public void Progress(string KeyOfSender, int Percent, string Message)
         {
             Console.WriteLine($"Callback {Percent} {Message}");
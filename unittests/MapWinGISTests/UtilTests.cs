@@ -1,4 +1,5 @@
 ﻿using System;
+using System.Collections.Generic;
 using System.Diagnostics;
 using System.IO;
 using System.Linq;
@@ -48,6 +49,123 @@ namespace MapWinGISTests
             Assert.IsTrue(tiffIn.GeoProjection.IsSame[tiffOut.GeoProjection], "Projections are not the same");
         }
 
+        [TestMethod]
+        public void CalculateRasterMatchesPerPixelValues()
+        {
+            const int numCols = 300;
+            const int numRows = 200;
+            const double nodata = -9999.0;
+            const float outputNodata = -1.0f;
+            var folder = Path.GetTempPath();
+            var filenameA = Path.Combine(folder, "CalcA.tif");
+            var filenameB = Path.Combine(folder, "CalcB.tif");
+            var output = Path.Combine(folder, "CalcResult.tif");
+
+            var a = CreateGrid(filenameA, numCols, numRows, 1.0, nodata,
+                (col, row) => (col + row) % 31 == 0 ? nodata : (3 * col + row) % 17 - 4.5);
+            var b = CreateGrid(filenameB, numCols, numRows, 1.0, nodata,
+                (col, row) => (col * row) % 43 == 7 ? nodata : (col + 2 * row) % 5);
+
+            // nulls stand for nodata of the output, both for nodata of inputs and division by zero:
+            var formulas = new Dictionary<string, Func<double, double, double?>>
+            {
+                { "[CalcA.tif@1] + 2 * [CalcB.tif@1]", (x, y) => x + 2 * y },
+                { "5 - [CalcA.tif@1]", (x, y) => 5 - x },
+                { "[CalcB.tif@1] / 2 - [CalcA.tif@1]", (x, y) => y / 2 - x },
+                { "[CalcA.tif@1] / [CalcB.tif@1]", (x, y) => y == 0.0 ? (double?)null : x / y },
+                {
+                    "([CalcA.tif@1] - [CalcB.tif@1]) / ([CalcA.tif@1] + [CalcB.tif@1])",
+                    (x, y) => x + y == 0.0 ? (double?)null : (x - y) / (x + y)
+                },
+                { "[CalcA.tif@1] > [CalcB.tif@1]", (x, y) => x > y ? 1.0 : 0.0 },
+            };
+
+            var utils = new Utils { GlobalCallback = this };
+            foreach (var item in formulas)
+            {
+                string errorMsg;
+                Helper.DeleteFile(output);
+                var result = utils.CalculateRaster(new[] { filenameA, filenameB }, item.Key, output, "GTiff",
+                    outputNodata, this, out errorMsg);
+                Assert.IsTrue(result, $"CalculateRaster failed for {item.Key}: {errorMsg}");
+
+                var values = ReadGrid(output);
+                for (var row = 0; row < numRows; row++)
+                {
+                    for (var col = 0; col < numCols; col++)
+                    {
+                        var x = a[row, col];
+                        var y = b[row, col];
+                        var expected = x.Equals(nodata) || y.Equals(nodata) ? null : item.Value(x, y);
+                        Assert.AreEqual(expected ?? outputNodata, values[row, col], 1e-5 * Math.Max(1.0, Math.Abs(expected ?? 0.0)),
+                            $"Wrong value of {item.Key} at row {row}, column {col}");
+                    }
+                }
+            }
+        }
+
+        [TestMethod]
+        public void TerrainDerivativesMatchPerCellFormula()
+        {
+            const int numCols = 150;
+            const int numRows = 120;
+            const double cellSize = 10.0;
+            const double nodata = -9999.0;
+            var demFilename = Path.Combine(Path.GetTempPath(), "TerrainDem.tif");
+            var shadeFilename = Path.Combine(Path.GetTempPath(), "TerrainShade.tif");
+            var slopeFilename = Path.Combine(Path.GetTempPath(), "TerrainSlope.tif");
+
+            // Hills and valleys on an inclined plane, with a few holes of nodata:
+            var dem = CreateGrid(demFilename, numCols, numRows, cellSize, nodata,
+                (col, row) => col % 37 == 5 && row % 23 == 7
+                    ? nodata
+                    : 50.0 * Math.Sin(col / 9.0) * Math.Cos(row / 7.0) + 0.3 * col);
+
+            var utils = new Utils { GlobalCallback = this };
+            Assert.IsTrue(utils.GenerateHillShade(demFilename, shadeFilename, 1.5f, 1.0f, 315.0f, 45.0f),
+                "GenerateHillShade failed: " + utils.ErrorMsg[utils.LastErrorCode]);
+            var shade = ReadGrid(shadeFilename);
+
+            Assert.IsTrue(utils.GenerateTerrainDerivative(demFilename, 1, slopeFilename, tkTerrainDerivative.tdSlope,
+                    1.5, 1.0, 0.0, 0.0, "GTiff", this),
+                "GenerateTerrainDerivative failed: " + utils.ErrorMsg[utils.LastErrorCode]);
+            var slope = ReadGrid(slopeFilename);
+
+            for (var row = 0; row < numRows; row++)
+            {
+                for (var col = 0; col < numCols; col++)
+                {
+                    // Reference values as the former per-cell implementation of GenerateHillShade calculated them:
+                    double x = 0.0, y = 0.0;
+                    var valid = row > 0 && row < numRows - 1 && col > 0 && col < numCols - 1;
+                    if (valid)
+                    {
+                        var w = new double[9];
+                        for (var i = 0; i < 9; i++)
+                        {
+                            w[i] = dem[row - 1 + i / 3, col - 1 + i % 3];
+                            valid &= !w[i].Equals(nodata);
+                        }
+
+                        x = (w[0] + 2 * w[3] + w[6] - (w[2] + 2 * w[5] + w[8])) * 1.5 / (8.0 * cellSize);
+                        y = (w[6] + 2 * w[7] + w[8] - (w[0] + 2 * w[1] + w[2])) * 1.5 / (8.0 * -cellSize);
+                    }
+
+                    var slopeValue = 90.0 - Math.Atan(Math.Sqrt(x * x + y * y)) * 180.0 / Math.PI;
+                    var aspect = Math.Atan2(x, y);
+                    var cang = Math.Sin(45.0 * Math.PI / 180.0) * Math.Sin(slopeValue * Math.PI / 180.0) +
+                               Math.Cos(45.0 * Math.PI / 180.0) * Math.Cos(slopeValue * Math.PI / 180.0) *
+                               Math.Cos((315.0 - 90.0) * Math.PI / 180.0 - aspect);
+
+                    var expectedShade = valid && cang > 0.0 ? 255.0 * cang : 0.0;
+                    Assert.AreEqual(expectedShade, shade[row, col], 1.0, $"Wrong hillshade at row {row}, column {col}");
+
+                    var expectedSlope = valid ? 90.0 - slopeValue : nodata;
+                    Assert.AreEqual(expectedSlope, slope[row, col], 1e-3, $"Wrong slope at row {row}, column {col}");
+                }
+            }
+        }
+
         [TestMethod]
         public void FixUpShapes()
         {
@@ -136,6 +254,72 @@ namespace MapWinGISTests
             Console.WriteLine("Saved as " + newShapefileFile);
         }
 
+        [TestMethod]
+        public void ZonalStatisticsMatchCellsWithCentresWithin()
+        {
+            const int numCols = 100;
+            const int numRows = 80;
+            const double nodata = -9999.0;
+            var gridFilename = Path.Combine(Path.GetTempPath(), "ZonalGrid.tif");
+            var values = CreateGrid(gridFilename, numCols, numRows, 1.0, nodata,
+                (col, row) => (col * row) % 29 == 3 ? nodata : (7 * col + 3 * row) % 11);
+
+            // A fishnet with borders between the centres of cells, a triangle and a concave polygon:
+            var extents = new Extents();
+            extents.SetBounds(3.3, 2.7, 0.0, 93.3, 72.7, 0.0);
+            var sf = (Shapefile)Helper.CreateFishnet(extents, 17.9, 13.1);
+            foreach (var wkt in new[]
+            {
+                "POLYGON((10.2 5.3, 60.7 40.1, 20.4 75.9, 10.2 5.3))",
+                "POLYGON((50.3 10.3, 95.7 10.3, 95.7 60.1, 80.6 60.1, 80.6 25.2, 50.3 25.2, 50.3 10.3))"
+            })
+            {
+                var shp = new Shape();
+                Assert.IsTrue(shp.ImportFromWKT(wkt), "Cannot import polygon: " + shp.ErrorMsg[shp.LastErrorCode]);
+                Assert.IsTrue(sf.EditAddShape(shp) != -1, "Cannot add polygon: " + sf.ErrorMsg[sf.LastErrorCode]);
+            }
+
+            var grid = new Grid();
+            Assert.IsTrue(grid.Open(gridFilename, GridDataType.UnknownDataType, false),
+                "Cannot open grid: " + grid.ErrorMsg[grid.LastErrorCode]);
+
+            var utils = new Utils { GlobalCallback = this };
+            var retVal = utils.GridStatisticsToShapefile(grid, sf, false, true, true);
+            grid.Close();
+            Assert.IsTrue(retVal, "GridStatisticsToShapefile failed: " + utils.ErrorMsg[utils.LastErrorCode]);
+
+            for (var shapeIndex = 0; shapeIndex < sf.NumShapes; shapeIndex++)
+            {
+                var shp = sf.Shape[shapeIndex];
+                var cells = new List<double>();
+                for (var row = 0; row < numRows; row++)
+                {
+                    for (var col = 0; col < numCols; col++)
+                    {
+                        if (values[row, col].Equals(nodata)) continue;
+                        if (IsWithin(shp, 0.5 + col, 0.5 + numRows - 1 - row))
+                            cells.Add(values[row, col]);
+                    }
+                }
+
+                Assert.IsTrue(cells.Count > 0, $"No cells within polygon {shapeIndex}");
+                cells.Sort();
+                var mean = cells.Average();
+                var groups = cells.GroupBy(v => v).OrderByDescending(g => g.Count()).ThenBy(g => g.Key).ToList();
+                var message = $" of polygon {shapeIndex} is wrong";
+
+                Assert.AreEqual(cells.Count, Convert.ToInt32(sf.CellValue[sf.FieldIndexByName["Count"], shapeIndex]), "Count" + message);
+                Assert.AreEqual(groups.Count, Convert.ToInt32(sf.CellValue[sf.FieldIndexByName["Variety"], shapeIndex]), "Variety" + message);
+                Assert.AreEqual(cells.Sum(), GetDouble(sf, "Sum", shapeIndex), 1e-6, "Sum" + message);
+                Assert.AreEqual(mean, GetDouble(sf, "Mean", shapeIndex), 1e-6, "Mean" + message);
+                Assert.AreEqual(cells.First(), GetDouble(sf, "Minimum", shapeIndex), 1e-6, "Minimum" + message);
+                Assert.AreEqual(cells.Last(), GetDouble(sf, "Maximum", shapeIndex), 1e-6, "Maximum" + message);
+                Assert.AreEqual(Math.Sqrt(cells.Average(v => (v - mean) * (v - mean))), GetDouble(sf, "StD", shapeIndex), 1e-6, "StD" + message);
+                Assert.AreEqual(cells[cells.Count / 2], GetDouble(sf, "Median", shapeIndex), 1e-6, "Median" + message);
+                Assert.AreEqual(groups[0].Key, GetDouble(sf, "Majority", shapeIndex), 1e-6, "Majority" + message);
+            }
+        }
+
         [TestMethod]
         public void GdalInfoEcw()
         {
@@ -335,6 +519,90 @@ namespace MapWinGISTests
             Assert.AreEqual("Index Out of Bounds", errorMsg);
         }
 
+        /// <summary>
+        /// Creates a GeoTiff grid of floats with the lower left corner at the origin
+        /// </summary>
+        private static double[,] CreateGrid(string filename, int numCols, int numRows, double cellSize, double nodata,
+            Func<int, int, double> getValue)
+        {
+            Helper.DeleteFile(filename);
+
+            var header = new GridHeader
+            {
+                NumberCols = numCols,
+                NumberRows = numRows,
+                dX = cellSize,
+                dY = cellSize,
+                XllCenter = cellSize / 2.0,
+                YllCenter = cellSize / 2.0,
+                NodataValue = nodata
+            };
+
+            var grid = new Grid();
+            Assert.IsTrue(grid.CreateNew(filename, header, GridDataType.FloatDataType, nodata, true, GridFileType.GeoTiff),
+                "Cannot create grid: " + grid.ErrorMsg[grid.LastErrorCode]);
+
+            var values = new double[numRows, numCols];
+            for (var row = 0; row < numRows; row++)
+            {
+                for (var col = 0; col < numCols; col++)
+                {
+                    // stored as float, so the values are compared after the same rounding:
+                    values[row, col] = (float)getValue(col, row);
+                    grid.Value[col, row] = values[row, col];
+                }
+            }
+
+            Assert.IsTrue(grid.Save(), "Cannot save grid: " + grid.ErrorMsg[grid.LastErrorCode]);
+            grid.Close();
+            return values;
+        }
+
+        /// <summary>
+        /// Reads all values of the first band of a grid, indexed by row and column
+        /// </summary>
+        private static double[,] ReadGrid(string filename)
+        {
+            var grid = new Grid();
+            Assert.IsTrue(grid.Open(filename, GridDataType.UnknownDataType, true),
+                "Cannot open grid: " + grid.ErrorMsg[grid.LastErrorCode]);
+
+            var values = new double[grid.Header.NumberRows, grid.Header.NumberCols];
+            for (var row = 0; row < grid.Header.NumberRows; row++)
+            {
+                for (var col = 0; col < grid.Header.NumberCols; col++)
+                {
+                    values[row, col] = Convert.ToDouble(grid.Value[col, row]);
+                }
+            }
+
+            grid.Close();
+            return values;
+        }
+
+        /// <summary>
+        /// Even-odd rule over all the points of the shape
+        /// </summary>
+        private static bool IsWithin(IShape shp, double x, double y)
+        {
+            var within = false;
+            for (var i = 0; i < shp.numPoints - 1; i++)
+            {
+                var p1 = shp.Point[i];
+                var p2 = shp.Point[i + 1];
+                if (p1.y > y == p2.y > y) continue;
+                if (x < p1.x + (p2.x - p1.x) * (y - p1.y) / (p2.y - p1.y))
+                    within = !within;
+            }
+
+            return within;
+        }
+
+        private static double GetDouble(IShapefile sf, string fieldName, int shapeIndex)
+        {
+            return Convert.ToDouble(sf.CellValue[sf.FieldIndexByName[fieldName], shapeIndex]);
+        }
+
 
         public void Progress(string KeyOfSender, int Percent, string Message)
         {